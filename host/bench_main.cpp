@@ -0,0 +1,382 @@
+// Host microbenchmarks for the bulb controller's sample, serialize and format hot paths.
+// Runs the sketch against the simulated board (sine load on both relays, history log in its own
+// flash file) and reports ns/op, heap allocations/op and bytes/op for the formatters, the row
+// encoder, the sampling path, route lookup and /historicalData at several history depths and client counts.
+// Results can be saved as a baseline and compared against on the next run.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "HistoryBinaryDecoder.h"
+#include "HostHarness.h"
+#include "src/DateTime.h"
+#include "src/CurrentSampler.h"
+#include "src/Format.h"
+#include "src/HistoryJsonEncoder.h"
+#include "src/RouteTable.h"
+#include "src/WaveformCapture.h"
+
+// Sketch entry points and hot paths (main.cpp)
+void setup();
+void loop();
+void updateHistoricalData();
+extern HistoryRing<HISTORY_CAPACITY> history;
+extern const RouteTable routeTable;
+
+static const char *const benchFlashFile = "bulb_bench_flash.bin";
+static const size_t sampleBatch = 32; // sampleQueue capacity: one loop() drains a full batch
+
+struct BenchResult {
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+// Accumulates wall-clock time and heap activity over the timed regions of one benchmark
+struct BenchCounter {
+    uint64_t ns = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    uint64_t ops = 0;
+
+    template <typename Fn>
+    void time(Fn fn) {
+        const size_t allocsBefore = hostAllocationCount();
+        const size_t bytesBefore = hostAllocatedBytes();
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        allocations += hostAllocationCount() - allocsBefore;
+        bytes += hostAllocatedBytes() - bytesBefore;
+    }
+
+    BenchResult result() const {
+        return {static_cast<double>(ns) / ops, static_cast<double>(allocations) / ops, static_cast<double>(bytes) / ops};
+    }
+};
+
+// Results in run order, and the baseline they are compared against
+static std::vector<std::pair<std::string, BenchResult>> results;
+static std::map<std::string, BenchResult> baseline;
+static size_t heapChanges = 0; // Results whose heap figures differ from the baseline (or that it lacks)
+
+static void report(const std::string &name, const BenchResult &result) {
+    results.emplace_back(name, result);
+    printf("%-46s %10.1f %10.2f %10.1f", name.c_str(), result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+    auto previous = baseline.find(name);
+    if (previous != baseline.end()) {
+        const BenchResult &before = previous->second;
+        printf(" %+8.1f%%", before.nsPerOp > 0 ? 100.0 * (result.nsPerOp - before.nsPerOp) / before.nsPerOp : 0.0);
+        // Allocation counts are deterministic: any change is a real change, not noise
+        if (result.allocsPerOp != before.allocsPerOp || result.bytesPerOp != before.bytesPerOp) {
+            printf("  heap was %.2f allocs, %.1f bytes", before.allocsPerOp, before.bytesPerOp);
+            heapChanges++;
+        }
+    } else if (!baseline.empty()) {
+        printf("  not in baseline");
+        heapChanges++;
+    }
+    printf("\n");
+}
+
+// Baseline file: one "name ns/op allocs/op bytes/op" line per benchmark, '#' starts a comment
+static bool loadBaseline(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char name[128];
+        BenchResult result;
+        if (line[0] != '#' &&
+            sscanf(line, "%127s %lf %lf %lf", name, &result.nsPerOp, &result.allocsPerOp, &result.bytesPerOp) == 4) {
+            baseline[name] = result;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static bool saveResults(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "# bulb_bench results: name ns/op allocs/op bytes/op\n");
+    for (const auto &entry : results) {
+        fprintf(file, "%s %.1f %.2f %.1f\n", entry.first.c_str(), entry.second.nsPerOp, entry.second.allocsPerOp,
+                entry.second.bytesPerOp);
+    }
+    return fclose(file) == 0;
+}
+
+// Keeps benchmarked results observable so the calls are not optimized away
+static volatile size_t sink;
+
+// Inputs cycled through by the formatter benchmarks: idle, one bulb, both bulbs, sensor maximum
+static const HistoryRecord sampleRecords[] = {
+    {1730419200, 0, 0, 0},
+    {1730449815, 5946, 2703, 0x1},
+    {1730480430, 11877, 5399, 0x3},
+    {1730511045, 1441770, 65535, 0x3},
+};
+static const size_t sampleRecordCount = sizeof(sampleRecords) / sizeof(sampleRecords[0]);
+
+template <typename Fn>
+static void benchLoop(const char *name, uint64_t iterations, Fn fn) {
+    BenchCounter counter;
+    counter.time([&] {
+        for (uint64_t i = 0; i < iterations; i++) {
+            fn(sampleRecords[i % sampleRecordCount], static_cast<uint32_t>(i));
+        }
+    });
+    counter.ops = iterations;
+    report(name, counter.result());
+}
+
+static void benchFormatters(uint64_t iterations) {
+    benchLoop("format/current", iterations, [](const HistoryRecord &record, uint32_t) {
+        char out[16];
+        sink = formatFixed(out, record.currentTenthMilliAmps, 4);
+    });
+    benchLoop("format/power", iterations, [](const HistoryRecord &record, uint32_t) {
+        char out[16];
+        sink = formatFixed(out, record.powerCentiWatts, 2);
+    });
+    benchLoop("format/dateTime", iterations, [](const HistoryRecord &record, uint32_t) {
+        char date[11];
+        char time[9];
+        formatDate(record.timestamp, date);
+        formatTime(record.timestamp, time);
+        sink = date[9] + time[7];
+    });
+    benchLoop("serialize/historyRow", iterations, [](const HistoryRecord &record, uint32_t sequence) {
+        char out[historyRowJsonMax];
+        sink = encodeHistoryRow(out, record, sequence);
+    });
+}
+
+// Take samples the way the control task does, then let loop() move them into the ring, the flash
+// log and the rollups; each side is timed on its own, per sample
+static void addSamples(size_t count, BenchCounter *sample, BenchCounter *ingest) {
+    while (count > 0) {
+        const size_t batch = count < sampleBatch ? count : sampleBatch;
+        for (size_t i = 0; i < batch; i++) {
+            if (sample != nullptr) {
+                sample->time([] { updateHistoricalData(); });
+            } else {
+                updateHistoricalData();
+            }
+        }
+        if (ingest != nullptr) {
+            ingest->time([] { loop(); });
+        } else {
+            loop();
+        }
+        count -= batch;
+    }
+}
+
+static void benchSampling(size_t samples) {
+    BenchCounter sample;
+    BenchCounter ingest;
+    addSamples(samples, &sample, &ingest);
+    sample.ops = samples;
+    ingest.ops = samples;
+    report("sample/updateHistoricalData", sample.result());
+    report("sample/ingest", ingest.result());
+}
+
+// Per ADC reading in the sampler's timer: the RMS accumulator, and the capture's idle path (pre-trigger
+// ring and threshold compare) on a quiet 0.27 A sine that never triggers
+static CurrentSampler benchSampler(34, CURRENT_SAMPLE_RATE_HZ, CURRENT_WINDOW_MS);
+static WaveformCapture benchCapture;
+
+static void benchReadings(uint64_t iterations) {
+    uint16_t readings[40]; // One 50 Hz cycle at 2 kHz
+    for (size_t i = 0; i < 40; i++) {
+        readings[i] = static_cast<uint16_t>(2048 + lroundf(87.7f * sinf(2 * 3.14159265f * i / 40)));
+    }
+    benchCapture.begin(2048, 574);
+    benchLoop("sample/rmsReading", iterations, [&](const HistoryRecord &, uint32_t i) {
+        benchSampler.addSample(readings[i % 40]);
+    });
+    benchLoop("sample/captureIdle", iterations, [&](const HistoryRecord &, uint32_t i) {
+        benchCapture.add(readings[i % 40]);
+    });
+    sink = benchCapture.captured(WaveformCapture::TriggerThreshold) + benchSampler.windowCount();
+}
+
+// The sketch's route table: an exact path, the longest and the shortest prefix route, and a miss
+static void benchRouteLookup(uint64_t iterations) {
+    static const char *const paths[] = {"/historicalData", "/toggleBulb2", "/rollups/hour", "/nowhere"};
+    benchLoop("route/find", iterations, [](const HistoryRecord &, uint32_t i) {
+        sink = routeTable.find(HttpGet, paths[i % 4]);
+    });
+}
+
+// Serve GET uri to each of clients connections at once, rounds times, checking every body with valid.
+// Only loop() is timed: the loopback client's parsing stays outside the measurement. One op is one
+// complete response.
+static bool benchRoute(const std::string &name, const std::string &uri, int clients, size_t rounds,
+                       const std::function<bool(const std::string &body)> &valid) {
+    BenchCounter counter;
+    for (size_t round = 0; round <= rounds; round++) {
+        const bool timed = round > 0; // Round 0 warms up and opens the connections
+        for (int c = 0; c < clients; c++) {
+            hostHttpSubmit("GET", uri.c_str(), {}, HTTP_SERVER_PORT, c);
+        }
+        int outstanding = clients;
+        for (size_t spins = 0; outstanding > 0; spins++) {
+            if (spins > 1000000) {
+                fprintf(stderr, "%s: responses never completed\n", uri.c_str());
+                return false;
+            }
+            if (timed) {
+                counter.time([] { loop(); });
+            } else {
+                loop();
+            }
+            for (int c = 0; c < clients; c++) {
+                HostHttpResponse response;
+                while (hostHttpTakeResponse(response, HTTP_SERVER_PORT, c)) {
+                    if (response.code != 200 || !valid(response.body)) {
+                        fprintf(stderr, "%s: unexpected response %d\n", uri.c_str(), response.code);
+                        return false;
+                    }
+                    outstanding--;
+                }
+            }
+        }
+    }
+    counter.ops = rounds * clients;
+    report(name, counter.result());
+    return true;
+}
+
+// The newest depth rows as JSON (/historicalData?limit=)
+static bool benchHistoricalData(size_t depth, int clients, size_t rounds) {
+    const std::string marker = "\"seq\":" + std::to_string(history.lastSequence() - depth + 1) + ",";
+    return benchRoute("serialize/historicalData/depth=" + std::to_string(depth) + "/clients=" + std::to_string(clients),
+                      "/historicalData?limit=" + std::to_string(depth), clients, rounds,
+                      [&](const std::string &body) { return body.find(marker) != std::string::npos; });
+}
+
+// The newest depth rows in the binary export (/historicalData.bin?since=)
+static bool benchHistoricalDataBinary(size_t depth, const char *encoding, size_t rounds) {
+    const uint32_t since = history.lastSequence() - depth;
+    return benchRoute(std::string("serialize/historicalData.bin/") + encoding + "/depth=" + std::to_string(depth),
+                      "/historicalData.bin?encoding=" + std::string(encoding) + "&since=" + std::to_string(since), 1,
+                      rounds, [&](const std::string &body) {
+                          HistoryBinHeader header;
+                          std::vector<HistoryBinRow> rows;
+                          return decodeHistoryBinary(body.data(), body.size(), header, rows) && rows.size() == depth &&
+                                 rows[0].sequence == since + 1;
+                      });
+}
+
+int main(int argc, char **argv) {
+    const char *savePath = nullptr;
+    const char *baselinePath = nullptr;
+    const char *flashFile = benchFlashFile;
+    bool quick = false;
+    bool check = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--flash") == 0 && i + 1 < argc) {
+            flashFile = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else {
+            fprintf(stderr, "usage: %s [--baseline FILE] [--save FILE] [--flash FILE] [--quick] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (baselinePath != nullptr && !loadBaseline(baselinePath)) {
+        fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+        return 2;
+    }
+    if (check && baseline.empty()) {
+        fprintf(stderr, "--check needs a --baseline to check against\n");
+        return 2;
+    }
+
+    // Start from an empty history log so every run sees the same depths
+    remove(flashFile);
+    if (!hostFlashOpen(flashFile)) {
+        fprintf(stderr, "cannot open flash file %s\n", flashFile);
+        return 2;
+    }
+    hostSetSerialEcho(false);
+    hostSetCurrentWaveform([](double seconds) {
+        const int bulbsOn = hostPinLevel(33) + hostPinLevel(25);
+        return bulbsOn * hostSineWaveform(0.27f)(seconds);
+    });
+    setup();
+
+    // Both bulbs on, and long enough for the sampler to settle on their RMS current
+    hostHttpSubmit("GET", "/turnOnAll");
+    for (int i = 0; i < 2000; i++) {
+        loop();
+        hostClockAdvance(1000);
+    }
+    HostHttpResponse response;
+    while (hostHttpTakeResponse(response)) {
+    }
+
+    printf("%-46s %10s %10s %10s %9s\n", "benchmark", "ns/op", "allocs/op", "bytes/op", "vs base");
+    benchFormatters(quick ? 100000 : 2000000);
+    benchSampling(quick ? 256 : 4096);
+    benchReadings(quick ? 100000 : 10000000);
+    benchRouteLookup(quick ? 100000 : 2000000);
+
+    // The clock stays put from here on: no samples or timeouts fire while responses stream
+    const size_t depths[] = {10, 100, 1000, HISTORY_CAPACITY};
+    const int clientCounts[] = {1, 2, 4};
+    for (size_t depth : depths) {
+        if (history.size() < depth) {
+            addSamples(depth - history.size(), nullptr, nullptr);
+        }
+        for (int clients : clientCounts) {
+            size_t rounds = (quick ? 2000 : 100000) / (depth * clients);
+            if (rounds < 2) {
+                rounds = 2;
+            }
+            if (!benchHistoricalData(depth, clients, rounds)) {
+                return 1;
+            }
+        }
+        size_t binaryRounds = (quick ? 2000 : 100000) / depth;
+        if (binaryRounds < 2) {
+            binaryRounds = 2;
+        }
+        if (!benchHistoricalDataBinary(depth, "raw", binaryRounds) || !benchHistoricalDataBinary(depth, "delta", binaryRounds)) {
+            return 1;
+        }
+    }
+
+    if (savePath != nullptr && !saveResults(savePath)) {
+        fprintf(stderr, "cannot write %s\n", savePath);
+        return 2;
+    }
+    // Timings vary from run to run and machine to machine; heap figures do not, so they alone can fail
+    if (check && heapChanges > 0) {
+        fprintf(stderr, "%zu results allocate differently from the baseline\n", heapChanges);
+        return 1;
+    }
+    return 0;
+}
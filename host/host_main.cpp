@@ -0,0 +1,280 @@
+// Host simulator for the bulb controller sketch.
+// Runs setup()/loop() against the simulated board with a fake clock, scripts the current
+// waveform from the relay pins, drives the web routes over a loopback connection the way
+// the page does and reports loop/handler latency and heap activity.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "HostHarness.h"
+#include "src/HistoryJsonEncoder.h"
+
+// Sketch entry points and hot paths (main.cpp)
+void setup();
+void loop();
+void updateHistoricalData();
+extern HistoryRing<HISTORY_CAPACITY> history;
+extern uint64_t loopIdleMicros;
+extern uint32_t loopWakeups[3];
+extern uint16_t savedRelayMask;
+extern std::atomic<uint16_t> sensorZero;
+extern bool calibrationCached;
+extern uint32_t calibrationChecks;
+
+// Newest-first reader over the sketch's ring, for timing the encoder on its own
+static bool readHistoryRow(void *, size_t index, HistoryRecord &record, uint32_t &sequence) {
+    if (index >= history.size()) {
+        return false;
+    }
+    record = history.newest(index);
+    sequence = history.lastSequence() - index;
+    return true;
+}
+
+// Encode one /historicalData page of rows through a fixed buffer, as the server does
+static size_t encodeHistoryPage() {
+    HistoryJsonEncoder encoder;
+    encoder.begin(readHistoryRow, nullptr, history.size() < 10 ? history.size() : 10, history.lastSequence());
+    char chunk[1024];
+    size_t total = 0;
+    size_t length;
+    while ((length = encoder.read(chunk, sizeof(chunk))) > 0) {
+        total += length;
+    }
+    return total;
+}
+
+struct LatencyStats {
+    std::vector<uint64_t> samples; // Wall-clock nanoseconds
+    size_t allocations = 0;
+    size_t bytes = 0;
+
+    void add(uint64_t ns, size_t allocs, size_t allocBytes) {
+        samples.push_back(ns);
+        allocations += allocs;
+        bytes += allocBytes;
+    }
+};
+
+static uint64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void printStats(const char *name, LatencyStats &stats) {
+    if (stats.samples.empty()) {
+        printf("%-28s %8s\n", name, "-");
+        return;
+    }
+    std::vector<uint64_t> &s = stats.samples;
+    std::sort(s.begin(), s.end());
+    uint64_t total = 0;
+    for (uint64_t ns : s) {
+        total += ns;
+    }
+    const size_t n = s.size();
+    printf("%-28s %8zu %10.0f %10llu %10llu %10llu %9.1f %10.0f\n", name, n, static_cast<double>(total) / n,
+           static_cast<unsigned long long>(s[n / 2]), static_cast<unsigned long long>(s[(n * 99) / 100]),
+           static_cast<unsigned long long>(s[n - 1]), static_cast<double>(stats.allocations) / n,
+           static_cast<double>(stats.bytes) / n);
+}
+
+// Time one call and attribute its heap activity
+template <typename Fn>
+static void measure(LatencyStats &stats, Fn fn) {
+    const size_t allocsBefore = hostAllocationCount();
+    const size_t bytesBefore = hostAllocatedBytes();
+    const uint64_t start = nowNanos();
+    fn();
+    const uint64_t elapsed = nowNanos() - start;
+    stats.add(elapsed, hostAllocationCount() - allocsBefore, hostAllocatedBytes() - bytesBefore);
+}
+
+struct ScriptedRequest {
+    uint32_t atMillis;
+    const char *uri;
+};
+
+int main(int argc, char **argv) {
+    uint32_t simulatedSeconds = 120;
+    bool echoSerial = false;
+    const char *flashFile = HOST_FLASH_FILE;
+    const char *settingsFile = HOST_SETTINGS_FILE;
+    float overloadAmps = 0.0f;   // --overload: extra RMS current through the closed relays...
+    double overloadSeconds = 0;  // ...from this simulated time on
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            simulatedSeconds = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--serial") == 0) {
+            echoSerial = true;
+        } else if (strcmp(argv[i], "--flash") == 0 && i + 1 < argc) {
+            flashFile = argv[++i];
+        } else if (strcmp(argv[i], "--settings") == 0 && i + 1 < argc) {
+            settingsFile = argv[++i];
+        } else if (strcmp(argv[i], "--overload") == 0 && i + 1 < argc &&
+                   sscanf(argv[++i], "%f@%lf", &overloadAmps, &overloadSeconds) == 2) {
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--serial] [--flash FILE] [--settings FILE] [--overload AMPS@SECONDS]\n", argv[0]);
+            return 2;
+        }
+    }
+    hostSetSerialEcho(echoSerial);
+    if (!hostFlashOpen(flashFile)) {
+        fprintf(stderr, "cannot open flash file %s\n", flashFile);
+        return 2;
+    }
+    if (!hostSettingsOpen(settingsFile)) {
+        fprintf(stderr, "cannot open settings file %s\n", settingsFile);
+        return 2;
+    }
+
+    // Each closed relay draws a 0.27 A (about 60 W at 220 V) resistive load. An --overload adds its
+    // current while any relay is closed, until the overcurrent trip opens them; the waveform sees the
+    // first reading of it and the first one after the relays opened.
+    double overloadStarted = -1;
+    double overloadCleared = -1;
+    const HostWaveform overload = hostSineWaveform(overloadAmps);
+    hostSetCurrentWaveform([&](double seconds) {
+        const int bulbsOn = hostPinLevel(33) + hostPinLevel(25);
+        double amps = bulbsOn * hostSineWaveform(0.27f)(seconds);
+        if (overloadAmps > 0 && seconds >= overloadSeconds) {
+            if (bulbsOn > 0 && overloadCleared < 0) {
+                if (overloadStarted < 0) {
+                    overloadStarted = seconds;
+                }
+                amps += overload(seconds);
+            } else if (bulbsOn == 0 && overloadStarted >= 0 && overloadCleared < 0) {
+                overloadCleared = seconds;
+            }
+        }
+        return amps;
+    });
+
+    const ScriptedRequest script[] = {
+        {500, "/"},
+        {600, "/timeInit?date=2024-11-01&time=08:30:00"},
+        {2000, "/turnOnAll"},
+        {20000, "/toggleBulb1"},
+        {40000, "/toggleBulb2"},
+        {50000, "/schedule?value=30"},
+        {90000, "/toggleBulb2"},
+    };
+    size_t nextScripted = 0;
+    const uint32_t pollPeriodMillis = 5000; // Same cadence as the web page
+    uint32_t nextPoll = 1000;
+    unsigned long lastSeq = 0; // Poll state, kept like the page does
+    std::string historyETag;
+
+    std::map<std::string, LatencyStats> routeStats;
+    LatencyStats loopStats;
+    LatencyStats setupStats;
+
+    measure(setupStats, [] { setup(); });
+
+    // loop() sleeps until its next deadline or event, as on the device; the harness's own requests
+    // arrive as input at their scripted times
+    hostSetTickless(true);
+    const uint64_t startMicros = hostClockMicros();
+    const uint64_t startIdleMicros = loopIdleMicros;
+    const uint64_t endMicros = startMicros + static_cast<uint64_t>(simulatedSeconds) * 1000000;
+    while (hostClockMicros() < endMicros) {
+        std::string submitted;
+        std::vector<std::pair<std::string, std::string>> headers;
+        const uint32_t now = millis();
+        if (nextScripted < sizeof(script) / sizeof(script[0]) && now >= script[nextScripted].atMillis) {
+            submitted = script[nextScripted++].uri;
+        } else if (now >= nextPoll) {
+            submitted = "/historicalData?since=" + std::to_string(lastSeq) + "&limit=10";
+            if (!historyETag.empty()) {
+                headers.emplace_back("If-None-Match", historyETag);
+            }
+            nextPoll += pollPeriodMillis;
+        }
+        if (!submitted.empty()) {
+            hostHttpSubmit("GET", submitted.c_str(), headers);
+        }
+        uint64_t nextInput = static_cast<uint64_t>(nextPoll) * 1000;
+        if (nextScripted < sizeof(script) / sizeof(script[0])) {
+            nextInput = std::min(nextInput, static_cast<uint64_t>(script[nextScripted].atMillis) * 1000);
+        }
+        hostSetNextInput(std::min(nextInput, endMicros));
+
+        // Timed without the idle wait at its end, where the simulated control task and sampler run
+        LatencyStats iteration;
+        const uint64_t idleBefore = hostIdleWallNanos();
+        measure(iteration, [] { loop(); });
+        iteration.samples[0] -= hostIdleWallNanos() - idleBefore;
+        loopStats.add(iteration.samples[0], iteration.allocations, iteration.bytes);
+
+        HostHttpResponse response;
+        while (hostHttpTakeResponse(response)) {
+            std::string route = submitted.substr(0, submitted.find('?'));
+            if (route == "/historicalData") {
+                for (const auto &header : response.headers) {
+                    if (header.first == "ETag") {
+                        historyETag = header.second;
+                    }
+                }
+                const size_t seqAt = response.body.find("\"lastSeq\":");
+                if (seqAt != std::string::npos) {
+                    lastSeq = strtoul(response.body.c_str() + seqAt + 10, nullptr, 10);
+                }
+                route += response.code == 304 ? " (304)" : " (200)";
+            }
+            routeStats[route].add(iteration.samples[0], iteration.allocations, iteration.bytes);
+        }
+    }
+    hostSetTickless(false);
+
+    // Direct calls into the periodic hot paths
+    LatencyStats updateStats;
+    LatencyStats encodeStats;
+    for (int i = 0; i < 200; i++) {
+        measure(updateStats, [] { updateHistoricalData(); });
+        measure(encodeStats, [] { encodeHistoryPage(); });
+    }
+
+    const HostFlashStats flash = hostFlashStats();
+    printf("simulated %u s, serial bytes %zu\n", simulatedSeconds, Serial.bytesWritten());
+    printf("loop(): %u wakeups (%u deadline, %u socket, %u control task), idle %.2f%% of simulated time\n",
+           loopWakeups[0] + loopWakeups[1] + loopWakeups[2], loopWakeups[0], loopWakeups[1], loopWakeups[2],
+           100.0 * (loopIdleMicros - startIdleMicros) / (hostClockMicros() - startMicros));
+    printf("settings: relays %u stored, sensor zero %u (%s at boot), %u background re-checks\n", savedRelayMask,
+           sensorZero.load(), calibrationCached ? "stored" : "measured", calibrationChecks);
+    printf("flash: %llu bytes written, %u sector erases, %u erases on the most-worn sector\n",
+           (unsigned long long)flash.bytesWritten, flash.sectorsErased, flash.maxSectorErases);
+    printf("%-28s %8s %10s %10s %10s %10s %9s %10s\n", "probe", "calls", "mean ns", "p50 ns", "p99 ns", "max ns", "allocs", "bytes");
+    printStats("setup()", setupStats);
+    printStats("loop()", loopStats);
+    printStats("updateHistoricalData()", updateStats);
+    printStats("encode 10 history rows", encodeStats);
+    for (auto &entry : routeStats) {
+        printStats(("GET " + entry.first).c_str(), entry.second);
+    }
+
+    if (overloadAmps > 0) {
+        if (overloadStarted < 0) {
+            printf("overload: no relay was closed after %.3f s\n", overloadSeconds);
+        } else if (overloadCleared < 0) {
+            printf("overload: %.2f A from %.6f s, not cleared\n", overloadAmps, overloadStarted);
+        } else {
+            printf("overload: %.2f A from %.6f s, relays open after %.0f us\n", overloadAmps, overloadStarted,
+                   (overloadCleared - overloadStarted) * 1e6);
+        }
+        hostHttpSubmit("GET", "/faults");
+        loop();
+        HostHttpResponse response;
+        while (hostHttpTakeResponse(response)) {
+            printf("/faults: %s\n", response.body.c_str());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host (Linux) stand-in for the ACS712 current sensor library.
+// Same algorithms as the device library; samples come from analogRead(), which the
+// harness feeds from a scripted waveform, and each read advances the fake clock.
+
+#include "Arduino.h"
+
+#define ADC_SCALE 4095.0
+#define VREF 3.3
+#define DEFAULT_FREQUENCY 50
+
+enum ACS712_type { ACS712_05B, ACS712_20A, ACS712_30A };
+
+class ACS712 {
+public:
+    ACS712(ACS712_type type, uint8_t pin);
+
+    int calibrate();
+    void setZeroPoint(int zeroPoint) { zero = zeroPoint; }
+    void setSensitivity(float sens) { sensitivity = sens; }
+    float getCurrentDC();
+    float getCurrentAC(uint16_t frequency = DEFAULT_FREQUENCY);
+
+private:
+    int zero = 2048;
+    float sensitivity;
+    uint8_t pin;
+};
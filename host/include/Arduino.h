@@ -0,0 +1,38 @@
+#pragma once
+
+// Host (Linux) stand-in for the Arduino-ESP32 core.
+// Time, GPIO and ADC are backed by the simulated board in HostHarness.h so the sketch
+// can run unchanged off-device with a fake clock and a scripted current waveform.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WString.h"
+#include "HardwareSerial.h"
+
+#define PROGMEM
+#define PGM_P const char *
+
+#define LOW    0x0
+#define HIGH   0x1
+#define INPUT  0x01
+#define OUTPUT 0x03
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+uint32_t esp_random(); // Deterministic on the host so runs are repeatable
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
@@ -0,0 +1,19 @@
+#pragma once
+
+// Host (Linux) stand-in for the ESP32 mDNS responder.
+
+#include "Arduino.h"
+
+class MDNSResponder {
+public:
+    bool begin(const char *hostName) {
+        name = hostName ? hostName : "";
+        return true;
+    }
+    void end() { name = ""; }
+
+private:
+    String name;
+};
+
+extern MDNSResponder MDNS;
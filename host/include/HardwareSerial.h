@@ -0,0 +1,39 @@
+#pragma once
+
+// Host (Linux) stand-in for the ESP32 UART. Output goes to stdout when echo is enabled
+// (see hostSetSerialEcho) and is always counted so the harness can report log volume.
+// Tests may capture it and limit how much the transmit buffer takes (hostSetSerialCapture, hostSetSerialRoom).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WString.h"
+
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) { baudRate = baud; }
+    int availableForWrite();
+
+    size_t write(const uint8_t *data, size_t size);
+    size_t print(const char *text);
+    size_t print(const String &text) { return print(text.c_str()); }
+    size_t print(char c);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    size_t println(double value, int digits) { size_t n = print(value, digits); return n + println(); }
+    template <typename T>
+    size_t println(const T &value) { size_t n = print(value); return n + println(); }
+
+    size_t bytesWritten() const { return totalBytes; } // Host-only counter for the harness
+
+private:
+    unsigned long baudRate = 0;
+    size_t totalBytes = 0;
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,64 @@
+#pragma once
+
+// Host-side decoder for the /historicalData.bin layout (src/HistoryBinary.h), for collectors and tools.
+// Plain C++17; it does not depend on the simulated board.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "HistoryBinary.h"
+
+struct HistoryBinHeader {
+    uint8_t version = 0;
+    HistoryBinEncoding encoding = HistoryBinRaw;
+    uint8_t rowBytes = 0;
+    uint8_t currentDecimals = 0;
+    uint8_t powerDecimals = 0;
+    uint32_t newestSequence = 0; // Newest row held on the device when the response started
+    uint32_t from = 0;           // Requested timestamp range
+    uint32_t to = 0;
+};
+
+struct HistoryBinRow {
+    uint32_t sequence;
+    HistoryRecord record;
+};
+
+// Incremental decoder: feed body bytes as they arrive and take rows as they complete.
+class HistoryBinaryDecoder {
+public:
+    // Append body bytes; false once the stream is malformed (error() says why)
+    bool feed(const void *data, size_t length);
+
+    // Call at the end of the body; false if it is malformed or stops part way through a row
+    bool finish();
+
+    bool headerReady() const { return haveHeader; }
+    const HistoryBinHeader &header() const { return decodedHeader; }
+
+    // Next decoded row, oldest first; false when none is waiting
+    bool next(HistoryBinRow &row);
+
+    const std::string &error() const { return failure; }
+
+private:
+    bool decodeHeader();
+    bool decodeRow(const uint8_t *in, size_t available, size_t &consumed); // false if incomplete or malformed
+    bool fail(const std::string &message);
+
+    std::vector<uint8_t> pending; // Bytes not decoded yet
+    std::vector<HistoryBinRow> rows;
+    size_t nextRow = 0;
+    HistoryBinHeader decodedHeader;
+    bool haveHeader = false;
+    bool havePrevious = false;
+    HistoryBinRow previous = {};
+    std::string failure;
+};
+
+// Decode a whole body at once
+bool decodeHistoryBinary(const void *data, size_t length, HistoryBinHeader &header, std::vector<HistoryBinRow> &rows,
+                         std::string *error = nullptr);
@@ -0,0 +1,97 @@
+#pragma once
+
+// Control surface of the simulated board used by host builds.
+// The sketch never includes this header; host drivers (simulator, benchmarks) use it to
+// drive the fake clock, script the current-sensor waveform and talk to the web server over loopback.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Config.h"
+
+// Fake clock. millis()/micros() only move when the harness (or a blocking call such as
+// delay() or analogRead()) advances it, so runs are repeatable. Periodic hal:: timers fire
+// in time order while the clock advances past their deadlines.
+uint64_t hostClockMicros();
+void hostClockAdvance(uint64_t micros);
+void hostClockReset();
+
+// Tickless loop(): once enabled, the sketch's idle wait (hal::waitForEvent) advances the fake clock to
+// its own deadline, to the harness's next input (hostSetNextInput, as if a request arrived then) or to
+// the first hal::wakeLoop() from a timer, whichever comes first. Off by default: the wait returns at
+// once and the harness moves the clock. hostIdleWallNanos() is the real time spent in those waits
+// (running timers), for taking it out of loop() timings.
+void hostSetTickless(bool enabled);
+void hostSetNextInput(uint64_t atMicros);
+uint64_t hostIdleWallNanos();
+
+// Scripted current waveform: instantaneous current in amps as a function of time in seconds.
+// analogRead() on the current sensor pin converts it to raw ACS712 ADC counts.
+typedef std::function<float(double seconds)> HostWaveform;
+void hostSetCurrentWaveform(HostWaveform waveform);
+HostWaveform hostSineWaveform(float rmsAmps, float frequencyHz = 50.0f);
+void hostSetAdcConversionMicros(uint32_t micros); // Simulated cost of one analogRead()
+
+const uint8_t hostCurrentSensorPin = 35;      // ADC pin wired to the ACS712 output
+const float hostAdcZeroCounts = 2048.0f;      // ADC reading at 0 A (VCC / 2)
+const float hostAdcCountsPerAmp = 0.185f * 4095.0f / 3.3f; // ACS712-05B: 185 mV/A on a 12-bit, 3.3 V ADC
+
+// GPIO and serial observation
+int hostPinLevel(uint8_t pin);
+void hostSetSerialEcho(bool enabled);
+void hostSetSerialCapture(std::string *capture); // Append Serial output to *capture (nullptr stops)
+void hostSetSerialRoom(int bytes);               // Bytes the UART takes until set again; -1 is unlimited
+
+// Flash stand-in for the history log: the hal:: flash region is a file (created erased), so a log
+// written by one run is recovered by the next. Without hostFlashOpen() the first flash access opens
+// HOST_FLASH_FILE in the working directory. hostFlashCutPower(n) lets only the next n bytes of writes
+// through and drops everything after them, erases included, like a brown-out in the middle of a write.
+#ifndef HOST_FLASH_FILE
+#define HOST_FLASH_FILE "bulb_flash.bin"
+#endif
+struct HostFlashStats {
+    uint64_t bytesWritten;    // Bytes programmed since the file was opened
+    uint32_t sectorsErased;   // Sector erases since the file was opened
+    uint32_t maxSectorErases; // Erases of the most-erased sector (wear)
+};
+bool hostFlashOpen(const char *path, size_t bytes = HISTORY_LOG_BYTES);
+void hostFlashCutPower(size_t bytesBeforeCut);
+void hostFlashRestorePower();
+HostFlashStats hostFlashStats();
+
+// Settings stand-in for NVS (hal::settingsRead/Write). Without hostSettingsOpen() they live in memory
+// for the run; with it they are kept in the file, so one run can boot from what the previous one stored.
+#ifndef HOST_SETTINGS_FILE
+#define HOST_SETTINGS_FILE "bulb_settings.bin"
+#endif
+bool hostSettingsOpen(const char *path);
+void hostSettingsClear(); // Like a fresh NVS partition
+
+// Loopback HTTP client for the sketch's server (HTTP_SERVER_PORT, 8080 in the host build).
+// Each port and connection number (0, 1, ... for several concurrent clients) gets one keep-alive
+// connection: requests are written immediately (and may be pipelined), responses are parsed as
+// they arrive while the sketch's loop() runs.
+struct HostHttpResponse {
+    int code = 0;
+    std::string contentType;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body; // Chunked bodies are already decoded
+};
+
+void hostHttpSubmit(const char *method, const char *uri,
+                    const std::vector<std::pair<std::string, std::string>> &headers = {}, int port = HTTP_SERVER_PORT,
+                    int connection = 0);
+void hostHttpPost(const char *uri, const std::string &body, const char *contentType = "text/plain",
+                  int port = HTTP_SERVER_PORT, int connection = 0); // POST with a body
+bool hostHttpTakeResponse(HostHttpResponse &response, int port = HTTP_SERVER_PORT, int connection = 0); // False until one has fully arrived
+size_t hostHttpPending(int port = HTTP_SERVER_PORT, int connection = 0); // Submitted requests whose response has not been taken
+
+// Heap accounting: operator new is replaced in host builds so every allocation made by the sketch or
+// the host core is counted. Read the counters before and after a call to attribute its allocations.
+size_t hostAllocationCount();
+size_t hostAllocatedBytes();
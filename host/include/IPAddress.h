@@ -0,0 +1,26 @@
+#pragma once
+
+// Host (Linux) stand-in for the Arduino IPAddress class.
+
+#include <stdint.h>
+
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress() : octets{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return octets[index]; }
+    bool operator==(const IPAddress &rhs) const {
+        return octets[0] == rhs.octets[0] && octets[1] == rhs.octets[1] &&
+               octets[2] == rhs.octets[2] && octets[3] == rhs.octets[3];
+    }
+
+    String toString() const {
+        return String(octets[0]) + "." + String(octets[1]) + "." + String(octets[2]) + "." + String(octets[3]);
+    }
+
+private:
+    uint8_t octets[4];
+};
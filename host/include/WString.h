@@ -0,0 +1,55 @@
+#pragma once
+
+// Host (Linux) stand-in for the Arduino core String class.
+// Implements the subset of the WString API used by the sketch, backed by std::string.
+
+#include <cstddef>
+#include <string>
+
+class String {
+public:
+    String() = default;
+    String(const char *cstr) : buffer(cstr ? cstr : "") {}
+    String(const std::string &str) : buffer(str) {}
+    explicit String(char c) : buffer(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    const char *c_str() const { return buffer.c_str(); }
+    unsigned int length() const { return static_cast<unsigned int>(buffer.size()); }
+    bool isEmpty() const { return buffer.empty(); }
+    char operator[](unsigned int index) const { return index < buffer.size() ? buffer[index] : 0; }
+
+    String &operator+=(const String &rhs) { buffer += rhs.buffer; return *this; }
+    String &operator+=(const char *rhs) { buffer += rhs ? rhs : ""; return *this; }
+    String &operator+=(char c) { buffer += c; return *this; }
+    bool concat(const char *cstr, unsigned int len) { buffer.append(cstr, len); return true; }
+
+    bool operator==(const String &rhs) const { return buffer == rhs.buffer; }
+    bool operator==(const char *rhs) const { return buffer == (rhs ? rhs : ""); }
+    bool operator!=(const String &rhs) const { return !(*this == rhs); }
+    bool operator!=(const char *rhs) const { return !(*this == rhs); }
+    bool operator<(const String &rhs) const { return buffer < rhs.buffer; }
+
+    int indexOf(char c, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const;
+    bool startsWith(const String &prefix) const { return buffer.compare(0, prefix.buffer.size(), prefix.buffer) == 0; }
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    long toInt() const;
+    float toFloat() const;
+
+    const std::string &str() const { return buffer; } // Host-only accessor for the harness
+
+private:
+    std::string buffer;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
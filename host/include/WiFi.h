@@ -0,0 +1,33 @@
+#pragma once
+
+// Host (Linux) stand-in for the ESP32 WiFi library. The soft-AP calls only record the
+// requested configuration; networking on the host goes through HostHarness.h.
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiClass {
+public:
+    bool softAP(const char *ssid, const char *passphrase = nullptr) {
+        apSsid = ssid ? ssid : "";
+        apPassphrase = passphrase ? passphrase : "";
+        return true;
+    }
+    bool softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet) {
+        apIP = localIP;
+        apGateway = gateway;
+        apSubnet = subnet;
+        return true;
+    }
+    IPAddress softAPIP() const { return apIP; }
+    String softAPSSID() const { return apSsid; }
+
+private:
+    String apSsid;
+    String apPassphrase;
+    IPAddress apIP;
+    IPAddress apGateway;
+    IPAddress apSubnet;
+};
+
+extern WiFiClass WiFi;
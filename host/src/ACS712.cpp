@@ -0,0 +1,44 @@
+#include "ACS712.h"
+
+ACS712::ACS712(ACS712_type type, uint8_t sensorPin) : pin(sensorPin) {
+    switch (type) {
+        case ACS712_05B: sensitivity = 0.185f; break;
+        case ACS712_20A: sensitivity = 0.100f; break;
+        case ACS712_30A: sensitivity = 0.066f; break;
+        default: sensitivity = 0.185f; break;
+    }
+}
+
+int ACS712::calibrate() {
+    uint32_t acc = 0;
+    for (int i = 0; i < 10; i++) {
+        acc += analogRead(pin);
+    }
+    zero = acc / 10;
+    return zero;
+}
+
+float ACS712::getCurrentDC() {
+    int32_t acc = 0;
+    for (int i = 0; i < 10; i++) {
+        acc += analogRead(pin) - zero;
+    }
+    return static_cast<float>(acc / 10.0 / ADC_SCALE * VREF / sensitivity);
+}
+
+// Busy-sample one full mains period and return the RMS current, exactly like the device library
+float ACS712::getCurrentAC(uint16_t frequency) {
+    const uint32_t period = 1000000 / frequency;
+    const uint32_t tStart = micros();
+
+    uint32_t iSum = 0;
+    uint32_t measurementsCount = 0;
+    while (micros() - tStart < period) {
+        const int32_t iNow = analogRead(pin) - zero;
+        iSum += iNow * iNow;
+        measurementsCount++;
+    }
+
+    const float iRms = sqrtf(static_cast<float>(iSum) / measurementsCount) / ADC_SCALE * VREF / sensitivity;
+    return iRms;
+}
@@ -0,0 +1,156 @@
+#include "Arduino.h"
+#include "HostHarness.h"
+
+#include <stdio.h>
+
+// Simulated board state (the fake clock itself lives in hal_host.cpp)
+static uint32_t adcConversionMicros = 10;    // Time one analogRead() takes on the ESP32 ADC
+static HostWaveform currentWaveform;         // Scripted sensor input (empty = 0 A)
+static uint8_t pinLevels[40];                // Last level written to each GPIO
+static bool serialEcho = true;               // Forward Serial output to stdout
+static std::string *serialCapture = nullptr; // Test copy of Serial output
+static int serialRoom = -1;                  // Transmit buffer space left; -1 never fills
+
+HardwareSerial Serial;
+
+void hostSetCurrentWaveform(HostWaveform waveform) {
+    currentWaveform = waveform;
+}
+
+HostWaveform hostSineWaveform(float rmsAmps, float frequencyHz) {
+    const double peak = rmsAmps * sqrt(2.0);
+    return [peak, frequencyHz](double seconds) {
+        return static_cast<float>(peak * sin(2.0 * M_PI * frequencyHz * seconds));
+    };
+}
+
+void hostSetAdcConversionMicros(uint32_t micros) {
+    adcConversionMicros = micros;
+}
+
+int hostPinLevel(uint8_t pin) {
+    return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+void hostSetSerialEcho(bool enabled) {
+    serialEcho = enabled;
+}
+
+void hostSetSerialCapture(std::string *capture) {
+    serialCapture = capture;
+}
+
+void hostSetSerialRoom(int bytes) {
+    serialRoom = bytes;
+}
+
+unsigned long millis() {
+    return static_cast<unsigned long>(hostClockMicros() / 1000);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(hostClockMicros());
+}
+
+void delay(unsigned long ms) {
+    hostClockAdvance(static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    hostClockAdvance(us);
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < sizeof(pinLevels)) {
+        pinLevels[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return hostPinLevel(pin);
+}
+
+// Sample the scripted waveform and convert it to 12-bit ACS712 counts; each conversion costs simulated time
+uint16_t analogRead(uint8_t pin) {
+    float counts = 0.0f;
+    if (pin == hostCurrentSensorPin) {
+        const float amps = currentWaveform ? currentWaveform(hostClockMicros() / 1e6) : 0.0f;
+        counts = hostAdcZeroCounts + amps * hostAdcCountsPerAmp;
+    }
+    hostClockAdvance(adcConversionMicros);
+    if (counts < 0.0f) {
+        return 0;
+    }
+    if (counts > 4095.0f) {
+        return 4095;
+    }
+    return static_cast<uint16_t>(lroundf(counts));
+}
+
+uint32_t esp_random() {
+    static uint32_t state = 0x9e3779b9; // xorshift32, fixed seed
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void configTime(long, int, const char *, const char *, const char *) {
+    // No SNTP on the host; wall-clock time is whatever the browser supplies
+}
+
+// Unlimited room reads as the ESP32's 128-byte transmit FIFO
+int HardwareSerial::availableForWrite() {
+    return serialRoom < 0 ? 128 : serialRoom;
+}
+
+// Blocks on the ESP32 when the buffer is full; here a limited room just runs out
+size_t HardwareSerial::write(const uint8_t *data, size_t size) {
+    if (serialRoom >= 0) {
+        size = size < static_cast<size_t>(serialRoom) ? size : serialRoom;
+        serialRoom -= size;
+    }
+    totalBytes += size;
+    if (serialEcho) {
+        fwrite(data, 1, size, stdout);
+    }
+    if (serialCapture != nullptr) {
+        serialCapture->append(reinterpret_cast<const char *>(data), size);
+    }
+    return size;
+}
+
+size_t HardwareSerial::print(const char *text) {
+    return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+size_t HardwareSerial::print(char c) {
+    return write(reinterpret_cast<const uint8_t *>(&c), 1);
+}
+
+size_t HardwareSerial::print(int value) {
+    return print(String(value));
+}
+
+size_t HardwareSerial::print(unsigned int value) {
+    return print(String(value));
+}
+
+size_t HardwareSerial::print(long value) {
+    return print(String(value));
+}
+
+size_t HardwareSerial::print(unsigned long value) {
+    return print(String(value));
+}
+
+size_t HardwareSerial::print(double value, int digits) {
+    return print(String(value, static_cast<unsigned int>(digits)));
+}
+
+size_t HardwareSerial::println() {
+    return print("\r\n");
+}
@@ -0,0 +1,6 @@
+#include "ESPmDNS.h"
+#include "WiFi.h"
+
+// Singletons the device core provides
+WiFiClass WiFi;
+MDNSResponder MDNS;
@@ -0,0 +1,160 @@
+#include "HistoryBinaryDecoder.h"
+
+#include <string.h>
+
+static uint16_t get16(const uint8_t *in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *in) {
+    return get16(in) | (static_cast<uint32_t>(get16(in + 2)) << 16);
+}
+
+bool HistoryBinaryDecoder::fail(const std::string &message) {
+    if (failure.empty()) {
+        failure = message;
+    }
+    return false;
+}
+
+bool HistoryBinaryDecoder::feed(const void *data, size_t length) {
+    if (!failure.empty()) {
+        return false;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    pending.insert(pending.end(), bytes, bytes + length);
+    if (!haveHeader && !decodeHeader()) {
+        return failure.empty();
+    }
+    size_t offset = 0;
+    size_t consumed;
+    while (decodeRow(pending.data() + offset, pending.size() - offset, consumed)) {
+        offset += consumed;
+    }
+    pending.erase(pending.begin(), pending.begin() + offset);
+    return failure.empty();
+}
+
+bool HistoryBinaryDecoder::finish() {
+    if (!failure.empty()) {
+        return false;
+    }
+    if (!haveHeader) {
+        return fail("body ends inside the header");
+    }
+    if (!pending.empty()) {
+        return fail("body ends inside a row");
+    }
+    return true;
+}
+
+bool HistoryBinaryDecoder::next(HistoryBinRow &row) {
+    if (nextRow == rows.size()) {
+        rows.clear();
+        nextRow = 0;
+        return false;
+    }
+    row = rows[nextRow++];
+    return true;
+}
+
+bool HistoryBinaryDecoder::decodeHeader() {
+    if (pending.size() < 6) {
+        return false;
+    }
+    if (memcmp(pending.data(), "BHST", 4) != 0) {
+        return fail("not a binary history export (bad magic)");
+    }
+    const uint8_t version = pending[4];
+    const uint8_t headerBytes = pending[5];
+    if (version != historyBinVersion) {
+        return fail("unsupported version " + std::to_string(version));
+    }
+    if (headerBytes < historyBinHeaderBytes) {
+        return fail("header too short");
+    }
+    if (pending.size() < headerBytes) {
+        return false;
+    }
+    const uint8_t *in = pending.data();
+    decodedHeader.version = version;
+    decodedHeader.encoding = static_cast<HistoryBinEncoding>(in[6]);
+    decodedHeader.rowBytes = in[7];
+    decodedHeader.currentDecimals = in[8];
+    decodedHeader.powerDecimals = in[9];
+    decodedHeader.newestSequence = get32(in + 12);
+    decodedHeader.from = get32(in + 16);
+    decodedHeader.to = get32(in + 20);
+    if (!(decodedHeader.encoding == HistoryBinRaw && decodedHeader.rowBytes == historyBinRawRowBytes) &&
+        !(decodedHeader.encoding == HistoryBinDelta && decodedHeader.rowBytes == historyBinDeltaRowBytes)) {
+        return fail("unknown row layout");
+    }
+    pending.erase(pending.begin(), pending.begin() + headerBytes); // Skips fields newer than this decoder
+    haveHeader = true;
+    return true;
+}
+
+bool HistoryBinaryDecoder::decodeRow(const uint8_t *in, size_t available, size_t &consumed) {
+    consumed = 0;
+    HistoryBinRow row;
+    if (decodedHeader.encoding == HistoryBinRaw) {
+        if (available < historyBinRawRowBytes) {
+            return false;
+        }
+        row.sequence = get32(in);
+        row.record.timestamp = get32(in + 4);
+        row.record.powerCentiWatts = get32(in + 8);
+        row.record.currentTenthMilliAmps = get16(in + 12);
+        row.record.relayMask = get16(in + 14);
+        consumed = historyBinRawRowBytes;
+    } else {
+        if (available < historyBinDeltaRowBytes) {
+            return false;
+        }
+        const uint8_t sequenceDelta = in[10];
+        row.record.powerCentiWatts = get32(in);
+        row.record.relayMask = get16(in + 8);
+        if (sequenceDelta == 0) {
+            if (available < 2 * historyBinDeltaRowBytes) {
+                return false;
+            }
+            row.sequence = get32(in + 12);
+            row.record.timestamp = get32(in + 16);
+            row.record.currentTenthMilliAmps = get16(in + 20);
+            consumed = 2 * historyBinDeltaRowBytes;
+        } else {
+            if (!havePrevious) {
+                return fail("delta row before the first key row");
+            }
+            row.sequence = previous.sequence + sequenceDelta;
+            row.record.timestamp = previous.record.timestamp + static_cast<int16_t>(get16(in + 4));
+            row.record.currentTenthMilliAmps =
+                static_cast<uint16_t>(previous.record.currentTenthMilliAmps + static_cast<int16_t>(get16(in + 6)));
+            consumed = historyBinDeltaRowBytes;
+        }
+    }
+    if (havePrevious && row.sequence <= previous.sequence) {
+        consumed = 0;
+        return fail("sequence numbers go backwards at " + std::to_string(row.sequence));
+    }
+    rows.push_back(row);
+    previous = row;
+    havePrevious = true;
+    return true;
+}
+
+bool decodeHistoryBinary(const void *data, size_t length, HistoryBinHeader &header, std::vector<HistoryBinRow> &rows,
+                         std::string *error) {
+    HistoryBinaryDecoder decoder;
+    const bool ok = decoder.feed(data, length) && decoder.finish();
+    header = decoder.header();
+    rows.clear();
+    HistoryBinRow row;
+    while (decoder.next(row)) {
+        rows.push_back(row);
+    }
+    if (!ok && error != nullptr) {
+        *error = decoder.error();
+    }
+    return ok;
+}
@@ -0,0 +1,34 @@
+#include "HostHarness.h"
+
+#include <stdlib.h>
+
+#include <new>
+
+// Counting replacements for the global allocation functions
+static size_t allocationCount = 0;
+static size_t allocatedBytes = 0;
+
+size_t hostAllocationCount() {
+    return allocationCount;
+}
+
+size_t hostAllocatedBytes() {
+    return allocatedBytes;
+}
+
+void *operator new(size_t size) {
+    allocationCount++;
+    allocatedBytes += size;
+    if (void *ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
@@ -0,0 +1,200 @@
+#include "HostHarness.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdlib.h>
+
+// One persistent client connection per server port and connection number
+struct HostHttpClient {
+    int port;
+    int connection;
+    int fd = -1;
+    bool closed = false;   // Server closed its end; parse what is left, then reconnect
+    std::string received;  // Bytes not yet parsed into a response
+    size_t pending = 0;    // Requests written whose response has not been taken
+};
+
+static std::vector<HostHttpClient> &clients() {
+    static std::vector<HostHttpClient> registry;
+    return registry;
+}
+
+static HostHttpClient &clientFor(int port, int connection) {
+    for (HostHttpClient &client : clients()) {
+        if (client.port == port && client.connection == connection) {
+            return client;
+        }
+    }
+    clients().push_back(HostHttpClient());
+    clients().back().port = port;
+    clients().back().connection = connection;
+    return clients().back();
+}
+
+static void disconnect(HostHttpClient &client) {
+    if (client.fd >= 0) {
+        close(client.fd);
+    }
+    client.fd = -1;
+    client.closed = false;
+    client.received.clear();
+}
+
+// Connect to the sketch's listener; completes from the listen backlog before the server accepts
+static bool connectClient(HostHttpClient &client) {
+    client.fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(client.port);
+    if (client.fd < 0 || connect(client.fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+        disconnect(client);
+        return false;
+    }
+    int noDelay = 1;
+    setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+}
+
+// Pull whatever has arrived without blocking
+static void receive(HostHttpClient &client) {
+    char buffer[4096];
+    while (client.fd >= 0 && !client.closed) {
+        ssize_t count = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (count > 0) {
+            client.received.append(buffer, count);
+        } else if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            client.closed = true;
+        } else {
+            break;
+        }
+    }
+}
+
+// Decode a chunked body starting at offset; returns the offset past the last chunk, or 0 if incomplete
+static size_t decodeChunked(const std::string &data, size_t offset, std::string &body) {
+    for (;;) {
+        size_t lineEnd = data.find("\r\n", offset);
+        if (lineEnd == std::string::npos) {
+            return 0;
+        }
+        size_t size = strtoul(data.c_str() + offset, nullptr, 16);
+        if (size == 0) {
+            return data.size() >= lineEnd + 4 ? lineEnd + 4 : 0; // "0\r\n\r\n", no trailers
+        }
+        if (data.size() < lineEnd + 2 + size + 2) {
+            return 0;
+        }
+        body.append(data, lineEnd + 2, size);
+        offset = lineEnd + 2 + size + 2;
+    }
+}
+
+// Parse one complete response off the front of the received bytes
+static bool parseResponse(HostHttpClient &client, HostHttpResponse &response) {
+    const std::string &data = client.received;
+    size_t headerEnd = data.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return false;
+    }
+    HostHttpResponse parsed;
+    parsed.code = atoi(data.c_str() + data.find(' ') + 1);
+    long contentLength = -1;
+    bool chunked = false;
+    for (size_t line = data.find("\r\n") + 2; line < headerEnd; line = data.find("\r\n", line) + 2) {
+        size_t colon = data.find(':', line);
+        size_t end = data.find("\r\n", line);
+        std::string name = data.substr(line, colon - line);
+        std::string value = data.substr(colon + 2, end - colon - 2);
+        if (strcasecmp(name.c_str(), "Content-Type") == 0) {
+            parsed.contentType = value;
+        } else if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+            contentLength = atol(value.c_str());
+        } else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0 && value == "chunked") {
+            chunked = true;
+        }
+        parsed.headers.emplace_back(name, value);
+    }
+
+    size_t bodyStart = headerEnd + 4;
+    size_t consumed;
+    if (chunked) {
+        consumed = decodeChunked(data, bodyStart, parsed.body);
+        if (consumed == 0) {
+            return false;
+        }
+    } else if (contentLength >= 0) {
+        if (data.size() < bodyStart + contentLength) {
+            return false;
+        }
+        parsed.body = data.substr(bodyStart, contentLength);
+        consumed = bodyStart + contentLength;
+    } else if (client.closed) {
+        parsed.body = data.substr(bodyStart); // Body runs to the end of the connection
+        consumed = data.size();
+    } else {
+        return false;
+    }
+    client.received.erase(0, consumed);
+    response = parsed;
+    return true;
+}
+
+// Write one whole request on the client's connection, reconnecting first if the server closed it
+static void submit(HostHttpClient &client, const std::string &request) {
+    receive(client);
+    if (client.closed && client.received.empty()) {
+        disconnect(client); // The server ended the keep-alive connection, open a fresh one
+    }
+    if (client.fd < 0 && !connectClient(client)) {
+        return;
+    }
+    if (send(client.fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size())) {
+        client.pending++;
+    }
+}
+
+void hostHttpSubmit(const char *method, const char *uri, const std::vector<std::pair<std::string, std::string>> &headers, int port,
+                    int connection) {
+    std::string request = std::string(method) + " " + uri + " HTTP/1.1\r\nHost: localhost\r\n";
+    for (const auto &header : headers) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    request += "\r\n";
+    submit(clientFor(port, connection), request);
+}
+
+void hostHttpPost(const char *uri, const std::string &body, const char *contentType, int port, int connection) {
+    std::string request = std::string("POST ") + uri + " HTTP/1.1\r\nHost: localhost\r\nContent-Type: " + contentType +
+                          "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    submit(clientFor(port, connection), request);
+}
+
+bool hostHttpTakeResponse(HostHttpResponse &response, int port, int connection) {
+    HostHttpClient &client = clientFor(port, connection);
+    receive(client);
+    if (!parseResponse(client, response)) {
+        if (client.closed) {
+            client.pending = 0; // Anything still outstanding was lost with the connection
+            disconnect(client);
+        }
+        return false;
+    }
+    if (client.pending > 0) {
+        client.pending--;
+    }
+    if (client.closed && client.received.empty()) {
+        disconnect(client);
+    }
+    return true;
+}
+
+size_t hostHttpPending(int port, int connection) {
+    return clientFor(port, connection).pending;
+}
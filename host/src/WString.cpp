@@ -0,0 +1,98 @@
+#include "WString.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// Render an integer in the requested base the way itoa()/ultoa() do on the device
+static std::string toBase(unsigned long value, unsigned char base, bool negative) {
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    char digits[sizeof(unsigned long) * 8 + 2];
+    int pos = sizeof(digits) - 1;
+    digits[pos] = '\0';
+    do {
+        const unsigned long digit = value % base;
+        digits[--pos] = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value != 0);
+    if (negative) {
+        digits[--pos] = '-';
+    }
+    return std::string(&digits[pos]);
+}
+
+String::String(int value, unsigned char base) : String(static_cast<long>(value), base) {}
+
+String::String(unsigned int value, unsigned char base) : String(static_cast<unsigned long>(value), base) {}
+
+String::String(long value, unsigned char base) {
+    const bool negative = value < 0 && base == 10;
+    const unsigned long magnitude = negative ? 0UL - static_cast<unsigned long>(value) : static_cast<unsigned long>(value);
+    buffer = toBase(magnitude, base, negative);
+}
+
+String::String(unsigned long value, unsigned char base) : buffer(toBase(value, base, false)) {}
+
+String::String(float value, unsigned int decimalPlaces) : String(static_cast<double>(value), decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", static_cast<int>(decimalPlaces), value); // Same output as dtostrf()
+    buffer = text;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+    const size_t pos = buffer.find(c, fromIndex);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+    const size_t pos = buffer.find(str.buffer, fromIndex);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        const unsigned int swap = beginIndex;
+        beginIndex = endIndex;
+        endIndex = swap;
+    }
+    if (beginIndex >= buffer.size()) {
+        return String();
+    }
+    if (endIndex > buffer.size()) {
+        endIndex = length();
+    }
+    return String(buffer.substr(beginIndex, endIndex - beginIndex));
+}
+
+long String::toInt() const {
+    return atol(buffer.c_str());
+}
+
+float String::toFloat() const {
+    return static_cast<float>(atof(buffer.c_str()));
+}
+
+String operator+(const String &lhs, const String &rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
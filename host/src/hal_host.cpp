@@ -0,0 +1,394 @@
+#include "hal/hal.h"
+#include "hal/net.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <chrono>
+#include <vector>
+
+#include "Arduino.h"
+#include "HostHarness.h"
+
+// Fake clock and the periodic timers it drives
+struct HostTimer {
+    uint64_t periodMicros;
+    uint64_t nextDue;
+    hal::TimerCallback callback;
+    void *arg;
+};
+
+static uint64_t clockMicros = 0;
+static std::vector<HostTimer> timers;
+static bool firingTimers = false; // Timer callbacks that touch the clock (analogRead) must not recurse
+
+// Tickless loop(): hal::waitForEvent() moves the clock itself, stopping early at the harness's next
+// input or at a hal::wakeLoop() from a timer callback
+static bool tickless = false;
+static uint64_t nextInputMicros = UINT64_MAX;
+static bool wakePending = false;
+static uint32_t wakeMicros = 0;
+static uint64_t idleWallNanos = 0;
+
+static uint64_t wallNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t hostClockMicros() {
+    return clockMicros;
+}
+
+// Move the clock to target, running every timer that falls due on the way in time order; with
+// stopOnWake, stop right after the timer callback that calls hal::wakeLoop()
+static void advanceClock(uint64_t target, bool stopOnWake) {
+    if (firingTimers) {
+        clockMicros = target;
+        return;
+    }
+    firingTimers = true;
+    while (!(stopOnWake && wakePending)) {
+        HostTimer *due = nullptr;
+        for (HostTimer &timer : timers) {
+            if (timer.nextDue <= target && (due == nullptr || timer.nextDue < due->nextDue)) {
+                due = &timer;
+            }
+        }
+        if (due == nullptr) {
+            break;
+        }
+        if (due->nextDue > clockMicros) {
+            clockMicros = due->nextDue;
+        }
+        due->nextDue += due->periodMicros;
+        due->callback(due->arg);
+    }
+    if (clockMicros < target && !(stopOnWake && wakePending)) {
+        clockMicros = target;
+    }
+    firingTimers = false;
+}
+
+void hostClockAdvance(uint64_t micros) {
+    advanceClock(clockMicros + micros, false);
+}
+
+void hostSetTickless(bool enabled) {
+    tickless = enabled;
+}
+
+void hostSetNextInput(uint64_t atMicros) {
+    nextInputMicros = atMicros;
+}
+
+uint64_t hostIdleWallNanos() {
+    return idleWallNanos;
+}
+
+void hostClockReset() {
+    clockMicros = 0;
+    timers.clear();
+}
+
+// Flash stand-in: an in-memory image written through to a file
+static FILE *flashFile = nullptr;
+static std::vector<uint8_t> flashImage;
+static std::vector<uint32_t> flashSectorErases;
+static HostFlashStats flashStats = {};
+static bool flashPowerCut = false;
+static size_t flashBytesBeforeCut = 0;
+
+bool hostFlashOpen(const char *path, size_t bytes) {
+    if (flashFile != nullptr) {
+        fclose(flashFile);
+    }
+    bytes -= bytes % hal::flashSectorBytes;
+    flashImage.assign(bytes, 0xff);
+    flashSectorErases.assign(bytes / hal::flashSectorBytes, 0);
+    flashStats = {};
+    flashFile = fopen(path, "r+b");
+    size_t existing = 0;
+    if (flashFile != nullptr) {
+        existing = fread(flashImage.data(), 1, bytes, flashFile); // A short file reads as erased beyond its end
+    } else {
+        flashFile = fopen(path, "w+b");
+    }
+    if (flashFile == nullptr) {
+        flashImage.clear();
+        return false;
+    }
+    if (existing < bytes) {
+        fseek(flashFile, 0, SEEK_SET);
+        fwrite(flashImage.data(), 1, bytes, flashFile);
+        fflush(flashFile);
+    }
+    return true;
+}
+
+void hostFlashCutPower(size_t bytesBeforeCut) {
+    flashPowerCut = true;
+    flashBytesBeforeCut = bytesBeforeCut;
+}
+
+void hostFlashRestorePower() {
+    flashPowerCut = false;
+}
+
+HostFlashStats hostFlashStats() {
+    return flashStats;
+}
+
+// Settings stand-in for NVS: a small fixed table (no allocation once running), written through to a
+// file as a whole when one is open
+struct HostSetting {
+    char key[16];
+    uint32_t length; // 0 for an unused entry
+    uint8_t data[64];
+};
+static HostSetting settings[16];
+static FILE *settingsFile = nullptr;
+
+bool hostSettingsOpen(const char *path) {
+    if (settingsFile != nullptr) {
+        fclose(settingsFile);
+    }
+    memset(settings, 0, sizeof(settings));
+    settingsFile = fopen(path, "r+b");
+    if (settingsFile != nullptr) {
+        if (fread(settings, 1, sizeof(settings), settingsFile) != sizeof(settings)) {
+            memset(settings, 0, sizeof(settings)); // Not one of ours
+        }
+    } else {
+        settingsFile = fopen(path, "w+b");
+    }
+    return settingsFile != nullptr;
+}
+
+void hostSettingsClear() {
+    memset(settings, 0, sizeof(settings));
+    if (settingsFile != nullptr) {
+        fseek(settingsFile, 0, SEEK_SET);
+        fwrite(settings, 1, sizeof(settings), settingsFile);
+        fflush(settingsFile);
+    }
+}
+
+static HostSetting *findSetting(const char *key) {
+    for (HostSetting &setting : settings) {
+        if (setting.length > 0 && strncmp(setting.key, key, sizeof(setting.key)) == 0) {
+            return &setting;
+        }
+    }
+    return nullptr;
+}
+
+static bool flashReady() {
+    return flashFile != nullptr || hostFlashOpen(HOST_FLASH_FILE);
+}
+
+static void flashStore(uint32_t offset, size_t length) {
+    fseek(flashFile, offset, SEEK_SET);
+    fwrite(flashImage.data() + offset, 1, length, flashFile);
+    fflush(flashFile); // Visible to the next run even if this one is killed
+}
+
+namespace hal {
+
+bool startPeriodicTimer(uint32_t periodMicros, TimerCallback callback, void *arg) {
+    if (periodMicros == 0) {
+        return false;
+    }
+    timers.push_back({periodMicros, clockMicros + periodMicros, callback, arg});
+    return true;
+}
+
+bool setTimerPeriod(TimerCallback callback, void *arg, uint32_t periodMicros) {
+    for (HostTimer &timer : timers) {
+        if (timer.callback == callback && timer.arg == arg && periodMicros != 0) {
+            timer.periodMicros = periodMicros;
+            timer.nextDue = clockMicros + periodMicros;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t readAdc(uint8_t pin) {
+    return analogRead(pin);
+}
+
+void writeOutputs(uint64_t setPins, uint64_t clearPins) {
+    for (uint8_t pin = 0; pin < 64; pin++) {
+        if (setPins & (1ULL << pin)) {
+            digitalWrite(pin, HIGH);
+        } else if (clearPins & (1ULL << pin)) {
+            digitalWrite(pin, LOW);
+        }
+    }
+}
+
+uint64_t monotonicMicros() {
+    return hostClockMicros();
+}
+
+// The host "cycle" is a nanosecond of real time: the fake clock does not move while code runs
+uint32_t cycleCount() {
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t cyclesPerMicrosecond() {
+    return 1000;
+}
+
+// glibc's free arena bytes stand in for the ESP32 heap; there is no fragmentation figure, so the
+// largest block is reported as all of it
+static size_t lowestFreeHeap = SIZE_MAX;
+
+size_t freeHeap() {
+#if defined(__GLIBC__)
+    const size_t free = mallinfo2().fordblks;
+#else
+    const size_t free = 0;
+#endif
+    if (free < lowestFreeHeap) {
+        lowestFreeHeap = free;
+    }
+    return free;
+}
+
+size_t minFreeHeap() {
+    freeHeap();
+    return lowestFreeHeap;
+}
+
+size_t largestFreeBlock() {
+    return freeHeap();
+}
+
+size_t flashSize() {
+    return flashReady() ? flashImage.size() : 0;
+}
+
+bool flashRead(uint32_t offset, void *data, size_t length) {
+    if (!flashReady() || offset + length > flashImage.size()) {
+        return false;
+    }
+    memcpy(data, flashImage.data() + offset, length);
+    return true;
+}
+
+// Programming can only clear bits, like NOR flash
+bool flashWrite(uint32_t offset, const void *data, size_t length) {
+    if (!flashReady() || offset + length > flashImage.size()) {
+        return false;
+    }
+    if (flashPowerCut) {
+        length = length < flashBytesBeforeCut ? length : flashBytesBeforeCut;
+        flashBytesBeforeCut -= length;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < length; i++) {
+        flashImage[offset + i] &= bytes[i];
+    }
+    flashStore(offset, length);
+    flashStats.bytesWritten += length;
+    return true; // A write cut short by power loss still "succeeds"; the device would not live to notice
+}
+
+bool settingsRead(const char *key, void *data, size_t length) {
+    const HostSetting *setting = findSetting(key);
+    if (setting == nullptr || setting->length != length) {
+        return false;
+    }
+    memcpy(data, setting->data, length);
+    return true;
+}
+
+bool settingsWrite(const char *key, const void *data, size_t length) {
+    if (strlen(key) >= sizeof(settings[0].key) || length == 0 || length > sizeof(settings[0].data)) {
+        return false;
+    }
+    HostSetting *setting = findSetting(key);
+    for (size_t i = 0; setting == nullptr && i < sizeof(settings) / sizeof(settings[0]); i++) {
+        if (settings[i].length == 0) {
+            setting = &settings[i];
+            strncpy(setting->key, key, sizeof(setting->key));
+        }
+    }
+    if (setting == nullptr) {
+        return false;
+    }
+    setting->length = length;
+    memcpy(setting->data, data, length);
+    if (settingsFile != nullptr) {
+        fseek(settingsFile, 0, SEEK_SET);
+        fwrite(settings, 1, sizeof(settings), settingsFile);
+        fflush(settingsFile); // Visible to the next run even if this one is killed
+    }
+    return true;
+}
+
+bool flashEraseSector(uint32_t offset) {
+    if (!flashReady() || offset % flashSectorBytes != 0 || offset >= flashImage.size()) {
+        return false;
+    }
+    if (flashPowerCut && flashBytesBeforeCut == 0) {
+        return true;
+    }
+    memset(flashImage.data() + offset, 0xff, flashSectorBytes);
+    flashStore(offset, flashSectorBytes);
+    uint32_t &erases = flashSectorErases[offset / flashSectorBytes];
+    erases++;
+    flashStats.sectorsErased++;
+    if (erases > flashStats.maxSectorErases) {
+        flashStats.maxSectorErases = erases;
+    }
+    return true;
+}
+
+void wakeLoop() {
+    if (!wakePending) {
+        wakePending = true;
+        wakeMicros = static_cast<uint32_t>(clockMicros);
+    }
+}
+
+// The loopback sockets are real, so they are polled for real (without blocking); the time in between
+// is simulated
+WakeReason waitForEvent(const WaitSocket *sockets, size_t count, uint32_t timeoutMicros, uint32_t &signalMicros) {
+    struct pollfd descriptors[32]; // No allocation: the harness counts them against loop()
+    count = count < 32 ? count : 32;
+    for (size_t i = 0; i < count; i++) {
+        descriptors[i] = {sockets[i].fd, static_cast<short>(sockets[i].writable ? POLLOUT : POLLIN), 0};
+    }
+    if (count > 0 && poll(descriptors, count, 0) > 0) {
+        return WakeSocket;
+    }
+    if (tickless && !wakePending) {
+        const uint64_t started = wallNanos();
+        const uint64_t deadline = clockMicros + timeoutMicros;
+        advanceClock(deadline < nextInputMicros ? deadline : nextInputMicros, true);
+        idleWallNanos += wallNanos() - started;
+    }
+    if (wakePending) {
+        wakePending = false;
+        signalMicros = wakeMicros;
+        return WakeSignal;
+    }
+    return tickless && clockMicros >= nextInputMicros ? WakeSocket : WakeTimeout; // The harness's input arrives
+}
+
+bool enablePowerSaving() {
+    return false;
+}
+
+// Tasks run cooperatively on the fake clock so simulations stay deterministic
+bool startPeriodicTask(const char *, TaskStep step, void *arg, uint32_t periodMillis, int, int) {
+    return startPeriodicTimer(periodMillis * 1000, step, arg);
+}
+
+} // namespace hal
@@ -0,0 +1,119 @@
+// POST /batch (handleBatch in main.cpp): scene changes applied together, schedule entries added with
+// them, and every way a batch is refused without touching the relays
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/Config.h"
+
+static const uint8_t channel1Pin = 33;
+static const uint8_t channel2Pin = 25;
+
+static HostHttpResponse postBatch(const std::string &body) {
+    const HostHttpResponse response = httpPost("/batch", body);
+    runSketch(10000); // Let the control task apply it
+    return response;
+}
+
+// A refused batch: 400 with this message, and the relays as they were
+static void checkRefused(const std::string &body, const char *message) {
+    const int before1 = hostPinLevel(channel1Pin);
+    const int before2 = hostPinLevel(channel2Pin);
+    const HostHttpResponse response = postBatch(body);
+    CHECK_EQ(response.code, 400);
+    if (!CHECK(response.body.find(message) != std::string::npos)) {
+        printf("%s\n", response.body.c_str());
+    }
+    CHECK_EQ(hostPinLevel(channel1Pin), before1);
+    CHECK_EQ(hostPinLevel(channel2Pin), before2);
+}
+
+TEST(batch_apply) {
+    bootSketch("batch_apply");
+
+    // Immediate operations fold into one change, reported as the state it leaves
+    HostHttpResponse response = postBatch("set 1 on\nset 2 on\n");
+    CHECK_EQ(response.code, 200);
+    CHECK_EQ(response.body, std::string("{\"status\":\"success\",\"relays\":3,\"states\":[\"On\",\"On\"],\"scheduled\":[]}"));
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+
+    // In order: toggling both then switching 1 off leaves both off; ';' separates like a line break
+    response = postBatch("toggle all; set 1 off");
+    CHECK_EQ(response.body, std::string("{\"status\":\"success\",\"relays\":0,\"states\":[\"Off\",\"Off\"],\"scheduled\":[]}"));
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+    response = postBatch("set 1,2 on;toggle 2");
+    CHECK_EQ(response.body, std::string("{\"status\":\"success\",\"relays\":1,\"states\":[\"On\",\"Off\"],\"scheduled\":[]}"));
+
+    // Schedule entries alongside, with CRLF, blank lines and extra blanks between the words
+    response = postBatch("set 1 off\r\n\r\n  schedule 2   on in=2\r\nschedule all toggle in=60 every=60\r\n");
+    CHECK_EQ(response.code, 200);
+    CHECK(response.body.find("\"relays\":0,") != std::string::npos);
+    const size_t ids = response.body.find("\"scheduled\":[");
+    REQUIRE(ids != std::string::npos);
+    char *next;
+    const unsigned long first = strtoul(response.body.c_str() + ids + 13, &next, 10);
+    CHECK(first > 0);
+    CHECK_EQ(std::string(next), "," + std::to_string(first + 1) + "]}"); // Ids in operation order
+    const std::string list = httpGet("/schedules").body;
+    CHECK(list.find("\"every\":60") != std::string::npos);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+    runSketch(2100000);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+
+    // A time of day stays on the wall clock, also when the clock is stepped after the batch
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=09:00:00").code, 200);
+    CHECK_EQ(postBatch("schedule 1 on at=12:00:00").code, 200);
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=11:59:55").code, 200);
+    runSketch(5100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+
+    CHECK_EQ(httpGet("/batch").code, 405);
+}
+
+TEST(batch_refused) {
+    bootSketch("batch_refused");
+    CHECK_EQ(postBatch("set 1 on").code, 200);
+
+    // One bad operation refuses the whole batch, naming it
+    checkRefused("set 2 on\nset 3 on", "Operation 2: No such channel");
+    checkRefused("set 1,,2 on", "Operation 1: No such channel");
+    checkRefused("set 2 maybe", "Operation 1: Unknown action");
+    checkRefused("flip 2", "Operation 1: Use set <channels> on|off");
+    checkRefused("set 2", "Operation 1: Use set");
+    checkRefused("set 2 on on on on on", "Operation 1: Too many words");
+    checkRefused("set 2 on\nschedule 2 on", "Operation 2: Need in=<seconds> or at=HH:MM:SS");
+    checkRefused("schedule 2 on in=abc", "Operation 1: Bad time");
+    checkRefused("schedule 2 on at=25:00:00", "Operation 1: Bad time");
+    checkRefused("schedule 2 on in=5 every=x", "Operation 1: Bad period");
+    checkRefused("schedule 2 on in=5 at=10:00:00", "Operation 1: Unexpected word");
+    checkRefused("schedule 2 on in=31622401", "Operation 1: Time out of range");
+    checkRefused("set 2 on\n" + std::string(96, ' ') + "set 2 off", "Operation 2: Line too long");
+
+    std::string many;
+    for (int i = 0; i <= BATCH_MAX_OPERATIONS; i++) {
+        many += "toggle 2\n";
+    }
+    checkRefused(many, ("Operation " + std::to_string(BATCH_MAX_OPERATIONS + 1) + ": Too many operations").c_str());
+
+    // Nothing to do, or a body that is not text
+    checkRefused("", "No operations");
+    checkRefused("\n \n;;\r\n", "No operations");
+    checkRefused(std::string("set 2 on\0set 2 off", 18), "Body contains a NUL byte");
+
+    // Schedule entries that would not fit: 503, and the immediate part is not applied either
+    HostHttpResponse response;
+    while ((response = httpGet("/schedules/add?action=off&in=1000")).code == 200) {
+    }
+    response = postBatch("set 2 on\nschedule 1 off in=5");
+    CHECK_EQ(response.code, 503);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+    CHECK_EQ(postBatch("set 2 on").code, 200); // Without entries it still goes through
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+}
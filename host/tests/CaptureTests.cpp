@@ -0,0 +1,247 @@
+// Waveform captures (src/WaveformCapture.h): triggers, slots and the packed download on their own, then
+// /captures and /captures/<id>.bin from the sketch around relay changes
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "TestSupport.h"
+#include "src/Config.h"
+#include "src/WaveformCapture.h"
+
+static const size_t pre = WaveformCapture::preSamples;
+static const size_t post = WaveformCapture::postSamples;
+
+// Readings fed to the capture: quiet ones cycle just above zero, each one telling its position
+static uint32_t fed = 0;
+static uint16_t quietReading(uint32_t index) {
+    return (uint16_t)(2048 + index % 200);
+}
+static void feed(WaveformCapture &capture, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        capture.add(quietReading(fed++));
+    }
+}
+
+TEST(waveform_capture_triggers) {
+    WaveformCapture capture;
+    capture.begin(2048, 500);
+    feed(capture, 300);
+    CHECK(!capture.recording());
+    CHECK(capture.take() == nullptr);
+
+    // A relay change: the last preSamples readings (the trigger's own included), then postSamples more
+    capture.trigger(0x0, 0x1);
+    feed(capture, 1);
+    CHECK(capture.recording());
+    feed(capture, post - 1);
+    CHECK(capture.recording());
+    CHECK(capture.take() == nullptr);
+    feed(capture, 1);
+    CHECK(!capture.recording());
+    const WaveformCapture::Capture *relay = capture.take();
+    REQUIRE(relay != nullptr);
+    CHECK_EQ(relay->id.load(), 1u);
+    CHECK_EQ(relay->trigger, WaveformCapture::TriggerRelay);
+    CHECK_EQ(relay->relaysBefore, 0x0);
+    CHECK_EQ(relay->relaysAfter, 0x1);
+    CHECK_EQ(relay->before, pre);
+    CHECK_EQ(relay->after, post);
+    bool inOrder = true;
+    for (size_t i = 0; i < pre + post; i++) {
+        inOrder = inOrder && relay->samples[i] == quietReading(301 - pre + i);
+    }
+    CHECK(inOrder);
+    CHECK_EQ(capture.captured(WaveformCapture::TriggerRelay), 1u);
+
+    // A spike only triggers after a whole quiet ring; a relay change while recording joins that capture
+    capture.add(2048 + 501);
+    CHECK(!capture.recording());
+    feed(capture, pre);
+    capture.add(2048 - 501);
+    CHECK(capture.recording());
+    capture.trigger(0x1, 0x3);
+    feed(capture, post);
+    const WaveformCapture::Capture *spike = capture.take();
+    REQUIRE(spike != nullptr);
+    CHECK_EQ(spike->id.load(), 2u);
+    CHECK_EQ(spike->trigger, WaveformCapture::TriggerThreshold);
+    CHECK_EQ(spike->relaysBefore, 0x1);
+    CHECK_EQ(spike->relaysAfter, 0x3);
+    CHECK_EQ(spike->before, pre);
+    CHECK_EQ(spike->samples[pre - 1], 2048 - 501);
+    CHECK_EQ(capture.captured(WaveformCapture::TriggerRelay), 1u);
+    CHECK_EQ(capture.captured(WaveformCapture::TriggerThreshold), 1u);
+
+    // Right after a capture the ring starts over: a trip shortly after gets only what came since
+    feed(capture, 10);
+    CHECK_EQ(capture.captureNow(WaveformCapture::TriggerTrip), 3u);
+    CHECK_EQ(capture.captureNow(WaveformCapture::TriggerTrip), 3u); // Already covered
+    feed(capture, post);
+    const WaveformCapture::Capture *trip = capture.take();
+    REQUIRE(trip != nullptr);
+    CHECK_EQ(trip->before, 10u);
+    CHECK_EQ(trip->relaysBefore, 0x3);
+
+    // Every slot held by loop(): the next trigger is missed until one is released
+    CHECK_EQ(capture.captureNow(WaveformCapture::TriggerTrip), 0u);
+    CHECK_EQ(capture.missed(), 1u);
+    capture.release(relay);
+    CHECK_EQ(capture.captureNow(WaveformCapture::TriggerTrip), 4u);
+    CHECK_EQ(relay->id.load(), 4u); // The same slot, stamped anew
+    CHECK_EQ(capture.captured(WaveformCapture::TriggerTrip), 2u);
+}
+
+// Fields of a /captures/<id>.bin body, readings unpacked
+struct DecodedCapture {
+    uint8_t trigger;
+    uint32_t id;
+    uint32_t epochSeconds;
+    uint16_t before;
+    uint16_t after;
+    uint16_t baseRateHz;
+    uint16_t burstRateHz;
+    uint16_t zero;
+    uint16_t relaysBefore;
+    uint16_t relaysAfter;
+    float countsPerAmp;
+    std::vector<uint16_t> readings;
+};
+
+static bool decodeCapture(const std::string &body, DecodedCapture &capture) {
+    const uint8_t *in = reinterpret_cast<const uint8_t *>(body.data());
+    if (body.size() < captureBinHeaderBytes || memcmp(in, "BCAP", 4) != 0 || in[4] != captureBinVersion ||
+        in[5] != captureBinHeaderBytes || in[7] != 12) {
+        return false;
+    }
+    capture.trigger = in[6];
+    memcpy(&capture.id, in + 8, 4);
+    memcpy(&capture.epochSeconds, in + 12, 4);
+    uint16_t words[8];
+    memcpy(words, in + 20, sizeof(words));
+    capture.before = words[0];
+    capture.after = words[1];
+    capture.baseRateHz = words[2];
+    capture.burstRateHz = words[3];
+    capture.zero = words[4];
+    capture.relaysBefore = words[5];
+    capture.relaysAfter = words[6];
+    memcpy(&capture.countsPerAmp, in + 36, 4);
+
+    const size_t count = capture.before + capture.after;
+    if (body.size() != captureBinHeaderBytes + count / 2 * 3 + count % 2 * 2) {
+        return false;
+    }
+    capture.readings.clear();
+    for (const uint8_t *p = in + captureBinHeaderBytes; capture.readings.size() < count; p += 3) {
+        capture.readings.push_back((uint16_t)(p[0] | (p[1] & 0xf) << 8));
+        if (capture.readings.size() < count) {
+            capture.readings.push_back((uint16_t)(p[1] >> 4 | p[2] << 4));
+        }
+    }
+    return true;
+}
+
+// Run the encoder to the end, chunk bytes at a time
+static std::string encodeAll(CaptureBinaryEncoder &encoder, size_t chunk) {
+    std::string body;
+    char buffer[64];
+    for (size_t length; (length = encoder.read(buffer, chunk)) > 0;) {
+        body.append(buffer, length);
+    }
+    return body;
+}
+
+TEST(capture_binary_layout) {
+    WaveformCapture capture;
+    capture.begin(2050, 500);
+    feed(capture, 6);
+    capture.trigger(0x2, 0x0);
+    capture.add(4095);
+    feed(capture, post);
+    const WaveformCapture::Capture *taken = capture.take();
+    REQUIRE(taken != nullptr);
+    REQUIRE(taken->before == 7u); // An odd count: the last reading takes two bytes
+
+    // Any chunk size gives the same body, every reading back as it was
+    const CaptureBinInfo info = {1730419200, 123456, 2000, 8000, 229.6f};
+    for (size_t chunk : {3, 7, 64}) {
+        CaptureBinaryEncoder encoder;
+        encoder.begin(*taken, capture.zero(), info);
+        DecodedCapture decoded;
+        REQUIRE(decodeCapture(encodeAll(encoder, chunk), decoded));
+        CHECK_EQ(decoded.id, 1u);
+        CHECK_EQ(decoded.trigger, (uint8_t)WaveformCapture::TriggerRelay);
+        CHECK_EQ(decoded.epochSeconds, 1730419200u);
+        CHECK_EQ(decoded.before, 7u);
+        CHECK_EQ(decoded.after, post);
+        CHECK_EQ(decoded.baseRateHz, 2000u);
+        CHECK_EQ(decoded.burstRateHz, 8000u);
+        CHECK_EQ(decoded.zero, 2050u);
+        CHECK_EQ(decoded.relaysBefore, 0x2u);
+        CHECK_EQ(decoded.relaysAfter, 0x0u);
+        CHECK_EQ(decoded.countsPerAmp, 229.6f);
+        CHECK(decoded.readings == std::vector<uint16_t>(taken->samples, taken->samples + 7 + post));
+        CHECK_EQ(decoded.readings[6], 4095u);
+    }
+
+    // A slot rewritten during a download ends the body early instead of mixing two captures
+    CaptureBinaryEncoder encoder;
+    encoder.begin(*taken, capture.zero(), info);
+    char buffer[64];
+    CHECK_EQ(encoder.read(buffer, sizeof(buffer)), captureBinHeaderBytes);
+    CHECK(encoder.read(buffer, sizeof(buffer)) > 0);
+    capture.release(taken); // Back of the free queue: the third capture from here reuses it
+    for (int i = 0; i < 3; i++) {
+        capture.captureNow(WaveformCapture::TriggerTrip);
+        feed(capture, post);
+    }
+    CHECK_EQ(taken->id.load(), 4u);
+    CHECK_EQ(encoder.read(buffer, sizeof(buffer)), 0u);
+    CHECK_EQ(encoder.read(buffer, sizeof(buffer)), 0u);
+}
+
+TEST(capture_sketch) {
+    bootSketch("capture_sketch");
+    runSketch(500000); // A full pre-trigger ring at the base rate
+    CHECK_EQ(httpGet("/captures").body, std::string("{\"captures\":[],\"missed\":0}"));
+
+    // A relay change is captured around the moment the relay switched
+    CHECK_EQ(httpGet("/toggleBulb1").code, 200);
+    runSketch(500000);
+    std::string list = httpGet("/captures").body;
+    CHECK_EQ(list.find("{\"captures\":[{\"id\":1,\"trigger\":\"relay\",\"time\":\"2024-11-01 00:00:0"), 0u);
+    CHECK(list.find("\"relaysBefore\":0,\"relaysAfter\":1,") != std::string::npos);
+    CHECK(list.find("\"before\":" + std::to_string(pre) + ",\"after\":" + std::to_string(post) + "}") != std::string::npos);
+
+    // The download carries the same capture
+    HostHttpResponse download = httpGet("/captures/1.bin");
+    CHECK_EQ(download.code, 200);
+    DecodedCapture decoded;
+    REQUIRE(decodeCapture(download.body, decoded));
+    CHECK_EQ(decoded.id, 1u);
+    CHECK_EQ(decoded.trigger, (uint8_t)WaveformCapture::TriggerRelay);
+    CHECK_EQ(decoded.before, pre);
+    CHECK_EQ(decoded.after, post);
+    CHECK_EQ(decoded.baseRateHz, (uint16_t)CURRENT_SAMPLE_RATE_HZ);
+    CHECK_EQ(decoded.burstRateHz, (uint16_t)CAPTURE_SAMPLE_RATE_HZ);
+    CHECK_EQ(decoded.relaysAfter, 0x1u);
+    CHECK_EQ(httpGet("/captures/1").code, 404);
+    CHECK_EQ(httpGet("/captures/2.bin").code, 404);
+    CHECK_EQ(httpGet("/captures/x.bin").code, 404);
+
+    // loop() keeps the newest CAPTURE_SLOTS - 1; older ones go back to the sampler
+    for (int i = 0; i < CAPTURE_SLOTS; i++) {
+        CHECK_EQ(httpGet("/toggleBulb2").code, 200);
+        runSketch(500000);
+    }
+    list = httpGet("/captures").body;
+    const uint32_t newest = CAPTURE_SLOTS + 1;
+    for (uint32_t id = 1; id <= newest; id++) {
+        const bool held = id > newest - (CAPTURE_SLOTS - 1);
+        CHECK_EQ(list.find("{\"id\":" + std::to_string(id) + ",") != std::string::npos, held);
+        CHECK_EQ(httpGet(("/captures/" + std::to_string(id) + ".bin").c_str()).code, held ? 200 : 404);
+    }
+    CHECK(list.find("\"missed\":0}") != std::string::npos);
+}
@@ -0,0 +1,89 @@
+// Background RMS sampling (src/CurrentSampler.h) against synthetic sine waves of known amplitude
+
+#include <cmath>
+
+#include "TestSupport.h"
+#include "src/CurrentSampler.h"
+
+static const uint32_t sampleRateHz = 2000;
+static const uint32_t windowMillis = 100;
+static const uint32_t windowSamples = sampleRateHz * windowMillis / 1000;
+
+// Feed one window of a sine of rmsAmps around adcZero, as the ADC would read it
+static void feedSine(CurrentSampler &sampler, float rmsAmps, float frequencyHz, float adcZero, uint32_t &phase) {
+    for (uint32_t i = 0; i < windowSamples; i++, phase++) {
+        const double seconds = (double)phase / sampleRateHz;
+        const double counts = adcZero + rmsAmps * std::sqrt(2.0) * hostAdcCountsPerAmp * std::sin(2 * M_PI * frequencyHz * seconds);
+        sampler.addSample((uint16_t)std::lround(counts));
+    }
+}
+
+TEST(current_sampler_sine_rms) {
+    CurrentSampler sampler(hostCurrentSensorPin, sampleRateHz, windowMillis);
+    REQUIRE(sampler.begin((int)hostAdcZeroCounts, hostAdcCountsPerAmp)); // The timer stays idle: the clock does not move
+    CHECK_EQ(sampler.windowSamples(), windowSamples);
+    CHECK_EQ(sampler.windowCount(), 0u);
+    CHECK_EQ(sampler.currentRms(), 0.0f);
+
+    uint32_t phase = 0;
+    uint32_t windows = 0;
+    for (float frequency : {50.0f, 60.0f}) { // 100 ms is whole cycles of both
+        for (float amps : {0.1f, 0.5f, 1.0f, 2.5f, 4.5f}) {
+            feedSine(sampler, amps, frequency, hostAdcZeroCounts, phase);
+            windows++;
+            CHECK_EQ(sampler.windowCount(), windows);
+            CHECK_NEAR(sampler.currentRms(), amps, 0.01 * amps + 0.005); // 1% plus ADC rounding
+            CHECK_NEAR(sampler.meanReading(), hostAdcZeroCounts, 0.1);
+        }
+    }
+
+    // Nothing is published part way through a window
+    for (uint32_t i = 0; i < windowSamples - 1; i++) {
+        sampler.addSample((uint16_t)hostAdcZeroCounts);
+    }
+    CHECK_EQ(sampler.windowCount(), windows);
+    CHECK_NEAR(sampler.currentRms(), 4.5, 0.05);
+    sampler.addSample((uint16_t)hostAdcZeroCounts);
+    CHECK_EQ(sampler.windowCount(), windows + 1);
+    CHECK_NEAR(sampler.currentRms(), 0.0, 0.001);
+}
+
+TEST(current_sampler_zero_offset) {
+    const float sensorZero = 2100.0f; // This sensor's idle output, 52 counts above the nominal one
+    CurrentSampler sampler(hostCurrentSensorPin, sampleRateHz, windowMillis);
+    REQUIRE(sampler.begin((int)hostAdcZeroCounts, hostAdcCountsPerAmp));
+
+    // Measured around the wrong zero the offset adds in quadrature, and the mean reading shows it
+    uint32_t phase = 0;
+    const float amps = 1.0f;
+    const double offsetAmps = (sensorZero - hostAdcZeroCounts) / hostAdcCountsPerAmp;
+    feedSine(sampler, amps, 50.0f, sensorZero, phase);
+    CHECK_NEAR(sampler.currentRms(), std::sqrt(amps * amps + offsetAmps * offsetAmps), 0.01);
+    CHECK_NEAR(sampler.meanReading(), sensorZero, 0.1);
+
+    // Moving the zero to the mean reading takes the offset out from the next window on
+    sampler.setZero((int)std::lround(sampler.meanReading()));
+    feedSine(sampler, amps, 50.0f, sensorZero, phase);
+    CHECK_NEAR(sampler.currentRms(), amps, 0.01 * amps + 0.005);
+
+    // No current: the mean reading is the zero, the RMS is 0
+    feedSine(sampler, 0.0f, 50.0f, sensorZero, phase);
+    CHECK_NEAR(sampler.meanReading(), sensorZero, 0.01);
+    CHECK_NEAR(sampler.currentRms(), 0.0, 0.001);
+}
+
+TEST(current_sampler_timer) {
+    // The same through the hal timer and the simulated ACS712, one simulated second at a time
+    hostSetCurrentWaveform(hostSineWaveform(1.5f));
+    CurrentSampler sampler(hostCurrentSensorPin, sampleRateHz, windowMillis);
+    REQUIRE(sampler.begin((int)hostAdcZeroCounts, hostAdcCountsPerAmp));
+    hostClockAdvance(1000000);
+    CHECK_EQ(sampler.windowCount(), 1000 / windowMillis);
+    CHECK_NEAR(sampler.currentRms(), 1.5, 0.03);
+    CHECK_NEAR(sampler.meanReading(), hostAdcZeroCounts, 1.0);
+
+    hostSetCurrentWaveform(hostSineWaveform(3.0f, 60.0f));
+    hostClockAdvance(1000000);
+    CHECK_EQ(sampler.windowCount(), 2 * 1000 / windowMillis);
+    CHECK_NEAR(sampler.currentRms(), 3.0, 0.06);
+}
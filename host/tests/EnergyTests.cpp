@@ -0,0 +1,109 @@
+// Per-channel energy (src/EnergyMeter.h): exact integer integration on its own, then /energy through
+// the sketch against the kWh a known load should give
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/EnergyMeter.h"
+
+static const uint64_t microJoulesPerKWh = EnergyMeter::microJoulesPerKWh;
+static const uint64_t microJoulesPerWh = microJoulesPerKWh / 1000;
+
+TEST(energy_meter_integration) {
+    // 1 kW for an hour in 10 ms steps is exactly 1 kWh, with nothing lost between steps
+    EnergyMeter meter;
+    for (uint32_t step = 0; step < 360000; step++) {
+        meter.accumulate(1000000, 10000, 0x1);
+    }
+    CHECK_EQ(meter.channel(0).totalMicroJoules, microJoulesPerKWh);
+    CHECK_EQ(meter.channel(0).tripMicroJoules, microJoulesPerKWh);
+    CHECK_EQ(meter.channel(1).totalMicroJoules, 0u);
+    CHECK_EQ(meter.unattributedMicroJoules(), 0u);
+
+    // Steps far below a micro-joule add up: 1 mW for 1 us is 1 nJ
+    EnergyMeter tiny;
+    for (uint32_t step = 0; step < 1000000; step++) {
+        tiny.accumulate(1, 1, 0x2);
+    }
+    CHECK_EQ(tiny.channel(1).totalMicroJoules, 1000u);
+    CHECK_EQ(tiny.channel(1).pendingNanoJoules, 0u);
+
+    // Closed relays share the energy evenly, remainders included; none closed is unattributed
+    EnergyMeter shared;
+    for (uint32_t step = 0; step < 3000; step++) {
+        shared.accumulate(1, 1, 0x7); // 1 nJ a step between three channels
+    }
+    for (size_t channel = 0; channel < 3; channel++) {
+        CHECK_EQ(shared.channel(channel).totalMicroJoules, 1u);
+    }
+    shared.accumulate(100000, 3600000, 0x3); // 100 W for 3.6 s (0.1 Wh), two channels
+    CHECK_EQ(shared.channel(0).totalMicroJoules, 1 + microJoulesPerWh / 20);
+    CHECK_EQ(shared.channel(1).totalMicroJoules, 1 + microJoulesPerWh / 20);
+    CHECK_EQ(shared.channel(2).totalMicroJoules, 1u);
+    shared.accumulate(5000, 1000000, 0); // 5 W for a second with every relay open
+    CHECK_EQ(shared.unattributedMicroJoules(), 5000000u);
+
+    // reset() zeroes the trip counters of the channels given and nothing else
+    shared.reset(0x1);
+    CHECK_EQ(shared.channel(0).tripMicroJoules, 0u);
+    CHECK_EQ(shared.channel(0).totalMicroJoules, 1 + microJoulesPerWh / 20);
+    CHECK_EQ(shared.channel(1).tripMicroJoules, 1 + microJoulesPerWh / 20);
+}
+
+// "kWh" (or key) of channel n (1-based) in an /energy body
+static double channelKWh(const std::string &body, unsigned channel, const char *key = "kWh") {
+    const size_t at = body.find("{\"channel\":" + std::to_string(channel) + ",");
+    return at != std::string::npos ? jsonNumber(body, key, at) : NAN;
+}
+
+TEST(energy_sketch) {
+    bootSketch("energy_sketch");
+    CHECK_EQ(httpGet("/energy").body,
+             std::string("{\"channels\":[{\"channel\":1,\"state\":\"Off\",\"kWh\":\"0.000000\",\"tripKWh\":\"0.000000\"},"
+                         "{\"channel\":2,\"state\":\"Off\",\"kWh\":\"0.000000\",\"tripKWh\":\"0.000000\"}],"
+                         "\"unattributedKWh\":\"0.000000\"}"));
+
+    // 1 A at 220 V through channel 1 for a minute: 220 W x 60 s = 0.003667 kWh
+    CHECK_EQ(httpGet("/toggleBulb1").code, 200);
+    runSketch(100000);
+    hostSetCurrentWaveform(hostSineWaveform(1.0f));
+    runSketch(60000000);
+    hostSetCurrentWaveform(hostSineWaveform(0.0f));
+    runSketch(2000000); // The view loop() serves is up to a second old
+    std::string energy = httpGet("/energy").body;
+    const double expected = 220.0 * 60 / 3600 / 1000;
+    CHECK_NEAR(channelKWh(energy, 1), expected, expected * 0.02);
+    CHECK_NEAR(channelKWh(energy, 1, "tripKWh"), expected, expected * 0.02);
+    CHECK_EQ(channelKWh(energy, 2), 0.0);
+    CHECK(energy.find("{\"channel\":1,\"state\":\"On\"") != std::string::npos);
+    CHECK_EQ(jsonNumber(energy, "unattributedKWh"), 0.0);
+
+    // /energy/reset zeroes the trip counter only
+    const double total = channelKWh(energy, 1);
+    CHECK_EQ(httpGet("/energy/reset?channel=1").code, 200);
+    runSketch(100000);
+    energy = httpGet("/energy").body;
+    CHECK_EQ(channelKWh(energy, 1, "tripKWh"), 0.0);
+    CHECK_EQ(channelKWh(energy, 1), total);
+    CHECK_EQ(httpGet("/energy/reset?channel=9").code, 400);
+
+    // Both on: the same load is split evenly between them
+    CHECK_EQ(httpGet("/turnOnAll").code, 200);
+    runSketch(100000);
+    hostSetCurrentWaveform(hostSineWaveform(1.0f));
+    runSketch(60000000);
+    hostSetCurrentWaveform(hostSineWaveform(0.0f));
+    runSketch(2000000);
+    energy = httpGet("/energy").body;
+    CHECK_NEAR(channelKWh(energy, 1) - total, expected / 2, expected * 0.02);
+    CHECK_NEAR(channelKWh(energy, 2), expected / 2, expected * 0.02);
+
+    // With everything off, load current is unattributed
+    CHECK_EQ(httpGet("/turnOffAll").code, 200);
+    runSketch(100000);
+    hostSetCurrentWaveform(hostSineWaveform(1.0f));
+    runSketch(60000000);
+    hostSetCurrentWaveform(hostSineWaveform(0.0f));
+    runSketch(2000000);
+    CHECK_NEAR(jsonNumber(httpGet("/energy").body, "unattributedKWh"), expected, expected * 0.02);
+}
@@ -0,0 +1,144 @@
+// Server-Sent Events (src/EventStream.h): the stream on its own over socket pairs, then /events from
+// the sketch, where subscribers see relay changes and samples as they happen
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/EventStream.h"
+
+// A connected pair: the stream's end and the client's
+struct SocketPair {
+    int server = -1;
+    int client = -1;
+
+    SocketPair() {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        server = fds[0];
+        client = fds[1];
+    }
+};
+
+static const char streamHeaders[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                                    "Connection: keep-alive\r\n\r\nretry: 2000\n\n";
+
+TEST(event_stream_publish) {
+    EventStream stream;
+    uint32_t now = 1000;
+    SocketPair first;
+    SocketPair second;
+    REQUIRE(stream.adopt(first.server, now));
+    REQUIRE(stream.adopt(second.server, now));
+    CHECK_EQ(stream.subscriberCount(), 2u);
+    CHECK_EQ(rawReceive(first.client), std::string(streamHeaders));
+    CHECK_EQ(rawReceive(second.client), std::string(streamHeaders));
+
+    // One event to every subscriber, framed whole
+    stream.publish("relay", "{\"relays\":1}", 12);
+    stream.poll(now);
+    CHECK_EQ(rawReceive(first.client), std::string("event: relay\ndata: {\"relays\":1}\n\n"));
+    CHECK_EQ(rawReceive(second.client), std::string("event: relay\ndata: {\"relays\":1}\n\n"));
+
+    // A quiet stream gets a comment line 15 s after its last write, so dead peers are noticed
+    now += 14999;
+    stream.poll(now);
+    CHECK_EQ(rawReceive(first.client), std::string());
+    now += 1;
+    stream.poll(now);
+    CHECK_EQ(rawReceive(first.client), std::string(":\n\n"));
+    CHECK_EQ(rawReceive(second.client), std::string(":\n\n"));
+
+    // A subscriber that hangs up is dropped on the next write, without counting as slow
+    rawClose(second.client);
+    stream.publish("sample", "{}", 2);
+    stream.poll(now);
+    CHECK_EQ(stream.subscriberCount(), 1u);
+    CHECK_EQ(stream.droppedSubscribers(), 0u);
+    CHECK_EQ(rawReceive(first.client), std::string("event: sample\ndata: {}\n\n"));
+    rawClose(first.client);
+}
+
+TEST(event_stream_limits) {
+    EventStream stream;
+    SocketPair pairs[EVENT_MAX_SUBSCRIBERS];
+    for (SocketPair &pair : pairs) {
+        REQUIRE(stream.adopt(pair.server, 0));
+    }
+
+    // Every slot taken: the next one is answered 503 and closed
+    SocketPair extra;
+    CHECK(!stream.adopt(extra.server, 0));
+    CHECK_EQ(rawReceive(extra.client).find("HTTP/1.1 503 "), 0u);
+    CHECK(rawClosed(extra.client));
+    rawClose(extra.client);
+
+    // A subscriber that stops reading fills its socket, then its buffer, and is disconnected rather
+    // than holding the others back; the others get every event
+    const int small = 4096;
+    setsockopt(pairs[0].server, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    const std::string data(100, 'x');
+    size_t published = 0;
+    std::string received;
+    while (stream.droppedSubscribers() == 0 && published < 100000) {
+        stream.publish("sample", data.data(), data.size());
+        stream.poll(0);
+        published++;
+        received += rawReceive(pairs[1].client);
+        for (size_t i = 2; i < EVENT_MAX_SUBSCRIBERS; i++) {
+            rawReceive(pairs[i].client); // The others keep reading too
+        }
+    }
+    CHECK_EQ(stream.droppedSubscribers(), 1u);
+    CHECK_EQ(stream.subscriberCount(), EVENT_MAX_SUBSCRIBERS - 1u);
+    rawReceive(pairs[0].client); // What it had been sent, then the end of the stream
+    CHECK(rawClosed(pairs[0].client));
+    CHECK_EQ(received.size(), sizeof(streamHeaders) - 1 + published * (7 + 6 + 7 + data.size() + 2));
+    for (SocketPair &pair : pairs) {
+        rawClose(pair.client);
+    }
+}
+
+// Run the sketch for micros, collecting whatever arrives on fd meanwhile
+static std::string runAndReceive(int fd, uint64_t micros) {
+    std::string received;
+    for (uint64_t elapsed = 0; elapsed < micros; elapsed += 1000) {
+        loop();
+        received += rawReceive(fd);
+        hostClockAdvance(1000);
+    }
+    return received + rawReceive(fd);
+}
+
+TEST(event_stream_sketch) {
+    bootSketch("event_stream_sketch");
+    const int fd = rawConnect();
+    REQUIRE(fd >= 0);
+    REQUIRE(rawSend(fd, "GET /events HTTP/1.1\r\nAccept: text/event-stream\r\n\r\n"));
+    CHECK_EQ(runAndReceive(fd, 10000), std::string(streamHeaders));
+
+    // A relay change is pushed as soon as the control task has applied it, well before the next sample
+    CHECK_EQ(httpGet("/toggleBulb2").code, 200);
+    CHECK_EQ(runAndReceive(fd, 50000),
+             std::string("event: relay\ndata: {\"relays\":2,\"bulb1State\":\"Off\",\"bulb2State\":\"On\"}\n\n"));
+    CHECK_EQ(httpGet("/turnOnAll").code, 200);
+    CHECK_EQ(httpGet("/turnOnAll").code, 200); // No change, no second event
+    CHECK_EQ(runAndReceive(fd, 50000),
+             std::string("event: relay\ndata: {\"relays\":3,\"bulb1State\":\"On\",\"bulb2State\":\"On\"}\n\n"));
+
+    // Every history sample (one per 5 s) goes out as a "sample" event, the same row as /historicalData
+    hostSetCurrentWaveform(hostSineWaveform(1.0f));
+    const std::string events = runAndReceive(fd, 10000000);
+    size_t samples = 0;
+    for (size_t at = events.find("event: sample\ndata: {"); at != std::string::npos; at = events.find("event: sample", at + 1)) {
+        samples++;
+    }
+    CHECK_EQ(samples, 2u);
+    const size_t row = events.rfind("data: ") + 6;
+    const std::string newest = events.substr(row, events.find('\n', row) - row);
+    CHECK(newest.find("\"bulb1State\":\"On\",\"bulb2State\":\"On\",\"current\":\"1.") != std::string::npos);
+    CHECK(httpGet("/historicalData").body.find(newest) != std::string::npos);
+    rawClose(fd);
+}
@@ -0,0 +1,205 @@
+// /historicalData.bin: the encoder (src/HistoryBinary.h) against the host decoder
+
+#include <string>
+#include <vector>
+
+#include "HistoryBinaryDecoder.h"
+#include "TestSupport.h"
+
+// Records by sequence number; sequence numbers in missing are unreadable (like torn flash rows)
+struct RecordSource {
+    std::vector<HistoryRecord> records; // records[0] is sequence 1
+    std::vector<uint32_t> missing;
+};
+
+static bool readSourceRecord(void *context, uint32_t sequence, HistoryRecord &record) {
+    const RecordSource &source = *static_cast<RecordSource *>(context);
+    for (uint32_t gap : source.missing) {
+        if (gap == sequence) {
+            return false;
+        }
+    }
+    if (sequence == 0 || sequence > source.records.size()) {
+        return false;
+    }
+    record = source.records[sequence - 1];
+    return true;
+}
+
+// Slowly changing samples, one every 5 s
+static RecordSource steadySource(size_t count) {
+    RecordSource source;
+    for (size_t i = 0; i < count; i++) {
+        source.records.push_back({1730419200u + 5 * (uint32_t)i, 5000u + 37 * (uint32_t)i,
+                                  (uint16_t)(2000 + (i % 7) * 11), (uint16_t)(i % 4)});
+    }
+    return source;
+}
+
+// The whole body, pulled through the encoder in chunks of chunkBytes
+static std::string encodeAll(RecordSource &source, HistoryBinEncoding encoding, uint32_t from, uint32_t to,
+                             size_t chunkBytes) {
+    HistoryBinaryEncoder encoder;
+    const uint32_t last = (uint32_t)source.records.size();
+    encoder.begin(readSourceRecord, &source, encoding, 1, last, last, from, to);
+    std::string body;
+    std::vector<char> chunk(chunkBytes);
+    size_t length;
+    while ((length = encoder.read(chunk.data(), chunk.size())) > 0) {
+        body.append(chunk.data(), length);
+    }
+    return body;
+}
+
+static void checkSameRows(const std::vector<HistoryBinRow> &rows, const RecordSource &source) {
+    size_t at = 0;
+    for (uint32_t sequence = 1; sequence <= source.records.size(); sequence++) {
+        HistoryRecord expected;
+        if (!readSourceRecord(const_cast<RecordSource *>(&source), sequence, expected)) {
+            continue;
+        }
+        REQUIRE(at < rows.size());
+        const HistoryBinRow &row = rows[at++];
+        CHECK_EQ(row.sequence, sequence);
+        CHECK_EQ(row.record.timestamp, expected.timestamp);
+        CHECK_EQ(row.record.powerCentiWatts, expected.powerCentiWatts);
+        CHECK_EQ(row.record.currentTenthMilliAmps, expected.currentTenthMilliAmps);
+        CHECK_EQ(row.record.relayMask, expected.relayMask);
+    }
+    CHECK_EQ(rows.size(), at);
+}
+
+TEST(history_binary_raw) {
+    RecordSource source = steadySource(100);
+    const std::string body = encodeAll(source, HistoryBinRaw, 0, UINT32_MAX, 7); // Rows split across reads
+    CHECK_EQ(body.size(), historyBinHeaderBytes + 100 * historyBinRawRowBytes);
+    CHECK_EQ(body.substr(0, 4), std::string("BHST"));
+
+    HistoryBinHeader header;
+    std::vector<HistoryBinRow> rows;
+    std::string error;
+    REQUIRE(decodeHistoryBinary(body.data(), body.size(), header, rows, &error));
+    CHECK_EQ(header.version, historyBinVersion);
+    CHECK_EQ(header.encoding, HistoryBinRaw);
+    CHECK_EQ(header.rowBytes, historyBinRawRowBytes);
+    CHECK_EQ(header.currentDecimals, 4);
+    CHECK_EQ(header.powerDecimals, 2);
+    CHECK_EQ(header.newestSequence, 100u);
+    checkSameRows(rows, source);
+}
+
+TEST(history_binary_delta) {
+    RecordSource source = steadySource(100);
+    const std::string body = encodeAll(source, HistoryBinDelta, 0, UINT32_MAX, 4096);
+    // One key row (two row widths) to start, then a plain delta row per record
+    CHECK_EQ(body.size(), historyBinHeaderBytes + 2 * historyBinDeltaRowBytes + 99 * historyBinDeltaRowBytes);
+
+    HistoryBinHeader header;
+    std::vector<HistoryBinRow> rows;
+    REQUIRE(decodeHistoryBinary(body.data(), body.size(), header, rows));
+    CHECK_EQ(header.encoding, HistoryBinDelta);
+    CHECK_EQ(header.rowBytes, historyBinDeltaRowBytes);
+    checkSameRows(rows, source);
+
+    // Same rows whatever the read size, down to one byte at a time
+    for (size_t chunk : {1, 5, 13, 23, 24, 25}) {
+        CHECK(encodeAll(source, HistoryBinDelta, 0, UINT32_MAX, chunk) == body);
+    }
+}
+
+TEST(history_binary_key_rows) {
+    RecordSource source = steadySource(40);
+    source.records[10].timestamp += 40000;               // Timestamp delta beyond i16
+    for (size_t i = 11; i < source.records.size(); i++) {
+        source.records[i].timestamp += 40000;
+    }
+    source.records[20].currentTenthMilliAmps = 60000;    // Current delta beyond i16
+    source.missing = {5, 30};                            // Sequence gaps of 2 still fit a delta row
+    for (uint32_t sequence = 31; sequence <= 40; sequence++) {
+        source.missing.push_back(sequence);              // ...but not once they pass 255 (below)
+    }
+    for (size_t i = 0; i < 300; i++) {
+        source.records.push_back(source.records.back());
+        source.records.back().timestamp += 5;
+        source.missing.push_back((uint32_t)source.records.size());
+    }
+    source.records.push_back(source.records.back());     // Sequence 341, 301 after the last readable one
+
+    const std::string body = encodeAll(source, HistoryBinDelta, 0, UINT32_MAX, 64);
+    HistoryBinHeader header;
+    std::vector<HistoryBinRow> rows;
+    std::string error;
+    REQUIRE(decodeHistoryBinary(body.data(), body.size(), header, rows, &error));
+    checkSameRows(rows, source);
+
+    // Rows 1, 11, 21 and 22 (back from 60000) and 341 are key rows
+    const size_t readable = 40 - 2 - 10 + 1;
+    const size_t keyRows = 5;
+    CHECK_EQ(rows.size(), readable);
+    CHECK_EQ(body.size(), historyBinHeaderBytes + (readable + keyRows) * historyBinDeltaRowBytes);
+}
+
+TEST(history_binary_window) {
+    RecordSource source = steadySource(100); // Stamped start + 0, 5, ..., 495
+    const uint32_t start = source.records[0].timestamp;
+    for (HistoryBinEncoding encoding : {HistoryBinRaw, HistoryBinDelta}) {
+        const std::string body = encodeAll(source, encoding, start + 100, start + 150, 512);
+        HistoryBinHeader header;
+        std::vector<HistoryBinRow> rows;
+        REQUIRE(decodeHistoryBinary(body.data(), body.size(), header, rows));
+        CHECK_EQ(header.from, start + 100);
+        CHECK_EQ(header.to, start + 150);
+        REQUIRE(rows.size() == 11u); // 100, 105, ..., 150
+        CHECK_EQ(rows.front().sequence, 21u);
+        CHECK_EQ(rows.front().record.timestamp, start + 100);
+        CHECK_EQ(rows.back().sequence, 31u);
+        CHECK_EQ(rows.back().record.timestamp, start + 150);
+    }
+
+    // A window with nothing in it is a header alone
+    const std::string empty = encodeAll(source, HistoryBinDelta, start + 1000, start + 2000, 512);
+    CHECK_EQ(empty.size(), historyBinHeaderBytes);
+}
+
+TEST(history_binary_rejects_bad_input) {
+    RecordSource source = steadySource(10);
+    for (HistoryBinEncoding encoding : {HistoryBinRaw, HistoryBinDelta}) {
+        const std::string body = encodeAll(source, encoding, 0, UINT32_MAX, 4096);
+        HistoryBinHeader header;
+        std::vector<HistoryBinRow> rows;
+        std::string error;
+        // Every cut inside the header or a row is an error; a cut between rows is a shorter valid body
+        const size_t firstRow = encoding == HistoryBinRaw ? historyBinRawRowBytes : 2 * historyBinDeltaRowBytes; // Key row
+        const size_t rowBytes = encoding == HistoryBinRaw ? historyBinRawRowBytes : historyBinDeltaRowBytes;
+        for (size_t length = 0; length < body.size(); length++) {
+            const bool betweenRows = length == historyBinHeaderBytes ||
+                                     (length >= historyBinHeaderBytes + firstRow &&
+                                      (length - historyBinHeaderBytes - firstRow) % rowBytes == 0);
+            error.clear();
+            CHECK_EQ(decodeHistoryBinary(body.data(), length, header, rows, &error), betweenRows);
+            CHECK_EQ(error.empty(), betweenRows);
+        }
+    }
+
+    const std::string body = encodeAll(source, HistoryBinRaw, 0, UINT32_MAX, 4096);
+    HistoryBinHeader header;
+    std::vector<HistoryBinRow> rows;
+    std::string error;
+    std::string badMagic = body;
+    badMagic[0] = 'X';
+    CHECK(!decodeHistoryBinary(badMagic.data(), badMagic.size(), header, rows, &error));
+    CHECK(error.find("magic") != std::string::npos);
+
+    std::string badVersion = body;
+    badVersion[4] = historyBinVersion + 1;
+    CHECK(!decodeHistoryBinary(badVersion.data(), badVersion.size(), header, rows, &error));
+
+    std::string badLayout = body;
+    badLayout[7] = historyBinDeltaRowBytes; // Raw encoding with the delta row width
+    CHECK(!decodeHistoryBinary(badLayout.data(), badLayout.size(), header, rows, &error));
+
+    // Incremental feeding reports the bad magic as soon as it is seen
+    HistoryBinaryDecoder decoder;
+    CHECK(!decoder.feed(badMagic.data(), 6));
+    CHECK(!decoder.finish());
+}
@@ -0,0 +1,116 @@
+// /historicalData (handleHistoricalData in main.cpp): since/limit windows, the ETag and 304, and rows
+// torn on flash left out without stepping past since
+
+#include <string>
+#include <vector>
+
+#include "TestSupport.h"
+#include "src/HistoryLog.h"
+
+// Sequence numbers of the rows in a /historicalData body, in order (newest first)
+static std::vector<uint32_t> rowSequences(const std::string &body) {
+    std::vector<uint32_t> sequences;
+    for (size_t at = body.find("{\"seq\":"); at != std::string::npos; at = body.find("{\"seq\":", at + 1)) {
+        sequences.push_back((uint32_t)jsonNumber(body, "seq", at));
+    }
+    return sequences;
+}
+
+// Newest first, from newest down to oldest
+static std::vector<uint32_t> descending(uint32_t newest, uint32_t oldest) {
+    std::vector<uint32_t> sequences;
+    for (uint32_t sequence = newest; sequence >= oldest && sequence > 0; sequence--) {
+        sequences.push_back(sequence);
+    }
+    return sequences;
+}
+
+static HistoryRecord recordFor(uint32_t sequence) {
+    return {1730419200u + 5 * sequence, 100u * sequence, (uint16_t)sequence, 0};
+}
+
+static std::vector<uint32_t> rowsOf(const std::string &uri) {
+    const HostHttpResponse response = httpGet(uri.c_str());
+    CHECK_EQ(response.code, 200);
+    return rowSequences(response.body);
+}
+
+TEST(history_data_since_limit) {
+    bootSketch("history_data_since_limit");
+    runSketch(62000000); // A sample every 5 s
+    const HostHttpResponse all = httpGet("/historicalData");
+    CHECK_EQ(all.code, 200);
+    const uint32_t last = (uint32_t)jsonNumber(all.body, "lastSeq");
+    REQUIRE(last >= 12);
+
+    // The newest historyPageRows rows by default, fewer with limit=, all of them with a large one
+    CHECK(rowSequences(all.body) == descending(last, last - 9));
+    CHECK(rowsOf("/historicalData?limit=3") == descending(last, last - 2));
+    CHECK(rowsOf("/historicalData?limit=100") == descending(last, 1));
+
+    // since= leaves out what the client already has; with limit= the newest of those come first
+    const std::string since = "/historicalData?since=" + std::to_string(last - 4);
+    CHECK(rowsOf(since) == descending(last, last - 3));
+    CHECK(rowsOf(since + "&limit=2") == descending(last, last - 1));
+    CHECK(rowsOf("/historicalData?since=" + std::to_string(last)).empty());
+    CHECK(rowsOf("/historicalData?since=" + std::to_string(last + 5)).empty());
+    CHECK(rowsOf("/historicalData?since=0&limit=100") == descending(last, 1));
+
+    CHECK_EQ(httpGet("/historicalData?limit=0").code, 400);
+    CHECK_EQ(httpGet("/historicalData?since=abc").code, 400);
+}
+
+TEST(history_data_etag) {
+    bootSketch("history_data_etag");
+    runSketch(12000000);
+    const HostHttpResponse first = httpGet("/historicalData");
+    const std::string etag = responseHeader(first, "ETag");
+    CHECK(!etag.empty());
+    CHECK_EQ(responseHeader(first, "Cache-Control"), std::string("no-cache"));
+
+    // Nothing new: 304 without a body
+    const HostHttpResponse again = httpGet("/historicalData", {{"If-None-Match", etag}});
+    CHECK_EQ(again.code, 304);
+    CHECK(again.body.empty());
+    CHECK_EQ(responseHeader(again, "ETag"), etag);
+
+    // Another window is another body, so its validator differs even with nothing new recorded
+    const HostHttpResponse limited = httpGet("/historicalData?limit=1", {{"If-None-Match", etag}});
+    CHECK_EQ(limited.code, 200);
+    CHECK_EQ(rowSequences(limited.body).size(), 1u);
+    CHECK(responseHeader(limited, "ETag") != etag);
+    CHECK_EQ(httpGet("/historicalData?since=1", {{"If-None-Match", etag}}).code, 200);
+    CHECK_EQ(httpGet("/historicalData?limit=1", {{"If-None-Match", responseHeader(limited, "ETag")}}).code, 304);
+
+    // A new sample changes it
+    runSketch(5000000);
+    const HostHttpResponse newer = httpGet("/historicalData", {{"If-None-Match", etag}});
+    CHECK_EQ(newer.code, 200);
+    CHECK(responseHeader(newer, "ETag") != etag);
+    CHECK_EQ(jsonNumber(newer.body, "lastSeq"), jsonNumber(first.body, "lastSeq") + 1);
+}
+
+TEST(history_data_torn_rows) {
+    // An earlier run's log, sample 11 torn by a power cut
+    REQUIRE(hostFlashOpen(testFile("history_data_torn_rows", "_flash.bin").c_str()));
+    HistoryLog log;
+    REQUIRE(log.begin());
+    for (uint32_t sequence = 1; sequence <= 10; sequence++) {
+        REQUIRE(log.append(recordFor(sequence)));
+    }
+    hostFlashCutPower(5);
+    log.append(recordFor(11));
+    hostFlashRestorePower();
+    HistoryLog rebooted; // The torn slot keeps its sequence number
+    REQUIRE(rebooted.begin());
+    for (uint32_t sequence = 12; sequence <= 20; sequence++) {
+        REQUIRE(rebooted.append(recordFor(sequence)));
+    }
+    testFile("history_data_torn_rows", "_settings.bin");
+    bootSketch("history_data_torn_rows", true);
+
+    // The torn row is left out; the rows stop at since= rather than filling in from below it
+    CHECK(rowsOf("/historicalData?since=10&limit=10") == std::vector<uint32_t>({20, 19, 18, 17, 16, 15, 14, 13, 12}));
+    CHECK(rowsOf("/historicalData?limit=10") == std::vector<uint32_t>({20, 19, 18, 17, 16, 15, 14, 13, 12, 10}));
+    CHECK(rowsOf("/historicalData?since=11") == descending(20, 12));
+}
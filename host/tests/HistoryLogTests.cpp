@@ -0,0 +1,162 @@
+// Flash history log (src/HistoryLog.h): recovery after reboots and power cuts on a small simulated partition
+
+#include "TestSupport.h"
+#include "src/HistoryLog.h"
+
+static const size_t testSegments = 4; // 1020 records, so a test wraps around quickly
+
+// Stands for the sample with this sequence number
+static HistoryRecord recordFor(uint32_t sequence) {
+    return {1730419200u + 5 * sequence, 100u * sequence, (uint16_t)(sequence * 7), (uint16_t)(sequence & 3)};
+}
+
+static bool sameRecord(const HistoryRecord &a, const HistoryRecord &b) {
+    return a.timestamp == b.timestamp && a.powerCentiWatts == b.powerCentiWatts &&
+           a.currentTenthMilliAmps == b.currentTenthMilliAmps && a.relayMask == b.relayMask;
+}
+
+// A fresh partition of testSegments sectors
+static void openFlash(const char *name) {
+    REQUIRE(hostFlashOpen(testFile(name, "_flash.bin").c_str(), testSegments * 4096));
+}
+
+static void appendUpTo(HistoryLog &log, uint32_t lastSequence) {
+    while (log.lastSequence() < lastSequence) {
+        REQUIRE(log.append(recordFor(log.lastSequence() + 1)));
+    }
+}
+
+// Every held record reads back as written, except those in torn
+static void checkRecords(const HistoryLog &log, std::initializer_list<uint32_t> torn = {}) {
+    for (uint32_t sequence = log.firstSequence(); sequence <= log.lastSequence(); sequence++) {
+        bool isTorn = false;
+        for (uint32_t lost : torn) {
+            isTorn = isTorn || lost == sequence;
+        }
+        HistoryRecord record;
+        const bool readable = log.read(sequence, record);
+        CHECK_EQ(readable, !isTorn);
+        if (readable) {
+            CHECK(sameRecord(record, recordFor(sequence)));
+        }
+    }
+}
+
+TEST(history_log_reboot) {
+    openFlash("history_log_reboot");
+    HistoryLog log;
+    REQUIRE(log.begin());
+    CHECK_EQ(log.capacity(), testSegments * HistoryLog::slotsPerSegment);
+    CHECK_EQ(log.size(), 0u);
+    appendUpTo(log, 300); // Into the second segment
+
+    HistoryLog rebooted;
+    REQUIRE(rebooted.begin());
+    CHECK_EQ(rebooted.recoveredRecords(), 300u);
+    CHECK_EQ(rebooted.firstSequence(), 1u);
+    CHECK_EQ(rebooted.lastSequence(), 300u);
+    checkRecords(rebooted);
+
+    // Appends carry on from the recovered sequence number, in place
+    appendUpTo(rebooted, 310);
+    HistoryLog again;
+    REQUIRE(again.begin());
+    CHECK_EQ(again.lastSequence(), 310u);
+    CHECK_EQ(again.segmentsErased(), 0u);
+    checkRecords(again);
+}
+
+TEST(history_log_torn_record) {
+    openFlash("history_log_torn_record");
+    HistoryLog log;
+    REQUIRE(log.begin());
+    appendUpTo(log, 10);
+
+    hostFlashCutPower(5); // Sequence 11 loses power five bytes into its slot
+    log.append(recordFor(11));
+    hostFlashRestorePower();
+
+    HistoryLog rebooted;
+    REQUIRE(rebooted.begin());
+    CHECK_EQ(rebooted.lastSequence(), 11u); // The torn slot keeps its sequence number
+    checkRecords(rebooted, {11});
+    CHECK_EQ(rebooted.corruptRecords(), 1u);
+
+    appendUpTo(rebooted, 20);
+    HistoryLog again;
+    REQUIRE(again.begin());
+    CHECK_EQ(again.lastSequence(), 20u);
+    checkRecords(again, {11});
+}
+
+TEST(history_log_torn_segment_header) {
+    openFlash("history_log_torn_segment_header");
+    HistoryLog log;
+    REQUIRE(log.begin());
+    appendUpTo(log, HistoryLog::slotsPerSegment); // First segment exactly full
+
+    // The next append erases segment 1 and loses power eight bytes into its header
+    hostFlashCutPower(8);
+    log.append(recordFor(HistoryLog::slotsPerSegment + 1));
+    hostFlashRestorePower();
+
+    HistoryLog rebooted;
+    REQUIRE(rebooted.begin());
+    CHECK_EQ(rebooted.lastSequence(), (uint32_t)HistoryLog::slotsPerSegment); // The half-written segment is skipped
+    checkRecords(rebooted);
+
+    // ...and reclaimed by the next append
+    appendUpTo(rebooted, HistoryLog::slotsPerSegment + 20);
+    HistoryLog again;
+    REQUIRE(again.begin());
+    CHECK_EQ(again.firstSequence(), 1u);
+    CHECK_EQ(again.lastSequence(), HistoryLog::slotsPerSegment + 20u);
+    checkRecords(again);
+
+    // Power lost before the next segment's erase leaves the log as it was
+    appendUpTo(again, 2 * HistoryLog::slotsPerSegment);
+    hostFlashCutPower(0);
+    again.append(recordFor(2 * HistoryLog::slotsPerSegment + 1));
+    hostFlashRestorePower();
+    HistoryLog third;
+    REQUIRE(third.begin());
+    CHECK_EQ(third.lastSequence(), 2u * HistoryLog::slotsPerSegment);
+    checkRecords(third);
+}
+
+TEST(history_log_wrap_around) {
+    openFlash("history_log_wrap_around");
+    HistoryLog log;
+    REQUIRE(log.begin());
+    const uint32_t total = (uint32_t)(testSegments * HistoryLog::slotsPerSegment * 2 + 100); // Twice round and then some
+    appendUpTo(log, total);
+
+    // The oldest segment goes as a new one starts: between three and four segments stay readable
+    CHECK_EQ(log.lastSequence(), total);
+    CHECK(log.size() > (testSegments - 1) * HistoryLog::slotsPerSegment);
+    CHECK(log.size() <= log.capacity());
+    CHECK_EQ((log.firstSequence() - 1) % HistoryLog::slotsPerSegment, 0u);
+    HistoryRecord record;
+    CHECK(!log.read(log.firstSequence() - 1, record)); // Overwritten
+    checkRecords(log);
+
+    HistoryLog rebooted;
+    REQUIRE(rebooted.begin());
+    CHECK_EQ(rebooted.firstSequence(), log.firstSequence());
+    CHECK_EQ(rebooted.lastSequence(), total);
+    checkRecords(rebooted);
+
+    // Every sector is erased once per pass, evenly
+    const HostFlashStats stats = hostFlashStats();
+    CHECK(stats.maxSectorErases <= stats.sectorsErased / testSegments + 1);
+
+    // A power cut right after the wrap still recovers
+    appendUpTo(rebooted, total + 200);
+    hostFlashCutPower(3);
+    rebooted.append(recordFor(total + 201));
+    hostFlashRestorePower();
+    HistoryLog again;
+    REQUIRE(again.begin());
+    CHECK_EQ(again.lastSequence(), total + 201);
+    checkRecords(again, {total + 201});
+}
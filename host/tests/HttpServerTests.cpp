@@ -0,0 +1,274 @@
+// HTTP server (src/HttpServer.h) on a loopback port of its own, driven by raw clients: keep-alive,
+// pipelining, slow clients, busy slots and the error answers
+
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "TestSupport.h"
+#include "src/HttpServer.h"
+
+static const uint16_t testPort = HTTP_SERVER_PORT + 1; // Clear of the sketch's server
+static HttpServer *testServer = nullptr;
+
+static void handleHello() {
+    testServer->send(200, "text/plain", "hello");
+}
+
+static void handleEcho() {
+    testServer->send(200, "text/plain", testServer->body(), testServer->bodyLength());
+}
+
+constexpr Route testRouteList[] = {
+    {HttpGet, "/hello", false, handleHello},
+    {HttpPut, "/hello", false, handleHello},
+    {HttpPost, "/echo", false, handleEcho},
+};
+constexpr RouteTable testRoutes(testRouteList);
+
+struct Response {
+    int code;
+    std::string headers;
+    std::string body;
+
+    bool hasHeader(const char *line) const { return headers.find(std::string("\r\n") + line + "\r\n") != std::string::npos; }
+};
+
+// The server on testPort, its clock in ms moved on by hand
+struct TestServer {
+    HttpServer server{testPort};
+    uint32_t now = 1000;
+
+    TestServer() {
+        testServer = &server;
+        REQUIRE(server.begin(testRoutes));
+    }
+
+    // Poll, giving loopback a moment to deliver, until done() or about a second has passed
+    template <typename Done>
+    bool pollUntil(Done done) {
+        for (int i = 0; i < 1000; i++) {
+            server.poll(now);
+            if (done()) {
+                return true;
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+};
+
+// Whole responses at the front of received, taken off it
+static std::vector<Response> takeResponses(std::string &received) {
+    std::vector<Response> responses;
+    for (;;) {
+        const size_t headerEnd = received.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) {
+            break;
+        }
+        Response response;
+        response.code = atoi(received.c_str() + 9); // "HTTP/1.1 200"
+        response.headers = received.substr(0, headerEnd + 2);
+        const size_t length = response.headers.find("Content-Length: ");
+        const size_t bodyLength = length != std::string::npos ? atoi(response.headers.c_str() + length + 16) : 0;
+        if (received.size() < headerEnd + 4 + bodyLength) {
+            break;
+        }
+        response.body = received.substr(headerEnd + 4, bodyLength);
+        received.erase(0, headerEnd + 4 + bodyLength);
+        responses.push_back(response);
+    }
+    return responses;
+}
+
+// Poll until count responses have arrived on fd
+static std::vector<Response> receiveResponses(TestServer &test, int fd, size_t count) {
+    std::string received;
+    std::vector<Response> responses;
+    test.pollUntil([&]() {
+        received += rawReceive(fd);
+        for (const Response &response : takeResponses(received)) {
+            responses.push_back(response);
+        }
+        return responses.size() >= count;
+    });
+    CHECK_EQ(responses.size(), count);
+    CHECK_EQ(received, std::string()); // Nothing more than that
+    return responses;
+}
+
+static Response exchange(TestServer &test, int fd, const std::string &request) {
+    REQUIRE(rawSend(fd, request));
+    std::vector<Response> responses = receiveResponses(test, fd, 1);
+    REQUIRE(responses.size() == 1);
+    return responses[0];
+}
+
+static bool closedByServer(TestServer &test, int fd) {
+    return test.pollUntil([&]() { return rawClosed(fd); });
+}
+
+TEST(http_server_keep_alive) {
+    TestServer test;
+    const int fd = rawConnect(testPort);
+    REQUIRE(fd >= 0);
+
+    // HTTP/1.1 keeps the connection for the next request
+    for (int i = 0; i < 3; i++) {
+        const Response response = exchange(test, fd, "GET /hello HTTP/1.1\r\nHost: bulb\r\n\r\n");
+        CHECK_EQ(response.code, 200);
+        CHECK_EQ(response.body, std::string("hello"));
+        CHECK(response.hasHeader("Connection: keep-alive"));
+        CHECK_EQ(test.server.connectionCount(), 1u);
+    }
+
+    // ...until the client asks to close it
+    const Response last = exchange(test, fd, "GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n");
+    CHECK_EQ(last.code, 200);
+    CHECK(last.hasHeader("Connection: close"));
+    CHECK(closedByServer(test, fd));
+    CHECK_EQ(test.server.connectionCount(), 0u);
+    rawClose(fd);
+
+    // HTTP/1.0 closes unless it asks for keep-alive
+    int old = rawConnect(testPort);
+    CHECK(exchange(test, old, "GET /hello HTTP/1.0\r\n\r\n").hasHeader("Connection: close"));
+    CHECK(closedByServer(test, old));
+    rawClose(old);
+    old = rawConnect(testPort);
+    CHECK(exchange(test, old, "GET /hello HTTP/1.0\r\nConnection: keep-alive\r\n\r\n").hasHeader("Connection: keep-alive"));
+    CHECK(!rawClosed(old));
+
+    // An idle kept-alive connection is closed after HTTP_KEEPALIVE_TIMEOUT_MS, without a response
+    test.now += HTTP_KEEPALIVE_TIMEOUT_MS - 1;
+    test.server.poll(test.now);
+    CHECK_EQ(test.server.connectionCount(), 1u);
+    test.now += 1;
+    CHECK(closedByServer(test, old));
+    CHECK_EQ(rawReceive(old), std::string());
+    CHECK_EQ(test.server.timedOutConnections(), 0u);
+    rawClose(old);
+}
+
+TEST(http_server_pipelined) {
+    TestServer test;
+    const int fd = rawConnect(testPort);
+    REQUIRE(fd >= 0);
+
+    // Three requests in one write, the middle one with a body: answered in order on the one connection
+    REQUIRE(rawSend(fd, "GET /hello HTTP/1.1\r\n\r\n"
+                        "POST /echo HTTP/1.1\r\nContent-Length: 11\r\n\r\npipelined!!"
+                        "PUT /hello HTTP/1.1\r\n\r\n"));
+    const std::vector<Response> responses = receiveResponses(test, fd, 3);
+    REQUIRE(responses.size() == 3);
+    CHECK_EQ(responses[0].body, std::string("hello"));
+    CHECK_EQ(responses[1].body, std::string("pipelined!!"));
+    CHECK_EQ(responses[2].body, std::string("hello"));
+
+    // A second request split across writes, the next one starting in the same packet as the body's end
+    REQUIRE(rawSend(fd, "POST /echo HTTP/1.1\r\nContent-"));
+    test.server.poll(test.now);
+    REQUIRE(rawSend(fd, "Length: 4\r\n\r\nab"));
+    test.server.poll(test.now);
+    REQUIRE(rawSend(fd, "cdGET /hello HTTP/1.1\r\nConnection: close\r\n\r\n"));
+    const std::vector<Response> split = receiveResponses(test, fd, 2);
+    REQUIRE(split.size() == 2);
+    CHECK_EQ(split[0].body, std::string("abcd"));
+    CHECK_EQ(split[1].body, std::string("hello"));
+    CHECK(closedByServer(test, fd));
+    rawClose(fd);
+}
+
+TEST(http_server_slow_client) {
+    TestServer test;
+
+    // A client that stops part way through its request holds its own slot and nothing else
+    const int slow = rawConnect(testPort);
+    REQUIRE(slow >= 0);
+    REQUIRE(rawSend(slow, "GET /hel"));
+    REQUIRE(test.pollUntil([&]() { return test.server.connectionCount() == 1; }));
+    for (int i = 0; i < 5; i++) {
+        const int fd = rawConnect(testPort);
+        CHECK_EQ(exchange(test, fd, "GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n").code, 200);
+        CHECK(closedByServer(test, fd));
+        rawClose(fd);
+    }
+
+    // With every slot taken, one more connection is turned away with 503
+    int idle[HTTP_MAX_CONNECTIONS - 1];
+    for (int &fd : idle) {
+        fd = rawConnect(testPort);
+        REQUIRE(fd >= 0);
+    }
+    REQUIRE(test.pollUntil([&]() { return test.server.connectionCount() == HTTP_MAX_CONNECTIONS; }));
+    const int extra = rawConnect(testPort);
+    std::vector<Response> busy = receiveResponses(test, extra, 1);
+    REQUIRE(busy.size() == 1);
+    CHECK_EQ(busy[0].code, 503);
+    CHECK(closedByServer(test, extra));
+    CHECK_EQ(test.server.rejectedConnections(), 1u);
+    rawClose(extra);
+
+    // The partial request times out HTTP_REQUEST_TIMEOUT_MS after its first byte, with 408
+    test.now += HTTP_REQUEST_TIMEOUT_MS - 1;
+    test.server.poll(test.now);
+    CHECK_EQ(rawReceive(slow), std::string());
+    test.now += 1;
+    std::vector<Response> timeout = receiveResponses(test, slow, 1);
+    REQUIRE(timeout.size() == 1);
+    CHECK_EQ(timeout[0].code, 408);
+    CHECK(closedByServer(test, slow));
+    CHECK_EQ(test.server.timedOutConnections(), 1u);
+    rawClose(slow);
+
+    // The freed slot serves the next client while the idle ones wait
+    const int next = rawConnect(testPort);
+    CHECK_EQ(exchange(test, next, "GET /hello HTTP/1.1\r\n\r\n").code, 200);
+    CHECK_EQ(test.server.connectionCount(), (size_t)HTTP_MAX_CONNECTIONS);
+    rawClose(next);
+    for (int fd : idle) {
+        rawClose(fd);
+    }
+    REQUIRE(test.pollUntil([&]() { return test.server.connectionCount() == 0; }));
+}
+
+TEST(http_server_errors) {
+    TestServer test;
+    const int fd = rawConnect(testPort);
+    REQUIRE(fd >= 0);
+
+    // No route: 404; a route for other methods: 405 naming them. Both keep the connection.
+    const Response missing = exchange(test, fd, "GET /nothing HTTP/1.1\r\n\r\n");
+    CHECK_EQ(missing.code, 404);
+    const Response wrongMethod = exchange(test, fd, "POST /hello HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+    CHECK_EQ(wrongMethod.code, 405);
+    CHECK(wrongMethod.hasHeader("Allow: GET, PUT"));
+    const Response unknownMethod = exchange(test, fd, "BREW /hello HTTP/1.1\r\n\r\n");
+    CHECK_EQ(unknownMethod.code, 405);
+    CHECK(unknownMethod.hasHeader("Allow: GET, PUT"));
+    CHECK_EQ(exchange(test, fd, "GET /hello?x=1 HTTP/1.1\r\n\r\n").code, 200); // Still open, still in step
+    rawClose(fd);
+
+    // A body that could not fit the request buffer: 413 from the headers alone, then closed
+    int large = rawConnect(testPort);
+    const Response tooLarge = exchange(test, large, "POST /echo HTTP/1.1\r\nContent-Length: 5000\r\n\r\n");
+    CHECK_EQ(tooLarge.code, 413);
+    CHECK(closedByServer(test, large));
+    rawClose(large);
+
+    // Headers that fill the buffer without ending: 431, then closed
+    large = rawConnect(testPort);
+    std::string headers = "GET /hello HTTP/1.1\r\nX-Padding: ";
+    headers.append(HTTP_REQUEST_BUFFER_BYTES - headers.size(), 'x');
+    const Response tooLong = exchange(test, large, headers);
+    CHECK_EQ(tooLong.code, 431);
+    CHECK(closedByServer(test, large));
+    rawClose(large);
+
+    // Malformed Content-Length: 400
+    large = rawConnect(testPort);
+    CHECK_EQ(exchange(test, large, "POST /echo HTTP/1.1\r\nContent-Length: -3\r\n\r\n").code, 400);
+    CHECK(closedByServer(test, large));
+    rawClose(large);
+}
@@ -0,0 +1,165 @@
+// Deferred serial log (src/Log.h): formatting, a full ring, a busy UART and several producers at once,
+// then the sketch's own records reaching Serial through loop()
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TestSupport.h"
+#include "src/Log.h"
+
+// Drain until the ring is empty, with room bytes of UART space per drain
+static std::string drainAll(int room = -1) {
+    std::string output;
+    hostSetSerialEcho(false);
+    hostSetSerialCapture(&output);
+    for (int drains = 0; drains < 100000 && logPending(); drains++) {
+        hostSetSerialRoom(room);
+        logDrain();
+    }
+    hostSetSerialRoom(-1);
+    hostSetSerialCapture(nullptr);
+    return output;
+}
+
+TEST(log_format) {
+    hostClockAdvance(1234000);
+    LOG_INFO("Relays %u of %d, %.2f W at %t", 2u, -3, 12345u, 1730419200u);
+    LOG_WARN("%s: 100%% %x", "Sensor", 7);
+    LOG_ERROR("No arguments");
+    LOG_DEBUG("Compiled out at the default level %u", 1u);
+    LOG_INFO("Missing %u and %u", 1u); // A missing argument reads as 0
+    CHECK(logPending());
+    CHECK_EQ(drainAll(), std::string("1234 I Relays 2 of -3, 123.45 W at 2024-11-01 00:00:00\r\n"
+                                     "1234 W Sensor: 100% ?\r\n"
+                                     "1234 E No arguments\r\n"
+                                     "1234 I Missing 1 and 0\r\n"));
+    CHECK(!logPending());
+
+    // A line longer than the buffer is cut off, still ending in a line break
+    static const char longText[] =
+        "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789"
+        "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789";
+    LOG_INFO("%s", longText);
+    const std::string line = drainAll();
+    CHECK(line.size() < 160);
+    CHECK_EQ(line.substr(line.size() - 2), std::string("\r\n"));
+    CHECK_EQ(line.find("1234 I 0123456789"), 0u);
+}
+
+TEST(log_ring_full) {
+    // Nothing drains: records past the ring's size are dropped and counted, the oldest ones kept
+    for (uint32_t i = 0; i < LOG_RING_RECORDS + 3; i++) {
+        const uintptr_t args[] = {i};
+        CHECK_EQ(logWrite(LOG_LEVEL_INFO, "Record %u", args, 1), i < LOG_RING_RECORDS);
+    }
+    CHECK_EQ(logDroppedRecords(), 3u);
+
+    // A busy UART: a few bytes per drain, lines picked up where the last drain stopped
+    std::string expected = "0 W 3 log records dropped\r\n";
+    for (uint32_t i = 0; i < LOG_RING_RECORDS; i++) {
+        expected += "0 I Record " + std::to_string(i) + "\r\n";
+    }
+    CHECK_EQ(drainAll(7), expected);
+
+    // No room at all: nothing is written and the records wait
+    LOG_INFO("Waiting");
+    std::string output;
+    hostSetSerialCapture(&output);
+    hostSetSerialRoom(0);
+    logDrain();
+    CHECK(output.empty());
+    CHECK(logPending());
+    hostSetSerialRoom(-1);
+    hostSetSerialCapture(nullptr);
+    CHECK_EQ(drainAll(), std::string("0 I Waiting\r\n"));
+    CHECK_EQ(logDroppedRecords(), 3u);
+}
+
+TEST(log_producers) {
+    // Four tasks logging at once while loop() drains: every record arrives once and whole, each
+    // producer's in order, or is counted as dropped. Two of them retry until the ring takes their
+    // records (each refusal counts as a drop too), so drains have to keep up while they run.
+    const uint32_t perProducer = 20000;
+    std::atomic<int> running{4};
+    std::atomic<uint32_t> retries{0};
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < 4; producer++) {
+        producers.emplace_back([producer, &running, &retries] {
+            for (uint32_t i = 0; i < perProducer; i++) {
+                const uintptr_t args[] = {producer, i};
+                while (!logWrite(LOG_LEVEL_INFO, "p%u %u", args, 2) && producer % 2 == 1) {
+                    retries++;
+                    std::this_thread::yield();
+                }
+            }
+            running--;
+        });
+    }
+    std::string output;
+    hostSetSerialEcho(false);
+    hostSetSerialCapture(&output);
+    while (running > 0) {
+        logDrain();
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+    hostSetSerialCapture(nullptr);
+    output += drainAll();
+
+    int64_t last[4] = {-1, -1, -1, -1};
+    uint32_t received[4] = {};
+    uint32_t droppedReported = 0;
+    for (size_t at = 0; at < output.size();) {
+        const size_t end = output.find("\r\n", at);
+        REQUIRE(end != std::string::npos);
+        const std::string line = output.substr(at, end - at);
+        unsigned producer;
+        unsigned index;
+        unsigned count;
+        if (sscanf(line.c_str(), "0 I p%u %u", &producer, &index) == 2) {
+            REQUIRE(producer < 4);
+            CHECK((int64_t)index > last[producer]);
+            last[producer] = index;
+            received[producer]++;
+        } else if (sscanf(line.c_str(), "0 W %u log records dropped", &count) == 1) {
+            droppedReported += count;
+        } else {
+            CHECK(false);
+            printf("unexpected line: %s\n", line.c_str());
+        }
+        at = end + 2;
+    }
+    CHECK_EQ(received[1], perProducer);
+    CHECK_EQ(received[3], perProducer);
+    CHECK_EQ(received[0] + received[2] + logDroppedRecords() - retries, 2 * perProducer);
+    CHECK_EQ(droppedReported, logDroppedRecords());
+}
+
+TEST(log_sketch) {
+    std::string output;
+    hostSetSerialCapture(&output);
+    bootSketch("log_sketch");
+    CHECK(output.empty()); // setup() only queues
+    runSketch(10000);
+    CHECK(output.find(" I Server started\r\n") != std::string::npos);
+    CHECK(output.find(" I Boot phase ") != std::string::npos);
+
+    // A handler's record reaches Serial on a later pass of loop(), stamped when it was logged
+    output.clear();
+    const uint64_t requested = millis();
+    CHECK_EQ(httpGet("/turnOnAll").code, 200);
+    const uint64_t answered = millis();
+    runSketch(10000);
+    const size_t at = output.find(" I Turning on all bulbs\r\n");
+    REQUIRE(at != std::string::npos);
+    const size_t lineStart = output.rfind('\n', at) == std::string::npos ? 0 : output.rfind('\n', at) + 1;
+    const uint32_t stamp = (uint32_t)strtoul(output.c_str() + lineStart, nullptr, 10);
+    CHECK(stamp >= requested && stamp <= answered);
+    hostSetSerialCapture(nullptr);
+}
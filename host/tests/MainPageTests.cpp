@@ -0,0 +1,46 @@
+// The page at / (handleRoot in main.cpp, src/MainPage.h): served gzipped from flash with a strong ETag,
+// and 304 when the browser's copy is current
+
+#include <Arduino.h>
+#include <string.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/MainPage.h"
+
+TEST(main_page_gzip) {
+    bootSketch("main_page_gzip");
+    const HostHttpResponse page = httpGet("/");
+    CHECK_EQ(page.code, 200);
+    CHECK_EQ(page.contentType, std::string("text/html"));
+    CHECK_EQ(responseHeader(page, "Content-Encoding"), std::string("gzip"));
+    CHECK_EQ(responseHeader(page, "ETag"), std::string(MAIN_PAGE_ETAG));
+    CHECK_EQ(responseHeader(page, "Cache-Control"), std::string("public, max-age=86400"));
+
+    // The flash blob as it is: gzip magic and deflate method, and a trailer giving the inflated size
+    REQUIRE(page.body.size() == MAIN_PAGE_GZ_LENGTH);
+    CHECK(memcmp(page.body.data(), MAIN_PAGE_GZ, MAIN_PAGE_GZ_LENGTH) == 0);
+    CHECK_EQ((uint8_t)page.body[0], 0x1f);
+    CHECK_EQ((uint8_t)page.body[1], 0x8b);
+    CHECK_EQ((uint8_t)page.body[2], 8);
+    uint32_t inflated;
+    memcpy(&inflated, page.body.data() + page.body.size() - 4, sizeof(inflated));
+    CHECK(inflated > 2 * page.body.size());
+}
+
+TEST(main_page_revalidate) {
+    bootSketch("main_page_revalidate");
+
+    // The browser's copy is current: 304, no body, the same validator and caching
+    const HostHttpResponse current = httpGet("/", {{"If-None-Match", MAIN_PAGE_ETAG}});
+    CHECK_EQ(current.code, 304);
+    CHECK(current.body.empty());
+    CHECK_EQ(responseHeader(current, "ETag"), std::string(MAIN_PAGE_ETAG));
+    CHECK_EQ(responseHeader(current, "Cache-Control"), std::string("public, max-age=86400"));
+    CHECK(responseHeader(current, "Content-Encoding").empty());
+
+    // Any other validator (an older page, a weak one) gets the page
+    CHECK_EQ(httpGet("/", {{"If-None-Match", "\"0000000000000000\""}}).code, 200);
+    CHECK_EQ(httpGet("/", {{"If-None-Match", std::string("W/") + MAIN_PAGE_ETAG}}).body.size(), MAIN_PAGE_GZ_LENGTH);
+}
@@ -0,0 +1,143 @@
+// Instrumentation (src/Metrics.h): the histogram and the chunked Prometheus writer on their own, then
+// /metrics from the sketch counting what it was asked to do
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/Metrics.h"
+
+TEST(latency_histogram_buckets) {
+    LatencyHistogram histogram;
+    histogram.record(0);
+    histogram.record(255);        // Under 2^8 cycles: bucket 0
+    histogram.record(256);        // Bucket 1 up to 511
+    histogram.record(511);
+    histogram.record(512);        // Bucket 2
+    histogram.record(UINT32_MAX); // Past the last bound: the last bucket
+    CHECK_EQ(histogram.bucketCount(0), 2u);
+    CHECK_EQ(histogram.bucketCount(1), 2u);
+    CHECK_EQ(histogram.bucketCount(2), 1u);
+    CHECK_EQ(histogram.bucketCount(LatencyHistogram::buckets - 1), 1u);
+    CHECK_EQ(histogram.count(), 6u);
+    CHECK_EQ(histogram.sumCycles(), 255u + 256 + 511 + 512 + (uint64_t)UINT32_MAX);
+    CHECK_EQ(histogram.maxCycles(), UINT32_MAX);
+}
+
+// A fixed set of metrics, as writeMetrics() in the sketch makes them
+static void writeSample(MetricsWriter &writer, const LatencyHistogram &histogram) {
+    writer.describe("test_requests_total", "counter", "Requests");
+    writer.value("test_requests_total", "route=\"/a\"", 12);
+    writer.value("test_requests_total", nullptr, 18446744073709551615ULL);
+    writer.describe("test_drift", "gauge", "Drift");
+    writer.signedValue("test_drift", nullptr, -42);
+    writer.describe("test_seconds_total", "counter", "Seconds");
+    writer.fixedValue("test_seconds_total", nullptr, 1000005, 6);
+    writer.fixedValue("test_seconds_total", "a=\"b\"", 7, 4);
+    writer.describe("test_latency_seconds", "histogram", "Latency");
+    writer.histogram("test_latency_seconds", nullptr, histogram);
+    writer.histogram("test_latency_seconds", "route=\"/a\"", histogram);
+}
+
+TEST(metrics_writer_chunks) {
+    LatencyHistogram histogram;
+    histogram.record(100);  // 100 ns on the host, where a cycle is a nanosecond
+    histogram.record(1000);
+
+    static char whole[16384];
+    MetricsWriter writer;
+    writer.begin(whole, sizeof(whole), 0);
+    writeSample(writer, histogram);
+    const std::string text(whole, writer.length());
+    CHECK_EQ(text.find("# HELP test_requests_total Requests\n# TYPE test_requests_total counter\n"
+                       "test_requests_total{route=\"/a\"} 12\ntest_requests_total 18446744073709551615\n"),
+             0u);
+    CHECK(text.find("\ntest_drift -42\n") != std::string::npos);
+    CHECK(text.find("\ntest_seconds_total 1.000005\ntest_seconds_total{a=\"b\"} 0.0007\n") != std::string::npos);
+    CHECK(text.find("\ntest_latency_seconds_bucket{le=\"2.56e-07\"} 1\n") != std::string::npos);
+    CHECK(text.find("\ntest_latency_seconds_bucket{le=\"5.12e-07\"} 1\n") != std::string::npos);
+    CHECK(text.find("\ntest_latency_seconds_bucket{le=\"1.02e-06\"} 2\n") != std::string::npos);
+    CHECK(text.find("\ntest_latency_seconds_bucket{le=\"+Inf\"} 2\ntest_latency_seconds_sum 0.000001100\n"
+                    "test_latency_seconds_count 2\n") != std::string::npos);
+    CHECK(text.find("\ntest_latency_seconds_bucket{route=\"/a\",le=\"+Inf\"} 2\n"
+                    "test_latency_seconds_sum{route=\"/a\"} 0.000001100\ntest_latency_seconds_count{route=\"/a\"} 2\n") !=
+          std::string::npos);
+
+    // Chunk by chunk, each as small as the longest line allows: the same text with no line split or repeated
+    for (size_t capacity : {80, 97, 256}) {
+        std::string chunked;
+        size_t linesSent = 0;
+        char chunk[256];
+        for (size_t chunks = 0; chunks < 1000; chunks++) {
+            writer.begin(chunk, capacity, linesSent);
+            writeSample(writer, histogram);
+            if (writer.length() == 0) {
+                break;
+            }
+            CHECK_EQ(chunk[writer.length() - 1], '\n');
+            chunked.append(chunk, writer.length());
+            linesSent = writer.lines();
+        }
+        CHECK_EQ(chunked, text);
+    }
+}
+
+static size_t countOf(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+// The value of the sample line that starts with series, followed by a space; NAN if there is none
+static double metricValue(const std::string &text, const std::string &series) {
+    const size_t at = text.find("\n" + series + " ");
+    return at != std::string::npos ? strtod(text.c_str() + at + series.size() + 2, nullptr) : NAN;
+}
+
+TEST(metrics_sketch) {
+    bootSketch("metrics_sketch");
+    CHECK_EQ(httpGet("/toggleBulb1").code, 200);
+    CHECK_EQ(httpGet("/toggleBulb2").code, 200);
+    CHECK_EQ(httpGet("/energy").code, 200);
+    CHECK_EQ(httpGet("/nothing").code, 404);
+    CHECK_EQ(httpPost("/energy", "").code, 405);
+    runSketch(100000);
+
+    // One whole exposition over several chunks: every family once, ending with the last
+    const HostHttpResponse response = httpGet("/metrics");
+    CHECK_EQ(response.code, 200);
+    const std::string &text = response.body;
+    CHECK(text.size() > 16384);
+    CHECK_EQ(countOf(text, "# TYPE "), countOf(text, "# HELP "));
+    CHECK_EQ(countOf(text, "# TYPE bulb_loop_seconds histogram\n"), 1u);
+    CHECK_EQ(countOf(text, "\nbulb_loop_seconds_count "), 1u);
+    CHECK_EQ(text.substr(text.rfind("# HELP ")), std::string("# HELP bulb_uptime_seconds Seconds since boot\n"
+                                                              "# TYPE bulb_uptime_seconds gauge\nbulb_uptime_seconds 0\n"));
+
+    // Requests by route, including the prefix routes, and the ones that matched nothing
+    CHECK_EQ(metricValue(text, "bulb_http_requests_total{route=\"/toggleBulb*\",method=\"GET\"}"), 2);
+    CHECK_EQ(metricValue(text, "bulb_http_requests_total{route=\"/energy\",method=\"GET\"}"), 1);
+    CHECK_EQ(metricValue(text, "bulb_http_requests_total{route=\"/batch\",method=\"POST\"}"), 0);
+    CHECK_EQ(metricValue(text, "bulb_http_handler_seconds_count{route=\"/toggleBulb*\",method=\"GET\"}"), 2);
+    CHECK_EQ(metricValue(text, "bulb_http_not_found_total"), 1);
+    CHECK_EQ(metricValue(text, "bulb_http_method_not_allowed_total"), 1);
+    CHECK(metricValue(text, "bulb_loop_seconds_count") > 0);
+    CHECK(metricValue(text, "bulb_control_step_seconds_count") > 0);
+    CHECK_EQ(metricValue(text, "bulb_overcurrent_trips_total{limit=\"instant\"}"), 0);
+
+    // A trip is counted under its limit, with its latency
+    hostSetCurrentWaveform(hostSineWaveform(8.0f));
+    runSketch(100000);
+    hostSetCurrentWaveform(hostSineWaveform(0.0f));
+    runSketch(10000);
+    const std::string tripped = httpGet("/metrics").body;
+    CHECK_EQ(metricValue(tripped, "bulb_overcurrent_trips_total{limit=\"instant\"}"), 1);
+    CHECK_EQ(metricValue(tripped, "bulb_overcurrent_trips_total{limit=\"i2t\"}"), 0);
+    CHECK_EQ(metricValue(tripped, "bulb_overcurrent_tripped"), 1);
+    CHECK_EQ(metricValue(tripped, "bulb_trip_latency_seconds_count"), 1);
+    CHECK_EQ(metricValue(tripped, "bulb_http_requests_total{route=\"/metrics\",method=\"GET\"}"), 2); // This scrape counts itself
+}
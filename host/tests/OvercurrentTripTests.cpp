@@ -0,0 +1,208 @@
+// Overcurrent protection (src/OvercurrentTrip.h): readings fed straight to add(), as the sampler's timer would
+
+#include <Arduino.h>
+
+#include "TestSupport.h"
+#include "src/OvercurrentTrip.h"
+#include "src/hal/hal.h"
+
+static const uint16_t zero = 2048;
+static const uint8_t relayPins[] = {33, 25};
+static const uint64_t relayOutputs = (1ULL << 33) | (1ULL << 25);
+static const uint8_t otherPin = 2; // Not a relay output: a trip leaves it alone
+
+static void feed(OvercurrentTrip &trip, int32_t distance, uint32_t readings) {
+    for (uint32_t i = 0; i < readings; i++) {
+        trip.add((uint16_t)(zero + ((i & 1) ? -distance : distance))); // Both half-waves count
+    }
+}
+
+// Close both relays, as the control task would
+static void closeRelays(OvercurrentTrip &trip) {
+    hal::writeOutputs(relayOutputs | (1ULL << otherPin), 0);
+    trip.relaysChanged(0x3);
+}
+
+static void checkRelaysOpen(bool open) {
+    for (uint8_t pin : relayPins) {
+        CHECK_EQ(hostPinLevel(pin), open ? LOW : HIGH);
+    }
+}
+
+TEST(overcurrent_trip_instant) {
+    OvercurrentTrip trip;
+    // Peak limit of 500 counts for 3 readings, after 100 readings of inrush; the heat limit is out of reach
+    trip.begin(zero, {500, 3, 100, 400u * 400u, INT64_MAX}, relayOutputs, nullptr);
+    feed(trip, 0, 10);
+    closeRelays(trip);
+
+    // Inrush: far over the limit, but ignored until the allowance runs out
+    feed(trip, 800, 100);
+    CHECK(!trip.tripped());
+
+    // Two readings over, then one under: the count starts again
+    feed(trip, 800, 2);
+    feed(trip, 100, 1);
+    feed(trip, 800, 2);
+    CHECK(!trip.tripped());
+    checkRelaysOpen(false);
+
+    // The third consecutive one trips
+    feed(trip, 800, 1);
+    CHECK(trip.tripped());
+    checkRelaysOpen(true);
+    CHECK_EQ(hostPinLevel(otherPin), HIGH);
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripInstant), 1u);
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripI2t), 0u);
+
+    OvercurrentTrip::Fault fault;
+    REQUIRE(trip.takeFault(fault));
+    CHECK_EQ(fault.kind, OvercurrentTrip::TripInstant);
+    CHECK_EQ(fault.relays, 0x3);
+    CHECK_EQ(fault.detectReadings, 3u);
+    CHECK_EQ(fault.peakCounts, 800);
+    CHECK_EQ(fault.captureId, 0u);
+    CHECK(!trip.takeFault(fault));
+
+    // Latched: more overcurrent neither trips again nor clears it, and the outputs stay as they are
+    feed(trip, 2000, 50);
+    CHECK(trip.tripped());
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripInstant), 1u);
+    CHECK(!trip.faultWaiting());
+
+    // reset() takes effect with the next reading
+    trip.reset();
+    CHECK(trip.tripped());
+    feed(trip, 0, 1);
+    CHECK(!trip.tripped());
+
+    // A relay already closed is no new inrush: the next overcurrent trips at once
+    closeRelays(trip);
+    feed(trip, 1000, 3);
+    CHECK(trip.tripped());
+    checkRelaysOpen(true);
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripInstant), 2u);
+    REQUIRE(trip.takeFault(fault));
+    CHECK_EQ(fault.detectReadings, 3u);
+    CHECK_EQ(fault.peakCounts, 1000);
+}
+
+TEST(overcurrent_trip_i2t) {
+    OvercurrentTrip trip;
+    // No peak limit; heat builds above 200 counts and trips past 1e8 counts^2 x readings
+    const uint32_t pickup = 200;
+    const int64_t heatLimit = 100000000;
+    trip.begin(zero, {4095, 1, 0, pickup * pickup, heatLimit}, relayOutputs, nullptr);
+    closeRelays(trip);
+    feed(trip, 0, 10);
+
+    // Below the rating it never trips
+    feed(trip, 150, 100000);
+    CHECK(!trip.tripped());
+
+    // 400 counts adds 400^2 - 200^2 = 120000 per reading: the 834th reading passes the limit
+    const auto readingsToTrip = [&](int64_t perReading, int64_t startHeat) {
+        return (uint32_t)((heatLimit - startHeat) / perReading + 1);
+    };
+    const uint32_t moderate = readingsToTrip(400 * 400 - pickup * pickup, 0);
+    CHECK_EQ(moderate, 834u);
+    feed(trip, 400, moderate - 1);
+    CHECK(!trip.tripped());
+    feed(trip, 400, 1);
+    CHECK(trip.tripped());
+    checkRelaysOpen(true);
+
+    OvercurrentTrip::Fault fault;
+    REQUIRE(trip.takeFault(fault));
+    CHECK_EQ(fault.kind, OvercurrentTrip::TripI2t);
+    CHECK_EQ(fault.detectReadings, moderate);
+    CHECK_EQ(fault.peakCounts, 400);
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripI2t), 1u);
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripInstant), 0u);
+
+    // reset() also empties the accumulator: a heavier overload trips sooner, from scratch
+    trip.reset();
+    feed(trip, 0, 1);
+    CHECK(!trip.tripped());
+    closeRelays(trip);
+    const uint32_t heavy = readingsToTrip(800 * 800 - pickup * pickup, 0);
+    CHECK(heavy < moderate);
+    feed(trip, 800, heavy);
+    CHECK(trip.tripped());
+    REQUIRE(trip.takeFault(fault));
+    CHECK_EQ(fault.detectReadings, heavy);
+    CHECK_EQ(fault.peakCounts, 800);
+
+    // Heat cools below the rating but not below zero: a burst that has fully cooled counts for nothing...
+    trip.reset();
+    feed(trip, 0, 1);
+    closeRelays(trip);
+    feed(trip, 400, 500);                  // 60e6
+    feed(trip, 0, 1500 + 1000);            // Cools by 40000 a reading: to 0 after 1500, then stays there
+    feed(trip, 400, moderate - 1);
+    CHECK(!trip.tripped());
+    feed(trip, 400, 1);
+    CHECK(trip.tripped());
+    REQUIRE(trip.takeFault(fault));
+    CHECK_EQ(fault.detectReadings, moderate);
+
+    // ...while one that only partly cooled trips sooner, counted from its first reading over the rating
+    trip.reset();
+    feed(trip, 0, 1);
+    closeRelays(trip);
+    feed(trip, 400, 500);                  // 60e6
+    feed(trip, 0, 1000);                   // Down to 20e6
+    const uint32_t rest = readingsToTrip(400 * 400 - pickup * pickup, 20000000);
+    CHECK_EQ(rest, 667u);
+    feed(trip, 400, rest - 1);
+    CHECK(!trip.tripped());
+    feed(trip, 400, 1);
+    CHECK(trip.tripped());
+    REQUIRE(trip.takeFault(fault));
+    CHECK_EQ(fault.detectReadings, 500 + 1000 + rest);
+    CHECK_EQ(trip.trips(OvercurrentTrip::TripI2t), 4u);
+}
+
+TEST(overcurrent_trip_sketch) {
+    // The whole path: simulated sensor, sampler timer, trip, control task and /faults
+    bootSketch("overcurrent_trip_sketch");
+    CHECK_EQ(httpGet("/turnOnAll").code, 200);
+    runSketch(100000);
+    checkRelaysOpen(false);
+
+    // 8 A RMS peaks at 11.3 A, past the 4.5 A peak limit once the 30 ms inrush allowance has run out
+    hostSetCurrentWaveform(hostSineWaveform(8.0f));
+    runSketch(100000);
+    hostSetCurrentWaveform(hostSineWaveform(0.0f));
+    checkRelaysOpen(true);
+    HostHttpResponse faults = httpGet("/faults");
+    CHECK(faults.body.find("\"tripped\":true") != std::string::npos);
+    CHECK(faults.body.find("\"limit\":\"instant\"") != std::string::npos);
+    CHECK(faults.body.find("\"relays\":3") != std::string::npos);
+
+    // Latched: nothing closes a relay until the trip is reset
+    CHECK_EQ(httpGet("/turnOnAll").code, 409);
+    CHECK_EQ(httpGet("/toggleBulb1").code, 409);
+    CHECK_EQ(httpGet("/turnOffAll").code, 200);
+    runSketch(10000);
+    checkRelaysOpen(true);
+    CHECK_EQ(httpGet("/faults/reset").code, 200);
+    runSketch(10000);
+    CHECK(httpGet("/faults").body.find("\"tripped\":false") != std::string::npos);
+    CHECK_EQ(httpGet("/turnOnAll").code, 200);
+    runSketch(100000);
+    checkRelaysOpen(false);
+
+    // 3 A RMS stays under the peak limit and trips on I2t after about a second
+    hostSetCurrentWaveform(hostSineWaveform(3.0f));
+    runSketch(800000);
+    checkRelaysOpen(false);
+    runSketch(400000);
+    hostSetCurrentWaveform(hostSineWaveform(0.0f));
+    checkRelaysOpen(true);
+    faults = httpGet("/faults");
+    CHECK(faults.body.find("\"limit\":\"i2t\"") != std::string::npos);
+    const size_t detect = faults.body.find("\"detectMicros\":");
+    REQUIRE(detect != std::string::npos);
+    CHECK_NEAR(atol(faults.body.c_str() + detect + 15), 1000000, 100000);
+}
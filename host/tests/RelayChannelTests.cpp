@@ -0,0 +1,118 @@
+// Relay channels: the channel table (src/RelayBank.h) with many channels and multi-bit masks, then the
+// /channel/<n>/<action> and /toggleBulb<n> routes of the sketch and the channel numbers they refuse
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/RelayBank.h"
+
+static const uint8_t channel1Pin = 33;
+static const uint8_t channel2Pin = 25;
+
+// Channel n's pin is HIGH exactly when bit n of mask is set
+static bool pinsShow(const uint8_t *pins, size_t count, uint16_t mask) {
+    bool matches = true;
+    for (size_t channel = 0; channel < count; channel++) {
+        matches = matches && hostPinLevel(pins[channel]) == ((mask >> channel) & 1 ? HIGH : LOW);
+    }
+    return matches;
+}
+
+TEST(relay_bank_masks) {
+    // Sixteen channels over both GPIO banks, out of pin order
+    static const uint8_t pins[RelayBank::maxChannels] = {33, 25, 2, 4, 39, 5, 12, 13, 14, 15, 32, 16, 17, 18, 19, 21};
+    RelayBank bank;
+    bank.begin(pins, RelayBank::maxChannels);
+    CHECK_EQ(bank.channels(), RelayBank::maxChannels);
+    CHECK_EQ(bank.allChannels(), 0xffff);
+    CHECK(pinsShow(pins, RelayBank::maxChannels, 0));
+
+    // Every group of four channels at once, then changes to several bits in one call
+    bank.apply(0xa5c3);
+    CHECK_EQ(bank.mask(), 0xa5c3);
+    CHECK(pinsShow(pins, RelayBank::maxChannels, 0xa5c3));
+    bank.turnOn(0x0f0f);
+    CHECK(pinsShow(pins, RelayBank::maxChannels, 0xafcf));
+    bank.turnOff(0x8001);
+    CHECK(pinsShow(pins, RelayBank::maxChannels, 0x2fce));
+    bank.toggle(0xffff);
+    CHECK(pinsShow(pins, RelayBank::maxChannels, 0xd031));
+    bank.transform(0x00ff, 0x0f00); // Channels 1-8 off, then 9-12 toggled
+    CHECK_EQ(bank.mask(), 0xdf00);
+    CHECK(pinsShow(pins, RelayBank::maxChannels, 0xdf00));
+
+    // Fewer channels: bits past the table are ignored
+    RelayBank three;
+    three.begin(pins, 3);
+    CHECK_EQ(three.allChannels(), 0x7);
+    three.apply(0xffff);
+    CHECK_EQ(three.mask(), 0x7);
+    CHECK_EQ(hostPinLevel(pins[3]), LOW);
+}
+
+TEST(relay_channel_routes) {
+    bootSketch("relay_channel_routes");
+
+    HostHttpResponse response = httpGet("/channel/1/on");
+    CHECK_EQ(response.code, 200);
+    CHECK_EQ(response.body, std::string("{\"status\":\"success\", \"channel\":1, \"action\":\"on\"}"));
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+
+    CHECK_EQ(httpGet("/channel/2/toggle").body, std::string("{\"status\":\"success\", \"channel\":2, \"action\":\"toggle\"}"));
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+    CHECK_EQ(httpGet("/channel/1/off").code, 200);
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+
+    CHECK_EQ(httpGet("/toggleBulb1").body, std::string("{\"status\":\"Bulb 1 toggled\"}"));
+    CHECK_EQ(httpGet("/toggleBulb2").body, std::string("{\"status\":\"Bulb 2 toggled\"}"));
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+
+    // Every channel in one change
+    CHECK_EQ(httpGet("/turnOnAll").code, 200);
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+    CHECK_EQ(httpGet("/turnOffAll").code, 200);
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+}
+
+TEST(relay_channel_refused) {
+    bootSketch("relay_channel_refused");
+
+    // Channels this board does not have, and numbers written any other way than plain decimal
+    for (const char *uri : {"/channel/0/on", "/channel/3/on", "/channel/17/toggle", "/channel/4294967297/on",
+                            "/channel/01/on", "/channel/+1/on", "/channel/-1/on", "/channel/x/on",
+                            "/channel//on", "/channel/1", "/channel/1/", "/channel/1/blink", "/channel/1/on/",
+                            "/channel/1/onx", "/channel/1x/on"}) {
+        const HostHttpResponse response = httpGet(uri);
+        if (!CHECK_EQ(response.code, 404)) {
+            printf("%s\n", uri);
+        }
+        CHECK_EQ(response.body, std::string("{\"status\":\"error\", \"message\":\"Use /channel/<n>/on|off|toggle\"}"));
+    }
+    for (const char *uri : {"/toggleBulb", "/toggleBulb0", "/toggleBulb3", "/toggleBulb16", "/toggleBulb01",
+                            "/toggleBulb1x", "/toggleBulb+1", "/toggleBulb-1"}) {
+        const HostHttpResponse response = httpGet(uri);
+        if (!CHECK_EQ(response.code, 404)) {
+            printf("%s\n", uri);
+        }
+        CHECK_EQ(response.body, std::string("{\"status\":\"error\", \"message\":\"No such bulb\"}"));
+    }
+
+    // None of them switched anything
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+}
@@ -0,0 +1,112 @@
+// Minute/hour/day rollups (src/HistoryRollup.h): one tier on its own, then /rollups through the sketch,
+// rebuilt from the flash log at boot and kept up to date by new samples
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/HistoryLog.h"
+#include "src/HistoryRollup.h"
+
+static const uint32_t start = 1730419200; // 2024-11-01 00:00:00, on every bucket boundary
+
+TEST(rollup_tier_buckets) {
+    RollupRing<3> tier("minute", 60);
+    CHECK_EQ(tier.size(), 0u);
+
+    // Four samples in one minute, then the next minute opens a bucket of its own
+    tier.add({start + 0, 1000, 500, 1});
+    tier.add({start + 15, 3000, 1500, 1});
+    tier.add({start + 30, 2000, 1000, 1});
+    tier.add({start + 59, 2001, 1001, 1});
+    CHECK_EQ(tier.size(), 1u);
+    const RollupBucket &first = tier.newest(0);
+    CHECK_EQ(first.start, start);
+    CHECK_EQ(first.count, 4u);
+    CHECK_EQ(first.minCurrent, 500);
+    CHECK_EQ(first.maxCurrent, 1500);
+    CHECK_EQ(first.meanCurrent(), 1000u); // 4001 / 4, rounded
+    CHECK_EQ(first.minPower, 1000u);
+    CHECK_EQ(first.maxPower, 3000u);
+    CHECK_EQ(first.meanPower(), 2000u);
+
+    char json[rollupBucketJsonMax];
+    const size_t length = encodeRollupBucket(json, first);
+    CHECK_EQ(std::string(json, length),
+             std::string("{\"start\":1730419200,\"count\":4,\"current\":{\"min\":\"0.0500\",\"max\":\"0.1500\",\"mean\":\"0.1000\"},"
+                         "\"power\":{\"min\":\"10.00\",\"max\":\"30.00\",\"mean\":\"20.00\"}}"));
+
+    tier.add({start + 60, 100, 10, 0});
+    CHECK_EQ(tier.size(), 2u);
+    CHECK_EQ(tier.newest(0).start, start + 60);
+    CHECK_EQ(tier.newest(0).count, 1u);
+    CHECK_EQ(tier.newest(1).count, 4u);
+
+    // A full ring overwrites its oldest bucket; a gap just skips buckets
+    tier.add({start + 600, 100, 10, 0});
+    tier.add({start + 3600, 100, 10, 0});
+    CHECK_EQ(tier.size(), 3u);
+    CHECK_EQ(tier.bucketsOpened(), 4u);
+    CHECK_EQ(tier.newest(2).start, start + 60);
+
+    // A clock step back opens a new bucket rather than reopening an old one
+    tier.add({start + 600, 200, 20, 0});
+    CHECK_EQ(tier.newest(0).start, start + 600);
+    CHECK_EQ(tier.newest(0).count, 1u);
+    CHECK_EQ(tier.newest(1).start, start + 3600);
+    CHECK_EQ(tier.bucketsOpened(), 5u);
+
+    // An empty bucket reads as zeros rather than dividing by zero
+    CHECK_EQ(RollupBucket().meanCurrent(), 0u);
+}
+
+static size_t countOf(const std::string &text, const char *needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+TEST(rollup_rebuild_at_boot) {
+    // Ten minutes of samples on flash from an earlier run, one every 5 s
+    REQUIRE(hostFlashOpen(testFile("rollup_rebuild_at_boot", "_flash.bin").c_str()));
+    {
+        HistoryLog log;
+        REQUIRE(log.begin());
+        for (uint32_t i = 0; i < 120; i++) {
+            REQUIRE(log.append({start + 5 * i, 10000 + 100 * i, (uint16_t)(1000 + i), 1}));
+        }
+    }
+    testFile("rollup_rebuild_at_boot", "_settings.bin"); // Fresh settings; the flash is kept
+    bootSketch("rollup_rebuild_at_boot", true);
+
+    // Every minute is back, newest first, with the same statistics the samples give
+    const std::string minutes = httpGet("/rollups/minute").body;
+    CHECK_EQ(minutes.find("{\"tier\":\"minute\",\"seconds\":60,\"buckets\":[{\"start\":1730419740,\"count\":12,"), 0u);
+    CHECK_EQ(countOf(minutes, "\"count\":12,"), 10u);
+    CHECK_EQ(countOf(minutes, "{\"start\":"), 10u);
+    const size_t oldest = minutes.find("{\"start\":1730419200,");
+    REQUIRE(oldest != std::string::npos);
+    CHECK_NEAR(jsonNumber(minutes, "min", oldest), 0.1000, 1e-9);  // Current, samples 0..11
+    CHECK_NEAR(jsonNumber(minutes, "max", oldest), 0.1011, 1e-9);
+    CHECK_NEAR(jsonNumber(minutes, "mean", oldest), 0.1006, 1e-9); // 1005.5 rounded half up
+    const std::string hours = httpGet("/rollups/hour").body;
+    CHECK_EQ(countOf(hours, "{\"start\":1730419200,\"count\":120,"), 1u);
+    CHECK_EQ(countOf(httpGet("/rollups/day").body, "\"count\":120,"), 1u);
+
+    // limit and from trim the listing
+    CHECK_EQ(countOf(httpGet("/rollups/minute?limit=3").body, "{\"start\":"), 3u);
+    CHECK_EQ(countOf(httpGet("/rollups/minute?from=1730419500").body, "{\"start\":"), 5u);
+    CHECK_EQ(httpGet("/rollups/week").code, 404);
+
+    // New samples carry on in the same tiers once the clock is set
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=00:10:00").code, 200);
+    hostSetCurrentWaveform(hostSineWaveform(1.0f));
+    runSketch(30000000);
+    const std::string live = httpGet("/rollups/minute?limit=1").body;
+    CHECK_EQ(live.find("{\"tier\":\"minute\",\"seconds\":60,\"buckets\":[{\"start\":1730419800,"), 0u);
+    CHECK_NEAR(jsonNumber(live, "count"), 6, 1);
+    CHECK_NEAR(jsonNumber(live, "mean"), 1.0, 0.03);
+    CHECK_EQ(countOf(httpGet("/rollups/hour").body, "{\"start\":1730419200,"), 1u);
+    CHECK_NEAR(jsonNumber(httpGet("/rollups/hour").body, "count"), 126, 1);
+}
@@ -0,0 +1,134 @@
+// Route lookup (src/RouteTable.h) and typed query arguments (HttpServer::parseArgs) through the sketch
+
+#include <stdio.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/RouteTable.h"
+
+extern const RouteTable routeTable; // The sketch's
+
+static void noHandler() {}
+
+constexpr Route precedenceList[] = {
+    {HttpGet, "/", false, noHandler},         // 0
+    {HttpGet, "/a", false, noHandler},        // 1
+    {HttpGet, "/a/", true, noHandler},        // 2
+    {HttpGet, "/a/b/", true, noHandler},      // 3
+    {HttpGet, "/a/b/c", false, noHandler},    // 4
+    {HttpPost, "/a", false, noHandler},       // 5
+    {HttpDelete, "/x/", true, noHandler},     // 6
+    {HttpPut, "/a/b/c", false, noHandler},    // 7
+};
+constexpr RouteTable precedence(precedenceList);
+
+TEST(route_table_precedence) {
+    REQUIRE(precedence.size() == 8u);
+    CHECK_EQ(precedence.find(HttpGet, "/"), 0);
+    CHECK_EQ(precedence.find(HttpGet, "/a"), 1);
+    CHECK_EQ(precedence.find(HttpPost, "/a"), 5);
+
+    // A prefix route takes the paths under it, the longest prefix first, and an exact route beats both
+    CHECK_EQ(precedence.find(HttpGet, "/a/"), 2);
+    CHECK_EQ(precedence.find(HttpGet, "/a/b"), 2);
+    CHECK_EQ(precedence.find(HttpGet, "/a/z/b/c"), 2);
+    CHECK_EQ(precedence.find(HttpGet, "/a/b/"), 3);
+    CHECK_EQ(precedence.find(HttpGet, "/a/b/q"), 3);
+    CHECK_EQ(precedence.find(HttpGet, "/a/b/c/d"), 3);
+    CHECK_EQ(precedence.find(HttpGet, "/a/b/c"), 4);
+    CHECK_EQ(precedence.find(HttpPut, "/a/b/c"), 7);
+    CHECK_EQ(precedence.find(HttpDelete, "/x/12"), 6);
+
+    // Near misses: one character short or long, other methods
+    CHECK_EQ(precedence.find(HttpGet, "/ab"), -1);
+    CHECK_EQ(precedence.find(HttpGet, "/x/12"), -1);
+    CHECK_EQ(precedence.find(HttpGet, "/b"), -1);
+    CHECK_EQ(precedence.find(HttpGet, ""), -1);
+    CHECK_EQ(precedence.find(HttpPost, "/a/z"), -1);
+    CHECK_EQ(precedence.find(HttpPut, "/a/b/c/"), -1);
+    CHECK_EQ(precedence.find(HttpDelete, "/x"), -1);
+    CHECK_EQ(precedence.find(HttpMethodCount, "/a"), -1);
+
+    // The methods a path has, for 405 and Allow
+    CHECK_EQ(precedence.allowedMethods("/a"), (1u << HttpGet) | (1u << HttpPost));
+    CHECK_EQ(precedence.allowedMethods("/a/b/c"), (1u << HttpGet) | (1u << HttpPut));
+    CHECK_EQ(precedence.allowedMethods("/a/q"), 1u << HttpGet);
+    CHECK_EQ(precedence.allowedMethods("/x/1"), 1u << HttpDelete);
+    CHECK_EQ(precedence.allowedMethods("/nothing"), 0u);
+}
+
+TEST(route_table_methods) {
+    for (uint8_t method = 0; method < HttpMethodCount; method++) {
+        CHECK_EQ(RouteTable::parseMethod(RouteTable::methodName((HttpMethod)method)), method);
+    }
+    CHECK_EQ(RouteTable::methodName(HttpDelete), std::string("DELETE"));
+    CHECK_EQ(RouteTable::methodName(HttpMethodCount), std::string());
+    CHECK_EQ(RouteTable::parseMethod("get"), HttpMethodCount); // Methods are case-sensitive
+    CHECK_EQ(RouteTable::parseMethod("PATCH"), HttpMethodCount);
+    CHECK_EQ(RouteTable::parseMethod(""), HttpMethodCount);
+}
+
+TEST(route_table_no_collisions) {
+    // A full table of similar paths, built at run time: the seed search finds a slot for every route,
+    // and each one is found under its own index and nothing else
+    static char paths[RouteTable::capacity][16];
+    static Route list[RouteTable::capacity];
+    for (size_t i = 0; i < RouteTable::capacity; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "/route%02u", (unsigned)(i / 2));
+        list[i] = {(HttpMethod)(i % 2), paths[i], false, noHandler};
+    }
+    const RouteTable full(list);
+    REQUIRE(full.size() == RouteTable::capacity);
+    for (size_t i = 0; i < RouteTable::capacity; i++) {
+        CHECK_EQ(full.find(list[i].method, paths[i]), (int)i);
+        CHECK_EQ(full.find(HttpPut, paths[i]), -1);
+        CHECK_EQ(full.find(list[i].method, (std::string(paths[i]) + "0").c_str()), -1);
+    }
+
+    // Likewise every route of the sketch's table, built at compile time
+    REQUIRE(routeTable.size() > 0u);
+    for (size_t i = 0; i < routeTable.size(); i++) {
+        CHECK_EQ(routeTable.find(routeTable[i].method, routeTable[i].path), (int)i);
+    }
+}
+
+static void checkBadArg(const char *uri, const char *message) {
+    const HostHttpResponse response = httpGet(uri);
+    CHECK_EQ(response.code, 400);
+    if (!CHECK(response.body.find(message) != std::string::npos)) {
+        printf("%s: %s\n", uri, response.body.c_str());
+    }
+}
+
+TEST(route_table_query_args) {
+    bootSketch("route_table_query_args");
+
+    // Numbers: digits only, within bounds, no overflow; required ones must be there
+    checkBadArg("/schedule", "Missing value");
+    checkBadArg("/schedule?value=", "value must be 0 to 31622400");
+    checkBadArg("/schedule?value=abc", "value must be 0 to 31622400");
+    checkBadArg("/schedule?value=-5", "value must be 0 to 31622400");
+    checkBadArg("/schedule?value=31622401", "value must be 0 to 31622400");
+    checkBadArg("/schedule?value=18446744073709551617", "value must be 0 to 31622400");
+    checkBadArg("/historicalData?limit=0", "limit must be 1 to 4294967295");
+    checkBadArg("/schedules/cancel?id=0", "id must be 1 to 4294967295");
+
+    // Choices: one of the words, exactly
+    checkBadArg("/historicalData.bin?encoding=zip", "encoding must be raw|delta");
+    checkBadArg("/schedules/add?action=ON&in=5", "action must be on|off|toggle");
+    checkBadArg("/schedules/add?in=5", "Missing action");
+
+    // Text: the length after URL decoding
+    checkBadArg("/schedules/add?action=on&at=10:00:000", "at is too long");
+    checkBadArg("/energy/reset?channel=1234", "channel is too long");
+
+    // The same arguments in bounds are accepted; escapes are decoded before they are checked
+    CHECK_EQ(httpGet("/schedule?value=31622400").code, 200);
+    CHECK_EQ(httpGet("/historicalData?limit=1").code, 200);
+    CHECK_EQ(httpGet("/historicalData.bin?encoding=delta").code, 200);
+    const HostHttpResponse added = httpGet("/schedules/add?action=toggle&at=10%3A00%3A00");
+    CHECK_EQ(added.code, 200);
+    CHECK(added.body.find("\"status\":\"success\"") != std::string::npos);
+    CHECK(httpGet("/schedules").body.find("toggle") != std::string::npos);
+}
@@ -0,0 +1,189 @@
+// Schedules: the timing wheel (src/TimerWheel.h) on its own, then /schedules through the sketch
+
+#include <Arduino.h>
+
+#include <string>
+#include <vector>
+
+#include "TestSupport.h"
+#include "src/Config.h"
+#include "src/TimerWheel.h"
+
+typedef TimerWheel<int, 8, 16> SmallWheel; // One revolution is 16 ticks
+
+// Advance to nowTick, returning the payloads that fired in order; every timer is one-shot
+static std::vector<int> advanceTo(SmallWheel &wheel, uint32_t nowTick) {
+    std::vector<int> fired;
+    wheel.advance(nowTick, [&](uint32_t, int &payload, uint32_t &) {
+        fired.push_back(payload);
+        return false;
+    });
+    return fired;
+}
+
+TEST(timer_wheel_deadlines) {
+    SmallWheel wheel;
+    CHECK(wheel.schedule(3, 1) != 0);
+    CHECK(wheel.schedule(0, 2) != 0);  // Never this tick: the next one
+    CHECK(wheel.schedule(19, 3) != 0); // More than one revolution out: same bucket as tick 3
+    CHECK(wheel.schedule(40, 4) != 0);
+    CHECK_EQ(wheel.size(), 4u);
+    CHECK_EQ(wheel.ticksToNext(100), 1u);
+
+    CHECK(advanceTo(wheel, 1) == std::vector<int>({2}));
+    CHECK_EQ(wheel.ticksToNext(100), 2u);
+    CHECK(advanceTo(wheel, 2).empty());
+    CHECK(advanceTo(wheel, 3) == std::vector<int>({1})); // Timer 3 shares the bucket but is not due
+    CHECK_EQ(wheel.ticksToNext(10), 10u);               // Nothing within the limit
+    CHECK(advanceTo(wheel, 18).empty());
+    CHECK(advanceTo(wheel, 19) == std::vector<int>({3}));
+
+    // A stall of more than one revolution visits every bucket once and misses nothing
+    CHECK(advanceTo(wheel, 100) == std::vector<int>({4}));
+    CHECK_EQ(wheel.size(), 0u);
+    CHECK_EQ(wheel.now(), 100u);
+
+    // Deadlines across the uint32_t wrap
+    wheel.advance(UINT32_MAX - 2, [](uint32_t, int &, uint32_t &) { return false; });
+    wheel.schedule(5, 5);
+    CHECK(advanceTo(wheel, UINT32_MAX).empty());
+    CHECK(advanceTo(wheel, 2) == std::vector<int>({5}));
+}
+
+TEST(timer_wheel_ids) {
+    SmallWheel wheel;
+    uint32_t ids[8];
+    for (uint32_t &id : ids) {
+        id = wheel.schedule(10, 0);
+        CHECK(id != 0);
+    }
+    CHECK_EQ(wheel.schedule(10, 0), 0u); // Pool full
+
+    // Cancelled and fired ids stay dead after their slot is reused
+    CHECK(wheel.cancel(ids[3]));
+    CHECK(!wheel.cancel(ids[3]));
+    const uint32_t reused = wheel.schedule(5, 42);
+    CHECK(reused != 0 && reused != ids[3]);
+    CHECK(!wheel.reschedule(ids[3], 1));
+    CHECK(!wheel.cancel(0));
+    CHECK(!wheel.cancel(0xffff));
+
+    // reschedule() moves a timer either way
+    CHECK(wheel.reschedule(reused, 2));
+    uint32_t id;
+    int payload;
+    uint32_t deadline;
+    REQUIRE(wheel.at((reused & 0xffff) - 1, id, payload, deadline));
+    CHECK_EQ(id, reused);
+    CHECK_EQ(payload, 42);
+    CHECK_EQ(deadline, 2u);
+    CHECK(advanceTo(wheel, 2) == std::vector<int>({42}));
+    CHECK(!wheel.cancel(reused));
+
+    // Re-arming from the callback: a period of 3 ticks
+    SmallWheel periodic;
+    periodic.schedule(3, 7);
+    std::vector<uint32_t> runs;
+    auto every3 = [&](uint32_t, int &, uint32_t &due) {
+        runs.push_back(due);
+        due += 3;
+        return true;
+    };
+    for (uint32_t tick = 1; tick <= 12; tick++) {
+        periodic.advance(tick, every3);
+    }
+    CHECK(runs == std::vector<uint32_t>({3, 6, 9, 12}));
+    CHECK_EQ(periodic.size(), 1u);
+}
+
+static const uint8_t channel1Pin = 33;
+static const uint8_t channel2Pin = 25;
+
+static uint32_t addSchedule(const char *query) {
+    const HostHttpResponse response = httpGet((std::string("/schedules/add?") + query).c_str());
+    CHECK_EQ(response.code, 200);
+    return (uint32_t)jsonNumber(response.body, "id");
+}
+
+// "in" of the listed entry with this id
+static double secondsUntil(uint32_t id) {
+    const std::string list = httpGet("/schedules").body;
+    const size_t at = list.find("{\"id\":" + std::to_string(id) + ",");
+    return at != std::string::npos ? jsonNumber(list, "in", at) : NAN;
+}
+
+TEST(schedule_api_sketch) {
+    bootSketch("schedule_api_sketch");
+
+    // One-shot: nothing until it is due, then the relay changes within a tick
+    const uint32_t once = addSchedule("action=on&channel=1&in=2");
+    CHECK_EQ(secondsUntil(once), 2);
+    runSketch(1900000);
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+    runSketch(200000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK(std::isnan(secondsUntil(once))); // Gone once it has run
+    CHECK_EQ(httpGet(("/schedules/cancel?id=" + std::to_string(once)).c_str()).code, 404);
+
+    // Recurring: every second until cancelled
+    const uint32_t blink = addSchedule("action=toggle&channel=2&in=1&every=1");
+    runSketch(500000); // Check half way between runs
+    for (int level : {HIGH, LOW, HIGH}) {
+        runSketch(1000000);
+        CHECK_EQ(hostPinLevel(channel2Pin), level);
+    }
+    CHECK_EQ(httpGet(("/schedules/cancel?id=" + std::to_string(blink)).c_str()).code, 200);
+    runSketch(2000000);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+
+    // /schedule?value= switches everything on now and off after the countdown
+    CHECK_EQ(httpGet("/schedule?value=3").code, 200);
+    runSketch(100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+    runSketch(3000000);
+    CHECK_EQ(hostPinLevel(channel1Pin), LOW);
+    CHECK_EQ(hostPinLevel(channel2Pin), LOW);
+
+    // Time of day: follows the wall clock, including a step after the entry was added
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=09:59:58").code, 200);
+    const uint32_t morning = addSchedule("action=on&channel=1&at=10:00:00");
+    CHECK_EQ(secondsUntil(morning), 2);
+    const uint32_t noon = addSchedule("action=on&channel=2&at=12:00:00");
+    CHECK_NEAR(secondsUntil(noon), 7202, 1);
+    runSketch(2100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=11:59:50").code, 200);
+    CHECK_NEAR(secondsUntil(noon), 10, 1);
+    runSketch(10100000);
+    CHECK_EQ(hostPinLevel(channel2Pin), HIGH);
+    CHECK_EQ(httpGet("/schedules/add?action=on&in=5&at=10:00:00").code, 400);
+
+    // The pool holds SCHEDULE_CAPACITY entries, all of them listed (the listing spans many buffers)
+    size_t added = 0;
+    HostHttpResponse response;
+    while ((response = httpGet("/schedules/add?action=off&in=1000")).code == 200) {
+        added++;
+    }
+    CHECK_EQ(response.code, 503);
+    CHECK_EQ(added, (size_t)SCHEDULE_CAPACITY);
+    const std::string list = httpGet("/schedules").body;
+    size_t listed = 0;
+    for (size_t at = list.find("{\"id\":"); at != std::string::npos; at = list.find("{\"id\":", at + 1)) {
+        listed++;
+    }
+    CHECK_EQ(listed, (size_t)SCHEDULE_CAPACITY);
+    CHECK_EQ(list.substr(list.size() - 2), std::string("]}"));
+}
+
+TEST(schedule_long_period) {
+    bootSketch("schedule_long_period");
+
+    // A period past 2^32 ms (about 49.7 days) comes round again after the whole period
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=11:59:50").code, 200);
+    const uint32_t rare = addSchedule("action=on&channel=1&at=12:00:00&every=5000000");
+    CHECK_NEAR(secondsUntil(rare), 10, 1);
+    runSketch(10100000);
+    CHECK_EQ(hostPinLevel(channel1Pin), HIGH);
+    CHECK_NEAR(secondsUntil(rare), 5000000, 1);
+}
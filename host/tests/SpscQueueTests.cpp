@@ -0,0 +1,75 @@
+// Lock-free SPSC queue (src/SpscQueue.h) between two real threads
+
+#include <atomic>
+#include <thread>
+
+#include "TestSupport.h"
+#include "src/SpscQueue.h"
+
+// Large enough that a torn copy (half of one item, half of another) would show
+struct Item {
+    uint32_t sequence;
+    uint32_t check;   // ~sequence
+    uint64_t payload; // sequence * a constant
+};
+
+TEST(spsc_queue_single_thread) {
+    SpscQueue<Item, 4> queue;
+    Item item;
+    CHECK(!queue.pop(item));
+    for (uint32_t i = 1; i <= 4; i++) {
+        CHECK(queue.push({i, ~i, i}));
+    }
+    CHECK(!queue.push({5, ~5u, 5})); // Full: refused, nothing overwritten
+    CHECK_EQ(queue.size(), 4u);
+    for (uint32_t i = 1; i <= 4; i++) {
+        REQUIRE(queue.pop(item));
+        CHECK_EQ(item.sequence, i);
+    }
+    CHECK(!queue.pop(item));
+    CHECK_EQ(queue.size(), 0u);
+}
+
+TEST(spsc_queue_threads) {
+    // The producer spins on a full queue and the consumer on an empty one, so both sides wrap
+    // the indices many times and see each other's stores as they land
+    static SpscQueue<Item, 16> queue;
+    const uint32_t count = 2000000;
+    std::atomic<uint32_t> refused{0};
+
+    std::thread producer([&]() {
+        for (uint32_t sequence = 1; sequence <= count; sequence++) {
+            const Item item = {sequence, ~sequence, sequence * 0x9e3779b97f4a7c15ull};
+            while (!queue.push(item)) {
+                refused.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 1;
+    uint32_t outOfOrder = 0;
+    uint32_t torn = 0;
+    Item item;
+    while (expected <= count) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.sequence != expected) {
+            outOfOrder++;
+            expected = item.sequence; // Report once per break, not for every item after it
+        }
+        if (item.check != ~item.sequence || item.payload != item.sequence * 0x9e3779b97f4a7c15ull) {
+            torn++;
+        }
+        expected++;
+    }
+    producer.join();
+
+    CHECK_EQ(outOfOrder, 0u);
+    CHECK_EQ(torn, 0u);
+    CHECK_EQ(expected, count + 1); // Every item arrived
+    CHECK(!queue.pop(item));       // ...and nothing more
+    printf("%u items, producer found the queue full %u times\n", count, refused.load());
+}
@@ -0,0 +1,137 @@
+#include "TestSupport.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool testCheck(bool passed, const char *expression, const std::string &values, const char *file, int line) {
+    if (!passed) {
+        testFailures++;
+        fprintf(stderr, "%s:%d: check failed: %s%s%s\n", file, line, expression, values.empty() ? "" : " -- ",
+                values.c_str());
+    }
+    return passed;
+}
+
+void testAbort() {
+    fprintf(stderr, "FAIL (stopped at the first failed requirement)\n");
+    exit(1);
+}
+
+std::string testFile(const char *name, const char *suffix) {
+    std::string path = std::string(name) + suffix;
+    remove(path.c_str());
+    return path;
+}
+
+void bootSketch(const char *name, bool keepFiles) {
+    const std::string flash = keepFiles ? std::string(name) + "_flash.bin" : testFile(name, "_flash.bin");
+    const std::string settings = keepFiles ? std::string(name) + "_settings.bin" : testFile(name, "_settings.bin");
+    REQUIRE(hostFlashOpen(flash.c_str()));
+    REQUIRE(hostSettingsOpen(settings.c_str()));
+    hostSetSerialEcho(false);
+    setup();
+}
+
+void runSketch(uint64_t micros, uint64_t stepMicros) {
+    for (uint64_t elapsed = 0; elapsed < micros; elapsed += stepMicros) {
+        loop();
+        hostClockAdvance(stepMicros);
+    }
+}
+
+bool waitForResponse(HostHttpResponse &response, int port, int connection) {
+    for (int i = 0; i < 5000; i++) {
+        loop();
+        if (hostHttpTakeResponse(response, port, connection)) {
+            return true;
+        }
+        hostClockAdvance(100);
+    }
+    return false;
+}
+
+HostHttpResponse httpGet(const char *uri, const std::vector<std::pair<std::string, std::string>> &headers) {
+    HostHttpResponse response;
+    hostHttpSubmit("GET", uri, headers);
+    REQUIRE(waitForResponse(response));
+    return response;
+}
+
+HostHttpResponse httpPost(const char *uri, const std::string &body, const char *contentType) {
+    HostHttpResponse response;
+    hostHttpPost(uri, body, contentType);
+    REQUIRE(waitForResponse(response));
+    return response;
+}
+
+std::string responseHeader(const HostHttpResponse &response, const char *name) {
+    for (const auto &header : response.headers) {
+        if (strcasecmp(header.first.c_str(), name) == 0) {
+            return header.second;
+        }
+    }
+    return "";
+}
+
+double jsonNumber(const std::string &body, const char *key, size_t from) {
+    const std::string name = std::string("\"") + key + "\":";
+    const size_t at = body.find(name, from);
+    if (at == std::string::npos) {
+        return NAN;
+    }
+    const char *text = body.c_str() + at + name.size();
+    text += *text == '"'; // Decimals the sketch sends as strings, like "kWh":"0.001234"
+    char *end;
+    const double value = strtod(text, &end);
+    return end != text ? value : NAN;
+}
+
+int rawConnect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return fd;
+}
+
+bool rawSend(int fd, const std::string &data) {
+    return send(fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size();
+}
+
+std::string rawReceive(int fd) {
+    std::string received;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        received.append(buffer, count);
+    }
+    return received;
+}
+
+bool rawClosed(int fd) {
+    char byte;
+    const ssize_t count = recv(fd, &byte, 1, MSG_DONTWAIT | MSG_PEEK);
+    return count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+void rawClose(int fd) {
+    close(fd);
+}
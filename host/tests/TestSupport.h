@@ -0,0 +1,79 @@
+#pragma once
+
+// Checks and registration for bulb_tests. Every test is a function registered under a name, and CTest
+// runs each one in a process of its own (bulb_tests <name>), since the sketch's setup() runs once per
+// process. A failed CHECK is reported and the test goes on; a failed REQUIRE also ends it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <string>
+
+#include "HostHarness.h"
+
+typedef void (*TestFunction)();
+
+struct TestRegistration {
+    TestRegistration(const char *name, TestFunction function);
+};
+
+#define TEST(name)                                                  \
+    static void name##Test();                                       \
+    static TestRegistration name##Registration(#name, name##Test);  \
+    static void name##Test()
+
+extern size_t testFailures; // Failed checks in the test being run
+
+// Record one check; false if it failed
+bool testCheck(bool passed, const char *expression, const std::string &values, const char *file, int line);
+[[noreturn]] void testAbort();
+
+inline std::string testValue(const std::string &value) { return "\"" + value + "\""; }
+inline std::string testValue(const char *value) { return value != nullptr ? testValue(std::string(value)) : "nullptr"; }
+template <typename T>
+std::string testValue(const T &value) { return std::to_string(value); }
+
+template <typename A, typename B>
+bool testCheckEqual(const A &actual, const B &expected, const char *expression, const char *file, int line) {
+    return testCheck(actual == expected, expression, testValue(actual) + " vs " + testValue(expected), file, line);
+}
+
+template <typename A, typename B>
+bool testCheckNear(const A &actual, const B &expected, double tolerance, const char *expression, const char *file, int line) {
+    return testCheck(std::fabs((double)actual - (double)expected) <= tolerance, expression,
+                     testValue((double)actual) + " vs " + testValue((double)expected), file, line);
+}
+
+#define CHECK(condition) testCheck((condition), #condition, "", __FILE__, __LINE__)
+#define CHECK_EQ(actual, expected) testCheckEqual((actual), (expected), #actual " == " #expected, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) \
+    testCheckNear((actual), (expected), (tolerance), #actual " ~ " #expected, __FILE__, __LINE__)
+#define REQUIRE(condition)                                           \
+    do {                                                             \
+        if (!testCheck((condition), #condition, "", __FILE__, __LINE__)) { \
+            testAbort();                                             \
+        }                                                            \
+    } while (0)
+
+// The sketch on the simulated board, for end-to-end tests. bootSketch() starts it on empty flash and
+// settings files named after the test (in the working directory) unless keepFiles is set; the helpers
+// run loop() on the fake clock.
+void setup(); // The sketch's own
+void loop();
+void bootSketch(const char *name, bool keepFiles = false);
+std::string testFile(const char *name, const char *suffix); // <name><suffix>, removed first
+void runSketch(uint64_t micros, uint64_t stepMicros = 1000); // loop() while the clock moves on
+HostHttpResponse httpGet(const char *uri, const std::vector<std::pair<std::string, std::string>> &headers = {}); // One request, loop() until it is answered
+HostHttpResponse httpPost(const char *uri, const std::string &body, const char *contentType = "text/plain");
+bool waitForResponse(HostHttpResponse &response, int port = HTTP_SERVER_PORT, int connection = 0);
+std::string responseHeader(const HostHttpResponse &response, const char *name); // Empty if it was not sent
+// First "key":<number> or "key":"<number>" at or after from; NAN if there is none
+double jsonNumber(const std::string &body, const char *key, size_t from = 0);
+
+// Raw loopback client, for what HostHarness's client does not do: partial requests, streams
+int rawConnect(int port = HTTP_SERVER_PORT);
+bool rawSend(int fd, const std::string &data);
+std::string rawReceive(int fd); // Whatever has arrived, without waiting
+bool rawClosed(int fd);         // The server closed its end
+void rawClose(int fd);
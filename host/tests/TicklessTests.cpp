@@ -0,0 +1,124 @@
+// Tickless loop() (waitForNextEvent in main.cpp): the same script of requests, schedules and samples run
+// once with loop() sleeping to its deadlines and once polled every millisecond must give the same relay
+// changes at the same times, the same responses and the same history, with far fewer wakeups asleep
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "TestSupport.h"
+#include "src/hal/hal.h"
+
+extern uint32_t loopWakeups[3]; // The sketch's, by hal::WakeReason
+
+struct ScriptStep {
+    uint32_t atMillis;
+    const char *uri;
+};
+static const ScriptStep script[] = {
+    {1000, "/schedules/add?action=on&channel=1&in=3"},
+    {2000, "/schedules/add?action=toggle&channel=2&in=5&every=7"},
+    {6000, "/toggleBulb1"},
+    {9000, "/schedule?value=10"},
+    {25000, "/channel/2/toggle"},
+    {31000, "/schedules"},
+    {41000, "/historicalData?limit=100"},
+};
+static const uint32_t scriptMillis = 45000;
+
+// Relay changes, timestamped by a 1 ms timer of its own so neither way of running loop() moves them
+static std::string *traceOut = nullptr;
+static int observedRelays = 0;
+static void observeRelays(void *) {
+    const int relays = (hostPinLevel(33) == HIGH ? 1 : 0) | (hostPinLevel(25) == HIGH ? 2 : 0);
+    if (relays != observedRelays) {
+        observedRelays = relays;
+        *traceOut += std::to_string(millis()) + " ms: relays " + std::to_string(relays) + "\n";
+    }
+}
+
+// Boot the sketch and run the script, loop() either sleeping (tickless) or polled every millisecond;
+// returns the trace and the number of loop() wakeups
+static std::string runScript(bool tickless, uint32_t &wakeups) {
+    std::string trace;
+    traceOut = &trace;
+    hostSetCurrentWaveform(hostSineWaveform(0.5f));
+    hal::startPeriodicTimer(1000, observeRelays, nullptr);
+    bootSketch(tickless ? "tickless_run_sleeping" : "tickless_run_polled");
+    hostSetTickless(tickless);
+
+    const uint32_t wakeupsBefore = loopWakeups[0] + loopWakeups[1] + loopWakeups[2];
+    const uint64_t endMicros = hostClockMicros() + (uint64_t)scriptMillis * 1000;
+    size_t next = 0;
+    while (hostClockMicros() < endMicros) {
+        const size_t steps = sizeof(script) / sizeof(script[0]);
+        if (next < steps && millis() >= script[next].atMillis) {
+            trace += std::to_string(millis()) + " ms: GET " + script[next].uri + "\n";
+            hostHttpSubmit("GET", script[next].uri);
+            next++;
+        }
+        hostSetNextInput(next < steps ? (uint64_t)script[next].atMillis * 1000 : endMicros);
+        loop();
+        HostHttpResponse response;
+        while (hostHttpTakeResponse(response)) {
+            trace += std::to_string(response.code) + " " + response.body + "\n";
+        }
+        if (!tickless) {
+            hostClockAdvance(1000 - hostClockMicros() % 1000); // On to the next whole millisecond
+        }
+    }
+    wakeups = loopWakeups[0] + loopWakeups[1] + loopWakeups[2] - wakeupsBefore;
+    return trace;
+}
+
+// runScript() in a child process (setup() runs once per process); the trace comes back through a pipe
+static std::string runScriptInChild(bool tickless, uint32_t &wakeups) {
+    int pipeEnds[2];
+    REQUIRE(pipe(pipeEnds) == 0);
+    const pid_t child = fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+        close(pipeEnds[0]);
+        uint32_t childWakeups;
+        std::string trace = runScript(tickless, childWakeups);
+        trace += std::to_string(childWakeups);
+        const bool written = write(pipeEnds[1], trace.data(), trace.size()) == (ssize_t)trace.size();
+        _exit(written ? 0 : 1);
+    }
+    close(pipeEnds[1]);
+    std::string output;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(pipeEnds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, count);
+    }
+    close(pipeEnds[0]);
+    int status = 0;
+    CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    const size_t last = output.rfind('\n');
+    REQUIRE(last != std::string::npos);
+    wakeups = (uint32_t)strtoul(output.c_str() + last + 1, nullptr, 10);
+    return output.substr(0, last + 1);
+}
+
+TEST(tickless_matches_polling) {
+    uint32_t sleepingWakeups;
+    uint32_t polledWakeups;
+    const std::string sleeping = runScriptInChild(true, sleepingWakeups);
+    const std::string polled = runScriptInChild(false, polledWakeups);
+    if (!CHECK_EQ(sleeping, polled)) {
+        printf("tickless:\n%s\npolled:\n%s\n", sleeping.c_str(), polled.c_str());
+    }
+
+    // The script did what it says: each schedule run switched the relays on the control step after it
+    // was due, and a sample was recorded every 5 s
+    CHECK(polled.find("\n4001 ms: relays 1\n") != std::string::npos);
+    for (uint32_t run = 7000; run < scriptMillis; run += 7000) {
+        CHECK(polled.find("\n" + std::to_string(run + 1) + " ms: relays ") != std::string::npos);
+    }
+    CHECK(polled.find("{\"lastSeq\":8,") != std::string::npos);
+    CHECK(sleepingWakeups * 100 < polledWakeups);
+}
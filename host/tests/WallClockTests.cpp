@@ -0,0 +1,138 @@
+// Wall clock (src/WallClock.h): steps, slews and the drift estimate against the fake monotonic timer,
+// then /timeInit through the sketch
+
+#include <string>
+#include <vector>
+
+#include "TestSupport.h"
+#include "src/WallClock.h"
+
+static const int64_t start = 1730419200LL * 1000000; // 2024-11-01 00:00:00
+static const int64_t second = 1000000;
+
+extern WallClock wallTime; // The sketch's
+
+TEST(wall_clock_step_and_slew) {
+    WallClock clock(1730419200);
+    CHECK(!clock.synced());
+    hostClockAdvance(5 * second);
+    CHECK_EQ(clock.nowMicros(), start + 5 * second); // The default epoch runs from boot
+
+    // The first sync steps, however small the offset
+    CHECK_EQ(clock.sync(start + 6 * second), second);
+    CHECK(clock.synced());
+    CHECK_EQ(clock.stepCount(), 1u);
+    CHECK_EQ(clock.nowMicros(), start + 6 * second);
+    hostClockAdvance(10 * second);
+    CHECK_EQ(clock.nowMicros(), start + 16 * second);
+
+    // A second fast: no jump, then 500 us more per second until it is in, and no more after that
+    const int64_t target = start + 17 * second;
+    CHECK_EQ(clock.sync(target), second);
+    CHECK_EQ(clock.stepCount(), 1u);
+    CHECK_EQ(clock.nowMicros(), start + 16 * second);
+    hostClockAdvance(1000 * second);
+    CHECK_EQ(clock.nowMicros(), target + 1000 * second - second / 2);
+    hostClockAdvance(1000 * second);
+    CHECK_EQ(clock.nowMicros(), target + 2000 * second);
+    hostClockAdvance(1000 * second);
+    CHECK_EQ(clock.nowMicros(), target + 3000 * second);
+
+    // A second slow is taken out the same way: the clock runs slower but never backwards
+    const int64_t behind = clock.nowMicros() - second;
+    CHECK_EQ(clock.sync(behind), -second);
+    int64_t previous = clock.nowMicros();
+    for (int i = 0; i < 2100; i++) {
+        hostClockAdvance(second);
+        const int64_t now = clock.nowMicros();
+        CHECK(now > previous);
+        previous = now;
+    }
+    CHECK_EQ(clock.nowMicros(), behind + 2100 * second);
+    CHECK_EQ(clock.stepCount(), 1u);
+
+    // Past stepMicros it steps, either way
+    CHECK_EQ(clock.sync(clock.nowMicros() + 3 * second), 3 * second);
+    CHECK_EQ(clock.stepCount(), 2u);
+    CHECK_EQ(clock.sync(clock.nowMicros() - WallClock::stepMicros - 1), -WallClock::stepMicros - 1);
+    CHECK_EQ(clock.stepCount(), 3u);
+    CHECK_EQ(clock.syncCount(), 5u);
+
+    // 50 days on, past the point where millis() wraps, the reading still just adds up
+    const int64_t before = clock.nowMicros();
+    hostClockAdvance(50ULL * 86400 * second);
+    CHECK_EQ(clock.nowMicros(), before + 50LL * 86400 * second);
+}
+
+TEST(wall_clock_drift) {
+    WallClock clock(1730419200);
+    clock.sync(start);
+
+    // The clients' time runs 10 ppm ahead of the timer: an hour apart, half the measured rate is
+    // adopted, the next hour the rest of the way by half again
+    hostClockAdvance(3600 * second);
+    CHECK_EQ(clock.sync(start + 3600 * second + 36000), 36000);
+    CHECK_EQ(clock.driftPpb(), 5000);
+    hostClockAdvance(3600 * second);
+    CHECK_EQ(clock.nowMicros(), start + 7200 * second + 36000 + 18000); // 5 ppm applied, the 36 ms slewed in
+    clock.sync(start + 7200 * second + 72000);
+    CHECK_EQ(clock.driftPpb(), 7500);
+
+    // Syncs closer together than driftWindowMicros leave the estimate alone
+    hostClockAdvance(600 * second);
+    clock.sync(clock.nowMicros() + 1000);
+    CHECK_EQ(clock.driftPpb(), 7500);
+
+    // An implausible rate (550 ppm, over an hour from the last baseline) is thrown away
+    hostClockAdvance(3000 * second);
+    clock.sync(start + 10800 * second + 72000 + 1980000);
+    CHECK_EQ(clock.driftPpb(), 7500);
+    CHECK_EQ(clock.stepCount(), 1u);
+
+    // A step starts the measurement again rather than reading the jump as drift
+    hostClockAdvance(3600 * second);
+    clock.sync(clock.nowMicros() + 60 * second);
+    CHECK_EQ(clock.stepCount(), 2u);
+    CHECK_EQ(clock.driftPpb(), 7500);
+    const int64_t stepped = clock.nowMicros();
+    hostClockAdvance(3600 * second);
+    clock.sync(stepped + 3600 * second);
+    CHECK_EQ(clock.driftPpb(), 3750); // The timer was right this hour: halfway back to zero
+}
+
+// Timestamp ("date time") of every /historicalData row, newest first
+static std::vector<std::string> rowTimes(const std::string &body) {
+    std::vector<std::string> times;
+    for (size_t at = body.find("\"date\":\""); at != std::string::npos; at = body.find("\"date\":\"", at + 1)) {
+        const size_t time = body.find("\"time\":\"", at);
+        times.push_back(body.substr(at + 8, 10) + " " + body.substr(time + 8, 8));
+    }
+    return times;
+}
+
+TEST(wall_clock_sketch) {
+    bootSketch("wall_clock_sketch");
+
+    // The page's sync steps the clock; the next samples carry the new time
+    CHECK_EQ(httpGet("/timeInit?date=2024-11-01&time=12:00:00").code, 200);
+    runSketch(10500000);
+    std::vector<std::string> times = rowTimes(httpGet("/historicalData").body);
+    REQUIRE(times.size() >= 2u);
+    CHECK(times[0] >= std::string("2024-11-01 12:00:05") && times[0] <= std::string("2024-11-01 12:00:10"));
+
+    // A client a second behind is slewed in: rows stay in order
+    const int64_t behindMs = wallTime.nowMicros() / 1000 - 1000;
+    CHECK_EQ(httpGet(("/timeInit?epochMs=" + std::to_string(behindMs)).c_str()).code, 200);
+    runSketch(30000000);
+    times = rowTimes(httpGet("/historicalData").body);
+    for (size_t i = 1; i < times.size(); i++) {
+        CHECK(times[i] <= times[i - 1]);
+    }
+
+    // Syncs and steps are counted
+    const std::string metrics = httpGet("/metrics").body;
+    CHECK(metrics.find("\nbulb_clock_syncs_total 2\n") != std::string::npos);
+    CHECK(metrics.find("\nbulb_clock_steps_total 1\n") != std::string::npos);
+    CHECK_EQ(httpGet("/timeInit?date=2024-13-01&time=12:00:00").code, 400);
+    CHECK_EQ(httpGet("/timeInit").code, 400);
+}
@@ -0,0 +1,42 @@
+// Host tests for the bulb controller: runs one registered test by name (CTest runs each in a fresh
+// process, see CMakeLists.txt), or lists them.
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "TestSupport.h"
+
+size_t testFailures = 0;
+
+static std::vector<std::pair<const char *, TestFunction>> &registry() {
+    static std::vector<std::pair<const char *, TestFunction>> tests;
+    return tests;
+}
+
+TestRegistration::TestRegistration(const char *name, TestFunction function) {
+    registry().emplace_back(name, function);
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "--list") == 0) {
+        for (const auto &test : registry()) {
+            printf("%s\n", test.first);
+        }
+        return 0;
+    }
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s TEST | --list\n", argv[0]);
+        return 2;
+    }
+    for (const auto &test : registry()) {
+        if (strcmp(test.first, argv[1]) == 0) {
+            test.second();
+            printf("%s: %s\n", test.first, testFailures == 0 ? "PASS" : "FAIL");
+            return testFailures == 0 ? 0 : 1;
+        }
+    }
+    fprintf(stderr, "no test named %s\n", argv[1]);
+    return 2;
+}
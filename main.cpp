@@ -1,9 +1,26 @@
 #include <WiFi.h>        // Include the WiFi library for network connectivity
-#include <time.h>        // Include the time library for date and time functionalities
-#include <WebServer.h>   // Include the WebServer library to create a web server
 #include <ESPmDNS.h>     // Include mDNS library for DNS services
-#include <ArduinoJson.h> // Include the ArduinoJson library for handling JSON data
 #include "ACS712.h"      // Include the ACS712 library for current sensing
+#include "src/Config.h"      // Compile-time configuration (history depth, ...)
+#include "src/DateTime.h"    // Date/time parsing and formatting for history timestamps
+#include "src/HistoryRing.h" // Compact history records and their ring buffer
+#include "src/HistoryJsonEncoder.h" // Streaming JSON encoder for /historicalData
+#include "src/HistoryBinary.h"      // Packed binary export for /historicalData.bin
+#include "src/HistoryLog.h"         // History kept on flash across reboots
+#include "src/HistoryRollup.h"      // Minute/hour/day summaries of the history
+#include "src/CurrentSampler.h"     // Timer-driven RMS current measurement
+#include "src/WaveformCapture.h"    // Raw current captures around relay changes and spikes
+#include "src/OvercurrentTrip.h"    // Overcurrent protection in the sampling path
+#include "src/SpscQueue.h"          // Lock-free queues between the control task and the web server
+#include "src/HttpServer.h"         // Non-blocking multi-client HTTP server
+#include "src/EventStream.h"        // Server-Sent Events push to the page
+#include "src/TimerWheel.h"         // O(1) timers for relay schedules
+#include "src/RelayBank.h"          // Table-driven relay channels
+#include "src/EnergyMeter.h"        // Per-channel energy counters
+#include "src/Metrics.h"            // Latency histograms and counters for /metrics
+#include "src/Log.h"                // Serial log queued in RAM and drained by loop()
+#include "src/WallClock.h"          // Wall clock kept from client time syncs
+#include "src/hal/hal.h"            // Board services: timers, tasks, raw ADC
 
 // WiFi credentials and mDNS hostname
 const char *ssid = "ESP32-AP";     // SSID for the WiFi network
@@ -15,597 +32,1955 @@ IPAddress localIP(192, 168, 4, 1);  // Default local IP address for the ESP32 in
 IPAddress gateway(192, 168, 4, 1);   // Default gateway, same as local IP in AP mode
 IPAddress subnet(255, 255, 255, 0);  // Subnet mask for the network
 
-// Web server on port 80
-WebServer server(80); // Create a web server instance listening on port 80
+// Web server on port 80, serving several clients at once without ever blocking loop()
+HttpServer server(HTTP_SERVER_PORT); // Create a web server instance listening on port 80
+
+// Live updates: samples and relay changes pushed to open pages as Server-Sent Events
+EventStream eventStream; // Takes over the connections of GET /events; serviced from loop()
+
+// Relay channels: channel n (1-based in URLs) drives relayPins[n - 1] and is bit n - 1 of every relay mask.
+// Add a pin here to add a channel; routes, schedules and history pick it up from the table.
+// 33 and 25 sit in different GPIO banks, so a change to both is two register stores (src/RelayBank.h).
+const uint8_t relayPins[] = {
+    33, // Channel 1, Bulb 1
+    25, // Channel 2, Bulb 2
+};
+const size_t relayChannels = sizeof(relayPins) / sizeof(relayPins[0]);
+static_assert(relayChannels >= 2 && relayChannels <= RelayBank::maxChannels, "2 to 16 relay channels");
+const uint16_t allRelaysMask = (1u << relayChannels) - 1; // Every channel
 
 // Pin Definitions
-const int relay1Pin = 33;        // Pin for Relay 1, controlling Bulb 1
-const int relay2Pin = 25;        // Pin for Relay 2, controlling Bulb 2
 const int currentSensorPin = 35; // Pin for the current sensor to monitor current flow
 const int greenLEDPin = 21;      // Pin for the green LED indicating system readiness
 const int yellowLEDPin = 19;     // Pin for the yellow LED indicating idle state
 const int redLEDPin = 18;        // Pin for the red LED indicating an error state
 
-// States
-bool bulb1State = false;          // Variable to store the state of Bulb 1 (On/Off)
-bool bulb2State = false;          // Variable to store the state of Bulb 2 (On/Off)
-bool isAnyBulbOn = false;         // Flag to check if any bulb is currently on
-bool isScheduled = false;         // Flag to check if a schedule is set for operations
-int scheduledTime = 5;            // Default scheduled time in seconds for bulb operations
+// States (owned by the control task)
+RelayBank relays;                 // Relay outputs and their states as one bitmask
 unsigned long lastUpdateTime = 0; // Variable to track the last update time for scheduled tasks
-unsigned long relayOnTime = 0;    // Timer to track how long the relay has been activated
-
-// Historical data structure definition
-struct HistoricalData {
-    String date;                // Date of the data entry
-    String time;                // Time of the data entry
-    String bulb1State;          // State of Bulb 1 (On/Off)
-    String bulb2State;          // State of Bulb 2 (On/Off)
-    float roundedCurrent;       // Current reading from the current sensor, rounded
-    float roundedPower;         // Calculated power consumption based on current readings
+
+// Relay actions, as queued for the control task and as named in URLs and JSON
+enum ControlCommandType : uint8_t {
+    CommandSwitchOn,    // Turn on the channels in mask
+    CommandSwitchOff,   // Turn off the channels in mask
+    CommandSwitchToggle, // Toggle the channels in mask
+    CommandResetEnergy,  // Zero the resettable energy counters of the channels in mask (not schedulable)
+    CommandApply,        // Clear the channels in mask, then toggle those in flip: any mix of the above in one write
+    CommandResetTrip     // Clear a latched overcurrent trip (not schedulable)
+};
+const char *const commandNames[] = {"on", "off", "toggle"}; // URL and JSON names of the relay actions, by ControlCommandType
+
+// Historical data: fixed-size records in a ring sized by HISTORY_CAPACITY
+const int historyPageRows = 10;                 // Default number of newest rows per /historicalData response
+HistoryRing<HISTORY_CAPACITY> history;          // Ring buffer of historical data entries
+HistoryLog historyLog;                          // Every sample also goes to flash; older rows are read back from there
+uint32_t historyBootId = 0;                     // Random per boot, part of the ETag so sequence restarts never match
+
+// A /historicalData response streams over many loop() iterations, so each connection keeps its own encoder
+struct HistoryResponse {
+    HistoryJsonEncoder encoder; // Pulls rows from the ring as the socket drains
+    uint32_t lastSeq;           // Newest row when the response started; rows are read by sequence number
+    uint32_t since;             // The client's since=: rows at or below it are never sent
+    uint32_t skipped;           // Unreadable (torn) flash rows passed over so far
+};
+HistoryResponse historyResponses[HTTP_MAX_CONNECTIONS];
+HistoryBinaryEncoder historyBinaryResponses[HTTP_MAX_CONNECTIONS]; // Same for /historicalData.bin
+
+// Rollups (owned by loop()): each sample is folded into the open minute, hour and day bucket as it
+// arrives, so long-range queries read a few buckets instead of rescanning raw samples
+RollupRing<ROLLUP_MINUTE_BUCKETS> minuteRollup("minute", 60);
+RollupRing<ROLLUP_HOUR_BUCKETS> hourRollup("hour", 3600);
+RollupRing<ROLLUP_DAY_BUCKETS> dayRollup("day", 86400);
+RollupTier *const rollupTiers[] = {&minuteRollup, &hourRollup, &dayRollup};
+
+// A /rollups/<tier> response streams a few buckets at a time, so each connection keeps its position
+struct RollupResponse {
+    const RollupTier *tier; // Tier being listed
+    uint32_t opened;        // tier->bucketsOpened() when the response started
+    uint32_t from;          // Oldest bucket start to include
+    size_t limit;           // Most buckets to list
+    size_t nextAge;         // Next bucket, by age when the response started
+    bool started;           // Document prefix written
+    bool finished;          // Document suffix written
+};
+RollupResponse rollupResponses[HTTP_MAX_CONNECTIONS];
+
+// Wall clock: runs from 2024-11-01 00:00:00 at boot until a page reports its time through /timeInit,
+// then follows every later report (slewing small corrections, learning the drift between them)
+WallClock wallTime(1730419200);
+
+// Relay schedules (owned by loop()): one-shot and recurring on/off/toggle entries in a timing wheel.
+// Due entries become relay commands for the control task.
+struct ScheduleEntry {
+    ControlCommandType action; // What to do with the relays
+    uint16_t relayMask;    // Which relays, HistoryRecord::relayMask bits
+    uint32_t periodTicks;  // Re-arm interval, 0 for a one-shot entry
+    uint32_t anchorEpoch;  // Entries given a time of day: wall-clock second of the first run, 0 for in= entries
+    uint32_t dueTick;      // Deadline of the run being retried while the control task is behind
+    bool retrying;         // Deadline is a retry of the run due at dueTick
 };
+TimerWheel<ScheduleEntry, SCHEDULE_CAPACITY, SCHEDULE_WHEEL_SLOTS> schedules; // Every pending entry
+uint32_t scheduleTick = 0;        // Ticks of SCHEDULE_TICK_MS processed so far
+unsigned long scheduleMillis = 0; // millis() at the start of the current tick
+uint32_t countdownId = 0;         // Entry that ends the /schedule countdown (0 = none)
+const uint32_t maxScheduleSeconds = 366UL * 86400; // Furthest ahead (and longest period) an entry may be
 
-const int maxHistoryRows = 10;          // Maximum number of rows for historical data
-HistoricalData history[maxHistoryRows]; // Array to store historical data entries
-int historyIndex = 0;                    // Current index for inserting new historical data entries
+// A /schedules listing streams a few entries at a time, so each connection keeps its position
+struct ScheduleListResponse {
+    size_t nextIndex; // Next pool position to look at
+    bool started;     // Document prefix written
+    bool listed;      // At least one entry written (the next one needs a comma)
+    bool finished;    // Document suffix written
+};
+ScheduleListResponse scheduleListResponses[HTTP_MAX_CONNECTIONS];
 
-// Time Related Variables
-String storedDate = "2024-11-1"; // Default date in format YYYY-MM-DD
-String storedTime = "00:00:00";  // Default time in format HH:MM:SS
-bool timeInitialized = false;    // Flag to check if the time has been initialized
+// Work split: the control task (core CONTROL_TASK_CORE) owns sensing, relays and LEDs; loop() (the
+// other core) serves HTTP and owns the history ring and the schedules. They only talk through these queues.
+struct ControlCommand {
+    ControlCommandType type; // Requested action
+    uint16_t mask;           // Channels it applies to; several change in one GPIO write
+    uint16_t flip;           // CommandApply only: channels toggled after mask is cleared
+};
+struct RelayState {
+    uint16_t mask;    // Relay states
+    uint32_t applied; // Commands applied so far, including the ones that changed nothing
+};
+SpscQueue<ControlCommand, 16> commandQueue; // Web server -> control task
+SpscQueue<HistoryRecord, 32> sampleQueue;   // Control task -> web server
+SpscQueue<RelayState, 16> relayStateQueue;  // Control task -> web server: relay mask after each change
+RelayState relayView = {};                  // Latest relay state from relayStateQueue (loop() only)
+SpscQueue<EnergyMeter, 2> energyQueue;      // Control task -> web server: energy counters about once a second
+RelayState publishedRelayState = {};        // Last relay state queued for the web server (control task only)
+uint32_t appliedCommands = 0;               // Commands popped from commandQueue (control task only)
+
+// Commands queued but not yet reported applied, as (clear, flip) relay transforms by queue order, so
+// loop() can tell what the relays will be once the control task catches up (loop() only)
+struct RelayTransform {
+    uint16_t clear; // Channels forced off
+    uint16_t flip;  // Channels toggled afterwards
+};
+const uint32_t pendingTransformSlots = 32; // Power of two; commands in flight beyond this are refused
+RelayTransform pendingTransforms[pendingTransformSlots];
+uint32_t queuedCommands = 0;               // Commands pushed to commandQueue so far
+uint32_t droppedSamples = 0;                // Samples lost because loop() fell behind (control task only)
 
 // Define variables for the ACS712 5A current sensor
 ACS712 current_Sensor(ACS712_05B, currentSensorPin); // Create an instance of the current sensor
 const float voltageReference = 3.3;                  // Reference voltage for the ESP32 in volts
 const float voltageSupply = 220.0;                   // Supply voltage (AC) in volts
+const float sensorVoltsPerAmp = 0.185;               // ACS712-05B sensitivity in volts per ampere
+const float adcCountsPerAmp = sensorVoltsPerAmp * 4095 / voltageReference; // 12-bit ADC counts per ampere
+
+// Background sampler: reads the sensor from a timer so loop() never blocks on the ADC
+CurrentSampler currentSampler(currentSensorPin, CURRENT_SAMPLE_RATE_HZ, CURRENT_WINDOW_MS);
+
+// Waveform capture: the sampler's raw readings around every relay change and current spike. loop()
+// keeps the newest finished captures for /captures; the sampler always has a slot left to record into.
+WaveformCapture waveformCapture;
+struct HeldCapture {
+    const WaveformCapture::Capture *capture;
+    int64_t epochMicros; // Trigger time on the wall clock
+    uint16_t peakCounts; // Largest distance of a reading from the zero reading
+};
+HeldCapture heldCaptures[CAPTURE_SLOTS - 1];                 // Oldest first (loop() only)
+size_t heldCaptureCount = 0;
+CaptureBinaryEncoder captureResponses[HTTP_MAX_CONNECTIONS]; // A /captures/<id>.bin download per connection
+const char *const captureTriggerNames[] = {"relay", "threshold", "trip"}; // By WaveformCapture::Trigger
+
+// Overcurrent protection: checks every reading in the sampler's timer and opens the relays from there.
+// loop() keeps the newest faults for /faults.
+OvercurrentTrip overcurrentTrip;
+struct FaultEntry {
+    OvercurrentTrip::Fault fault;
+    uint32_t id;         // Counts faults since boot
+    int64_t epochMicros; // Trip time on the wall clock
+};
+FaultEntry faultLog[FAULT_LOG_ENTRIES]; // Ring, newest at faultCount - 1 (loop() only)
+uint32_t faultCount = 0;
+const char *const tripKindNames[] = {"instant", "i2t"}; // By OvercurrentTrip::Kind
+bool tripShown = false;                 // Trip state the LEDs show (control task only)
+
+// Energy metering: the control task integrates power every step and hands loop() a copy once a second
+EnergyMeter energyMeter;             // Running counters (control task)
+EnergyMeter energyView;              // Latest copy, served by /energy (loop())
+unsigned long lastEnergyMicros = 0;  // micros() at the previous integration step (control task)
+unsigned long lastEnergyPublish = 0; // millis() of the last copy queued for loop() (control task)
+const unsigned long energyPublishMillis = 1000;
+
+// A /energy response streams a few channels at a time, so each connection keeps its position
+struct EnergyResponse {
+    size_t nextChannel; // Next channel to list
+    bool started;       // Document prefix written
+    bool finished;      // Document suffix written
+};
+EnergyResponse energyResponses[HTTP_MAX_CONNECTIONS];
+
+// Boot fast path: the relay states and the sensor's zero reading are kept in NVS so setup() can restore
+// the relays before anything slow runs; how long each phase of setup() took
+enum BootPhase { BootSensing, BootRelays, BootHistory, BootWiFi, BootMdns, BootHttp, BootPhaseCount };
+const char *const bootPhaseNames[] = {"sensing", "relays", "history", "wifi", "mdns", "http"}; // By BootPhase
+uint32_t bootPhaseMicros[BootPhaseCount] = {};
+uint32_t relaysRestoredMicros = 0;  // hal::monotonicMicros() once the relays were back (from app start)
+uint16_t savedRelayMask = 0;        // Relay states last stored (loop() only)
+
+struct StoredCalibration {
+    uint8_t version;    // storedCalibrationVersion
+    uint8_t sensorPin;  // Rewiring or another sensor model invalidates it
+    uint16_t zeroCounts;
+    float countsPerAmp;
+};
+const uint8_t storedCalibrationVersion = 1;
+std::atomic<uint16_t> sensorZero{2048};  // Zero-current ADC reading in use
+std::atomic<bool> calibrationChanged{false}; // sensorZero is not stored yet (set by setup() or the control task)
+bool calibrationCached = false;     // This boot used the stored zero
+unsigned long relaysOpenSince = 0;  // millis() since every relay is open (control task)
+bool zeroChecked = false;           // Zero re-checked during this stretch (control task)
+uint32_t calibrationChecks = 0;     // Background re-checks (control task)
+uint32_t calibrationUpdates = 0;    // Re-checks that moved the zero (control task)
+
+// Tickless loop(): time spent waiting for the next event, and why it woke (by hal::WakeReason)
+uint64_t loopIdleMicros = 0;        // Since boot
+uint32_t loopWakeups[3] = {};
+uint64_t idleWindowStart = 0;       // hal::monotonicMicros() at the start of the current minute
+uint64_t idleWindowMicros = 0;      // Waited so far in it
+uint32_t loopIdleRatio = 0;         // Share of the last full minute spent waiting, in 1/10000
+
+#if METRICS_ENABLED
+// Instrumentation served at /metrics: where loop() and the control task spend their time, heap
+// watermarks and everything that gets dropped when a side falls behind
+LatencyHistogram loopTime;            // One loop() iteration
+LatencyHistogram serverPollTime;      // server.poll(): accept, read, run handlers, write
+LatencyHistogram controlStepTime;     // One control task step (control core)
+LatencyHistogram updateHistoryTime;   // updateHistoricalData() (control core)
+LatencyHistogram tripLatency;         // First reading over a limit to relays open, per trip (recorded by loop())
+LatencyHistogram wakeLatency;         // Deadline or control task wakeup to loop() running again
+uint32_t rejectedCommands = 0;        // Requests answered 503 because the command queue was full
+size_t heapLowWatermark = SIZE_MAX;   // Least free heap seen by loop()
+size_t heapHighWatermark = 0;         // Most free heap seen by loop()
+unsigned long lastHeapCheck = 0;      // millis() of the last watermark update
+size_t metricsLinesSent[HTTP_MAX_CONNECTIONS]; // A /metrics response is rebuilt per chunk; lines already sent
+#endif
 
 // Current and Power Variable Holders
 float currentReading;   // Variable to store the current reading in Amperes
 float powerConsumption; // Variable to store power consumption in Watts
 
 // Function prototypes with brief descriptions
-void updateDateTime();                           // Update the date and time from the network
-void handleRoot();                               // Handle requests to the root URL by serving HTML, CSS, and JS
+void handleRoot();                               // Handle requests to the root URL by serving the gzipped page
 void handleTurnOnAll();                          // Handle request to turn on all bulbs simultaneously
 void handleTurnOffAll();                         // Handle request to turn off all bulbs simultaneously
-void handleToggleBulb1();                        // Handle request to toggle the state of Bulb 1
-void handleToggleBulb2();                        // Handle request to toggle the state of Bulb 2
+void handleToggleBulb();                         // Handle request to toggle the state of Bulb <n>
+void handleChannel();                            // Handle /channel/<n>/<on|off|toggle>
 void handleScheduleTime();                       // Handle request to set a scheduled time for operations
 void handleTimeInit();                           // Handle request to initialize the date and time
-void handleHistoricalData();                     // Serve historical data as JSON
-void updateHistoricalData();                     // Update the historical data array with new entries
+void handleHistoricalData();                     // Stream historical data as JSON
+void handleHistoricalDataBinary();               // Stream historical data in the packed binary layout
+bool readHistoryRecord(void *context, uint32_t sequence, HistoryRecord &record); // One row by sequence number
+uint32_t firstHistorySequenceAt(uint32_t from, uint32_t lastSeq); // Oldest row stamped at or after from
+void handleEvents();                             // Hand the connection to the event stream
+void handleScheduleList();                       // List pending schedule entries
+void handleScheduleAdd();                        // Add a one-shot or recurring schedule entry
+void handleScheduleCancel();                     // Cancel a schedule entry
+void handleBatch();                              // Apply several relay and schedule operations at once
+void handleRollups();                            // List the buckets of one rollup tier
+void handleEnergy();                             // Per-channel energy counters
+void handleEnergyReset();                        // Zero resettable energy counters
+void handleCaptureList();                        // List the held waveform captures
+void handleCaptureDownload();                    // Send one waveform capture in the packed binary layout
+size_t readCapture(void *context, char *buffer, size_t capacity); // Stream a capture download
+void collectCaptures();                          // Take finished captures from the sampler
+void handleFaults();                             // List overcurrent faults and the trip state
+void handleFaultReset();                         // Clear a latched overcurrent trip
+void collectFaults();                            // Take new faults from the trip
+uint32_t faultLatencyMicros(const OvercurrentTrip::Fault &fault); // First reading over a limit to relays open
+size_t readEnergy(void *context, char *buffer, size_t capacity); // Stream the energy counters
+uint32_t powerMilliWatts();                      // Present power draw from the RMS current
+#if METRICS_ENABLED
+void handleMetrics();                            // Instrumentation in Prometheus text format
+size_t readMetrics(void *context, char *buffer, size_t capacity); // Stream the metrics
+void writeMetrics(MetricsWriter &writer);        // Every metric, in a fixed order
+void trackHeap();                                // Update the heap watermarks
+#endif
+void waitForNextEvent();                         // Sleep until loop() has something to do
+uint64_t endBootPhase(BootPhase phase, uint64_t startMicros); // Time one phase of setup()
+bool calibrationUsable(const StoredCalibration &calibration); // Stored zero fits this sensor
+void revalidateCalibration(unsigned long nowMillis); // Re-check the zero while the relays are open
+void saveBootState();                            // Store changed relay states and calibration
+size_t rebuildRollups();                         // Refill the rollup tiers from the flash log
+size_t readRollups(void *context, char *buffer, size_t capacity); // Stream a rollup listing
+void runSchedules();                             // Fire due schedule entries
+size_t readScheduleList(void *context, char *buffer, size_t capacity); // Stream the schedule listing
+uint32_t firstHistorySequence();                 // Oldest row held in RAM or on flash
+uint32_t secondsToTicks(uint32_t seconds);       // Schedule ticks in a number of seconds
+uint32_t wallClockDelayTicks(const ScheduleEntry &entry, bool ran); // Ticks to the next run of a time-of-day entry
+void rearmTimeOfDaySchedules();                  // Move time-of-day entries after the clock was stepped
+void updateHistoricalData();                     // Take a history sample and hand it to the web server
 void setLEDs(bool ready, bool idle, bool error); // Control LED indicators based on system state
+void controlTaskStep(void *arg);                 // One iteration of the control task
+bool parseChannel(const char *text, const char **end, uint16_t &mask); // Channel number to relay mask bit
+void publishSample(const HistoryRecord &record, uint32_t sequence); // Push a new history row to subscribers
+void publishRelayState(uint16_t mask);           // Push the relay states to subscribers
+bool queueCommand(const ControlCommand &command); // Hand a command to the control task, or answer 503
+bool pushCommand(const ControlCommand &command);  // Hand a command to the control task; false if it is behind
+uint16_t relayTarget();                           // Relay states once every queued command is applied
+size_t writtenLength(int length, size_t size);    // snprintf's result clamped to what fit in the buffer
 
-const char MAIN_page[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>IoT Light Bulb Control</title>
-    <style>
-        body {
-            font-family: Arial, sans-serif;
-            background: #121212;
-            color: #fff;
-            margin: 0;
-            padding: 20px;
-        }
-        .container {
-            max-width: 800px;
-            margin: auto;
-            padding: 20px;
-            background: #1e1e1e;
-            border-radius: 8px;
-            box-shadow: 0 4px 20px rgba(0,0,0,0.3);
-        }
-        h1 {
-            text-align: center;
-            font-size: 2.5em;
-            margin-bottom: 20px;
-        }
-        .main-body {
-            display: flex;
-            flex-direction: row;
-        }
-        .left-column {
-            width: 25%;
-            padding: 10px;
-        }
-        .right-column {
-            width: 75%;
-            padding: 10px;
-        }
-        .bulb-control, .scheduling {
-            margin: 20px 0;
-            display: flex;
-            flex-direction: column;
-            align-items: center;
-        }
-        .circular-button {
-            margin-top: 10px;
-            padding: 15px;
-            font-size: 20px;
-            cursor: pointer;
-            background: #4caf50;
-            border: none;
-            border-radius: 50%;
-            width: 60px;
-            height: 60px;
-            display: flex;
-            align-items: center;
-            justify-content: center;
-            transition: background-color .3s ease, transform .2s ease;
-        }
-        .circular-button:hover {
-            background: #45a049;
-        }
-        input[type="range"] {
-            margin-top: 10px;
-        }
-        .submit-button {
-            margin-top: 10px;
-            background: #4caf50;
-            border: none;
-            border-radius: 10px; /* Rounded edges */
-            width: 100px; /* Adjust width */
-            height: 40px; /* Adjust height */
-            cursor: pointer;
-            transition: background-color .3s ease;
-            font-size: 22px;
-        }
-        .submit-button:hover {
-            background: #45a049;
-        }
-        .slider-label {
-            text-align: center; /* Center align label */
-        }
-        .slider-min-max {
-            display: flex;
-            justify-content: space-between; /* Space out min and max labels */
-            width: 100%; /* Full width under the slider */
-        }
-        table {
-            width: 100%;
-            max-width: 100%; /* Ensure table does not exceed container width */
-            border-collapse: collapse;
-            margin-top: 10px;
-        }
-        th, td {
-            padding: 10px;
-            border: 1px solid #333;
-            text-align: center;
-            font-size: 14px; /* Default font size for desktop */
-        }
-        th {
-            background: #333;
-        }
-        tbody tr:nth-child(even) {
-            background: #1e1e1e;
-        }
-
-        /* Media queries for scaling */
-        @media (max-width: 800px) {
-            .container {
-                padding: 15px;
-            }
-            h1 {
-                font-size: 2em;
-            }
-            th, td {
-                font-size: 12px; /* Slightly smaller for tablet/large mobile */
-            }
-            table {
-                margin: 0; /* Remove margin on smaller screens */
-            }
-        }
-        @media (max-width: 600px) {
-            .container {
-                padding: 4px;
-            }
-            h1 {
-                font-size: 2.0em;
-            }
-            .main-body {
-                flex-direction: column; /* Stack columns on smaller screens */
-            }
-            .left-column, .right-column {
-                width: 100%; /* Full width for both columns */
-                padding: 5px;
-            }
-            .circular-button {
-                width: 50px;
-                height: 50px;
-                font-size: 16px;
-            }
-            th, td {
-                padding: 5px;
-                font-size: 10px; 
-            }
-            table {
-                margin: 0; /* Remove margin on smaller screens */
-            }
-        }
-        @media (max-width: 400px) {
-            .container {
-                padding: 0px;
-            }
-            h1 {
-                font-size: 1.8em;
-            }
-            .circular-button {
-                width: 45px;
-                height: 45px;
-                font-size: 12px;
-            }
-            th, td {
-                padding: 2px;
-                font-size: 8px; 
-            }
-            table {
-                margin: 0; /* Remove margin on smaller screens */
-            }
-        }
-    </style>
-</head>
-
-<body>
-    <div class="container">
-        <h1>IoT Light Bulb Project</h1>
-        <div class="main-body">
-            <div class="left-column">
-                <h2 style="text-align:center;">Controls</h2>
-                <!-- Bulb control buttons -->
-                <div class="bulb-control">
-                    <label>Turn On All Bulbs</label>
-                    <button id="turnOnAll" class="circular-button">🔆</button>
-                </div>
-                <div class="bulb-control">
-                    <label>Toggle Bulb 1</label>
-                    <button id="toggleBulb1" class="circular-button">🔄</button>
-                </div>
-                <div class="bulb-control">
-                    <label>Toggle Bulb 2</label>
-                    <button id="toggleBulb2" class="circular-button">🔄</button>
-                </div>
-                <div class="bulb-control">
-                    <label>Turn Off All Bulbs</label>
-                    <button id="turnOffAll" class="circular-button">🔅</button>
-                </div>
-
-                <!-- Schedule timing -->
-                <div class="scheduling">
-                    <label class="slider-label">Schedule Bulb Time (seconds):</label>
-                    <input type="range" id="scheduleSlider" min="1" max="60" value="5" oninput="updateScheduleValue()">
-                    <div class="slider-min-max">
-                        <span>1</span>
-                        <span>60</span>
-                    </div>
-                    <div id="scheduleDisplay" class="current-value">5 seconds</div>
-                    <button id="submitSchedule" class="submit-button">✔️</button>
-                </div>
-            </div>
-            <div class="right-column">
-                <h2 style="text-align:center;">Historical Data</h2>
-                <table>
-                    <thead>
-                        <tr>
-                            <th>Date</th>
-                            <th>Time</th>
-                            <th>Bulb 1 State</th>
-                            <th>Bulb 2 State</th>
-                            <th>Current<br>(A)</th>
-                            <th>Power<br>(W)</th>
-                        </tr>
-                    </thead>
-                    <tbody id="dataRows"></tbody>
-                </table>
-            </div>
-        </div>
-    </div>
-    <script>
-        const esp32Ip = '192.168.4.1'; // Replace with your ESP32's IP address
-        let updateInterval; // To hold the interval ID
-
-        // Updates schedule display and sends the schedule command
-        function updateScheduleValue() {
-            const scheduleValue = document.getElementById("scheduleSlider").value;
-            document.getElementById("scheduleDisplay").innerText = scheduleValue + " seconds";
-        }
-
-        // Attach event listeners to buttons
-        document.getElementById("turnOnAll").onclick = () => sendCommand('turnOnAll');
-        document.getElementById("toggleBulb1").onclick = () => sendCommand('toggleBulb1');
-        document.getElementById("toggleBulb2").onclick = () => sendCommand('toggleBulb2');
-        document.getElementById("turnOffAll").onclick = () => sendCommand('turnOffAll');
-
-
-        // Attach event listeners for submit buttons for schedule slider
-        document.getElementById("submitSchedule").onclick = () => {
-            const scheduleValue = document.getElementById("scheduleSlider").value;
-            sendCommand('schedule', scheduleValue); // Send schedule value
-        };
-
-        // Send commands to the ESP32 with parameters
-        function sendCommand(command, value = null) {
-            const url = value !== null ? `http://${esp32Ip}/${command}?value=${value}` : `http://${esp32Ip}/${command}`;
-
-            fetch(url)
-                .then(response => {
-                    if (!response.ok) {
-                        throw new Error(`Network response was not ok: ${response.statusText}`);
-                    }
-                    return response.json(); // Parse JSON response
-                })
-                .then(data => {
-                    console.log("Response from ESP32:", data);
-                })
-                .catch(error => console.error("Fetch error:", error));
-        }
-        
-        // Function to fetch and update historical data
-        function fetchHistoricalData() {
-            fetch(`http://${esp32Ip}/historicalData`) // Ensure this matches your endpoint
-                .then(response => {
-                    if (!response.ok) {
-                        throw new Error('Network response was not ok');
-                    }
-                    return response.json();
-                })
-                .then(data => {
-                    const dataRows = document.getElementById("dataRows");
-                    dataRows.innerHTML = ""; // Clear existing rows
-
-                    // Populate the table with new data
-                    if (Array.isArray(data.data) && data.data.length > 0) {
-                        data.data.forEach(entry => {
-                            const row = document.createElement("tr");
-                            row.innerHTML = `
-                                <td>${entry.date}</td>
-                                <td>${entry.time}</td>
-                                <td>${entry.bulb1State}</td>
-                                <td>${entry.bulb2State}</td>
-                                <td>${entry.current}</td>
-                                <td>${entry.power}</td>
-                            `;
-                            dataRows.appendChild(row);
-                        });
-                    } else {
-                        const row = document.createElement("tr");
-                        row.innerHTML = `<td colspan="6">No historical data available</td>`;
-                        dataRows.appendChild(row);
-                    }
-                })
-                .catch(error => console.error("Fetch error:", error));
-        }
-
-        // Set an interval to fetch historical data every second
-        setInterval(fetchHistoricalData, 5000); // Fetch latest data every 5 second    
-
-        // Call this function when a device connects (like in an event listener)
-        function initializeTime() {
-            const now = new Date();
-            const formattedDate = now.toISOString().split('T')[0]; // YYYY-MM-DD
-            const formattedTime = now.toTimeString().split(' ')[0]; // HH:MM:SS
-            
-            fetch(`http://${esp32Ip}/timeInit?date=${formattedDate}&time=${formattedTime}`)
-                .then(response => {
-                    if (!response.ok) {
-                        throw new Error('Network response was not ok');
-                    }
-                    return response.text();
-                })
-                .then(data => console.log(data))
-                .catch(error => console.error("Fetch error:", error));
-        }
-
-        // Call this function on load or when the first device connects
-        initializeTime();
-    </script>
-</body>
-
-</html>
-)rawliteral";
-
-// Setup or Configure initial parameters
+// Web page: web/index.html minified and gzipped into PROGMEM by tools/build_page.py
+#include "src/MainPage.h"
+
+// Server routes, hashed at compile time (src/RouteTable.h). Prefix routes take the rest of the path
+// as an argument; the page and its scripts use GET for everything except /batch.
+constexpr Route routeList[] = {
+    {HttpGet, "/", false, handleRoot},  // Root URL request
+    {HttpGet, "/turnOnAll", false, handleTurnOnAll},  // Request to turn on all bulbs
+    {HttpGet, "/turnOffAll", false, handleTurnOffAll},  // Request to turn off all bulbs
+    {HttpGet, "/toggleBulb", true, handleToggleBulb},  // Request to toggle bulb <n> (the page's buttons)
+    {HttpGet, "/channel/", true, handleChannel},  // Switch one channel from the channel table
+    {HttpGet, "/schedule", false, handleScheduleTime},  // Request to set a schedule
+    {HttpGet, "/timeInit", false, handleTimeInit},  // Request to initialize time
+    {HttpGet, "/historicalData", false, handleHistoricalData},  // Request to get historical data
+    {HttpGet, "/historicalData.bin", false, handleHistoricalDataBinary},  // Historical data for collectors, packed binary
+    {HttpGet, "/events", false, handleEvents},  // Live updates as Server-Sent Events
+    {HttpGet, "/schedules", false, handleScheduleList},  // List schedule entries
+    {HttpGet, "/schedules/add", false, handleScheduleAdd},  // Add a schedule entry
+    {HttpGet, "/schedules/cancel", false, handleScheduleCancel},  // Cancel a schedule entry
+    {HttpPost, "/batch", false, handleBatch},  // Scene change: many operations, one relay write
+    {HttpGet, "/rollups/", true, handleRollups},  // Minute, hour or day summaries
+    {HttpGet, "/energy", false, handleEnergy},  // Per-channel kWh counters
+    {HttpGet, "/energy/reset", false, handleEnergyReset},  // Zero resettable kWh counters
+    {HttpGet, "/captures", false, handleCaptureList},  // Waveform captures held
+    {HttpGet, "/captures/", true, handleCaptureDownload},  // One capture, packed binary
+    {HttpGet, "/faults", false, handleFaults},  // Overcurrent faults
+    {HttpGet, "/faults/reset", false, handleFaultReset},  // Clear a latched trip
+#if METRICS_ENABLED
+    {HttpGet, "/metrics", false, handleMetrics},  // Prometheus scrape target
+#endif
+};
+extern constexpr RouteTable routeTable(routeList); // extern: the host benchmarks look routes up directly
+
+// Setup or Configure initial parameters. Phases run in order of urgency: the relays go back to their
+// last state (with the sensing that protects them running first) before the history scan, Wi-Fi, mDNS
+// and the web server, each timed for the boot report.
 void setup() {
-    // Initialize Serial Communication
-    Serial.begin(115200);
+    uint64_t phaseStart = hal::monotonicMicros();
 
-    // Set relay and LED pins as outputs to control the bulbs and indicators
-    pinMode(relay1Pin, OUTPUT);        // Relay for bulb 1
-    pinMode(relay2Pin, OUTPUT);        // Relay for bulb 2
+    // Sensing: the zero-current reading from NVS when it still matches this sensor; measured (relays
+    // open) only when it does not, and then stored by loop(). Drift is caught later by revalidateCalibration().
+    pinMode(currentSensorPin, INPUT);  // Current sensor input pin
+    StoredCalibration calibration;
+    calibrationCached = hal::settingsRead("calibration", &calibration, sizeof(calibration)) && calibrationUsable(calibration);
+    sensorZero = calibrationCached ? calibration.zeroCounts : current_Sensor.calibrate();
+    calibrationChanged = !calibrationCached;
+    waveformCapture.begin(sensorZero, (uint16_t)(CAPTURE_TRIGGER_AMPS * adcCountsPerAmp));
+    currentSampler.attachCapture(&waveformCapture, CAPTURE_SAMPLE_RATE_HZ); // Burst rate while a capture records
+    OvercurrentTrip::Limits limits;
+    const float pickupCounts = OVERCURRENT_PICKUP_AMPS * adcCountsPerAmp;
+    limits.instantCounts = (uint16_t)(OVERCURRENT_INSTANT_AMPS * adcCountsPerAmp);
+    limits.instantReadings = OVERCURRENT_INSTANT_READINGS;
+    limits.inrushReadings = (uint32_t)OVERCURRENT_INRUSH_MS * CURRENT_SAMPLE_RATE_HZ / 1000;
+    limits.pickupSquared = (uint32_t)(pickupCounts * pickupCounts);
+    limits.heatLimit = (int64_t)(OVERCURRENT_I2T_A2S * adcCountsPerAmp * adcCountsPerAmp * CURRENT_SAMPLE_RATE_HZ);
+    overcurrentTrip.begin(sensorZero, limits, relays.outputPins(), &waveformCapture);
+    currentSampler.attachTrip(&overcurrentTrip);              // Every base-rate reading is checked
+    currentSampler.begin(sensorZero, adcCountsPerAmp);
+    phaseStart = endBootPhase(BootSensing, phaseStart);
+
+    // Relays: back to the states stored before the restart, with the trip already watching
+    uint16_t restored = 0;
+#if BOOT_RESTORE_RELAYS
+    hal::settingsRead("relays", &restored, sizeof(restored));
+#endif
+    relays.begin(relayPins, relayChannels); // Relays, all off
+    relays.apply(restored);                 // Channels this build does not have are ignored
+    restored = relays.mask();
+    if (restored != 0) {
+        waveformCapture.trigger(0, restored); // Inrush of the restored bulbs
+        overcurrentTrip.relaysChanged(restored);
+    }
+    relaysRestoredMicros = (uint32_t)hal::monotonicMicros();
+    publishedRelayState = {restored, 0};
+    relayView = publishedRelayState;
+    savedRelayMask = restored;
     pinMode(greenLEDPin, OUTPUT);      // Green LED pin
     pinMode(yellowLEDPin, OUTPUT);     // Yellow LED pin
     pinMode(redLEDPin, OUTPUT);        // Red LED pin
-    pinMode(currentSensorPin, INPUT);  // Current sensor input pin
+    setLEDs(restored != 0, restored == 0, false); // Green if any bulb is on, yellow if all are off
+
+    // Hand sensing, relays and the schedule to their own task on the other core; energy is integrated
+    // from here, not from power-on
+    lastEnergyMicros = micros();
+    hal::startPeriodicTask("control", controlTaskStep, nullptr, CONTROL_TASK_PERIOD_MS, CONTROL_TASK_CORE, CONTROL_TASK_PRIORITY);
+    phaseStart = endBootPhase(BootRelays, phaseStart);
+
+    // Initialize Serial Communication (log records queue up until loop() drains them)
+    Serial.begin(115200);
+
+    // Recover the history log from flash; the RAM ring continues its sequence numbers
+    if (historyLog.begin()) {
+        LOG_INFO("History log: %u samples recovered", historyLog.recoveredRecords());
+    }
+    history.resume(historyLog.lastSequence());
+    LOG_INFO("Rollups rebuilt from %u samples", (uint32_t)rebuildRollups());
+    phaseStart = endBootPhase(BootHistory, phaseStart);
 
     // Start the ESP32 as an access point with the specified SSID and password
     WiFi.softAP(ssid, password);
     // Configure the access point with a static IP, gateway, and subnet
     WiFi.softAPConfig(localIP, gateway, subnet);
-    Serial.println("ESP32 Access Point started");
+    LOG_INFO("ESP32 Access Point started");
+    phaseStart = endBootPhase(BootWiFi, phaseStart);
 
     // Start mDNS service to allow easy access using a hostname
     MDNS.begin(hostname);
-    Serial.println("mDNS service started");
-
-    // Set up the time using NTP (Network Time Protocol)
-    configTime(28800, 0, "pool.ntp.org", "time.nist.gov"); // 28800 seconds = UTC+8
+    LOG_INFO("mDNS service started");
+    phaseStart = endBootPhase(BootMdns, phaseStart);
 
-    // Define server routes for handling different requests
-    server.on("/", handleRoot);  // Root URL request
-    server.on("/turnOnAll", handleTurnOnAll);  // Request to turn on all bulbs
-    server.on("/turnOffAll", handleTurnOffAll);  // Request to turn off all bulbs
-    server.on("/toggleBulb1", handleToggleBulb1);  // Request to toggle bulb 1
-    server.on("/toggleBulb2", handleToggleBulb2);  // Request to toggle bulb 2
-    server.on("/schedule", handleScheduleTime);  // Request to set a schedule
-    server.on("/timeInit", handleTimeInit);  // Request to initialize time
-    server.on("/historicalData", handleHistoricalData);  // Request to get historical data
+    // Request headers the handlers need to see (the server skips all others)
+    const char *collectedHeaders[] = {"If-None-Match"};
+    server.collectHeaders(collectedHeaders, 1);
+    historyBootId = esp_random(); // Distinguish this boot's sequence numbers from the previous one's
 
     // Start the server to listen for incoming requests
-    server.begin();
-    Serial.println("Server started");
+    server.begin(routeTable);
+    LOG_INFO("Server started");
+    endBootPhase(BootHttp, phaseStart);
 
-    // Set initial state of the LEDs (Idle state)
-    setLEDs(false, true, false);  // Green off, Yellow on, Red off
+#if LOOP_POWER_SAVE
+    if (hal::enablePowerSaving()) {
+        LOG_INFO("Power saving on");
+    }
+#endif
+    idleWindowStart = hal::monotonicMicros();
+
+    LOG_INFO("Relays restored to %u %u us after start, sensor zero %u (%s)", restored, relaysRestoredMicros,
+             sensorZero.load(), calibrationCached ? "stored" : "measured");
+    for (size_t phase = 0; phase < BootPhaseCount; phase++) {
+        LOG_INFO("Boot phase %s: %u us", bootPhaseNames[phase], bootPhaseMicros[phase]);
+    }
+}
 
-    // Calibrate the current sensor if necessary
-    current_Sensor.calibrate();
+// Record how long a boot phase took; returns when the next one starts
+uint64_t endBootPhase(BootPhase phase, uint64_t startMicros) {
+    const uint64_t now = hal::monotonicMicros();
+    bootPhaseMicros[phase] = (uint32_t)(now - startMicros);
+    return now;
 }
 
-// Main loop
+// A stored calibration is used only for the sensor it was measured with, and only if it is plausible
+bool calibrationUsable(const StoredCalibration &calibration) {
+    return calibration.version == storedCalibrationVersion && calibration.sensorPin == currentSensorPin &&
+           calibration.countsPerAmp == adcCountsPerAmp && calibration.zeroCounts >= 1024 && calibration.zeroCounts <= 3072;
+}
+
+// Re-check the sensor's zero reading in the background, once per stretch with every relay open for
+// CALIBRATION_SETTLE_MS (no load current, so a window's mean reading is the zero). Drift beyond
+// CALIBRATION_TOLERANCE_COUNTS moves the zero everywhere it is used; loop() stores it. (Control task)
+void revalidateCalibration(unsigned long nowMillis) {
+    if (relays.mask() != 0) {
+        relaysOpenSince = nowMillis;
+        zeroChecked = false;
+        return;
+    }
+    if (zeroChecked || nowMillis - relaysOpenSince < CALIBRATION_SETTLE_MS) {
+        return;
+    }
+    zeroChecked = true;
+    calibrationChecks++;
+    const int measured = (int)lroundf(currentSampler.meanReading());
+    const int drift = measured - sensorZero.load();
+    if (drift <= CALIBRATION_TOLERANCE_COUNTS && drift >= -CALIBRATION_TOLERANCE_COUNTS) {
+        return;
+    }
+    sensorZero = measured;
+    currentSampler.setZero(measured);
+    overcurrentTrip.setZero(measured);
+    waveformCapture.setZero(measured);
+    calibrationUpdates++;
+    calibrationChanged = true;
+    LOG_WARN("Current sensor zero moved by %d counts to %u", drift, measured);
+}
+
+// Keep what the next boot restores: the relay states and the sensor's zero reading. NVS writes, so
+// only when they change (loop() only).
+void saveBootState() {
+    if (relayView.mask != savedRelayMask && hal::settingsWrite("relays", &relayView.mask, sizeof(relayView.mask))) {
+        savedRelayMask = relayView.mask;
+    }
+    if (calibrationChanged.exchange(false)) {
+        const StoredCalibration calibration = {storedCalibrationVersion, currentSensorPin, sensorZero.load(), adcCountsPerAmp};
+        if (!hal::settingsWrite("calibration", &calibration, sizeof(calibration))) {
+            LOG_WARN("Could not store the sensor calibration");
+        }
+    }
+}
+
+// Fold every record the flash log recovered into the rollup tiers, oldest first, so /rollups covers
+// the time before this boot too. One flash read per record, in the history phase of setup().
+size_t rebuildRollups() {
+    size_t replayed = 0;
+    HistoryRecord record;
+    for (uint32_t sequence = historyLog.firstSequence(); (int32_t)(historyLog.lastSequence() - sequence) >= 0; sequence++) {
+        if (historyLog.read(sequence, record)) { // Torn records are skipped
+            for (RollupTier *tier : rollupTiers) {
+                tier->add(record);
+            }
+            replayed++;
+        }
+    }
+    return replayed;
+}
+
+// Main loop (web server core): handle whatever is due, then sleep until the next event
 void loop() {
-    // Handle incoming client requests
-    server.handleClient();
+    {
+        METRICS_TIME(loopTime);
 
-    // Check if a scheduled time for toggling bulbs is set
-    if (isScheduled) {
-        // Check if the scheduled time has passed
-        if (millis() - relayOnTime >= (scheduledTime * 1000)) {
-            handleTurnOffAll();  // Turn off all bulbs if scheduled time is reached
+        // Move samples produced by the control task into the history ring and push them to open pages;
+        // first, so the handlers below see the control task's latest state
+        HistoryRecord record;
+        while (sampleQueue.pop(record)) {
+            history.push(record);      // The ring overwrites the oldest entry when full
+            historyLog.append(record); // 16 bytes to flash; a sector erase once every 255 samples
+            for (RollupTier *tier : rollupTiers) {
+                tier->add(record);     // O(1) per tier
+            }
+            publishSample(record, history.lastSequence());
+        }
+        RelayState relayState;
+        while (relayStateQueue.pop(relayState)) {
+            if (relayState.mask != relayView.mask) {
+                publishRelayState(relayState.mask);
+            }
+            relayView = relayState;
+        }
+        while (energyQueue.pop(energyView)) {
+            // Keep only the newest copy
         }
+        collectCaptures();
+        collectFaults();
+        saveBootState();
+
+        // Turn due schedule entries into relay commands; this also brings the schedule's clock up to date
+        // after a sleep, before handlers add entries relative to it
+        runSchedules();
+
+        // Serve every open connection as far as it can go without blocking
+        {
+            METRICS_TIME(serverPollTime);
+            server.poll(millis());
+        }
+
+        // Accept subscribers and send whatever their sockets will take without blocking
+        eventStream.poll(millis());
+
+        // Write queued log lines as far as the UART's transmit buffer allows
+        logDrain();
+
+#if METRICS_ENABLED
+        trackHeap();
+#endif
+    }
+    waitForNextEvent();
+}
+
+// Block until a socket is ready, the control task has news (hal::wakeLoop()) or the earliest of
+// loop()'s own deadlines: the next schedule tick with an entry due, an HTTP timeout, an event
+// heartbeat, a log retry, at most LOOP_MAX_IDLE_MS. Records the idle time and the wakeup latency.
+void waitForNextEvent() {
+    const uint64_t nowMicros = hal::monotonicMicros();
+    const uint32_t nowMillis = (uint32_t)(nowMicros / 1000); // millis(), from the same reading
+    uint32_t waitMillis = LOOP_MAX_IDLE_MS;
+    if (schedules.size() > 0) {
+        const uint32_t ticks = schedules.ticksToNext(LOOP_MAX_IDLE_MS / SCHEDULE_TICK_MS + 1);
+        const uint32_t dueMillis = scheduleMillis + ticks * SCHEDULE_TICK_MS - nowMillis;
+        waitMillis = (int32_t)dueMillis < 0 ? 0 : (dueMillis < waitMillis ? dueMillis : waitMillis);
+    }
+    if (logPending()) {
+        waitMillis = LOOP_LOG_RETRY_MS < waitMillis ? LOOP_LOG_RETRY_MS : waitMillis;
+    }
+    hal::WaitSocket sockets[1 + HTTP_MAX_CONNECTIONS + EVENT_MAX_SUBSCRIBERS];
+    size_t socketCount = 0;
+    const uint32_t serverMillis = server.waitSet(sockets, socketCount, sizeof(sockets) / sizeof(sockets[0]), nowMillis);
+    const uint32_t eventMillis = eventStream.waitSet(sockets, socketCount, sizeof(sockets) / sizeof(sockets[0]), nowMillis);
+    waitMillis = serverMillis < waitMillis ? serverMillis : waitMillis;
+    waitMillis = eventMillis < waitMillis ? eventMillis : waitMillis;
+    if (waitMillis == 0) {
+        return; // Work is waiting already
     }
 
-    // Check if it's time to send updated historical data every 5 seconds
+    // Wake as millis() reaches the deadline: waitMillis counted from now would run the schedule tick
+    // up to a millisecond late, behind a control task step it should have made
+    const uint64_t deadline = (nowMicros / 1000 + waitMillis) * 1000;
+    const uint64_t started = hal::monotonicMicros();
+    uint32_t signalMicros = 0;
+    const uint32_t waitMicros = deadline > started ? (uint32_t)(deadline - started) : 0;
+    const hal::WakeReason reason = hal::waitForEvent(sockets, socketCount, waitMicros, signalMicros);
+    const uint64_t woke = hal::monotonicMicros();
+    loopIdleMicros += woke - started;
+    idleWindowMicros += woke - started;
+    loopWakeups[reason]++;
+    if (woke - idleWindowStart >= 60000000) {
+        loopIdleRatio = (uint32_t)(idleWindowMicros * 10000 / (woke - idleWindowStart));
+        idleWindowStart = woke;
+        idleWindowMicros = 0;
+    }
+#if METRICS_ENABLED
+    // How late loop() runs after it should: past its deadline, or after the control task's wakeup
+    if (reason == hal::WakeTimeout && woke >= deadline) {
+        wakeLatency.record((uint32_t)(woke - deadline) * hal::cyclesPerMicrosecond());
+    } else if (reason == hal::WakeSignal) {
+        wakeLatency.record(((uint32_t)woke - signalMicros) * hal::cyclesPerMicrosecond());
+    }
+#endif
+}
+
+// Send one history row as a "sample" event, same JSON as a /historicalData row
+void publishSample(const HistoryRecord &record, uint32_t sequence) {
+    char data[historyRowJsonMax];
+    size_t length = encodeHistoryRow(data, record, sequence);
+    eventStream.publish("sample", data, length);
+}
+
+// Send the relay states as a "relay" event as soon as they change
+void publishRelayState(uint16_t mask) {
+    char data[64];
+    int length = snprintf(data, sizeof(data), "{\"relays\":%u,\"bulb1State\":\"%s\",\"bulb2State\":\"%s\"}",
+                          mask, (mask & 1) ? "On" : "Off", (mask & 2) ? "On" : "Off");
+    eventStream.publish("relay", data, writtenLength(length, sizeof(data)));
+}
+
+// One iteration of the control task: apply queued commands, take samples
+void controlTaskStep(void *arg) {
+    (void)arg;
+    METRICS_TIME(controlStepTime);
+
+    // Integrate the power drawn since the last step and attribute it to the relays closed during it
+    unsigned long nowMicros = micros();
+    energyMeter.accumulate(powerMilliWatts(), nowMicros - lastEnergyMicros, relays.mask());
+    lastEnergyMicros = nowMicros;
+
+    ControlCommand command;
+    bool energyReset = false;
+    const uint16_t relaysBefore = relays.mask();
+    while (commandQueue.pop(command)) {
+        const bool tripped = overcurrentTrip.tripped(); // Relay commands wait for /faults/reset
+        switch (command.type) {
+            case CommandSwitchOn:     if (!tripped) relays.turnOn(command.mask);  break;
+            case CommandSwitchOff:    relays.turnOff(command.mask); break;
+            case CommandSwitchToggle: if (!tripped) relays.toggle(command.mask);  break;
+            case CommandResetEnergy:
+                energyMeter.reset(command.mask);
+                energyReset = true;
+                break;
+            case CommandApply:        if (!tripped) relays.transform(command.mask, command.flip); break;
+            case CommandResetTrip:    overcurrentTrip.reset(); break;
+        }
+        appliedCommands++;
+    }
+
+    // A trip already opened the outputs from the sampler's timer; bring the relay state in line (and
+    // undo a switch-on that raced with it)
+    const bool tripped = overcurrentTrip.tripped();
+    if (tripped && relays.mask() != 0) {
+        relays.apply(0);
+    }
+
+    // Record the inrush (or the current collapsing) around a relay change
+    if (relays.mask() != relaysBefore) {
+        waveformCapture.trigger(relaysBefore, relays.mask());
+        overcurrentTrip.relaysChanged(relays.mask());
+    }
+    if (relays.mask() != relaysBefore || tripped != tripShown) {
+        setLEDs(!tripped && relays.mask() != 0, !tripped && relays.mask() == 0, tripped); // Green if any bulb is on, yellow if all are off, red while tripped
+        tripShown = tripped;
+    }
+
+    // Hand loop() a fresh copy of the energy counters once a second (right away after a reset)
+    unsigned long nowMillis = millis();
+    revalidateCalibration(nowMillis);
+    if ((energyReset || nowMillis - lastEnergyPublish >= energyPublishMillis) && energyQueue.push(energyMeter)) {
+        lastEnergyPublish = nowMillis; // Retried next step if the queue was full
+    }
+
+    // Tell the web server about relay changes right away instead of waiting for the next sample
+    RelayState state = {relays.mask(), appliedCommands};
+    if ((state.mask != publishedRelayState.mask || state.applied != publishedRelayState.applied) &&
+        relayStateQueue.push(state)) {
+        publishedRelayState = state; // Retried next step if the queue was full
+    }
+
+    // Check if it's time to record a new historical data sample every 5 seconds
     unsigned long currentMillis = millis();  // Get the current time in milliseconds
     if (currentMillis - lastUpdateTime >= 5000) {
-        updateHistoricalData();         // Update historical data
+        updateHistoricalData();         // Sample and queue for the web server
         lastUpdateTime = currentMillis; // Update the last update time
-        handleHistoricalData();         // Call the function to send historical data
+    }
+
+    // loop() sleeps between its own deadlines; wake it for anything handed over here or by the sampler
+    if (sampleQueue.size() > 0 || relayStateQueue.size() > 0 || waveformCapture.finished() || overcurrentTrip.faultWaiting()) {
+        hal::wakeLoop();
+    }
+}
+
+// Relay transform of a command: on = clear and flip, off = clear, toggle = flip
+RelayTransform commandTransform(const ControlCommand &command) {
+    switch (command.type) {
+        case CommandSwitchOn:     return {command.mask, command.mask};
+        case CommandSwitchOff:    return {command.mask, 0};
+        case CommandSwitchToggle: return {0, command.mask};
+        case CommandApply:        return {command.mask, command.flip};
+        default:                  return {0, 0};
     }
 }
 
-// Function to handle root URL requests
+// Transform that applies first and then second
+RelayTransform composeTransforms(RelayTransform first, RelayTransform second) {
+    return {(uint16_t)(first.clear | second.clear), (uint16_t)((first.flip & ~second.clear) ^ second.flip)};
+}
+
+// Queue a command for the control task and remember its effect on the relays (loop() only)
+bool pushCommand(const ControlCommand &command) {
+    if (queuedCommands - relayView.applied >= pendingTransformSlots || !commandQueue.push(command)) {
+        return false;
+    }
+    pendingTransforms[queuedCommands % pendingTransformSlots] = commandTransform(command);
+    queuedCommands++;
+    return true;
+}
+
+// Relay states once the control task has applied everything queued so far
+uint16_t relayTarget() {
+    uint16_t mask = relayView.mask;
+    for (uint32_t i = relayView.applied; i != queuedCommands; i++) {
+        const RelayTransform &transform = pendingTransforms[i % pendingTransformSlots];
+        mask = (mask & ~transform.clear) ^ transform.flip;
+    }
+    return mask & allRelaysMask;
+}
+
+// Queue a command for the control task; answers 409 if it would close a relay while the overcurrent trip
+// is latched and 503 if the control task is not keeping up
+bool queueCommand(const ControlCommand &command) {
+    if (overcurrentTrip.tripped() && commandTransform(command).flip != 0) {
+        server.send(409, "application/json", "{\"status\":\"error\", \"message\":\"Overcurrent trip, reset at /faults/reset\"}");
+        return false;
+    }
+    if (pushCommand(command)) {
+        return true;
+    }
+    METRICS_COUNT(rejectedCommands);
+    server.send(503, "application/json", "{\"status\":\"error\", \"message\":\"Busy\"}");
+    return false;
+}
+
+// Function to handle root URL requests.
+// The page is stored pre-gzipped; browsers cache it for a day and then revalidate with the ETag.
 void handleRoot() {
-    Serial.println("Handling root request");  // Log the request handling
-    server.send(200, "text/html", MAIN_page); // Send the main HTML page as response
+    LOG_DEBUG("Handling root request");                      // Log the request handling
+    server.sendHeader("ETag", MAIN_PAGE_ETAG);               // Strong validator for the compressed bytes
+    server.sendHeader("Cache-Control", "public, max-age=86400"); // Reuse without asking for a day
+    if (strcmp(server.header("If-None-Match"), MAIN_PAGE_ETAG) == 0) {
+        server.send(304);                                    // Browser copy is current, send no body
+        return;
+    }
+    server.sendHeader("Content-Encoding", "gzip");           // Browser inflates the page itself
+    server.sendFlash(200, "text/html", (const char *)MAIN_PAGE_GZ, MAIN_PAGE_GZ_LENGTH); // Send the page straight from flash
 }
 
 // Function to turn on all bulbs
 void handleTurnOnAll() {
-    Serial.println("Turning on all bulbs");                                       // Log the action
-    bulb1State = true;                                                            // Set bulb 1 state to on
-    bulb2State = true;                                                            // Set bulb 2 state to on
-    digitalWrite(relay1Pin, HIGH);                                                // Activate relay for bulb 1
-    digitalWrite(relay2Pin, HIGH);                                                // Activate relay for bulb 2
-    setLEDs(true, false, false);                                                  // Set LEDs: Green on, Yellow off, Red off
-    server.send(200, "application/json", "{\"status\":\"All bulbs turned on\"}"); // Send success response
+    LOG_INFO("Turning on all bulbs");                                                 // Log the action
+    if (queueCommand({CommandSwitchOn, allRelaysMask, 0})) {                             // Applied by the control task
+        server.send(200, "application/json", "{\"status\":\"All bulbs turned on\"}"); // Send success response
+    }
 }
 
 // Function to turn off all bulbs
 void handleTurnOffAll() {
-    Serial.println("Turning off all bulbs");                                       // Log the action
-    bulb1State = false;                                                            // Set bulb 1 state to off
-    bulb2State = false;                                                            // Set bulb 2 state to off
-    digitalWrite(relay1Pin, LOW);                                                  // Deactivate relay for bulb 1
-    digitalWrite(relay2Pin, LOW);                                                  // Deactivate relay for bulb 2
-    setLEDs(false, true, false);                                                   // Set LEDs: Green off, Yellow on, Red off
-    isScheduled = false;                                                           // Clear any scheduled actions
-    server.send(200, "application/json", "{\"status\":\"All bulbs turned off\"}"); // Send success response
-}
-
-// Function to toggle Bulb 1
-void handleToggleBulb1() {
-    Serial.println("Toggling Bulb 1");                                       // Log the action
-    bulb1State = !bulb1State;                                                // Toggle the state of bulb 1
-    digitalWrite(relay1Pin, bulb1State ? HIGH : LOW);                        // Set relay based on the new state
-    
-    // Determine LED states based on bulb states
-    bool isAnyBulbOn = bulb1State || bulb2State;                             // True if any bulb is on
-    bool areBothBulbsOff = !bulb1State && !bulb2State;                       // True if both bulbs are off
-    
-    setLEDs(isAnyBulbOn, areBothBulbsOff, false);                            // Set LED states accordingly
-    server.send(200, "application/json", "{\"status\":\"Bulb 1 toggled\"}"); // Send success response
-}
-
-// Function to toggle Bulb 2
-void handleToggleBulb2() {
-    Serial.println("Toggling Bulb 2");                                       // Log the action
-    bulb2State = !bulb2State;                                                // Toggle the state of bulb 2
-    digitalWrite(relay2Pin, bulb2State ? HIGH : LOW);                        // Set relay based on the new state
-
-    // Determine LED states based on bulb states
-    bool isAnyBulbOn = bulb1State || bulb2State;                             // True if any bulb is on
-    bool areBothBulbsOff = !bulb1State && !bulb2State;                       // True if both bulbs are off
-
-    setLEDs(isAnyBulbOn, areBothBulbsOff, false);                            // Set LED states accordingly
-    server.send(200, "application/json", "{\"status\":\"Bulb 2 toggled\"}"); // Send success response
-}
-
-// Function to schedule bulb time and turn off if scheduled time has passed
-void handleScheduleTime() {
-    Serial.println("Received schedule request"); // Log the received schedule request
-    handleTurnOnAll();                           // Turn on the bulbs immediately when scheduling
+    LOG_INFO("Turning off all bulbs");                                                 // Log the action
+    if (queueCommand({CommandSwitchOff, allRelaysMask, 0})) {                             // Applied by the control task
+        schedules.cancel(countdownId);                                                 // Turning everything off ends the countdown
+        countdownId = 0;
+        server.send(200, "application/json", "{\"status\":\"All bulbs turned off\"}"); // Send success response
+    }
+}
 
-    // Check if a "value" parameter was provided in the request
-    if (server.hasArg("value")) {
-        scheduledTime = server.arg("value").toInt(); // Convert the parameter to an integer for scheduled time
-        relayOnTime = millis();                      // Record the current time to track when the bulbs were turned on
-        isScheduled = true;                          // Mark that a schedule has been set
+// Parse a 1-based channel number from the start of text into its relay mask bit; false if there is
+// no such channel or the number is not plain decimal (a sign or leading zero). end is left just past the number.
+bool parseChannel(const char *text, const char **end, uint16_t &mask) {
+    char *numberEnd;
+    unsigned long channel = strtoul(text, &numberEnd, 10);
+    *end = numberEnd;
+    if (numberEnd == text || !isdigit((unsigned char)text[0]) || text[0] == '0' || channel > relayChannels) {
+        return false;
+    }
+    mask = 1u << (channel - 1);
+    return true;
+}
 
-        // Send a success response back to the client
-        server.send(200, "application/json", "{\"status\":\"success\"}");
-        Serial.println("Scheduled time set to: " + String(scheduledTime) + " seconds."); // Log the scheduled time
-    } else {
-        // If the parameter is missing, send an error response
-        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Missing parameter\"}");
-        Serial.println("Error: Missing time parameter"); // Log the error
+// snprintf returns the length it would have written; past the end of the buffer that is not the text
+size_t writtenLength(int length, size_t size) {
+    if (length < 0) {
+        return 0;
+    }
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+// Function to toggle Bulb <n> (/toggleBulb1, /toggleBulb2, ...)
+void handleToggleBulb() {
+    const char *end;
+    uint16_t mask;
+    if (!parseChannel(server.uri() + strlen("/toggleBulb"), &end, mask) || *end != '\0') {
+        server.send(404, "application/json", "{\"status\":\"error\", \"message\":\"No such bulb\"}");
+        return;
+    }
+    if (queueCommand({CommandSwitchToggle, mask, 0})) {                             // Applied by the control task
+        char body[40];
+        int length = snprintf(body, sizeof(body), "{\"status\":\"Bulb %d toggled\"}", __builtin_ctz(mask) + 1);
+        server.send(200, "application/json", body, writtenLength(length, sizeof(body))); // Send success response
     }
 }
 
-// Function to initialize the date and time for display
+// Function to switch one channel: /channel/<n>/on, /channel/<n>/off or /channel/<n>/toggle
+void handleChannel() {
+    const char *path = server.uri() + strlen("/channel/");
+    const char *end;
+    uint16_t mask;
+    int action = -1;
+    if (parseChannel(path, &end, mask) && *end == '/') {
+        for (int i = 0; i < 3; i++) {
+            if (strcmp(end + 1, commandNames[i]) == 0) {
+                action = i;
+            }
+        }
+    }
+    if (action < 0) {
+        server.send(404, "application/json", "{\"status\":\"error\", \"message\":\"Use /channel/<n>/on|off|toggle\"}");
+        return;
+    }
+    if (queueCommand({(ControlCommandType)action, mask, 0})) {                       // Applied by the control task
+        char body[64];
+        int length = snprintf(body, sizeof(body), "{\"status\":\"success\", \"channel\":%d, \"action\":\"%s\"}",
+                              __builtin_ctz(mask) + 1, commandNames[action]);
+        server.send(200, "application/json", body, writtenLength(length, sizeof(body))); // Send success response
+    }
+}
+
+// Query arguments of /schedule
+struct ScheduleTimeArgs {
+    uint32_t seconds;
+};
+constexpr QueryArg<ScheduleTimeArgs> scheduleTimeArgs[] = {
+    numberArg("value", &ScheduleTimeArgs::seconds, 0, maxScheduleSeconds, true), // Seconds until everything goes off
+};
+
+// Function to turn all bulbs on now and off again after the requested number of seconds: /schedule?value=<seconds>
+void handleScheduleTime() {
+    LOG_DEBUG("Received schedule request"); // Log the received schedule request
+
+    ScheduleTimeArgs args = {};
+    if (!server.parseArgs(scheduleTimeArgs, args)) {
+        LOG_WARN("Bad schedule request");   // Missing or out of range; answered 400
+        return;
+    }
+    if (queueCommand({CommandSwitchOn, allRelaysMask, 0})) {             // Turn on the bulbs immediately when scheduling
+        schedules.cancel(countdownId);                                // A new countdown replaces the previous one
+        countdownId = schedules.schedule(secondsToTicks(args.seconds), {CommandSwitchOff, allRelaysMask, 0, 0, 0, false}); // Turn everything off later
+        LOG_INFO("Scheduled time set to: %u seconds.", args.seconds); // Log the scheduled time
+        server.send(200, "application/json", "{\"status\":\"success\"}"); // Send a success response back to the client
+    }
+}
+
+// Query arguments of /timeInit
+struct TimeInitArgs {
+    uint64_t epochMs;
+    const char *date;
+    const char *time;
+};
+constexpr QueryArg<TimeInitArgs> timeInitArgs[] = {
+    numberArg("epochMs", &TimeInitArgs::epochMs, 0, 4294967295999ULL), // Seconds must fit the 4-byte stamps
+    textArg("date", &TimeInitArgs::date, 10),
+    textArg("time", &TimeInitArgs::time, 8),
+};
+
+// Function to sync the wall clock to a client's local time, on every page load.
+// Arguments: epochMs=<milliseconds since 1970-01-01 in local time>, or date=YYYY-MM-DD&time=HH:MM:SS
 void handleTimeInit() {
-    // Check if the time has not been initialized and both date and time are provided
-    if (!timeInitialized && server.hasArg("date") && server.hasArg("time")) { 
-        storedDate = server.arg("date");                                      // Get date from the request
-        storedTime = server.arg("time");                                      // Get time from the request
-        timeInitialized = true;                                               // Set the flag to indicate time is initialized
-        Serial.println("Time initialized: " + storedDate + " " + storedTime); // Log the initialized time
+    TimeInitArgs args = {UINT64_MAX, "", ""};
+    if (!server.parseArgs(timeInitArgs, args)) {
+        return;
+    }
+    int64_t epochMicros = -1;
+    uint32_t timestamp;
+    if (args.epochMs != UINT64_MAX) {
+        epochMicros = (int64_t)args.epochMs * 1000;
+    } else if (parseDateTime(args.date, args.time, timestamp)) { // Whole seconds only
+        epochMicros = (int64_t)timestamp * 1000000;
+    }
+    if (epochMicros < 0) {
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Use epochMs=<ms> or date=YYYY-MM-DD&time=HH:MM:SS\"}");
+        return;
+    }
+
+    const bool first = !wallTime.synced();
+    const uint32_t steps = wallTime.stepCount();
+    const int64_t offset = wallTime.sync(epochMicros);                         // Step, or slew small corrections
+    if (first || wallTime.stepCount() != steps) {
+        LOG_INFO("Time initialized: %t", wallTime.seconds());                  // Log the new time
+        rearmTimeOfDaySchedules();                                            // at= entries follow the new time
+    } else {
+        LOG_DEBUG("Time synced, offset %d ms", (int32_t)(offset / 1000));
     }
     server.send(200, "text/plain", "Time initialized");                       // Respond to the client indicating success
 }
 
-// Function to format current readings to 4 decimal places
-String formatCurrent(float value) {
-    return String(floor(value * 10000) / 10000.0, 4); // Formats the value to 4 decimal places
+// Row reader for the JSON encoder: index 0 is the newest record when the response started.
+// Rows are addressed by sequence number so samples arriving mid-response do not shift them.
+// Recent rows come from the RAM ring, older ones straight from the flash log.
+bool readNewestHistoryRow(void *context, size_t index, HistoryRecord &record, uint32_t &sequence) {
+    HistoryResponse &response = *static_cast<HistoryResponse *>(context);
+    for (;;) {
+        if (index + response.skipped >= response.lastSeq) {
+            return false;
+        }
+        sequence = response.lastSeq - index - response.skipped;
+        if (sequence <= response.since) {
+            return false; // Torn rows skipped until the rows run into since=, the array ends early
+        }
+        if (sequence >= history.firstSequence()) {
+            record = history.newest(history.lastSequence() - sequence);
+            return true;
+        }
+        if (sequence < historyLog.firstSequence()) {
+            return false; // Overwritten while the response was streaming, end the array here
+        }
+        if (historyLog.read(sequence, record)) {
+            return true;
+        }
+        response.skipped++; // Torn by a power cut, leave it out
+    }
+}
+
+// Oldest sequence number still held, on flash or in RAM
+uint32_t firstHistorySequence() {
+    if (historyLog.size() > 0 && historyLog.firstSequence() < history.firstSequence()) {
+        return historyLog.firstSequence();
+    }
+    return history.firstSequence();
 }
 
-// Function to format power readings to 2 decimal places
-String formatPower(float value) {
-    return String(floor(value * 100) / 100.0, 2); // Formats the value to 2 decimal places
+// Body reader for the server: the next piece of the connection's JSON document
+size_t readHistoryBody(void *context, char *buffer, size_t capacity) {
+    return static_cast<HistoryResponse *>(context)->encoder.read(buffer, capacity);
 }
 
-// Function to handle historical data retrieval
+// Query arguments of /historicalData
+struct HistoryArgs {
+    uint32_t since; // Missing = 0, everything
+    uint32_t limit;
+};
+constexpr QueryArg<HistoryArgs> historyArgs[] = {
+    numberArg("since", &HistoryArgs::since, 0, UINT32_MAX),
+    numberArg("limit", &HistoryArgs::limit, 1, UINT32_MAX),
+};
+
+// Function to handle historical data retrieval.
+// Optional arguments: since=<seq> returns only rows newer than seq, limit=<n> caps the row count
+// (default historyPageRows). Sequence numbers carry on across reboots while the flash log holds rows. Rows are newest first; the response carries lastSeq and an ETag,
+// and a matching If-None-Match is answered with 304 when nothing new was recorded.
 void handleHistoricalData() {
-    DynamicJsonDocument jsonDoc(2048);                       // Create a JSON document with a capacity of 2048 bytes
-    JsonArray dataArray = jsonDoc.createNestedArray("data"); // Create a nested array for JSON response
-
-    // Add historical entries to the JSON array, preserving the order
-    for (int i = 0; i < maxHistoryRows; i++) {
-        // Calculate index to fetch the latest data first using modulo for wrapping around
-        int index = (historyIndex - 1 - i + maxHistoryRows) % maxHistoryRows; 
-        JsonObject entry = dataArray.createNestedObject();               // Create a new JSON object for each entry
-        entry["date"] = history[index].date;                             // Add date entry
-        entry["time"] = history[index].time;                             // Add time entry
-        entry["bulb1State"] = history[index].bulb1State;                 // Add state of Bulb 1
-        entry["bulb2State"] = history[index].bulb2State;                 // Add state of Bulb 2
-        entry["current"] = formatCurrent(history[index].roundedCurrent); // Format and add current value
-        entry["power"] = formatPower(history[index].roundedPower);       // Format and add power value
-    }
-    
-    String response;                                // Declare a string to hold the serialized JSON response
-    serializeJson(jsonDoc, response);               // Serialize the JSON document into the response string
-    server.send(200, "application/json", response); // Send the JSON response back to the client
-}
-
-// Function to update historical data array with new entries
+    HistoryArgs args = {0, historyPageRows};                        // Default page size
+    if (!server.parseArgs(historyArgs, args)) {
+        return;
+    }
+    uint32_t lastSeq = history.lastSequence();                      // Sequence number of the newest row
+
+    // The ETag changes exactly when a new sample is recorded (or the device restarts), and differs
+    // between since/limit windows, which get different bodies
+    char etag[48];
+    snprintf(etag, sizeof(etag), "\"%08lx-%lu-%lu-%lu\"", (unsigned long)historyBootId, (unsigned long)lastSeq,
+             (unsigned long)args.since, (unsigned long)args.limit);
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", "no-cache");                 // Always revalidate, never serve stale rows
+    if (strcmp(server.header("If-None-Match"), etag) == 0) {
+        server.send(304);                                           // Client already has everything
+        return;
+    }
+
+    uint32_t first = firstHistorySequence();                        // Oldest row in RAM or on flash
+    size_t rows = lastSeq >= first ? lastSeq - first + 1 : 0;       // Every held row...
+    if (args.since >= first - 1) {
+        rows = args.since < lastSeq ? lastSeq - args.since : 0;     // ...or only those the client has not seen
+    }
+    if (rows > args.limit) {
+        rows = args.limit;
+    }
+
+    HistoryResponse &response = historyResponses[server.connectionIndex()]; // Lives as long as the connection's response
+    response.lastSeq = lastSeq;
+    response.since = args.since;
+    response.skipped = 0;
+    response.encoder.begin(readNewestHistoryRow, &response, rows, lastSeq); // Encodes rows on demand, no document in memory
+    server.sendStream(200, "application/json", readHistoryBody, &response); // Chunked, pulled as the socket drains
+}
+
+// Row reader for the binary encoder: recent rows from the RAM ring, older ones from the flash log.
+// False for rows that are gone or were torn by a power cut.
+bool readHistoryRecord(void *context, uint32_t sequence, HistoryRecord &record) {
+    (void)context;
+    if (sequence >= history.firstSequence() && sequence <= history.lastSequence()) {
+        record = history.newest(history.lastSequence() - sequence);
+        return true;
+    }
+    return historyLog.read(sequence, record);
+}
+
+// Binary search for the oldest row stamped at or after from. Timestamps only go backwards when the
+// clock is first set, so the boundary can be off around that point; the encoder filters every row anyway.
+uint32_t firstHistorySequenceAt(uint32_t from, uint32_t lastSeq) {
+    uint32_t low = firstHistorySequence();
+    uint32_t high = lastSeq + 1;
+    while (from > 0 && low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        uint32_t probe = middle;
+        HistoryRecord record;
+        while (probe < high && !readHistoryRecord(nullptr, probe, record)) {
+            probe++; // Step over torn rows
+        }
+        if (probe < high && record.timestamp < from) {
+            low = probe + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Body reader for the server: the next piece of the connection's binary export
+size_t readHistoryBinaryBody(void *context, char *buffer, size_t capacity) {
+    return static_cast<HistoryBinaryEncoder *>(context)->read(buffer, capacity);
+}
+
+// Query arguments of /historicalData.bin
+struct HistoryBinaryArgs {
+    uint32_t from;     // Epoch seconds; stamps are 4 bytes
+    uint32_t to;
+    uint32_t since;
+    uint8_t encoding;  // HistoryBinEncoding
+};
+const char *const historyEncodingNames[] = {"raw", "delta"}; // By HistoryBinEncoding
+constexpr QueryArg<HistoryBinaryArgs> historyBinaryArgs[] = {
+    numberArg("from", &HistoryBinaryArgs::from, 0, UINT32_MAX),
+    numberArg("to", &HistoryBinaryArgs::to, 0, UINT32_MAX),
+    numberArg("since", &HistoryBinaryArgs::since, 0, UINT32_MAX),
+    choiceArg("encoding", &HistoryBinaryArgs::encoding, historyEncodingNames, 2),
+};
+
+// Function to export historical data for collectors in the layout described in src/HistoryBinary.h,
+// oldest row first. Optional arguments: from=<epoch seconds> and to=<epoch seconds> bound the row
+// timestamps (inclusive), since=<seq> keeps only rows newer than seq (for incremental scrapes),
+// encoding=delta selects delta-encoded rows (default raw).
+void handleHistoricalDataBinary() {
+    HistoryBinaryArgs args = {0, UINT32_MAX, 0, HistoryBinRaw};    // Every row, raw
+    if (!server.parseArgs(historyBinaryArgs, args)) {
+        return;
+    }
+    const uint32_t from = args.from;
+    const uint32_t to = args.to;
+    if (from > to) {
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"from is after to\"}");
+        return;
+    }
+
+    uint32_t lastSeq = history.lastSequence();                      // Rows arriving mid-response are left out
+    uint32_t first = firstHistorySequenceAt(from, lastSeq);
+    if (args.since >= first) {
+        first = args.since + 1;
+    }
+    HistoryBinaryEncoder &encoder = historyBinaryResponses[server.connectionIndex()];
+    encoder.begin(readHistoryRecord, nullptr, (HistoryBinEncoding)args.encoding, first, lastSeq, lastSeq, from, to);
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendStream(200, "application/octet-stream", readHistoryBinaryBody, &encoder); // Chunked, pulled as the socket drains
+}
+
+// Query arguments of /rollups/<tier>
+struct RollupArgs {
+    uint32_t from;  // Epoch seconds
+    uint32_t limit;
+};
+constexpr QueryArg<RollupArgs> rollupArgs[] = {
+    numberArg("from", &RollupArgs::from, 0, UINT32_MAX),
+    numberArg("limit", &RollupArgs::limit, 0, UINT32_MAX),
+};
+
+// Function to list the buckets of one rollup tier: /rollups/minute, /rollups/hour or /rollups/day.
+// Optional arguments: limit=<n> caps the bucket count, from=<epoch seconds> drops older buckets.
+// {"tier":"hour","seconds":3600,"buckets":[{"start":..,"count":..,"current":{"min":"..","max":"..","mean":".."},"power":{..}},..]}
+// Buckets are newest first; the first one is still filling.
+void handleRollups() {
+    const char *name = server.uri() + strlen("/rollups/");
+    const RollupTier *tier = nullptr;
+    for (const RollupTier *candidate : rollupTiers) {
+        if (strcmp(name, candidate->name()) == 0) {
+            tier = candidate;
+        }
+    }
+    if (tier == nullptr) {
+        server.send(404, "application/json", "{\"status\":\"error\", \"message\":\"Use /rollups/minute|hour|day\"}");
+        return;
+    }
+    RollupArgs args = {0, (uint32_t)tier->capacity()};              // Every bucket
+    if (!server.parseArgs(rollupArgs, args)) {
+        return;
+    }
+    RollupResponse &response = rollupResponses[server.connectionIndex()];
+    response = RollupResponse();
+    response.tier = tier;
+    response.opened = tier->bucketsOpened();
+    response.from = args.from;
+    response.limit = args.limit;
+    server.sendStream(200, "application/json", readRollups, &response); // A tier can be larger than one buffer
+}
+
+// Body reader for a rollup listing: as many whole buckets as fit
+size_t readRollups(void *context, char *buffer, size_t capacity) {
+    RollupResponse &response = *static_cast<RollupResponse *>(context);
+    const RollupTier &tier = *response.tier;
+    char *out = buffer;
+    char *end = buffer + capacity;
+    if (!response.started) {
+        out += snprintf(out, end - out, "{\"tier\":\"%s\",\"seconds\":%lu,\"buckets\":[", tier.name(),
+                        (unsigned long)tier.bucketSeconds());
+        response.started = true;
+    }
+    while (!response.finished && end - out > (long)rollupBucketJsonMax + 1) {
+        size_t age = tier.bucketsOpened() - response.opened + response.nextAge; // Buckets opened since the start shift ages
+        if (response.nextAge >= response.limit || age >= tier.size() || tier.newest(age).start < response.from) {
+            memcpy(out, "]}", 2);
+            out += 2;
+            response.finished = true;
+            break;
+        }
+        if (response.nextAge > 0) {
+            *out++ = ',';
+        }
+        out += encodeRollupBucket(out, tier.newest(age));
+        response.nextAge++;
+    }
+    return out - buffer;
+}
+
+// Function to report the energy counters.
+// {"channels":[{"channel":1,"state":"On","kWh":"0.123456","tripKWh":"0.023456"},..],"unattributedKWh":"0.000000"}
+// "kWh" counts since boot, "tripKWh" since the last /energy/reset. Up to a second old.
+void handleEnergy() {
+    EnergyResponse &response = energyResponses[server.connectionIndex()];
+    response = EnergyResponse();
+    server.sendStream(200, "application/json", readEnergy, &response); // 16 channels do not fit one buffer
+}
+
+// Print micro-joules as kWh with 6 decimals (rounded to the nearest milli-watt-hour)
+int formatKWh(char *out, size_t size, uint64_t microJoules) {
+    const uint64_t microKWh = (microJoules + EnergyMeter::microJoulesPerKWh / 2000000) / (EnergyMeter::microJoulesPerKWh / 1000000);
+    return snprintf(out, size, "\"%llu.%06llu\"", (unsigned long long)(microKWh / 1000000), (unsigned long long)(microKWh % 1000000));
+}
+
+// Body reader for the energy report: as many whole channels as fit
+size_t readEnergy(void *context, char *buffer, size_t capacity) {
+    const size_t channelMax = 112;                                  // Longest encoded channel
+    EnergyResponse &response = *static_cast<EnergyResponse *>(context);
+    char *out = buffer;
+    char *end = buffer + capacity;
+    if (!response.started) {
+        out += snprintf(out, end - out, "{\"channels\":[");
+        response.started = true;
+    }
+    while (response.nextChannel < relayChannels && end - out > (long)channelMax) {
+        const EnergyMeter::Channel &channel = energyView.channel(response.nextChannel);
+        out += snprintf(out, end - out, "%s{\"channel\":%u,\"state\":\"%s\",\"kWh\":", response.nextChannel ? "," : "",
+                        (unsigned)(response.nextChannel + 1), (relayView.mask & (1u << response.nextChannel)) ? "On" : "Off");
+        out += formatKWh(out, end - out, channel.totalMicroJoules);
+        out += snprintf(out, end - out, ",\"tripKWh\":");
+        out += formatKWh(out, end - out, channel.tripMicroJoules);
+        *out++ = '}';
+        response.nextChannel++;
+    }
+    if (response.nextChannel == relayChannels && !response.finished && end - out > (long)channelMax) {
+        out += snprintf(out, end - out, "],\"unattributedKWh\":");
+        out += formatKWh(out, end - out, energyView.unattributedMicroJoules());
+        *out++ = '}';
+        response.finished = true;
+    }
+    return out - buffer;
+}
+
+// Query arguments of /energy/reset
+struct EnergyResetArgs {
+    const char *channel; // <n> or all
+};
+constexpr QueryArg<EnergyResetArgs> energyResetArgs[] = {
+    textArg("channel", &EnergyResetArgs::channel, 3),
+};
+
+// Function to zero the resettable energy counters: /energy/reset?channel=<n>|all (default all)
+void handleEnergyReset() {
+    EnergyResetArgs args = {""};
+    if (!server.parseArgs(energyResetArgs, args)) {
+        return;
+    }
+    uint16_t mask = allRelaysMask;
+    if (args.channel[0] != '\0' && strcmp(args.channel, "all") != 0) {
+        const char *end;
+        if (!parseChannel(args.channel, &end, mask) || *end != '\0') {
+            server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Need channel=<n>|all\"}");
+            return;
+        }
+    }
+    if (queueCommand({CommandResetEnergy, mask, 0})) {                              // Applied by the control task
+        server.send(200, "application/json", "{\"status\":\"success\"}");
+    }
+}
+
+// Take finished captures from the sampler. Once loop() holds CAPTURE_SLOTS - 1 of them the oldest goes
+// back, so the sampler always has a free slot; a download of it still streaming ends when the slot is reused.
+void collectCaptures() {
+    const WaveformCapture::Capture *capture;
+    while ((capture = waveformCapture.take()) != nullptr) {
+        if (heldCaptureCount == CAPTURE_SLOTS - 1) {
+            waveformCapture.release(heldCaptures[0].capture);
+            memmove(heldCaptures, heldCaptures + 1, (heldCaptureCount - 1) * sizeof(HeldCapture));
+            heldCaptureCount--;
+        }
+        HeldCapture &held = heldCaptures[heldCaptureCount++];
+        held.capture = capture;
+        held.epochMicros = wallTime.nowMicros() - (int64_t)(hal::monotonicMicros() - capture->triggerMicros);
+        held.peakCounts = 0;
+        const int32_t zero = waveformCapture.zero();
+        for (size_t i = 0; i < (size_t)capture->before + capture->after; i++) {
+            const int32_t distance = abs((int32_t)capture->samples[i] - zero);
+            if (distance > held.peakCounts) {
+                held.peakCounts = distance;
+            }
+        }
+
+        char data[96];
+        int length = snprintf(data, sizeof(data), "{\"id\":%lu,\"trigger\":\"%s\",\"peakAmps\":%.2f}",
+                              (unsigned long)capture->id.load(), captureTriggerNames[capture->trigger],
+                              held.peakCounts / adcCountsPerAmp);
+        eventStream.publish("capture", data, writtenLength(length, sizeof(data)));
+        LOG_INFO("Waveform capture %u (%s), peak %.2f A", capture->id.load(), captureTriggerNames[capture->trigger],
+                 (uint32_t)lroundf(held.peakCounts * 100 / adcCountsPerAmp)); // In 0.01 A
+    }
+}
+
+// Function to list the held waveform captures, oldest first:
+// {"captures":[{"id":N,"trigger":"relay|threshold","time":"YYYY-MM-DD HH:MM:SS.uuuuuu","relaysBefore":M,
+//   "relaysAfter":M,"peakAmps":A,"before":N,"after":N},...],"missed":N}
+// "before" readings at the base rate precede the trigger, "after" readings at the burst rate follow it.
+void handleCaptureList() {
+    const size_t entryMax = 176;                       // Longest encoded capture
+    char body[48 + (CAPTURE_SLOTS - 1) * entryMax];    // Room for every held capture
+    char *out = body;
+    char *end = body + sizeof(body);
+    out += snprintf(out, end - out, "{\"captures\":[");
+    for (size_t i = 0; i < heldCaptureCount && end - out > (long)entryMax; i++) {
+        const HeldCapture &held = heldCaptures[i];
+        const WaveformCapture::Capture &capture = *held.capture;
+        const uint32_t seconds = (uint32_t)(held.epochMicros / 1000000);
+        out += snprintf(out, end - out, "%s{\"id\":%lu,\"trigger\":\"%s\",\"time\":\"", i ? "," : "",
+                        (unsigned long)capture.id.load(), captureTriggerNames[capture.trigger]);
+        formatDate(seconds, out);
+        out[10] = ' ';
+        formatTime(seconds, out + 11);
+        out += 19;
+        out += snprintf(out, end - out, ".%06lu\",\"relaysBefore\":%u,\"relaysAfter\":%u,\"peakAmps\":%.2f,\"before\":%u,\"after\":%u}",
+                        (unsigned long)(held.epochMicros % 1000000), capture.relaysBefore, capture.relaysAfter,
+                        held.peakCounts / adcCountsPerAmp, capture.before, capture.after);
+    }
+    out += snprintf(out, end - out, "],\"missed\":%lu}", (unsigned long)waveformCapture.missed());
+    server.send(200, "application/json", body, out - body);
+}
+
+// Function to download one capture: /captures/<id>.bin, layout in src/WaveformCapture.h
+void handleCaptureDownload() {
+    const char *path = server.uri() + strlen("/captures/");
+    char *end;
+    uint32_t id = strtoul(path, &end, 10);
+    const HeldCapture *held = nullptr;
+    if (end != path && strcmp(end, ".bin") == 0) {
+        for (size_t i = 0; i < heldCaptureCount; i++) {
+            if (heldCaptures[i].capture->id.load() == id) {
+                held = &heldCaptures[i];
+            }
+        }
+    }
+    if (held == nullptr) {
+        server.send(404, "application/json", "{\"status\":\"error\", \"message\":\"No such capture\"}");
+        return;
+    }
+    CaptureBinInfo info = {(uint32_t)(held->epochMicros / 1000000), (uint32_t)(held->epochMicros % 1000000),
+                           (uint16_t)currentSampler.sampleRate(), (uint16_t)currentSampler.burstRate(), adcCountsPerAmp};
+    CaptureBinaryEncoder &encoder = captureResponses[server.connectionIndex()];
+    encoder.begin(*held->capture, waveformCapture.zero(), info);
+    server.sendStream(200, "application/octet-stream", readCapture, &encoder); // 2.8 KB, a few chunks
+}
+
+// Body reader for a capture download
+size_t readCapture(void *context, char *buffer, size_t capacity) {
+    return static_cast<CaptureBinaryEncoder *>(context)->read(buffer, capacity);
+}
+
+// Take new faults from the trip: log them, push them to open pages and keep the newest for /faults
+void collectFaults() {
+    OvercurrentTrip::Fault fault;
+    while (overcurrentTrip.takeFault(fault)) {
+        FaultEntry &entry = faultLog[faultCount % FAULT_LOG_ENTRIES];
+        entry.fault = fault;
+        entry.id = ++faultCount;
+        entry.epochMicros = wallTime.nowMicros() - (int64_t)(hal::monotonicMicros() - fault.tripMicros);
+        const uint32_t latencyMicros = faultLatencyMicros(fault);
+#if METRICS_ENABLED
+        tripLatency.record(latencyMicros * hal::cyclesPerMicrosecond());
+#endif
+
+        char data[128];
+        int length = snprintf(data, sizeof(data), "{\"id\":%lu,\"limit\":\"%s\",\"relays\":%u,\"latencyMicros\":%lu,\"capture\":%lu}",
+                              (unsigned long)entry.id, tripKindNames[fault.kind], fault.relays,
+                              (unsigned long)latencyMicros, (unsigned long)fault.captureId);
+        eventStream.publish("fault", data, writtenLength(length, sizeof(data)));
+        LOG_ERROR("Overcurrent trip (%s): relays %u opened, peak %.2f A, %u us after onset", tripKindNames[fault.kind],
+                  fault.relays, (uint32_t)lroundf(fault.peakCounts * 100 / adcCountsPerAmp), latencyMicros);
+    }
+}
+
+// Time from the first reading over a limit to the relay outputs written. The fault may have started up
+// to one reading before the first one that saw it, so the readings count in full.
+uint32_t faultLatencyMicros(const OvercurrentTrip::Fault &fault) {
+    return (uint32_t)((uint64_t)fault.detectReadings * 1000000 / currentSampler.sampleRate()) + fault.openMicros;
+}
+
+// Function to list overcurrent faults, newest first, and whether the trip is latched:
+// {"tripped":true,"faults":[{"id":N,"limit":"instant|i2t","time":"YYYY-MM-DD HH:MM:SS.uuuuuu","relays":M,
+//   "peakAmps":A,"detectMicros":N,"openMicros":N,"latencyMicros":N,"capture":N},...]}
+// detectMicros runs from the first reading over the limit to the trip decision, openMicros from there to
+// the relay outputs written; "capture" is the /captures id holding the readings around it (0 if none).
+void handleFaults() {
+    char body[1024];
+    char *out = body;
+    char *end = body + sizeof(body);
+    const size_t entryMax = 224; // Longest encoded fault
+    out += snprintf(out, end - out, "{\"tripped\":%s,\"faults\":[", overcurrentTrip.tripped() ? "true" : "false");
+    const uint32_t listed = faultCount < FAULT_LOG_ENTRIES ? faultCount : FAULT_LOG_ENTRIES;
+    for (uint32_t i = 0; i < listed && end - out > (long)entryMax; i++) {
+        const FaultEntry &entry = faultLog[(faultCount - 1 - i) % FAULT_LOG_ENTRIES];
+        const OvercurrentTrip::Fault &fault = entry.fault;
+        const uint32_t seconds = (uint32_t)(entry.epochMicros / 1000000);
+        out += snprintf(out, end - out, "%s{\"id\":%lu,\"limit\":\"%s\",\"time\":\"", i ? "," : "",
+                        (unsigned long)entry.id, tripKindNames[fault.kind]);
+        formatDate(seconds, out);
+        out[10] = ' ';
+        formatTime(seconds, out + 11);
+        out += 19;
+        const uint32_t detectMicros = faultLatencyMicros(fault) - fault.openMicros;
+        out += snprintf(out, end - out, ".%06lu\",\"relays\":%u,\"peakAmps\":%.2f,\"detectMicros\":%lu,\"openMicros\":%lu,"
+                        "\"latencyMicros\":%lu,\"capture\":%lu}",
+                        (unsigned long)(entry.epochMicros % 1000000), fault.relays, fault.peakCounts / adcCountsPerAmp,
+                        (unsigned long)detectMicros, (unsigned long)fault.openMicros,
+                        (unsigned long)faultLatencyMicros(fault), (unsigned long)fault.captureId);
+    }
+    out += snprintf(out, end - out, "]}");
+    server.send(200, "application/json", body, out - body);
+}
+
+// Function to clear a latched overcurrent trip; the relays stay open until switched again
+void handleFaultReset() {
+    if (!overcurrentTrip.tripped()) {
+        server.send(200, "application/json", "{\"status\":\"Not tripped\"}");
+        return;
+    }
+    if (queueCommand({CommandResetTrip, 0, 0})) {                                    // Applied by the control task
+        LOG_INFO("Overcurrent trip reset");
+        server.send(200, "application/json", "{\"status\":\"success\"}");
+    }
+}
+
+#if METRICS_ENABLED
+// Function to serve the instrumentation in Prometheus text format
+void handleMetrics() {
+    size_t &linesSent = metricsLinesSent[server.connectionIndex()];
+    linesSent = 0;
+    server.sendStream(200, "text/plain; version=0.0.4", readMetrics, &linesSent); // Several chunks long
+}
+
+// Body reader for /metrics: write every metric again, skipping the lines earlier chunks carried
+size_t readMetrics(void *context, char *buffer, size_t capacity) {
+    size_t &linesSent = *static_cast<size_t *>(context);
+    MetricsWriter writer;
+    writer.begin(buffer, capacity, linesSent);
+    writeMetrics(writer);
+    linesSent = writer.lines();
+    return writer.length();
+}
+
+void writeMetrics(MetricsWriter &writer) {
+    char labels[64];
+    writer.describe("bulb_loop_seconds", "histogram", "Duration of loop() iterations");
+    writer.histogram("bulb_loop_seconds", nullptr, loopTime);
+    writer.describe("bulb_loop_idle_seconds_total", "counter", "Time loop() spent waiting for its next event");
+    writer.fixedValue("bulb_loop_idle_seconds_total", nullptr, loopIdleMicros, 6);
+    writer.describe("bulb_loop_idle_ratio", "gauge", "Share of the last full minute loop() spent waiting");
+    writer.fixedValue("bulb_loop_idle_ratio", nullptr, loopIdleRatio, 4);
+    writer.describe("bulb_loop_wakeups_total", "counter", "loop() wakeups, by reason");
+    const char *const wakeReasons[] = {"deadline", "socket", "control"}; // By hal::WakeReason
+    for (size_t i = 0; i < 3; i++) {
+        snprintf(labels, sizeof(labels), "reason=\"%s\"", wakeReasons[i]);
+        writer.value("bulb_loop_wakeups_total", labels, loopWakeups[i]);
+    }
+    writer.describe("bulb_loop_wakeup_latency_seconds", "histogram", "Deadline or control task wakeup to loop() running");
+    writer.histogram("bulb_loop_wakeup_latency_seconds", nullptr, wakeLatency);
+    writer.describe("bulb_boot_phase_seconds", "gauge", "Duration of each setup() phase at the last boot");
+    for (size_t phase = 0; phase < BootPhaseCount; phase++) {
+        snprintf(labels, sizeof(labels), "phase=\"%s\"", bootPhaseNames[phase]);
+        writer.fixedValue("bulb_boot_phase_seconds", labels, bootPhaseMicros[phase], 6);
+    }
+    writer.describe("bulb_boot_relays_restored_seconds", "gauge", "Application start to the relays restored");
+    writer.fixedValue("bulb_boot_relays_restored_seconds", nullptr, relaysRestoredMicros, 6);
+    writer.describe("bulb_calibration_cached", "gauge", "1 if this boot used the stored sensor zero");
+    writer.value("bulb_calibration_cached", nullptr, calibrationCached ? 1 : 0);
+    writer.describe("bulb_calibration_checks_total", "counter", "Background re-checks of the sensor zero");
+    writer.value("bulb_calibration_checks_total", nullptr, calibrationChecks);
+    writer.describe("bulb_calibration_updates_total", "counter", "Re-checks that moved the sensor zero");
+    writer.value("bulb_calibration_updates_total", nullptr, calibrationUpdates);
+    writer.describe("bulb_sensor_zero_counts", "gauge", "Zero-current ADC reading in use");
+    writer.value("bulb_sensor_zero_counts", nullptr, sensorZero.load());
+    writer.describe("bulb_http_poll_seconds", "histogram", "Duration of HttpServer::poll()");
+    writer.histogram("bulb_http_poll_seconds", nullptr, serverPollTime);
+    writer.describe("bulb_control_step_seconds", "histogram", "Duration of control task steps");
+    writer.histogram("bulb_control_step_seconds", nullptr, controlStepTime);
+    writer.describe("bulb_update_history_seconds", "histogram", "Duration of updateHistoricalData()");
+    writer.histogram("bulb_update_history_seconds", nullptr, updateHistoryTime);
+
+    writer.describe("bulb_http_handler_seconds", "histogram", "Route handler run time");
+    for (size_t i = 0; i < server.registeredRoutes(); i++) {
+        const Route &route = server.route(i);
+        snprintf(labels, sizeof(labels), "route=\"%s%s\",method=\"%s\"", route.path, route.prefix ? "*" : "",
+                 RouteTable::methodName(route.method));
+        writer.histogram("bulb_http_handler_seconds", labels, server.routeStats(i).handlerTime);
+    }
+    writer.describe("bulb_http_requests_total", "counter", "Requests by route");
+    for (size_t i = 0; i < server.registeredRoutes(); i++) {
+        const Route &route = server.route(i);
+        snprintf(labels, sizeof(labels), "route=\"%s%s\",method=\"%s\"", route.path, route.prefix ? "*" : "",
+                 RouteTable::methodName(route.method));
+        writer.value("bulb_http_requests_total", labels, server.routeStats(i).requests);
+    }
+    writer.describe("bulb_http_not_found_total", "counter", "Requests that matched no route");
+    writer.value("bulb_http_not_found_total", nullptr, server.unmatchedRequests());
+    writer.describe("bulb_http_method_not_allowed_total", "counter", "Requests for a route's path with another method");
+    writer.value("bulb_http_method_not_allowed_total", nullptr, server.wrongMethodRequests());
+    writer.describe("bulb_http_rejected_connections_total", "counter", "Connections turned away with every slot busy");
+    writer.value("bulb_http_rejected_connections_total", nullptr, server.rejectedConnections());
+    writer.describe("bulb_http_timeouts_total", "counter", "Connections closed for stalling");
+    writer.value("bulb_http_timeouts_total", nullptr, server.timedOutConnections());
+
+    writer.describe("bulb_heap_free_bytes", "gauge", "Free heap now");
+    writer.value("bulb_heap_free_bytes", nullptr, hal::freeHeap());
+    writer.describe("bulb_heap_free_low_bytes", "gauge", "Least free heap since boot");
+    writer.value("bulb_heap_free_low_bytes", nullptr, hal::minFreeHeap() < heapLowWatermark ? hal::minFreeHeap() : heapLowWatermark);
+    writer.describe("bulb_heap_free_high_bytes", "gauge", "Most free heap seen since boot");
+    writer.value("bulb_heap_free_high_bytes", nullptr, heapHighWatermark);
+    writer.describe("bulb_heap_largest_free_block_bytes", "gauge", "Largest allocatable block (fragmentation)");
+    writer.value("bulb_heap_largest_free_block_bytes", nullptr, hal::largestFreeBlock());
+
+    writer.describe("bulb_samples_dropped_total", "counter", "History samples lost because loop() fell behind");
+    writer.value("bulb_samples_dropped_total", nullptr, droppedSamples);
+    writer.describe("bulb_commands_rejected_total", "counter", "Relay commands refused because the control task fell behind");
+    writer.value("bulb_commands_rejected_total", nullptr, rejectedCommands);
+    writer.describe("bulb_event_subscribers_dropped_total", "counter", "Event stream subscribers cut off for falling behind");
+    writer.value("bulb_event_subscribers_dropped_total", nullptr, eventStream.droppedSubscribers());
+    writer.describe("bulb_history_log_corrupt_records_total", "counter", "Flash history records that failed their CRC");
+    writer.value("bulb_history_log_corrupt_records_total", nullptr, historyLog.corruptRecords());
+    writer.describe("bulb_history_log_erases_total", "counter", "Flash sectors erased by the history log since boot");
+    writer.value("bulb_history_log_erases_total", nullptr, historyLog.segmentsErased());
+    writer.describe("bulb_log_records_dropped_total", "counter", "Log records lost because the log ring was full");
+    writer.value("bulb_log_records_dropped_total", nullptr, logDroppedRecords());
+    writer.describe("bulb_clock_syncs_total", "counter", "Wall clock syncs from clients");
+    writer.value("bulb_clock_syncs_total", nullptr, wallTime.syncCount());
+    writer.describe("bulb_clock_steps_total", "counter", "Syncs that stepped the wall clock instead of slewing it");
+    writer.value("bulb_clock_steps_total", nullptr, wallTime.stepCount());
+    writer.describe("bulb_clock_drift_ppb", "gauge", "Rate correction applied to the wall clock");
+    writer.signedValue("bulb_clock_drift_ppb", nullptr, wallTime.driftPpb());
+    writer.describe("bulb_captures_total", "counter", "Waveform captures recorded, by trigger");
+    for (size_t i = 0; i < 3; i++) {
+        snprintf(labels, sizeof(labels), "trigger=\"%s\"", captureTriggerNames[i]);
+        writer.value("bulb_captures_total", labels, waveformCapture.captured((WaveformCapture::Trigger)i));
+    }
+    writer.describe("bulb_captures_missed_total", "counter", "Triggers ignored because every capture slot was held");
+    writer.value("bulb_captures_missed_total", nullptr, waveformCapture.missed());
+    writer.describe("bulb_overcurrent_trips_total", "counter", "Overcurrent trips, by limit");
+    for (size_t i = 0; i < 2; i++) {
+        snprintf(labels, sizeof(labels), "limit=\"%s\"", tripKindNames[i]);
+        writer.value("bulb_overcurrent_trips_total", labels, overcurrentTrip.trips((OvercurrentTrip::Kind)i));
+    }
+    writer.describe("bulb_overcurrent_tripped", "gauge", "1 while an overcurrent trip is latched");
+    writer.value("bulb_overcurrent_tripped", nullptr, overcurrentTrip.tripped());
+    writer.describe("bulb_trip_latency_seconds", "histogram", "First reading over a limit to relays open");
+    writer.histogram("bulb_trip_latency_seconds", nullptr, tripLatency);
+    writer.describe("bulb_uptime_seconds", "gauge", "Seconds since boot");
+    writer.value("bulb_uptime_seconds", nullptr, millis() / 1000);
+}
+
+// Sample free heap once a second for the high and low watermarks (loop())
+void trackHeap() {
+    unsigned long now = millis();
+    if (now - lastHeapCheck < 1000 && heapHighWatermark != 0) {
+        return;
+    }
+    lastHeapCheck = now;
+    size_t free = hal::freeHeap();
+    if (free < heapLowWatermark) {
+        heapLowWatermark = free;
+    }
+    if (free > heapHighWatermark) {
+        heapHighWatermark = free;
+    }
+}
+#endif
+
+// Function to subscribe a page to live updates; the event stream owns the socket from here on
+void handleEvents() {
+    eventStream.adopt(server.detachClient(), millis());
+}
+
+// Convert seconds to schedule ticks
+uint32_t secondsToTicks(uint32_t seconds) {
+    return (uint32_t)((uint64_t)seconds * 1000 / SCHEDULE_TICK_MS);
+}
+
+// Ticks from now to the next run of an entry given a time of day, worked out on the wall clock so runs
+// follow /timeInit and clock corrections. Runs come every period (one-shot entries: daily) from
+// anchorEpoch. Right after a run (ran) it is the run nearest to one period later, so one the tick count
+// fired a little early or late is neither repeated nor skipped; otherwise the next one still ahead.
+uint32_t wallClockDelayTicks(const ScheduleEntry &entry, bool ran) {
+    const int64_t periodMicros = (entry.periodTicks != 0 ? (int64_t)entry.periodTicks * SCHEDULE_TICK_MS : 86400000) * 1000; // Periods reach past 2^32 ms
+    int64_t delayMicros = ((int64_t)entry.anchorEpoch * 1000000 - wallTime.nowMicros()) % periodMicros;
+    if (ran) {
+        if (delayMicros < -periodMicros / 2) {
+            delayMicros += periodMicros;
+        } else if (delayMicros >= periodMicros / 2) {
+            delayMicros -= periodMicros;
+        }
+        delayMicros += periodMicros;
+    } else if (delayMicros < 0) {
+        delayMicros += periodMicros;
+    }
+    return (uint32_t)((delayMicros + SCHEDULE_TICK_MS * 500) / (SCHEDULE_TICK_MS * 1000));
+}
+
+// After the wall clock was stepped, move every entry given a time of day to its next run on the new
+// time; entries given a delay keep counting ticks
+void rearmTimeOfDaySchedules() {
+    for (size_t i = 0; i < schedules.capacity(); i++) {
+        uint32_t id;
+        ScheduleEntry entry;
+        uint32_t deadline;
+        if (schedules.at(i, id, entry, deadline) && entry.anchorEpoch != 0 && !entry.retrying) {
+            schedules.reschedule(id, wallClockDelayTicks(entry, false));
+        }
+    }
+}
+
+// Advance the schedule wheel to the current tick and queue the relay command of every due entry.
+// Ticks are counted from millis() differences, so the millis() rollover does not disturb them.
+void runSchedules() {
+    unsigned long elapsed = millis() - scheduleMillis;
+    if (elapsed < SCHEDULE_TICK_MS) {
+        return;
+    }
+    uint32_t ticks = elapsed / SCHEDULE_TICK_MS;
+    scheduleMillis += ticks * SCHEDULE_TICK_MS;
+    scheduleTick += ticks;
+    const uint32_t nowTick = scheduleTick;
+    schedules.advance(nowTick, [nowTick](uint32_t id, ScheduleEntry &entry, uint32_t &deadline) {
+        if (!pushCommand({entry.action, entry.relayMask, 0})) {
+            if (!entry.retrying) {
+                entry.dueTick = deadline; // Later runs keep their phase
+                entry.retrying = true;
+            }
+            deadline = nowTick + 1; // Control task is behind, try again on the next tick
+            return true;
+        }
+        if (entry.retrying) {
+            deadline = entry.dueTick;
+            entry.retrying = false;
+        }
+        if (id == countdownId) {
+            countdownId = 0;
+        }
+        if (entry.periodTicks == 0) {
+            return false; // One-shot entry is done
+        }
+        if (entry.anchorEpoch != 0) {
+            deadline = nowTick + wallClockDelayTicks(entry, true);
+            return true;
+        }
+        do {
+            deadline += entry.periodTicks; // Next occurrence, skipping any missed while loop() was stalled
+        } while ((int32_t)(deadline - nowTick) <= 0);
+        return true;
+    });
+}
+
+// Function to list pending schedule entries.
+// {"now":"YYYY-MM-DD HH:MM:SS","entries":[{"id":N,"action":"on","mask":3,"in":<s>,"every":<s>},...]}
+// "in" is the number of seconds until the entry fires, "every" its period (0 for one-shot entries).
+void handleScheduleList() {
+    ScheduleListResponse &response = scheduleListResponses[server.connectionIndex()];
+    response = ScheduleListResponse();
+    server.sendStream(200, "application/json", readScheduleList, &response); // Pool can be larger than one buffer
+}
+
+// Body reader for the schedule listing: as many whole entries as fit, pool position by position
+size_t readScheduleList(void *context, char *buffer, size_t capacity) {
+    const size_t entryMax = 96;                                     // Longest encoded entry
+    ScheduleListResponse &response = *static_cast<ScheduleListResponse *>(context);
+    char *out = buffer;
+    char *end = buffer + capacity;
+    if (!response.started) {
+        uint32_t now = wallTime.seconds();
+        out += snprintf(out, end - out, "{\"now\":\"");
+        formatDate(now, out);
+        out[10] = ' ';
+        formatTime(now, out + 11);
+        out += 19;
+        out += snprintf(out, end - out, "\",\"entries\":[");
+        response.started = true;
+    }
+    while (response.nextIndex < schedules.capacity() && end - out > (long)entryMax) {
+        uint32_t id;
+        ScheduleEntry entry;
+        uint32_t deadline;
+        if (schedules.at(response.nextIndex++, id, entry, deadline)) {
+            out += snprintf(out, end - out, "%s{\"id\":%lu,\"action\":\"%s\",\"mask\":%u,\"in\":%lu,\"every\":%lu}",
+                            response.listed ? "," : "", (unsigned long)id, commandNames[entry.action], entry.relayMask,
+                            (unsigned long)((deadline - schedules.now()) * (uint64_t)SCHEDULE_TICK_MS / 1000),
+                            (unsigned long)(entry.periodTicks * (uint64_t)SCHEDULE_TICK_MS / 1000));
+            response.listed = true;
+        }
+    }
+    if (response.nextIndex == schedules.capacity() && !response.finished && end - out >= 2) {
+        memcpy(out, "]}", 2);
+        out += 2;
+        response.finished = true;
+    }
+    return out - buffer;
+}
+
+// Query arguments of /schedules/add
+struct ScheduleAddArgs {
+    uint8_t action;      // ControlCommandType
+    const char *channel; // <n> or all
+    uint32_t in;         // Seconds from now...
+    const char *at;      // ...or HH:MM:SS, nullptr if not given
+    uint32_t every;      // Period in seconds, 0 for one-shot
+};
+constexpr QueryArg<ScheduleAddArgs> scheduleAddArgs[] = {
+    choiceArg("action", &ScheduleAddArgs::action, commandNames, 3, true),
+    textArg("channel", &ScheduleAddArgs::channel, 3),
+    numberArg("in", &ScheduleAddArgs::in, 0, maxScheduleSeconds),
+    textArg("at", &ScheduleAddArgs::at, 8),
+    numberArg("every", &ScheduleAddArgs::every, 0, maxScheduleSeconds),
+};
+
+// Function to add a schedule entry.
+// action=on|off|toggle, channel=<n>|all (default all), and when: in=<seconds> from now or at=HH:MM:SS
+// (next occurrence, wall clock). every=<seconds> makes it recurring, e.g. at=18:30:00&every=86400 daily.
+void handleScheduleAdd() {
+    ScheduleAddArgs args = {0, "", 0, nullptr, 0};
+    if (!server.parseArgs(scheduleAddArgs, args)) {
+        return;
+    }
+
+    uint16_t mask = allRelaysMask;
+    if (args.channel[0] != '\0' && strcmp(args.channel, "all") != 0) {
+        const char *end;
+        if (!parseChannel(args.channel, &end, mask) || *end != '\0') {
+            mask = 0;
+        }
+    }
+
+    if (server.hasArg("in") && args.at != nullptr) {
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Use in= or at=, not both\"}");
+        return;
+    }
+    uint32_t delaySeconds = args.in;
+    bool haveTime = server.hasArg("in");
+    if (args.at != nullptr) {
+        uint32_t secondOfDay;
+        haveTime = parseDateTime("1970-01-01", args.at, secondOfDay);
+        delaySeconds = (secondOfDay + 86400 - wallTime.seconds() % 86400) % 86400; // Later today or tomorrow
+    }
+
+    if (mask == 0 || !haveTime) {
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Need channel=<n>|all and in= or at=HH:MM:SS\"}");
+        return;
+    }
+    if (args.every > 0 && secondsToTicks(args.every) == 0) {
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Time out of range\"}");
+        return;
+    }
+
+    const uint32_t anchorEpoch = args.at != nullptr ? wallTime.seconds() + delaySeconds : 0; // Runs follow the wall clock
+    uint32_t id = schedules.schedule(secondsToTicks(delaySeconds), {(ControlCommandType)args.action, mask,
+                                                                    secondsToTicks(args.every), anchorEpoch, 0, false});
+    if (id == 0) {
+        server.send(503, "application/json", "{\"status\":\"error\", \"message\":\"Schedule full\"}");
+        return;
+    }
+    char body[48];
+    int length = snprintf(body, sizeof(body), "{\"status\":\"success\", \"id\":%lu}", (unsigned long)id);
+    server.send(200, "application/json", body, writtenLength(length, sizeof(body)));
+}
+
+// Query arguments of /schedules/cancel
+struct ScheduleCancelArgs {
+    uint32_t id;
+};
+constexpr QueryArg<ScheduleCancelArgs> scheduleCancelArgs[] = {
+    numberArg("id", &ScheduleCancelArgs::id, 1, UINT32_MAX, true),
+};
+
+// Function to cancel a schedule entry by id
+void handleScheduleCancel() {
+    ScheduleCancelArgs args = {};
+    if (!server.parseArgs(scheduleCancelArgs, args)) {
+        return;
+    }
+    if (!schedules.cancel(args.id)) {
+        server.send(404, "application/json", "{\"status\":\"error\", \"message\":\"No such schedule\"}");
+        return;
+    }
+    if (args.id == countdownId) {
+        countdownId = 0;
+    }
+    server.send(200, "application/json", "{\"status\":\"success\"}");
+}
+
+// One /batch operation: an immediate relay change or a new schedule entry
+struct BatchOperation {
+    bool scheduled;            // Schedule entry rather than an immediate change
+    ControlCommandType action; // On, off or toggle
+    uint16_t mask;             // Channels
+    uint32_t delaySeconds;     // Schedule entries: first run
+    uint32_t every;            // Schedule entries: period, 0 for one-shot
+    uint32_t anchorEpoch;      // Schedule entries given at=: wall-clock second of the first run, else 0
+};
+
+// Parse a channel list, <n>[,<n>...] or all, into a relay mask; false if any channel does not exist
+bool parseChannelList(const char *text, uint16_t &mask) {
+    if (strcmp(text, "all") == 0) {
+        mask = allRelaysMask;
+        return true;
+    }
+    mask = 0;
+    do {
+        uint16_t bit;
+        if (!parseChannel(text, &text, bit) || (*text != ',' && *text != '\0')) {
+            return false;
+        }
+        mask |= bit;
+    } while (*text++ == ',');
+    return true;
+}
+
+// Parse one /batch line (split into words in place); returns the reason it is invalid, or nullptr
+const char *parseBatchOperation(char *line, BatchOperation &operation) {
+    char *words[6];
+    size_t count = 0;
+    for (char *word = strtok(line, " \t"); word != nullptr; word = strtok(nullptr, " \t")) {
+        if (count == 6) {
+            return "Too many words";
+        }
+        words[count++] = word;
+    }
+    if (count == 0) {
+        return "Empty operation";
+    }
+
+    operation = BatchOperation();
+    int action = -1;
+    if (strcmp(words[0], "set") == 0 && count == 3) {
+        action = strcmp(words[2], "on") == 0 ? CommandSwitchOn : strcmp(words[2], "off") == 0 ? CommandSwitchOff : -1;
+    } else if (strcmp(words[0], "toggle") == 0 && count == 2) {
+        action = CommandSwitchToggle;
+    } else if (strcmp(words[0], "schedule") == 0 && count >= 3) { // The time is checked below
+        for (int i = 0; i < 3; i++) {
+            if (strcmp(words[2], commandNames[i]) == 0) {
+                action = i;
+            }
+        }
+        operation.scheduled = true;
+    } else {
+        return "Use set <channels> on|off, toggle <channels> or schedule <channels> on|off|toggle in=|at= [every=]";
+    }
+    if (action < 0) {
+        return "Unknown action";
+    }
+    operation.action = (ControlCommandType)action;
+    if (!parseChannelList(words[1], operation.mask)) {
+        return "No such channel";
+    }
+
+    bool haveTime = !operation.scheduled;
+    for (size_t i = 3; i < count; i++) { // Schedule entries only: the time words
+        char *end;
+        if (strncmp(words[i], "in=", 3) == 0 && !haveTime) {
+            operation.delaySeconds = strtoul(words[i] + 3, &end, 10);
+            haveTime = end != words[i] + 3 && *end == '\0';
+        } else if (strncmp(words[i], "at=", 3) == 0 && !haveTime) {
+            uint32_t secondOfDay;
+            haveTime = parseDateTime("1970-01-01", words[i] + 3, secondOfDay);
+            operation.delaySeconds = (secondOfDay + 86400 - wallTime.seconds() % 86400) % 86400; // Later today or tomorrow
+            operation.anchorEpoch = wallTime.seconds() + operation.delaySeconds;
+        } else if (strncmp(words[i], "every=", 6) == 0 && operation.every == 0) {
+            operation.every = strtoul(words[i] + 6, &end, 10);
+            if (end == words[i] + 6 || *end != '\0') {
+                return "Bad period";
+            }
+        } else {
+            return "Unexpected word";
+        }
+        if (!haveTime) {
+            return "Bad time";
+        }
+    }
+    if (!haveTime) {
+        return "Need in=<seconds> or at=HH:MM:SS";
+    }
+    if (operation.delaySeconds > maxScheduleSeconds || operation.every > maxScheduleSeconds ||
+        (operation.every > 0 && secondsToTicks(operation.every) == 0)) {
+        return "Time out of range";
+    }
+    return nullptr;
+}
+
+// Function to apply a list of operations in one request (POST, text/plain body, one operation per
+// line or separated by ';'):
+//   set <channels> on|off
+//   toggle <channels>
+//   schedule <channels> on|off|toggle in=<seconds>|at=HH:MM:SS [every=<seconds>]
+// where <channels> is <n>[,<n>...] or all. The whole list is validated first; nothing happens if
+// any operation is invalid (400, naming it) or the schedule has no room for it (503). The immediate
+// operations are folded in order into one command, so the relays change together in a single GPIO
+// write. Answers with the relay states the batch leaves once applied and the new schedule ids:
+// {"status":"success","relays":<mask>,"states":["On","Off",...],"scheduled":[<id>,...]}
+void handleBatch() {
+    // Parse and validate everything before touching the relays or the schedule
+    BatchOperation operations[BATCH_MAX_OPERATIONS];
+    size_t operationCount = 0;
+    size_t scheduledCount = 0;
+    RelayTransform change = {0, 0};
+    const char *body = server.body();
+    const char *bodyEnd = body + server.bodyLength();
+    if (memchr(body, '\0', server.bodyLength()) != nullptr) { // Lines are handled as C strings
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"Body contains a NUL byte\"}");
+        return;
+    }
+    while (body < bodyEnd) {
+        const char *lineEnd = body;
+        while (lineEnd < bodyEnd && *lineEnd != '\n' && *lineEnd != ';') {
+            lineEnd++;
+        }
+        char line[96];
+        size_t length = lineEnd - body;
+        while (length > 0 && isspace((unsigned char)body[length - 1])) {
+            length--; // Trailing '\r' and blanks
+        }
+        const char *error = nullptr;
+        if (length >= sizeof(line)) {
+            error = "Line too long";
+        } else {
+            memcpy(line, body, length);
+            line[length] = '\0';
+        }
+        body = lineEnd + 1;
+        if (error == nullptr && strspn(line, " \t") == length) {
+            continue; // Blank line
+        }
+        if (error == nullptr && operationCount == BATCH_MAX_OPERATIONS) {
+            error = "Too many operations";
+        }
+        if (error == nullptr) {
+            error = parseBatchOperation(line, operations[operationCount]);
+        }
+        if (error != nullptr) {
+            char response[192];
+            int responseLength = snprintf(response, sizeof(response),
+                                          "{\"status\":\"error\", \"message\":\"Operation %u: %s\"}",
+                                          (unsigned)(operationCount + 1), error);
+            server.send(400, "application/json", response, writtenLength(responseLength, sizeof(response)));
+            return;
+        }
+        const BatchOperation &operation = operations[operationCount++];
+        if (operation.scheduled) {
+            scheduledCount++;
+        } else {
+            change = composeTransforms(change, commandTransform({operation.action, operation.mask, 0}));
+        }
+    }
+    if (operationCount == 0) {
+        server.send(400, "application/json", "{\"status\":\"error\", \"message\":\"No operations\"}");
+        return;
+    }
+    if (schedules.size() + scheduledCount > schedules.capacity()) {
+        server.send(503, "application/json", "{\"status\":\"error\", \"message\":\"Schedule full\"}");
+        return;
+    }
+
+    // Apply: one relay command for all immediate operations, then the schedule entries (room checked above)
+    if ((change.clear | change.flip) != 0 && !queueCommand({CommandApply, change.clear, change.flip})) {
+        return;
+    }
+    char response[384];
+    char *out = response;
+    char *end = response + sizeof(response);
+    const uint16_t mask = relayTarget();
+    out += snprintf(out, end - out, "{\"status\":\"success\",\"relays\":%u,\"states\":[", mask);
+    for (size_t channel = 0; channel < relayChannels; channel++) {
+        out += snprintf(out, end - out, "%s\"%s\"", channel ? "," : "", (mask & (1u << channel)) ? "On" : "Off");
+    }
+    out += snprintf(out, end - out, "],\"scheduled\":[");
+    bool listed = false;
+    for (size_t i = 0; i < operationCount; i++) {
+        const BatchOperation &operation = operations[i];
+        if (operation.scheduled) {
+            uint32_t id = schedules.schedule(secondsToTicks(operation.delaySeconds),
+                                             {operation.action, operation.mask, secondsToTicks(operation.every),
+                                              operation.anchorEpoch, 0, false});
+            out += snprintf(out, end - out, "%s%lu", listed ? "," : "", (unsigned long)id);
+            listed = true;
+        }
+    }
+    out += snprintf(out, end - out, "]}");
+    LOG_INFO("Batch of %u operations applied", (unsigned)operationCount);
+    server.send(200, "application/json", response, out - response);
+}
+
+// Present power draw in milliwatts from the latest RMS window, with the same noise floor as the samples (control task)
+uint32_t powerMilliWatts() {
+    float amps = currentSampler.currentRms();
+    if (amps < 0.09) {
+        return 0;
+    }
+    return (uint32_t)lroundf(voltageSupply * amps * 1000);
+}
+
+// Function to take a history sample (control task) and queue it for the web server
 void updateHistoricalData() {
-    String date = storedDate; // Use stored date for the new entry
-    String time = storedTime; // Use stored time for the new entry
+    METRICS_TIME(updateHistoryTime);
 
-    // Read the current from the ACS712 current sensor
-    currentReading = current_Sensor.getCurrentAC(); // Get the current in AC
+    // Read the RMS current of the latest sampling window (O(1), no ADC access here)
+    currentReading = currentSampler.currentRms(); // Get the current in AC
 
     // Ignore very small currents (below a threshold to avoid noise)
     if (currentReading < 0.09) { // Adjust this threshold based on your needs
@@ -615,17 +1990,24 @@ void updateHistoricalData() {
     // Calculate power consumption in watts
     powerConsumption = voltageSupply * currentReading; // Power in Watts
 
-    // Enforce strict decimal precision for current and power
-    float roundedCurrent = floor(currentReading * 10000) / 10000.0; // Keep only 4 decimal places
-    float roundedPower = floor(powerConsumption * 100) / 100.0;     // Keep only 2 decimal places
+    // Enforce strict decimal precision for current and power as fixed-point integers
+    float tenthMilliAmps = floor(currentReading * 10000);  // Keep only 4 decimal places
+    float centiWatts = floor(powerConsumption * 100);      // Keep only 2 decimal places
+
+    // Build the fixed-size record in place; no heap allocation per sample
+    HistoryRecord record;
+    record.timestamp = wallTime.seconds();                                              // Current date/time for the new entry
+    record.currentTenthMilliAmps = tenthMilliAmps > 65535 ? 65535 : (uint16_t)tenthMilliAmps; // Clamp to the field range
+    record.powerCentiWatts = (uint32_t)centiWatts;                                      // Power in 0.01 W
+    record.relayMask = relays.mask();                                                     // Relay states as a bitmask
 
-    // Log formatted current and power values
-    Serial.print("Current (A): "); Serial.println(formatCurrent(currentReading)); // Log current
-    Serial.print(", Power (W): "); Serial.println(formatPower(powerConsumption)); // Log power
+    // Log current and power values (queued as integers, formatted later by loop())
+    LOG_INFO("Current (A): %.4f, Power (W): %.2f", record.currentTenthMilliAmps, record.powerCentiWatts);
 
-    // Update the historical data entry with the latest values
-    history[historyIndex] = {date, time, bulb1State ? "On" : "Off", bulb2State ? "On" : "Off", roundedCurrent, roundedPower}; 
-    historyIndex = (historyIndex + 1) % maxHistoryRows; // Update index and wrap around if at max size
+    // Hand the record to the web server core; never block the control task
+    if (!sampleQueue.push(record)) {
+        droppedSamples++;
+    }
 }
 
 // Function to control the LED indicators
@@ -0,0 +1,208 @@
+#pragma once
+
+// Compile-time configuration. Every value can be overridden with a -D build flag
+// (Arduino IDE: platform.local.txt, host: CMAKE_CXX_FLAGS).
+
+// Number of samples kept in the RAM history ring (12 bytes each).
+// 2880 samples at one sample every 5 s is 4 hours of history in 34.5 KB.
+#ifndef HISTORY_CAPACITY
+#define HISTORY_CAPACITY 2880
+#endif
+
+// Background current sampling: ADC conversions per second and RMS window length.
+// 100 ms spans whole mains cycles at both 50 Hz (5) and 60 Hz (6).
+#ifndef CURRENT_SAMPLE_RATE_HZ
+#define CURRENT_SAMPLE_RATE_HZ 2000
+#endif
+#ifndef CURRENT_WINDOW_MS
+#define CURRENT_WINDOW_MS 100
+#endif
+
+// Waveform capture (/captures): raw ADC readings around every relay change and current spike.
+// While idle the last CAPTURE_PRE_SAMPLES readings are kept at CURRENT_SAMPLE_RATE_HZ (128 ms at
+// 2 kHz). A trigger freezes them and switches the sampler to CAPTURE_SAMPLE_RATE_HZ (a multiple of
+// the base rate) for CAPTURE_POST_SAMPLES readings (200 ms at 8 kHz), then back. Each of the
+// CAPTURE_SLOTS slots takes 2 bytes per reading, 3.7 KB with these values.
+#ifndef CAPTURE_PRE_SAMPLES
+#define CAPTURE_PRE_SAMPLES 256 // Power of two
+#endif
+#ifndef CAPTURE_POST_SAMPLES
+#define CAPTURE_POST_SAMPLES 1600
+#endif
+#ifndef CAPTURE_SAMPLE_RATE_HZ
+#define CAPTURE_SAMPLE_RATE_HZ 8000
+#endif
+#ifndef CAPTURE_SLOTS
+#define CAPTURE_SLOTS 3 // One is always free for the sampler; loop() keeps the others for download
+#endif
+#ifndef CAPTURE_TRIGGER_AMPS
+#define CAPTURE_TRIGGER_AMPS 2.5 // Instantaneous (not RMS) current that starts a capture
+#endif
+
+// Overcurrent protection, checked on every base-rate reading in the sampler's timer. A trip opens all
+// relays from there, latches the red LED and refuses to close relays until /faults/reset.
+// Instantaneous: OVERCURRENT_INSTANT_READINGS consecutive readings beyond OVERCURRENT_INSTANT_AMPS
+// (peak), not checked for OVERCURRENT_INRUSH_MS after a relay closes (a cold filament draws ~10x).
+// I2t: heat builds as the integral of (i^2 - OVERCURRENT_PICKUP_AMPS^2) and trips beyond
+// OVERCURRENT_I2T_A2S, so 3 A RMS trips after 1 s and 5 A after 0.24 s.
+#ifndef OVERCURRENT_INSTANT_AMPS
+#define OVERCURRENT_INSTANT_AMPS 4.5
+#endif
+#ifndef OVERCURRENT_INSTANT_READINGS
+#define OVERCURRENT_INSTANT_READINGS 2
+#endif
+#ifndef OVERCURRENT_INRUSH_MS
+#define OVERCURRENT_INRUSH_MS 30
+#endif
+#ifndef OVERCURRENT_PICKUP_AMPS
+#define OVERCURRENT_PICKUP_AMPS 2.0
+#endif
+#ifndef OVERCURRENT_I2T_A2S
+#define OVERCURRENT_I2T_A2S 5.0
+#endif
+#ifndef FAULT_LOG_ENTRIES
+#define FAULT_LOG_ENTRIES 8 // Newest faults listed by /faults (RAM only)
+#endif
+
+// Control task (sensing, relays, schedule) pinned away from the web server. Core 0 also runs
+// the esp_timer task that samples the sensor; the Arduino loop() serving HTTP runs on core 1.
+#ifndef CONTROL_TASK_CORE
+#define CONTROL_TASK_CORE 0
+#endif
+#ifndef CONTROL_TASK_PERIOD_MS
+#define CONTROL_TASK_PERIOD_MS 10
+#endif
+#ifndef CONTROL_TASK_PRIORITY
+#define CONTROL_TASK_PRIORITY 2
+#endif
+
+// Tickless loop(): between its deadlines (schedule ticks, HTTP timeouts, event heartbeats) loop()
+// blocks on its sockets and on wakeups from the control task instead of spinning, and wakes at least
+// every LOOP_MAX_IDLE_MS regardless. While log lines wait for the UART it retries every LOOP_LOG_RETRY_MS.
+// LOOP_POWER_SAVE lets the CPU clock down (and light-sleep, where the build allows) while idle.
+#ifndef LOOP_MAX_IDLE_MS
+#define LOOP_MAX_IDLE_MS 1000
+#endif
+#ifndef LOOP_LOG_RETRY_MS
+#define LOOP_LOG_RETRY_MS 5
+#endif
+#ifndef LOOP_POWER_SAVE
+#define LOOP_POWER_SAVE 1
+#endif
+
+// Boot fast path: the relay states and the current sensor's zero reading are kept in NVS, so setup()
+// restores the relays (BOOT_RESTORE_RELAYS) and skips the calibration before starting Wi-Fi and the
+// server. The stored zero is re-checked once the relays have all been open for CALIBRATION_SETTLE_MS,
+// and replaced when it is off by more than CALIBRATION_TOLERANCE_COUNTS ADC counts.
+#ifndef BOOT_RESTORE_RELAYS
+#define BOOT_RESTORE_RELAYS 1
+#endif
+#ifndef CALIBRATION_SETTLE_MS
+#define CALIBRATION_SETTLE_MS 2000
+#endif
+#ifndef CALIBRATION_TOLERANCE_COUNTS
+#define CALIBRATION_TOLERANCE_COUNTS 6
+#endif
+
+// Event-driven HTTP server. Every connection owns a request and a response buffer, so
+// RAM is HTTP_MAX_CONNECTIONS * (request + response) bytes. lwIP's default limit of 10
+// sockets covers the listener, these connections and the event stream subscribers.
+#ifndef HTTP_SERVER_PORT
+#define HTTP_SERVER_PORT 80
+#endif
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 4
+#endif
+#ifndef HTTP_REQUEST_BUFFER_BYTES
+#define HTTP_REQUEST_BUFFER_BYTES 1024 // Request line, headers and body
+#endif
+#ifndef HTTP_RESPONSE_BUFFER_BYTES
+#define HTTP_RESPONSE_BUFFER_BYTES 1024 // Headers plus a small body, or one chunk of a streamed body
+#endif
+#ifndef HTTP_REQUEST_TIMEOUT_MS
+#define HTTP_REQUEST_TIMEOUT_MS 2000 // Whole request must arrive, and a response keep draining, within this
+#endif
+#ifndef HTTP_KEEPALIVE_TIMEOUT_MS
+#define HTTP_KEEPALIVE_TIMEOUT_MS 5000 // Idle time before a kept-alive connection is closed
+#endif
+#ifndef HTTP_MAX_ROUTES
+#define HTTP_MAX_ROUTES 24
+#endif
+#ifndef HTTP_MAX_ARGS
+#define HTTP_MAX_ARGS 8 // Query arguments kept per request
+#endif
+#ifndef HTTP_MAX_HEADERS
+#define HTTP_MAX_HEADERS 4 // Headers registered with collectHeaders()
+#endif
+#ifndef HTTP_EXTRA_HEADER_BYTES
+#define HTTP_EXTRA_HEADER_BYTES 256 // Room for sendHeader() lines in one response
+#endif
+
+// Server-Sent Events push channel (GET /events). Each subscriber owns a fixed send buffer;
+// one that falls a whole buffer behind is disconnected rather than allowed to grow.
+#ifndef EVENT_MAX_SUBSCRIBERS
+#define EVENT_MAX_SUBSCRIBERS 4
+#endif
+#ifndef EVENT_BUFFER_BYTES
+#define EVENT_BUFFER_BYTES 1024
+#endif
+
+// Relay schedules kept in a hashed timing wheel: entry pool, wheel slots and tick length.
+// 256 slots of 100 ms turn once every 25.6 s; entries further out wait in their slot.
+#ifndef SCHEDULE_CAPACITY
+#define SCHEDULE_CAPACITY 256
+#endif
+#ifndef SCHEDULE_WHEEL_SLOTS
+#define SCHEDULE_WHEEL_SLOTS 256
+#endif
+#ifndef SCHEDULE_TICK_MS
+#define SCHEDULE_TICK_MS 100
+#endif
+
+// Most operations in one POST /batch (validated together, applied as one relay write)
+#ifndef BATCH_MAX_OPERATIONS
+#define BATCH_MAX_OPERATIONS 16
+#endif
+
+// Persistent history log: samples appended to rotating 4 KB segments of a raw flash partition
+// (partitions.csv) and recovered at boot. The default partition holds 496 segments of 255 samples,
+// about a week at one sample every 5 s; each sector is erased once per pass around the partition.
+#ifndef HISTORY_LOG_PARTITION
+#define HISTORY_LOG_PARTITION "history"
+#endif
+#ifndef HISTORY_LOG_BYTES
+#define HISTORY_LOG_BYTES 0x1F0000 // Size of the host's flash file; on the ESP32 the partition decides
+#endif
+
+// History rollups: count/min/max/mean of current and power per minute, hour and day, each tier
+// a ring of 40-byte buckets. Defaults keep 6 hours of minutes, a week of hours and 90 days.
+#ifndef ROLLUP_MINUTE_BUCKETS
+#define ROLLUP_MINUTE_BUCKETS 360
+#endif
+#ifndef ROLLUP_HOUR_BUCKETS
+#define ROLLUP_HOUR_BUCKETS 168
+#endif
+#ifndef ROLLUP_DAY_BUCKETS
+#define ROLLUP_DAY_BUCKETS 90
+#endif
+
+// Hot-path instrumentation served at /metrics (Prometheus text format): cycle-counter timers feeding
+// log2 latency histograms, per-route request counters, heap watermarks and drop counters.
+// 0 compiles every probe out and drops the route.
+#ifndef METRICS_ENABLED
+#define METRICS_ENABLED 1
+#endif
+
+// Serial log: records are queued in a RAM ring and written out by loop() as the UART drains.
+// Levels below LOG_LEVEL are compiled out; a full ring drops (and counts) new records.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RING_RECORDS
+#define LOG_RING_RECORDS 64 // Power of two; 32 bytes each on the ESP32
+#endif
@@ -0,0 +1,66 @@
+#include "CurrentSampler.h"
+
+#include <math.h>
+
+#include "OvercurrentTrip.h"
+#include "WaveformCapture.h"
+#include "hal/hal.h"
+
+CurrentSampler::CurrentSampler(uint8_t adcPin, uint32_t sampleRateHz, uint32_t windowMillis)
+    : pin(adcPin), rateHz(sampleRateHz), samplesPerWindow(sampleRateHz * windowMillis / 1000) {
+    if (samplesPerWindow == 0) {
+        samplesPerWindow = 1;
+    }
+}
+
+bool CurrentSampler::begin(int zeroCounts, float countsPerAmp) {
+    zero.store(zeroCounts, std::memory_order_relaxed);
+    ampsPerCount = 1.0f / countsPerAmp;
+    return hal::startPeriodicTimer(1000000 / rateHz, onTimer, this);
+}
+
+void CurrentSampler::attachCapture(WaveformCapture *waveformCapture, uint32_t burstRateHz) {
+    capture = waveformCapture;
+    burstFactor = burstRateHz > rateHz ? burstRateHz / rateHz : 1;
+}
+
+float CurrentSampler::currentRms() const {
+    return sqrtf((float)meanSquare.load(std::memory_order_relaxed)) * ampsPerCount;
+}
+
+void CurrentSampler::addSample(uint16_t raw) {
+    int32_t centered = (int32_t)raw - zero.load(std::memory_order_relaxed);
+    sumSquares += (uint32_t)(centered * centered);
+    sumReadings += raw;
+    if (++samplesInWindow == samplesPerWindow) {
+        meanSquare.store((uint32_t)(sumSquares / samplesInWindow), std::memory_order_relaxed);
+        meanRaw.store((uint32_t)((uint64_t)sumReadings * 16 / samplesInWindow), std::memory_order_relaxed);
+        windows.fetch_add(1, std::memory_order_relaxed);
+        sumSquares = 0;
+        sumReadings = 0;
+        samplesInWindow = 0;
+    }
+}
+
+void CurrentSampler::onTimer(void *arg) {
+    CurrentSampler *sampler = static_cast<CurrentSampler *>(arg);
+    const uint16_t raw = hal::readAdc(sampler->pin);
+    WaveformCapture *capture = sampler->capture;
+    if (capture != nullptr) {
+        capture->add(raw);
+    }
+    if (!sampler->bursting || ++sampler->burstPhase == sampler->burstFactor) {
+        sampler->burstPhase = 0;
+        sampler->addSample(raw); // Base-rate readings only
+        if (sampler->trip != nullptr) {
+            sampler->trip->add(raw);
+        }
+    }
+
+    // Burst while the capture records, base rate otherwise
+    if (capture != nullptr && capture->recording() != sampler->bursting) {
+        sampler->bursting = !sampler->bursting;
+        sampler->burstPhase = 0;
+        hal::setTimerPeriod(onTimer, sampler, 1000000 / (sampler->bursting ? sampler->burstRate() : sampler->rateHz));
+    }
+}
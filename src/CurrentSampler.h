@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+class OvercurrentTrip;
+class WaveformCapture;
+
+// Background RMS current measurement.
+// A periodic hal timer reads the ACS712 ADC at a fixed rate and adds each offset-corrected
+// sample to a running sum of squares. At the end of every window the mean square is
+// published atomically, so reading the current is O(1) and never waits for the ADC.
+// With a WaveformCapture attached, every reading also goes to the capture, and the timer runs at the
+// burst rate while it records; the RMS windows then take every n-th reading, so they see the base rate.
+class CurrentSampler {
+public:
+    // sampleRateHz: ADC conversions per second; windowMillis: RMS window length. A window
+    // that spans whole mains cycles (100 ms = 5 x 50 Hz = 6 x 60 Hz) avoids ripple in the result.
+    CurrentSampler(uint8_t adcPin, uint32_t sampleRateHz, uint32_t windowMillis);
+
+    // Start sampling around the zero-current ADC reading; countsPerAmp converts counts to amps
+    bool begin(int zeroCounts, float countsPerAmp);
+
+    // Feed capture as well, sampling at burstRateHz (a multiple of the base rate) while it records.
+    // Call before begin().
+    void attachCapture(WaveformCapture *capture, uint32_t burstRateHz);
+
+    // Check every base-rate reading against trip's limits. Call before begin().
+    void attachTrip(OvercurrentTrip *overcurrentTrip) { trip = overcurrentTrip; }
+
+    // Move the zero-current reading while sampling (any task); the next reading uses it
+    void setZero(int zeroCounts) { zero.store(zeroCounts, std::memory_order_relaxed); }
+
+    float currentRms() const;                             // RMS current of the latest complete window in amps
+    float meanReading() const { return meanRaw.load(std::memory_order_relaxed) / 16.0f; } // Raw mean of the latest window: the zero reading while no current flows
+    uint32_t windowCount() const { return windows.load(std::memory_order_relaxed); } // Completed windows since begin()
+    uint32_t sampleRate() const { return rateHz; }
+    uint32_t burstRate() const { return rateHz * burstFactor; }
+    uint32_t windowSamples() const { return samplesPerWindow; }
+
+    void addSample(uint16_t raw); // Accumulate one ADC reading (timer context; public so it can be driven directly)
+
+private:
+    static void onTimer(void *arg);
+
+    uint8_t pin;
+    uint32_t rateHz;
+    uint32_t samplesPerWindow;
+    std::atomic<int> zero{2048};
+    float ampsPerCount = 0.0f;
+
+    WaveformCapture *capture = nullptr;
+    OvercurrentTrip *trip = nullptr;
+    uint32_t burstFactor = 1; // Burst readings per base-rate reading
+
+    // Accumulator and rate, touched only from the timer context
+    bool bursting = false;
+    uint32_t burstPhase = 0; // Burst readings since the last one the RMS window took
+    uint64_t sumSquares = 0;
+    uint32_t sumReadings = 0;
+    uint32_t samplesInWindow = 0;
+
+    // Published results
+    std::atomic<uint32_t> meanSquare{0}; // Mean of (raw - zero)^2 over the last window, in counts^2
+    std::atomic<uint32_t> meanRaw{0};    // Mean raw reading over the last window, in 1/16 counts
+    std::atomic<uint32_t> windows{0};
+};
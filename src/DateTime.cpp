@@ -0,0 +1,95 @@
+#include "DateTime.h"
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's days_from_civil)
+static int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t yearOfEra = static_cast<uint32_t>(year - era * 400);
+    const uint32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int32_t>(dayOfEra) - 719468;
+}
+
+// Inverse of daysFromCivil
+static void civilFromDays(int32_t days, int32_t &year, uint32_t &month, uint32_t &day) {
+    days += 719468;
+    const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const uint32_t dayOfEra = static_cast<uint32_t>(days - era * 146097);
+    const uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int32_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// Parse an unsigned decimal field and the separator that follows it
+static bool parseField(const char *&text, uint32_t &value, char separator) {
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    value = 0;
+    while (*text >= '0' && *text <= '9') {
+        value = value * 10 + static_cast<uint32_t>(*text++ - '0');
+        if (value > 100000) {
+            return false;
+        }
+    }
+    if (*text != separator) {
+        return false;
+    }
+    if (separator != '\0') {
+        text++;
+    }
+    return true;
+}
+
+bool parseDateTime(const char *date, const char *time, uint32_t &epoch) {
+    uint32_t year, month, day, hour, minute, second;
+    if (!parseField(date, year, '-') || !parseField(date, month, '-') || !parseField(date, day, '\0') ||
+        !parseField(time, hour, ':') || !parseField(time, minute, ':') || !parseField(time, second, '\0')) {
+        return false;
+    }
+    if (year < 1970 || year > 2105 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+    const int64_t seconds = static_cast<int64_t>(daysFromCivil(static_cast<int32_t>(year), month, day)) * 86400 +
+                            hour * 3600 + minute * 60 + second;
+    if (seconds < 0 || seconds > UINT32_MAX) {
+        return false;
+    }
+    epoch = static_cast<uint32_t>(seconds);
+    return true;
+}
+
+// Write a zero-padded decimal field of the given width
+static char *writeDigits(char *out, uint32_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+void formatDate(uint32_t epoch, char *out) {
+    int32_t year;
+    uint32_t month, day;
+    civilFromDays(static_cast<int32_t>(epoch / 86400), year, month, day);
+    out = writeDigits(out, static_cast<uint32_t>(year), 4);
+    *out++ = '-';
+    out = writeDigits(out, month, 2);
+    *out++ = '-';
+    out = writeDigits(out, day, 2);
+    *out = '\0';
+}
+
+void formatTime(uint32_t epoch, char *out) {
+    const uint32_t secondOfDay = epoch % 86400;
+    out = writeDigits(out, secondOfDay / 3600, 2);
+    *out++ = ':';
+    out = writeDigits(out, secondOfDay / 60 % 60, 2);
+    *out++ = ':';
+    out = writeDigits(out, secondOfDay % 60, 2);
+    *out = '\0';
+}
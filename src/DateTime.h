@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+// Conversions between "YYYY-MM-DD" / "HH:MM:SS" strings and seconds since 1970-01-01.
+// Timestamps carry no time zone: they are whatever local time the browser reported.
+
+// Parse a date and a time into epoch seconds; returns false if either is malformed
+bool parseDateTime(const char *date, const char *time, uint32_t &epoch);
+
+// Write "YYYY-MM-DD" (11 bytes including the terminator) for an epoch timestamp
+void formatDate(uint32_t epoch, char *out);
+
+// Write "HH:MM:SS" (9 bytes including the terminator) for an epoch timestamp
+void formatTime(uint32_t epoch, char *out);
@@ -0,0 +1,34 @@
+#include "EnergyMeter.h"
+
+void EnergyMeter::accumulate(uint32_t milliWatts, uint32_t elapsedMicros, uint16_t relayMask) {
+    // mW x us = nJ; 4.29 MW for 71 minutes still fits in 64 bits
+    uint64_t nanoJoules = (uint64_t)milliWatts * elapsedMicros;
+    if (relayMask == 0) {
+        nanoJoules += unattributedNanoJoules;
+        unattributed += nanoJoules / 1000;
+        unattributedNanoJoules = nanoJoules % 1000;
+        return;
+    }
+
+    const uint32_t closed = __builtin_popcount(relayMask);
+    nanoJoules += splitRemainder;
+    const uint64_t share = nanoJoules / closed;
+    splitRemainder = nanoJoules % closed;
+    for (size_t index = 0; index < maxChannels; index++) {
+        if (relayMask & (1u << index)) {
+            Channel &channel = channels[index];
+            const uint64_t total = share + channel.pendingNanoJoules;
+            channel.totalMicroJoules += total / 1000;
+            channel.tripMicroJoules += total / 1000;
+            channel.pendingNanoJoules = total % 1000;
+        }
+    }
+}
+
+void EnergyMeter::reset(uint16_t channelMask) {
+    for (size_t index = 0; index < maxChannels; index++) {
+        if (channelMask & (1u << index)) {
+            channels[index].tripMicroJoules = 0;
+        }
+    }
+}
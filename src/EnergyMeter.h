@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-channel energy counters in integer micro-joules.
+// accumulate() integrates power over the real time since the previous call and splits it evenly
+// between the relays that were closed (one current sensor cannot tell the loads apart); energy
+// seen with every relay open is counted as unattributed. All arithmetic is 64-bit integer with
+// the sub-micro-joule remainders carried forward, so nothing is lost to rounding however long the
+// meter runs and every call costs the same. A 64-bit micro-joule counter overflows after
+// 5 million kWh.
+class EnergyMeter {
+public:
+    static const size_t maxChannels = 16;
+    static const uint64_t microJoulesPerKWh = 3600000000000ULL;
+
+    struct Channel {
+        uint64_t totalMicroJoules;  // Since boot
+        uint64_t tripMicroJoules;   // Since the last reset()
+        uint32_t pendingNanoJoules; // Remainder below one micro-joule, < 1000
+    };
+
+    // Add milliWatts held for elapsedMicros, with bit n of relayMask set while channel n was closed
+    void accumulate(uint32_t milliWatts, uint32_t elapsedMicros, uint16_t relayMask);
+
+    // Zero the resettable (trip) counters of the channels in channelMask
+    void reset(uint16_t channelMask);
+
+    const Channel &channel(size_t index) const { return channels[index]; }
+    uint64_t unattributedMicroJoules() const { return unattributed; }
+
+private:
+    Channel channels[maxChannels] = {};
+    uint64_t unattributed = 0;
+    uint32_t unattributedNanoJoules = 0;
+    uint32_t splitRemainder = 0; // Nano-joules left over from dividing between channels, < maxChannels
+};
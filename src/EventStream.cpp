@@ -0,0 +1,144 @@
+#include "EventStream.h"
+
+#include <string.h>
+
+#include "hal/net.h"
+
+static const uint32_t heartbeatMillis = 15000; // Comment line that detects dead peers
+
+static const char streamHeaders[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "retry: 2000\n\n";
+static const char busyResponse[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+bool EventStream::adopt(int fd, uint32_t nowMillis) {
+    for (Subscriber &subscriber : subscribers) {
+        if (!subscriber.active) {
+            subscriber.active = true;
+            subscriber.fd = fd;
+            subscriber.since = nowMillis;
+            subscriber.head = 0;
+            subscriber.length = 0;
+            enqueue(subscriber, streamHeaders, sizeof(streamHeaders) - 1);
+            flush(subscriber, nowMillis);
+            return true;
+        }
+    }
+    hal::sendSome(fd, busyResponse, sizeof(busyResponse) - 1);
+    hal::closeSocket(fd);
+    return false;
+}
+
+size_t EventStream::subscriberCount() const {
+    size_t count = 0;
+    for (const Subscriber &subscriber : subscribers) {
+        if (subscriber.active) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void EventStream::poll(uint32_t nowMillis) {
+    for (Subscriber &subscriber : subscribers) {
+        if (!subscriber.active) {
+            continue;
+        }
+        if (subscriber.length == 0 && nowMillis - subscriber.since >= heartbeatMillis) {
+            enqueue(subscriber, ":\n\n", 3);
+        }
+        flush(subscriber, nowMillis);
+    }
+}
+
+uint32_t EventStream::waitSet(hal::WaitSocket *sockets, size_t &count, size_t capacity, uint32_t nowMillis) const {
+    uint32_t wait = UINT32_MAX;
+    for (const Subscriber &subscriber : subscribers) {
+        if (!subscriber.active) {
+            continue;
+        }
+        if (subscriber.length > 0) {
+            if (count < capacity) {
+                sockets[count++] = {subscriber.fd, true};
+            }
+            continue;
+        }
+        const uint32_t elapsed = nowMillis - subscriber.since;
+        const uint32_t left = elapsed < heartbeatMillis ? heartbeatMillis - elapsed : 0;
+        wait = left < wait ? left : wait;
+    }
+    return wait;
+}
+
+void EventStream::publish(const char *event, const char *data, size_t length) {
+    char header[32];
+    size_t headerLength = strlen(event);
+    if (headerLength > sizeof(header) - 16) {
+        return;
+    }
+    memcpy(header, "event: ", 7);
+    memcpy(header + 7, event, headerLength);
+    memcpy(header + 7 + headerLength, "\ndata: ", 7);
+    headerLength += 14;
+
+    for (Subscriber &subscriber : subscribers) {
+        if (!subscriber.active) {
+            continue;
+        }
+        // All or nothing: a partially queued event would corrupt the stream
+        if (EVENT_BUFFER_BYTES - subscriber.length < headerLength + length + 2) {
+            dropped++;
+            closeSubscriber(subscriber);
+            continue;
+        }
+        enqueue(subscriber, header, headerLength);
+        enqueue(subscriber, data, length);
+        enqueue(subscriber, "\n\n", 2);
+    }
+}
+
+// Copy into the subscriber's ring; the caller has checked there is room
+bool EventStream::enqueue(Subscriber &subscriber, const char *data, size_t length) {
+    if (EVENT_BUFFER_BYTES - subscriber.length < length) {
+        return false;
+    }
+    size_t tail = (subscriber.head + subscriber.length) % EVENT_BUFFER_BYTES;
+    size_t first = EVENT_BUFFER_BYTES - tail < length ? EVENT_BUFFER_BYTES - tail : length;
+    memcpy(subscriber.buffer + tail, data, first);
+    memcpy(subscriber.buffer, data + first, length - first);
+    subscriber.length += length;
+    return true;
+}
+
+// Send as much as the socket takes right now, never blocking
+void EventStream::flush(Subscriber &subscriber, uint32_t nowMillis) {
+    while (subscriber.length > 0) {
+        size_t contiguous = EVENT_BUFFER_BYTES - subscriber.head;
+        if (contiguous > subscriber.length) {
+            contiguous = subscriber.length;
+        }
+        long sent = hal::sendSome(subscriber.fd, subscriber.buffer + subscriber.head, contiguous);
+        if (sent < 0) {
+            closeSubscriber(subscriber); // Peer went away
+            return;
+        }
+        if (sent == 0) {
+            return;
+        }
+        subscriber.head = (subscriber.head + sent) % EVENT_BUFFER_BYTES;
+        subscriber.length -= sent;
+        subscriber.since = nowMillis;
+    }
+    subscriber.head = 0;
+}
+
+void EventStream::closeSubscriber(Subscriber &subscriber) {
+    hal::closeSocket(subscriber.fd);
+    subscriber.active = false;
+    subscriber.fd = -1;
+    subscriber.length = 0;
+}
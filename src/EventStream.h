@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Config.h"
+#include "hal/net.h"
+
+// Server-Sent Events push channel.
+// The HTTP server hands over the socket of each GET /events request (adopt()); from then on
+// every published event is copied into each subscriber's fixed send buffer and flushed from
+// poll() as far as the socket accepts without blocking. A subscriber whose buffer cannot take
+// the next event is a slow consumer and is disconnected; browsers reconnect and catch up
+// through /historicalData?since=.
+class EventStream {
+public:
+    // Take ownership of a connected socket and send the stream headers; closes it if every slot is busy
+    bool adopt(int fd, uint32_t nowMillis);
+
+    // Flush buffers, send heartbeats and drop dead clients (loop() only)
+    void poll(uint32_t nowMillis);
+
+    // Like HttpServer::waitSet(): subscribers with unsent bytes wait for room to send; returns the
+    // milliseconds until the next heartbeat is due
+    uint32_t waitSet(hal::WaitSocket *sockets, size_t &count, size_t capacity, uint32_t nowMillis) const;
+
+    // Queue "event: <event>\ndata: <data>\n\n" for every subscriber (loop() only)
+    void publish(const char *event, const char *data, size_t length);
+
+    size_t subscriberCount() const;
+    uint32_t droppedSubscribers() const { return dropped; } // Disconnected for falling behind
+
+private:
+    struct Subscriber {
+        bool active;
+        int fd;
+        uint32_t since;             // Last write, in ms
+        size_t head;                // Oldest unsent byte in buffer
+        size_t length;              // Unsent bytes in buffer
+        char buffer[EVENT_BUFFER_BYTES];
+    };
+
+    bool enqueue(Subscriber &subscriber, const char *data, size_t length);
+    void flush(Subscriber &subscriber, uint32_t nowMillis);
+    void closeSubscriber(Subscriber &subscriber);
+
+    uint32_t dropped = 0;
+    Subscriber subscribers[EVENT_MAX_SUBSCRIBERS] = {};
+};
@@ -0,0 +1,32 @@
+#include "Format.h"
+
+size_t formatUnsigned(char *out, uint32_t value) {
+    char digits[10];
+    size_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+size_t formatFixed(char *out, uint32_t value, uint8_t decimals) {
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+    size_t length = formatUnsigned(out, value / scale);
+    if (decimals == 0) {
+        return length;
+    }
+    out[length++] = '.';
+    uint32_t fraction = value % scale;
+    for (int i = decimals - 1; i >= 0; i--) {
+        out[length + i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return length + decimals;
+}
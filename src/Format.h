@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Allocation-free number formatting into caller-provided buffers.
+// Functions return the number of characters written and do not add a terminator.
+
+// Decimal digits of an unsigned value (at most 10 characters)
+size_t formatUnsigned(char *out, uint32_t value);
+
+// Unsigned fixed-point value with the given number of decimals, e.g. (5399, 4) -> "0.5399"
+size_t formatFixed(char *out, uint32_t value, uint8_t decimals);
@@ -0,0 +1,133 @@
+#include "HistoryBinary.h"
+
+#include <string.h>
+
+static_assert(historyBinHeaderBytes >= 24, "The header holds at least the version 1 fields");
+
+static void put16(uint8_t *out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void put32(uint8_t *out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value));
+    put16(out + 2, static_cast<uint16_t>(value >> 16));
+}
+
+void HistoryBinaryEncoder::begin(RecordReader reader, void *context, HistoryBinEncoding encoding, uint32_t firstSequence,
+                                 uint32_t lastSequence, uint32_t newestSequence, uint32_t from, uint32_t to) {
+    recordReader = reader;
+    readerContext = context;
+    rowEncoding = encoding;
+    nextSequence = firstSequence;
+    endSequence = lastSequence;
+    headerSequence = newestSequence;
+    fromTimestamp = from;
+    toTimestamp = to;
+    headerSent = false;
+    finished = firstSequence == 0 || firstSequence > lastSequence;
+    havePrevious = false;
+    scratchLength = 0;
+    scratchOffset = 0;
+}
+
+size_t HistoryBinaryEncoder::read(char *buffer, size_t capacity) {
+    uint8_t *out = reinterpret_cast<uint8_t *>(buffer);
+    size_t written = 0;
+    while (written < capacity) {
+        if (scratchOffset < scratchLength) {
+            size_t count = scratchLength - scratchOffset;
+            if (count > capacity - written) {
+                count = capacity - written;
+            }
+            memcpy(out + written, scratch + scratchOffset, count);
+            scratchOffset += count;
+            written += count;
+            continue;
+        }
+        if (!headerSent) {
+            scratchLength = encodeHeader(scratch);
+            scratchOffset = 0;
+            headerSent = true;
+            continue;
+        }
+        if (finished) {
+            break;
+        }
+        // Rows go straight into the caller's buffer while a whole one fits, through scratch otherwise
+        if (capacity - written >= historyBinMaxRowBytes) {
+            written += encodeNextRow(out + written);
+        } else {
+            scratchLength = encodeNextRow(scratch);
+            scratchOffset = 0;
+        }
+    }
+    return written;
+}
+
+size_t HistoryBinaryEncoder::encodeHeader(uint8_t *out) const {
+    memcpy(out, "BHST", 4);
+    out[4] = historyBinVersion;
+    out[5] = historyBinHeaderBytes;
+    out[6] = rowEncoding;
+    out[7] = rowEncoding == HistoryBinDelta ? historyBinDeltaRowBytes : historyBinRawRowBytes;
+    out[8] = 4; // HistoryRecord::currentTenthMilliAmps
+    out[9] = 2; // HistoryRecord::powerCentiWatts
+    put16(out + 10, 0);
+    put32(out + 12, headerSequence);
+    put32(out + 16, fromTimestamp);
+    put32(out + 20, toTimestamp);
+    return historyBinHeaderBytes;
+}
+
+size_t HistoryBinaryEncoder::encodeNextRow(uint8_t *out) {
+    HistoryRecord record;
+    uint32_t sequence;
+    for (;;) {
+        if (nextSequence > endSequence || nextSequence == 0) {
+            finished = true;
+            return 0;
+        }
+        sequence = nextSequence++;
+        if (recordReader(readerContext, sequence, record) && record.timestamp >= fromTimestamp) {
+            break;
+        }
+    }
+    if (record.timestamp > toTimestamp) {
+        finished = true; // Rows are in time order: nothing later is in range
+        return 0;
+    }
+
+    if (rowEncoding == HistoryBinRaw) {
+        put32(out, sequence);
+        put32(out + 4, record.timestamp);
+        put32(out + 8, record.powerCentiWatts);
+        put16(out + 12, record.currentTenthMilliAmps);
+        put16(out + 14, record.relayMask);
+        return historyBinRawRowBytes;
+    }
+
+    const int64_t timeDelta = static_cast<int64_t>(record.timestamp) - previous.timestamp;
+    const int32_t currentDelta = static_cast<int32_t>(record.currentTenthMilliAmps) - previous.currentTenthMilliAmps;
+    const uint32_t sequenceDelta = sequence - previousSequence;
+    const bool key = !havePrevious || sequenceDelta > 255 || timeDelta < INT16_MIN || timeDelta > INT16_MAX ||
+                     currentDelta < INT16_MIN || currentDelta > INT16_MAX;
+    put32(out, record.powerCentiWatts);
+    put16(out + 4, key ? 0 : static_cast<uint16_t>(static_cast<int16_t>(timeDelta)));
+    put16(out + 6, key ? 0 : static_cast<uint16_t>(static_cast<int16_t>(currentDelta)));
+    put16(out + 8, record.relayMask);
+    out[10] = key ? 0 : static_cast<uint8_t>(sequenceDelta);
+    out[11] = 0;
+    size_t length = historyBinDeltaRowBytes;
+    if (key) {
+        put32(out + 12, sequence);
+        put32(out + 16, record.timestamp);
+        put16(out + 20, record.currentTenthMilliAmps);
+        put16(out + 22, 0);
+        length += historyBinDeltaRowBytes;
+    }
+    havePrevious = true;
+    previousSequence = sequence;
+    previous = record;
+    return length;
+}
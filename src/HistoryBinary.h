@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "HistoryRing.h"
+
+// Binary history export (/historicalData.bin), version 1. All integers are little-endian.
+//
+// Header, historyBinHeaderBytes long (decoders skip any bytes past the fields they know):
+//    0  char[4] magic "BHST"
+//    4  u8      version (1)
+//    5  u8      header length in bytes
+//    6  u8      encoding: 0 raw, 1 delta
+//    7  u8      row width in bytes (16 raw, 12 delta)
+//    8  u8      current decimals (4: the current field counts 0.0001 A)
+//    9  u8      power decimals (2: the power field counts 0.01 W)
+//   10  u16     reserved, 0
+//   12  u32     newest sequence number held when the response started
+//   16  u32     from: oldest timestamp requested (epoch seconds, local time)
+//   20  u32     to: newest timestamp requested
+//
+// Rows follow, oldest first, until the end of the body. Sequence numbers increase but may skip rows
+// lost to a power cut.
+// Raw row (16 bytes):
+//    0 u32 sequence, 4 u32 timestamp, 8 u32 power, 12 u16 current, 14 u16 relay mask (bit n = relay n)
+// Delta row (12 bytes), relative to the row before it:
+//    0 u32 power, 4 i16 timestamp delta, 6 i16 current delta, 8 u16 relay mask,
+//   10 u8 sequence delta, 11 u8 reserved (0)
+// A delta row with sequence delta 0 is a key row: its timestamp and current deltas are 0 and it is
+// followed by 12 more bytes holding u32 sequence, u32 timestamp, u16 current and u16 reserved.
+// The first row is always a key row, as is any row whose deltas do not fit.
+
+const uint8_t historyBinVersion = 1;
+const size_t historyBinHeaderBytes = 24;
+const size_t historyBinRawRowBytes = 16;
+const size_t historyBinDeltaRowBytes = 12;
+const size_t historyBinMaxRowBytes = 2 * historyBinDeltaRowBytes; // A key row
+
+enum HistoryBinEncoding : uint8_t {
+    HistoryBinRaw = 0,
+    HistoryBinDelta = 1
+};
+
+// Resumable encoder: produces the header and then one row per readable record, into whatever buffer
+// the caller hands it, so a response of any length streams with constant memory.
+class HistoryBinaryEncoder {
+public:
+    // Fetch the record with this sequence number; return false if it cannot be read (it is skipped)
+    typedef bool (*RecordReader)(void *context, uint32_t sequence, HistoryRecord &record);
+
+    // Emit records firstSequence..lastSequence in order, leaving out any stamped before from and
+    // stopping at the first one stamped after to.
+    // newestSequence, from and to are reported in the header.
+    void begin(RecordReader reader, void *context, HistoryBinEncoding encoding, uint32_t firstSequence,
+               uint32_t lastSequence, uint32_t newestSequence, uint32_t from, uint32_t to);
+
+    // Copy the next bytes of the body into buffer; returns 0 once it is complete
+    size_t read(char *buffer, size_t capacity);
+
+private:
+    size_t encodeHeader(uint8_t *out) const;
+    size_t encodeNextRow(uint8_t *out); // 0 at the end of the range
+
+    RecordReader recordReader = nullptr;
+    void *readerContext = nullptr;
+    HistoryBinEncoding rowEncoding = HistoryBinRaw;
+    uint32_t nextSequence = 0;
+    uint32_t endSequence = 0;
+    uint32_t headerSequence = 0;
+    uint32_t fromTimestamp = 0;
+    uint32_t toTimestamp = 0;
+    bool headerSent = true;
+    bool finished = true;
+
+    // Previous row, for delta encoding
+    bool havePrevious = false;
+    uint32_t previousSequence = 0;
+    HistoryRecord previous = {};
+
+    uint8_t scratch[historyBinHeaderBytes > historyBinMaxRowBytes ? historyBinHeaderBytes : historyBinMaxRowBytes];
+    size_t scratchLength = 0;
+    size_t scratchOffset = 0;
+};
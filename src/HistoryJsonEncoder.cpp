@@ -0,0 +1,103 @@
+#include "HistoryJsonEncoder.h"
+
+#include <string.h>
+
+#include "DateTime.h"
+#include "Format.h"
+
+static const char documentSuffix[] = "]}";
+
+// Append a string literal without its terminator
+template <size_t N>
+static size_t appendLiteral(char *out, const char (&text)[N]) {
+    memcpy(out, text, N - 1);
+    return N - 1;
+}
+
+void HistoryJsonEncoder::begin(RowReader reader, void *context, size_t rowCount, uint32_t lastSequence) {
+    rowReader = reader;
+    readerContext = context;
+    rowsTotal = rowCount;
+    nextRow = 0;
+    documentSequence = lastSequence;
+    stage = Prefix;
+    scratchLength = 0;
+    scratchOffset = 0;
+}
+
+size_t HistoryJsonEncoder::read(char *buffer, size_t capacity) {
+    size_t written = 0;
+    while (written < capacity) {
+        if (scratchOffset == scratchLength) {
+            if (stage == Done) {
+                break;
+            }
+            loadNext();
+            continue;
+        }
+        size_t count = scratchLength - scratchOffset;
+        if (count > capacity - written) {
+            count = capacity - written;
+        }
+        memcpy(buffer + written, scratch + scratchOffset, count);
+        scratchOffset += count;
+        written += count;
+    }
+    return written;
+}
+
+void HistoryJsonEncoder::loadNext() {
+    scratchOffset = 0;
+    scratchLength = 0;
+    switch (stage) {
+        case Prefix:
+            scratchLength = appendLiteral(scratch, "{\"lastSeq\":");
+            scratchLength += formatUnsigned(scratch + scratchLength, documentSequence);
+            scratchLength += appendLiteral(scratch + scratchLength, ",\"data\":[");
+            stage = Rows;
+            break;
+        case Rows: {
+            HistoryRecord record;
+            uint32_t sequence;
+            if (nextRow < rowsTotal && rowReader(readerContext, nextRow, record, sequence)) {
+                if (nextRow > 0) {
+                    scratch[scratchLength++] = ',';
+                }
+                scratchLength += encodeHistoryRow(scratch + scratchLength, record, sequence);
+                nextRow++;
+            } else {
+                stage = Suffix;
+            }
+            break;
+        }
+        case Suffix:
+            scratchLength = appendLiteral(scratch, documentSuffix);
+            stage = Done;
+            break;
+        case Done:
+            break;
+    }
+}
+
+// Same row shape the page has always consumed; numbers stay strings with fixed decimals
+size_t encodeHistoryRow(char *buffer, const HistoryRecord &record, uint32_t sequence) {
+    char *out = buffer;
+    out += appendLiteral(out, "{\"seq\":");
+    out += formatUnsigned(out, sequence);
+    out += appendLiteral(out, ",\"date\":\"");
+    formatDate(record.timestamp, out);
+    out += 10;
+    out += appendLiteral(out, "\",\"time\":\"");
+    formatTime(record.timestamp, out);
+    out += 8;
+    out += appendLiteral(out, "\",\"bulb1State\":\"");
+    out += (record.relayMask & 0x1) ? appendLiteral(out, "On") : appendLiteral(out, "Off");
+    out += appendLiteral(out, "\",\"bulb2State\":\"");
+    out += (record.relayMask & 0x2) ? appendLiteral(out, "On") : appendLiteral(out, "Off");
+    out += appendLiteral(out, "\",\"current\":\"");
+    out += formatFixed(out, record.currentTenthMilliAmps, 4);
+    out += appendLiteral(out, "\",\"power\":\"");
+    out += formatFixed(out, record.powerCentiWatts, 2);
+    out += appendLiteral(out, "\"}");
+    return static_cast<size_t>(out - buffer);
+}
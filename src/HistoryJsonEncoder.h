@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "HistoryRing.h"
+
+// Longest output of encodeHistoryRow(), with room to spare (about 140 bytes in practice)
+const size_t historyRowJsonMax = 160;
+
+// Encode one row object ({"seq":..,"date":..,...}) into out; returns its length
+size_t encodeHistoryRow(char *out, const HistoryRecord &record, uint32_t sequence);
+
+// Resumable JSON encoder for /historicalData.
+// Produces {"lastSeq":N,"data":[{"seq":...},...]} a piece at a time into whatever buffer the caller hands it,
+// so a response of any length is streamed with constant memory: one encoded row of scratch
+// space plus the caller's chunk buffer. Rows are pulled through a reader callback.
+class HistoryJsonEncoder {
+public:
+    // Fetch the index-th row to emit (0 = first in the output) and its sequence number;
+    // return false to stop early
+    typedef bool (*RowReader)(void *context, size_t index, HistoryRecord &record, uint32_t &sequence);
+
+    // lastSequence is reported in the document so clients can resume with ?since=
+    void begin(RowReader reader, void *context, size_t rowCount, uint32_t lastSequence);
+
+    // Copy the next bytes of the document into buffer; returns 0 once the document is complete
+    size_t read(char *buffer, size_t capacity);
+
+private:
+    enum Stage { Prefix, Rows, Suffix, Done };
+
+    void loadNext(); // Encode the next piece of output into scratch
+
+    RowReader rowReader = nullptr;
+    void *readerContext = nullptr;
+    size_t rowsTotal = 0;
+    size_t nextRow = 0;
+    uint32_t documentSequence = 0;
+    Stage stage = Done;
+
+    char scratch[historyRowJsonMax + 1]; // One row plus its leading comma
+    size_t scratchLength = 0;
+    size_t scratchOffset = 0;
+};
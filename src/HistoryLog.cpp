@@ -0,0 +1,180 @@
+#include "HistoryLog.h"
+
+#include <string.h>
+
+#include "hal/hal.h"
+
+static const uint32_t segmentMagic = 0x31474c48; // "HLG1"
+
+static_assert(sizeof(HistoryRecord) + sizeof(uint32_t) == HistoryLog::slotBytes, "A slot is one record and its CRC");
+static_assert(HistoryLog::headerBytes + HistoryLog::slotsPerSegment * HistoryLog::slotBytes <= hal::flashSectorBytes,
+              "A segment fits in one flash sector");
+
+// CRC-32 (IEEE, reflected) with a 16-entry table: two lookups per byte, 64 bytes of flash
+static uint32_t crc32Update(uint32_t crc, const void *data, size_t length) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xf] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0xf] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// A record's CRC also covers its sequence number, so a slot can never validate as another record
+static uint32_t recordCrc(uint32_t sequence, const HistoryRecord &record) {
+    return crc32Update(crc32Update(0, &sequence, sizeof(sequence)), &record, sizeof(record));
+}
+
+bool HistoryLog::begin() {
+    segmentCount = hal::flashSize() / hal::flashSectorBytes;
+    headSegment = 0;
+    headSlot = 0;
+    headNumber = 0;
+    headFirstSequence = 1;
+    oldestSequence = 1;
+    nextSequence = 1;
+    failed = false;
+    recovered = 0;
+    corrupt = 0;
+    erased = 0;
+    if (segmentCount == 0) {
+        return false;
+    }
+
+    // Newest and oldest segments by number. A segment whose header is missing or torn (erased, or
+    // power lost before the header landed) is skipped; the next append reclaims it.
+    uint32_t oldestNumber = 0;
+    for (size_t segment = 0; segment < segmentCount; segment++) {
+        SegmentHeader header;
+        if (!readHeader(segment, header)) {
+            continue;
+        }
+        if (headNumber == 0 || header.number > headNumber) {
+            headNumber = header.number;
+            headSegment = segment;
+            headFirstSequence = header.firstSequence;
+        }
+        if (oldestNumber == 0 || header.number < oldestNumber) {
+            oldestNumber = header.number;
+            oldestSequence = header.firstSequence;
+        }
+    }
+    if (headNumber == 0) {
+        return true; // Blank or foreign flash: start a new log on the first append
+    }
+
+    // Slots fill in order, so the written ones (valid or torn) are a prefix of the segment
+    size_t low = 0;
+    size_t high = slotsPerSegment;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (slotErased(headSegment, middle)) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    headSlot = low;
+    nextSequence = headFirstSequence + headSlot;
+    recovered = nextSequence - oldestSequence;
+    return true;
+}
+
+bool HistoryLog::append(const HistoryRecord &record) {
+    if (!ready()) {
+        return false;
+    }
+    if (headNumber == 0) {
+        if (!startSegment(0, 1, nextSequence)) {
+            return false;
+        }
+    } else if (headSlot == slotsPerSegment) {
+        // Reusing the oldest segment drops its records first
+        if (nextSequence - oldestSequence + slotsPerSegment > capacity()) {
+            oldestSequence = nextSequence + slotsPerSegment - capacity();
+        }
+        if (!startSegment((headSegment + 1) % segmentCount, headNumber + 1, nextSequence)) {
+            return false;
+        }
+    }
+
+    uint8_t slot[slotBytes];
+    const uint32_t crc = recordCrc(nextSequence, record);
+    memcpy(slot, &record, sizeof(record));
+    memcpy(slot + sizeof(record), &crc, sizeof(crc));
+    if (!hal::flashWrite(slotOffset(headSegment, headSlot), slot, sizeof(slot))) {
+        failed = true;
+        return false;
+    }
+    headSlot++;
+    nextSequence++;
+    return true;
+}
+
+bool HistoryLog::read(uint32_t sequence, HistoryRecord &record) const {
+    if (sequence < oldestSequence || sequence >= nextSequence) {
+        return false;
+    }
+    // Every segment before the head is full, so a sequence number maps straight to its slot
+    size_t segment = headSegment;
+    uint32_t first = headFirstSequence;
+    if (sequence < headFirstSequence) {
+        const size_t back = (headFirstSequence - 1 - sequence) / slotsPerSegment + 1;
+        segment = (headSegment + segmentCount - back % segmentCount) % segmentCount;
+        first = headFirstSequence - back * slotsPerSegment;
+    }
+    uint8_t slot[slotBytes];
+    if (!hal::flashRead(slotOffset(segment, sequence - first), slot, sizeof(slot))) {
+        return false;
+    }
+    uint32_t crc;
+    memcpy(&record, slot, sizeof(record));
+    memcpy(&crc, slot + sizeof(record), sizeof(crc));
+    if (crc != recordCrc(sequence, record)) {
+        corrupt++; // Torn by power loss (or worn out)
+        return false;
+    }
+    return true;
+}
+
+bool HistoryLog::readHeader(size_t segment, SegmentHeader &header) const {
+    if (!hal::flashRead(segment * hal::flashSectorBytes, &header, sizeof(header))) {
+        return false;
+    }
+    return header.magic == segmentMagic && header.number != 0 &&
+           header.crc == crc32Update(0, &header, offsetof(SegmentHeader, crc));
+}
+
+bool HistoryLog::slotErased(size_t segment, size_t slot) const {
+    uint32_t words[slotBytes / sizeof(uint32_t)];
+    if (!hal::flashRead(slotOffset(segment, slot), words, sizeof(words))) {
+        return false;
+    }
+    return (words[0] & words[1] & words[2] & words[3]) == 0xffffffff;
+}
+
+// Erase a segment and write its header; records follow from slot 0
+bool HistoryLog::startSegment(size_t segment, uint32_t number, uint32_t firstSequence) {
+    SegmentHeader header = {segmentMagic, number, firstSequence, 0};
+    header.crc = crc32Update(0, &header, offsetof(SegmentHeader, crc));
+    if (!hal::flashEraseSector(segment * hal::flashSectorBytes) ||
+        !hal::flashWrite(segment * hal::flashSectorBytes, &header, sizeof(header))) {
+        failed = true;
+        return false;
+    }
+    erased++;
+    headSegment = segment;
+    headSlot = 0;
+    headNumber = number;
+    headFirstSequence = firstSequence;
+    return true;
+}
+
+uint32_t HistoryLog::slotOffset(size_t segment, size_t slot) const {
+    return segment * hal::flashSectorBytes + headerBytes + slot * slotBytes;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "HistoryRing.h"
+
+// Append-only history log on raw flash (hal::flash*), kept across reboots and brown-outs.
+// The region is a ring of one-sector segments. Each segment starts with a header (segment number,
+// sequence number of its first record, CRC) followed by fixed 16-byte slots: one HistoryRecord and
+// a CRC over the record and its sequence number. Records are only ever appended, so each slot is
+// written once between erases and a sector is erased once per pass around the ring; when the ring
+// is full the oldest segment is erased to make room.
+//
+// begin() recovers the log from the segment headers plus a binary search for the first erased slot
+// of the newest segment, so boot cost does not grow with the number of records. A record torn by
+// power loss fails its CRC: its sequence number stays used and reads of it return false.
+class HistoryLog {
+public:
+    static const size_t slotBytes = 16;
+    static const size_t headerBytes = 16;
+    static const size_t slotsPerSegment = (4096 - headerBytes) / slotBytes; // 255
+
+    // Scan the flash region; false if there is none (the log then stays empty and ignores appends)
+    bool begin();
+
+    // Append a record as sequence number lastSequence() + 1; false if flash failed, after which the
+    // log stops appending and keeps serving what it holds
+    bool append(const HistoryRecord &record);
+
+    // Read the record with the given sequence number; false if it is not held or fails its CRC
+    bool read(uint32_t sequence, HistoryRecord &record) const;
+
+    // Sequence numbers of the oldest and newest held records (first > last while empty)
+    uint32_t firstSequence() const { return oldestSequence; }
+    uint32_t lastSequence() const { return nextSequence - 1; }
+    size_t size() const { return nextSequence - oldestSequence; }
+    size_t capacity() const { return segmentCount * slotsPerSegment; }
+
+    // Recovery and wear figures
+    uint32_t recoveredRecords() const { return recovered; }   // Records found by begin()
+    uint32_t corruptRecords() const { return corrupt; }       // Reads that failed their CRC
+    uint32_t segmentsErased() const { return erased; }        // Erases since begin()
+    bool ready() const { return segmentCount > 0 && !failed; }
+
+private:
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t number;        // Increases by one per segment, never reused
+        uint32_t firstSequence; // Sequence number of slot 0
+        uint32_t crc;           // CRC-32 of the fields above
+    };
+
+    bool readHeader(size_t segment, SegmentHeader &header) const;
+    bool slotErased(size_t segment, size_t slot) const;
+    bool startSegment(size_t segment, uint32_t number, uint32_t firstSequence);
+    uint32_t slotOffset(size_t segment, size_t slot) const;
+
+    size_t segmentCount = 0;
+    size_t headSegment = 0;        // Segment being appended to
+    size_t headSlot = 0;           // Next free slot in it (slotsPerSegment = full)
+    uint32_t headNumber = 0;       // Its segment number (0 = nothing written yet)
+    uint32_t headFirstSequence = 1;
+    uint32_t oldestSequence = 1;
+    uint32_t nextSequence = 1;
+    bool failed = false;
+
+    uint32_t recovered = 0;
+    mutable uint32_t corrupt = 0;
+    uint32_t erased = 0;
+};
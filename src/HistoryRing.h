@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One history sample. Plain fixed-point fields, no heap: 12 bytes per row.
+struct HistoryRecord {
+    uint32_t timestamp;             // Seconds since 1970-01-01 in the browser's local time
+    uint32_t powerCentiWatts;       // Power consumption in 0.01 W
+    uint16_t currentTenthMilliAmps; // RMS current in 0.0001 A (max 6.5535 A, the ACS712-05B tops out at 5 A)
+    uint16_t relayMask;             // Bit n set = relay n closed
+};
+
+static_assert(sizeof(HistoryRecord) == 12, "HistoryRecord must stay a packed 12-byte row");
+
+// Fixed-capacity ring of history samples; the oldest row is overwritten when full.
+// Every sample gets a sequence number (1, 2, 3, ...) derived from its position, so
+// clients can ask for "rows after N" without the records storing it.
+template <size_t Capacity>
+class HistoryRing {
+public:
+    static_assert(Capacity > 0, "History ring needs at least one row");
+
+    // Append a sample, overwriting the oldest one once the ring is full
+    void push(const HistoryRecord &record) {
+        rows[head] = record;
+        head = (head + 1) % Capacity;
+        if (count < Capacity) {
+            count++;
+        }
+        written++;
+    }
+
+    // Number the next sample sequence + 1, e.g. to continue after the rows recovered from flash.
+    // Only meaningful while the ring is empty.
+    void resume(uint32_t sequence) { written = sequence; }
+
+    // Sample by age: 0 is the newest, size() - 1 the oldest
+    const HistoryRecord &newest(size_t age) const {
+        return rows[(head + Capacity - 1 - age) % Capacity];
+    }
+
+    // Sequence number of the newest sample (0 while empty) and of the oldest one still held
+    uint32_t lastSequence() const { return written; }
+    uint32_t firstSequence() const { return written - count + 1; }
+
+    // Number of held samples with a sequence number greater than since
+    size_t countNewerThan(uint32_t since) const {
+        return since >= written ? 0 : (written - since < count ? written - since : count);
+    }
+
+    size_t size() const { return count; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    HistoryRecord rows[Capacity] = {};
+    size_t head = 0;  // Slot the next sample goes into
+    size_t count = 0; // Number of valid samples
+    uint32_t written = 0; // Samples pushed since boot = sequence number of the newest
+};
@@ -0,0 +1,40 @@
+#include "HistoryRollup.h"
+
+#include <string.h>
+
+#include "Format.h"
+
+// Append a string literal without its terminator
+template <size_t N>
+static size_t appendLiteral(char *out, const char (&text)[N]) {
+    memcpy(out, text, N - 1);
+    return N - 1;
+}
+
+// {"min":"..","max":"..","mean":".."} with the given number of decimals
+static size_t encodeStats(char *buffer, uint32_t minimum, uint32_t maximum, uint32_t mean, uint8_t decimals) {
+    char *out = buffer;
+    out += appendLiteral(out, "{\"min\":\"");
+    out += formatFixed(out, minimum, decimals);
+    out += appendLiteral(out, "\",\"max\":\"");
+    out += formatFixed(out, maximum, decimals);
+    out += appendLiteral(out, "\",\"mean\":\"");
+    out += formatFixed(out, mean, decimals);
+    out += appendLiteral(out, "\"}");
+    return static_cast<size_t>(out - buffer);
+}
+
+// Numbers stay strings with fixed decimals, like the history rows
+size_t encodeRollupBucket(char *buffer, const RollupBucket &bucket) {
+    char *out = buffer;
+    out += appendLiteral(out, "{\"start\":");
+    out += formatUnsigned(out, bucket.start);
+    out += appendLiteral(out, ",\"count\":");
+    out += formatUnsigned(out, bucket.count);
+    out += appendLiteral(out, ",\"current\":");
+    out += encodeStats(out, bucket.minCurrent, bucket.maxCurrent, bucket.meanCurrent(), 4);
+    out += appendLiteral(out, ",\"power\":");
+    out += encodeStats(out, bucket.minPower, bucket.maxPower, bucket.meanPower(), 2);
+    *out++ = '}';
+    return static_cast<size_t>(out - buffer);
+}
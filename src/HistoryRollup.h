@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "HistoryRing.h"
+
+// Summary of every sample whose timestamp falls in [start, start + bucket length).
+// Sums are kept instead of means so a bucket is updated in O(1) and never rounds twice.
+struct RollupBucket {
+    uint32_t start;           // Wall-clock seconds, a multiple of the tier's bucket length
+    uint32_t count;           // Samples in the bucket
+    uint16_t minCurrent;      // 0.0001 A, like HistoryRecord
+    uint16_t maxCurrent;
+    uint32_t minPower;        // 0.01 W, like HistoryRecord
+    uint32_t maxPower;
+    uint64_t currentSum;
+    uint64_t powerSum;
+
+    uint32_t meanCurrent() const { return count ? (uint32_t)((currentSum + count / 2) / count) : 0; }
+    uint32_t meanPower() const { return count ? (uint32_t)((powerSum + count / 2) / count) : 0; }
+};
+
+// Longest output of encodeRollupBucket()
+const size_t rollupBucketJsonMax = 192;
+
+// Encode one bucket ({"start":..,"count":..,"current":{"min":..,"max":..,"mean":..},"power":{...}}); returns its length
+size_t encodeRollupBucket(char *out, const RollupBucket &bucket);
+
+// One resolution tier: a fixed ring of buckets of bucketSeconds each, newest last.
+// add() folds a sample into the open bucket, or opens the next one (overwriting the oldest) when the
+// sample's timestamp lands in a different bucket, so every sample costs O(1) per tier and a query
+// only walks the buckets it returns. A clock step (e.g. /timeInit) simply opens a new bucket.
+class RollupTier {
+public:
+    RollupTier(const char *name, uint32_t bucketSeconds, RollupBucket *buckets, size_t capacity)
+        : tierName(name), seconds(bucketSeconds), rows(buckets), slots(capacity) {}
+
+    void add(const HistoryRecord &record) {
+        const uint32_t start = record.timestamp - record.timestamp % seconds;
+        if (count == 0 || rows[(head + slots - 1) % slots].start != start) {
+            RollupBucket &bucket = rows[head];
+            bucket = RollupBucket();
+            bucket.start = start;
+            bucket.minCurrent = 0xffff;
+            bucket.minPower = 0xffffffff;
+            head = (head + 1) % slots;
+            if (count < slots) {
+                count++;
+            }
+            opened++;
+        }
+        RollupBucket &bucket = rows[(head + slots - 1) % slots];
+        bucket.count++;
+        bucket.currentSum += record.currentTenthMilliAmps;
+        bucket.powerSum += record.powerCentiWatts;
+        if (record.currentTenthMilliAmps < bucket.minCurrent) {
+            bucket.minCurrent = record.currentTenthMilliAmps;
+        }
+        if (record.currentTenthMilliAmps > bucket.maxCurrent) {
+            bucket.maxCurrent = record.currentTenthMilliAmps;
+        }
+        if (record.powerCentiWatts < bucket.minPower) {
+            bucket.minPower = record.powerCentiWatts;
+        }
+        if (record.powerCentiWatts > bucket.maxPower) {
+            bucket.maxPower = record.powerCentiWatts;
+        }
+    }
+
+    // Bucket by age: 0 is the open (newest) bucket, size() - 1 the oldest
+    const RollupBucket &newest(size_t age) const { return rows[(head + slots - 1 - age) % slots]; }
+
+    const char *name() const { return tierName; }
+    uint32_t bucketSeconds() const { return seconds; }
+    size_t size() const { return count; }
+    size_t capacity() const { return slots; }
+    uint32_t bucketsOpened() const { return opened; } // Since boot; lets a reader notice the ring moved on
+
+private:
+    const char *tierName;
+    uint32_t seconds;
+    RollupBucket *rows;
+    size_t slots;
+    size_t head = 0;  // Slot the next bucket goes into
+    size_t count = 0; // Number of valid buckets
+    uint32_t opened = 0;
+};
+
+// A tier that owns its ring
+template <size_t Capacity>
+class RollupRing : public RollupTier {
+public:
+    static_assert(Capacity > 0, "Rollup tier needs at least one bucket");
+
+    RollupRing(const char *name, uint32_t bucketSeconds) : RollupTier(name, bucketSeconds, storage, Capacity) {}
+
+private:
+    RollupBucket storage[Capacity] = {};
+};
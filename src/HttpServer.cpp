@@ -0,0 +1,614 @@
+#include "HttpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "hal/net.h"
+
+static_assert(HTTP_RESPONSE_BUFFER_BYTES <= 0xffff, "Chunk sizes are written with at most 4 hex digits");
+
+static const size_t chunkPrefixBytes = 6; // "ffff\r\n"
+static const char busyResponse[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static const char *reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "";
+    }
+}
+
+// Offset just past the "\r\n\r\n" that ends the header block, or 0 if it has not arrived yet
+static size_t findHeaderEnd(const char *data, size_t length) {
+    for (size_t i = 3; i < length; i++) {
+        if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r') {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Content-Length of a complete header block without modifying it; 0 if absent, -1 if malformed
+static long findContentLength(const char *headers, size_t length) {
+    static const char name[] = "\ncontent-length:";
+    const size_t nameLength = sizeof(name) - 1;
+    for (size_t i = 0; i + nameLength < length; i++) {
+        if (headers[i] == '\n' && strncasecmp(headers + i, name, nameLength) == 0) {
+            char *end;
+            long value = strtol(headers + i + nameLength, &end, 10);
+            return value < 0 || (*end != '\r' && *end != ' ') ? -1 : value;
+        }
+    }
+    return 0;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode %XX escapes and '+' in place; the text only ever shrinks
+static void urlDecode(char *text) {
+    char *out = text;
+    for (char *in = text; *in != '\0'; in++) {
+        if (*in == '+') {
+            *out++ = ' ';
+        } else if (*in == '%' && hexValue(in[1]) >= 0 && hexValue(in[2]) >= 0) {
+            *out++ = static_cast<char>(hexValue(in[1]) * 16 + hexValue(in[2]));
+            in += 2;
+        } else {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+}
+
+bool HttpServer::begin(const RouteTable &routeTable) {
+    routes = &routeTable;
+    listenFd = hal::listenTcp(listenPort, HTTP_MAX_CONNECTIONS);
+    return listenFd >= 0;
+}
+
+void HttpServer::collectHeaders(const char *keys[], size_t count) {
+    headerKeyCount = count < HTTP_MAX_HEADERS ? count : HTTP_MAX_HEADERS;
+    for (size_t i = 0; i < headerKeyCount; i++) {
+        headerKeys[i] = keys[i];
+    }
+}
+
+size_t HttpServer::connectionCount() const {
+    size_t count = 0;
+    for (const Connection &connection : connections) {
+        if (connection.state != Free) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void HttpServer::poll(uint32_t nowMillis) {
+    if (listenFd < 0) {
+        return;
+    }
+    acceptClients(nowMillis);
+    for (Connection &connection : connections) {
+        if (connection.state == Reading) {
+            readRequest(connection, nowMillis);
+        }
+        if (connection.state == Writing) {
+            writeResponse(connection, nowMillis);
+        }
+    }
+}
+
+uint32_t HttpServer::waitSet(hal::WaitSocket *sockets, size_t &count, size_t capacity, uint32_t nowMillis) const {
+    if (listenFd < 0) {
+        return UINT32_MAX;
+    }
+    if (count < capacity) {
+        sockets[count++] = {listenFd, false};
+    }
+    uint32_t wait = UINT32_MAX;
+    for (const Connection &connection : connections) {
+        if (connection.state == Free) {
+            continue;
+        }
+        uint32_t timeout = HTTP_REQUEST_TIMEOUT_MS;
+        if (connection.state == Reading) {
+            // A pipelined request left behind by the last response is handled without new input
+            const size_t headerLength = findHeaderEnd(connection.input, connection.inputLength);
+            if (headerLength > 0 && (long)(connection.inputLength - headerLength) >= findContentLength(connection.input, headerLength)) {
+                return 0;
+            }
+            if (connection.inputLength == 0) {
+                timeout = HTTP_KEEPALIVE_TIMEOUT_MS;
+            }
+        }
+        const uint32_t elapsed = nowMillis - connection.since;
+        const uint32_t left = elapsed < timeout ? timeout - elapsed : 0;
+        wait = left < wait ? left : wait;
+        if (count < capacity) {
+            sockets[count++] = {connection.fd, connection.state == Writing};
+        }
+    }
+    return wait;
+}
+
+void HttpServer::acceptClients(uint32_t nowMillis) {
+    for (;;) {
+        int fd = hal::acceptClient(listenFd);
+        if (fd < 0) {
+            return; // Nothing pending (or a transient error); try again next poll
+        }
+        Connection *slot = nullptr;
+        for (Connection &connection : connections) {
+            if (connection.state == Free) {
+                slot = &connection;
+                break;
+            }
+        }
+        if (slot == nullptr) {
+            hal::sendSome(fd, busyResponse, sizeof(busyResponse) - 1);
+            hal::closeSocket(fd);
+            rejected++;
+            continue;
+        }
+        slot->state = Reading;
+        slot->keepAlive = false;
+        slot->fd = fd;
+        slot->since = nowMillis;
+        slot->inputLength = 0;
+        slot->requestLength = 0;
+        slot->outputHead = 0;
+        slot->outputLength = 0;
+        slot->flashBody = nullptr;
+        slot->flashRemaining = 0;
+        slot->reader = nullptr;
+    }
+}
+
+// Receive until a whole request (headers plus Content-Length body) is buffered, then handle it
+void HttpServer::readRequest(Connection &connection, uint32_t nowMillis) {
+    for (;;) {
+        size_t headerLength = findHeaderEnd(connection.input, connection.inputLength);
+        if (headerLength > 0) {
+            long contentLength = findContentLength(connection.input, headerLength);
+            if (contentLength < 0) {
+                sendError(connection, 400, "Bad Content-Length");
+                return;
+            }
+            if ((size_t)contentLength > sizeof(connection.input) - headerLength) {
+                sendError(connection, 413, "Request too large");
+                return;
+            }
+            if (connection.inputLength >= headerLength + contentLength) {
+                connection.requestLength = headerLength + contentLength;
+                if (!parseRequest(connection, connection.input + headerLength, headerLength)) {
+                    sendError(connection, 400, "Malformed request");
+                    return;
+                }
+                request.body = connection.input + headerLength;
+                request.bodyLength = contentLength;
+                dispatch(connection);
+                connection.since = nowMillis;
+                return;
+            }
+        } else if (connection.inputLength == sizeof(connection.input)) {
+            sendError(connection, 431, "Request headers too large");
+            return;
+        }
+
+        long received = hal::receiveSome(connection.fd, connection.input + connection.inputLength,
+                                         sizeof(connection.input) - connection.inputLength);
+        if (received < 0) {
+            closeConnection(connection); // Client closed (or reset) the connection
+            return;
+        }
+        if (received == 0) {
+            break;
+        }
+        if (connection.inputLength == 0) {
+            connection.since = nowMillis; // The request timeout runs from its first byte
+        }
+        connection.inputLength += received;
+    }
+
+    if (connection.inputLength > 0 && nowMillis - connection.since >= HTTP_REQUEST_TIMEOUT_MS) {
+        timedOut++;
+        sendError(connection, 408, "Request timeout");
+    } else if (connection.inputLength == 0 && nowMillis - connection.since >= HTTP_KEEPALIVE_TIMEOUT_MS) {
+        closeConnection(connection); // Idle keep-alive connection
+    }
+}
+
+// Split the request line, query arguments and collected headers in place (NUL-terminating each piece)
+bool HttpServer::parseRequest(Connection &connection, char *end, size_t headerLength) {
+    request = Request();
+    char *line = connection.input;
+    char *lineEnd = static_cast<char *>(memchr(line, '\r', headerLength));
+    *lineEnd = '\0';
+
+    char *target = strchr(line, ' ');
+    if (target == nullptr) {
+        return false;
+    }
+    *target++ = '\0';
+    char *version = strchr(target, ' ');
+    if (version == nullptr) {
+        return false;
+    }
+    *version++ = '\0';
+    request.method = line;
+    request.methodId = RouteTable::parseMethod(line);
+    request.keepAlive = strcmp(version, "HTTP/1.1") == 0; // HTTP/1.0 closes unless asked otherwise
+
+    char *query = strchr(target, '?');
+    if (query != nullptr) {
+        *query++ = '\0';
+        while (*query != '\0' && request.argCount < HTTP_MAX_ARGS) {
+            char *next = strchr(query, '&');
+            if (next != nullptr) {
+                *next++ = '\0';
+            }
+            if (*query != '\0') {
+                char *value = strchr(query, '=');
+                if (value != nullptr) {
+                    *value++ = '\0';
+                    urlDecode(value);
+                }
+                urlDecode(query);
+                request.args[request.argCount++] = {query, value != nullptr ? value : ""};
+            }
+            if (next == nullptr) {
+                break;
+            }
+            query = next;
+        }
+    }
+    request.path = target;
+
+    for (line = lineEnd + 2; line < end - 2; line = lineEnd + 2) {
+        lineEnd = static_cast<char *>(memchr(line, '\r', end - line));
+        *lineEnd = '\0';
+        char *value = strchr(line, ':');
+        if (value == nullptr) {
+            continue;
+        }
+        *value++ = '\0';
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        if (strcasecmp(line, "Connection") == 0) {
+            if (strcasecmp(value, "close") == 0) {
+                request.keepAlive = false;
+            } else if (strcasecmp(value, "keep-alive") == 0) {
+                request.keepAlive = true;
+            }
+        }
+        for (size_t i = 0; i < headerKeyCount; i++) {
+            if (strcasecmp(line, headerKeys[i]) == 0) {
+                request.headers[i] = value;
+            }
+        }
+    }
+    return true;
+}
+
+void HttpServer::dispatch(Connection &connection) {
+    current = &connection - connections;
+    responded = false;
+    detached = false;
+    pendingHeadersLength = 0;
+    connection.keepAlive = request.keepAlive;
+
+    const int match = routes->find(request.methodId, request.path);
+    if (match >= 0) {
+        METRICS_COUNT(stats[match].requests);
+        METRICS_TIME(stats[match].handlerTime);
+        (*routes)[match].handler();
+    } else if (const uint8_t allowed = routes->allowedMethods(request.path)) {
+        METRICS_COUNT(wrongMethod);
+        char allow[32];
+        size_t length = 0;
+        for (uint8_t method = 0; method < HttpMethodCount; method++) {
+            if (allowed & 1u << method) {
+                length += snprintf(allow + length, sizeof(allow) - length, "%s%s", length > 0 ? ", " : "",
+                                   RouteTable::methodName((HttpMethod)method));
+            }
+        }
+        sendHeader("Allow", allow);
+        send(405, "text/plain", "Method not allowed");
+    } else {
+        METRICS_COUNT(unmatched);
+        send(404, "text/plain", "Not found");
+    }
+    if (detached) {
+        return; // The socket now belongs to someone else
+    }
+    if (!responded) {
+        send(500, "text/plain", "Handler did not send a response");
+    }
+    connection.state = Writing;
+}
+
+bool HttpServer::hasArg(const char *name) const {
+    for (size_t i = 0; i < request.argCount; i++) {
+        if (strcmp(request.args[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *HttpServer::arg(const char *name) const {
+    for (size_t i = 0; i < request.argCount; i++) {
+        if (strcmp(request.args[i].name, name) == 0) {
+            return request.args[i].value;
+        }
+    }
+    return "";
+}
+
+// Check one query argument against its spec: text is the value (nullptr if not given), number the
+// decoded number or choice index. False after answering 400.
+bool HttpServer::decodeArg(const QueryArgSpec &spec, const char *&text, uint64_t &number) {
+    text = nullptr;
+    number = 0;
+    for (size_t i = 0; i < request.argCount && text == nullptr; i++) {
+        if (strcmp(request.args[i].name, spec.name) == 0) {
+            text = request.args[i].value;
+        }
+    }
+
+    bool valid = text != nullptr || !spec.required;
+    if (text != nullptr) {
+        switch (spec.kind) {
+            case QueryArgSpec::Number:
+                for (const char *digit = text; valid && *digit != '\0'; digit++) {
+                    const unsigned value = (unsigned)(*digit - '0');
+                    valid = value <= 9 && number <= (UINT64_MAX - value) / 10;
+                    number = number * 10 + value;
+                }
+                valid = valid && text[0] != '\0' && number >= spec.min && number <= spec.max;
+                break;
+            case QueryArgSpec::Choice:
+                valid = false;
+                for (size_t i = 0; i < spec.choiceCount && !valid; i++) {
+                    valid = strcmp(text, spec.choices[i]) == 0;
+                    number = i;
+                }
+                break;
+            case QueryArgSpec::Text:
+                valid = strlen(text) <= spec.max;
+                break;
+        }
+    }
+    if (valid) {
+        return true;
+    }
+
+    char message[128];
+    int length = snprintf(message, sizeof(message), "{\"status\":\"error\", \"message\":\"");
+    if (text == nullptr) {
+        length += snprintf(message + length, sizeof(message) - length, "Missing %s", spec.name);
+    } else if (spec.kind == QueryArgSpec::Number) {
+        length += snprintf(message + length, sizeof(message) - length, "%s must be %llu to %llu", spec.name,
+                           (unsigned long long)spec.min, (unsigned long long)spec.max);
+    } else if (spec.kind == QueryArgSpec::Choice) {
+        length += snprintf(message + length, sizeof(message) - length, "%s must be ", spec.name);
+        for (size_t i = 0; i < spec.choiceCount && length < (int)sizeof(message); i++) {
+            length += snprintf(message + length, sizeof(message) - length, "%s%s", i > 0 ? "|" : "", spec.choices[i]);
+        }
+    } else {
+        length += snprintf(message + length, sizeof(message) - length, "%s is too long", spec.name);
+    }
+    if (length < (int)sizeof(message)) {
+        snprintf(message + length, sizeof(message) - length, "\"}");
+    }
+    send(400, "application/json", message);
+    return false;
+}
+
+const char *HttpServer::header(const char *name) const {
+    for (size_t i = 0; i < headerKeyCount; i++) {
+        if (strcasecmp(headerKeys[i], name) == 0) {
+            return request.headers[i] != nullptr ? request.headers[i] : "";
+        }
+    }
+    return "";
+}
+
+void HttpServer::sendHeader(const char *name, const char *value) {
+    size_t space = sizeof(pendingHeaders) - pendingHeadersLength;
+    int length = snprintf(pendingHeaders + pendingHeadersLength, space, "%s: %s\r\n", name, value);
+    if (length > 0 && (size_t)length < space) {
+        pendingHeadersLength += length;
+    }
+}
+
+// Status line and headers into the current connection's output buffer; contentLength < 0 means chunked
+bool HttpServer::beginResponse(int code, const char *contentType, long contentLength) {
+    Connection &connection = connections[current];
+    char *out = connection.output;
+    size_t space = sizeof(connection.output);
+    int length = snprintf(out, space, "HTTP/1.1 %d %s\r\n", code, reasonPhrase(code));
+    if (contentType != nullptr && length >= 0 && (size_t)length < space) {
+        length += snprintf(out + length, space - length, "Content-Type: %s\r\n", contentType);
+    }
+    if (length >= 0 && (size_t)length < space) {
+        length += contentLength >= 0 ? snprintf(out + length, space - length, "Content-Length: %ld\r\n", contentLength)
+                                     : snprintf(out + length, space - length, "Transfer-Encoding: chunked\r\n");
+    }
+    if (length >= 0 && (size_t)length < space) {
+        length += connection.keepAlive
+                      ? snprintf(out + length, space - length, "Connection: keep-alive\r\nKeep-Alive: timeout=%u\r\n",
+                                 (unsigned)(HTTP_KEEPALIVE_TIMEOUT_MS / 1000))
+                      : snprintf(out + length, space - length, "Connection: close\r\n");
+    }
+    if (length < 0 || (size_t)length + pendingHeadersLength + 2 > space) {
+        return false;
+    }
+    memcpy(out + length, pendingHeaders, pendingHeadersLength);
+    length += pendingHeadersLength;
+    memcpy(out + length, "\r\n", 2);
+    connection.outputHead = 0;
+    connection.outputLength = length + 2;
+    connection.flashBody = nullptr;
+    connection.flashRemaining = 0;
+    connection.reader = nullptr;
+    responded = true;
+    return true;
+}
+
+void HttpServer::send(int code, const char *contentType, const char *content) {
+    send(code, contentType, content, strlen(content));
+}
+
+void HttpServer::send(int code, const char *contentType, const char *content, size_t length) {
+    if (responded) {
+        return;
+    }
+    Connection &connection = connections[current];
+    if (!beginResponse(code, contentType, length) || connection.outputLength + length > sizeof(connection.output)) {
+        pendingHeadersLength = 0;
+        connection.keepAlive = false;
+        beginResponse(500, nullptr, 0); // The handler's response does not fit the buffer
+        return;
+    }
+    memcpy(connection.output + connection.outputLength, content, length);
+    connection.outputLength += length;
+}
+
+void HttpServer::sendFlash(int code, const char *contentType, const char *content, size_t length) {
+    if (!responded && beginResponse(code, contentType, length)) {
+        connections[current].flashBody = content;
+        connections[current].flashRemaining = length;
+    }
+}
+
+void HttpServer::sendStream(int code, const char *contentType, BodyReader reader, void *context) {
+    if (!responded && beginResponse(code, contentType, -1)) {
+        connections[current].reader = reader;
+        connections[current].readerContext = context;
+    }
+}
+
+int HttpServer::detachClient() {
+    Connection &connection = connections[current];
+    int fd = connection.fd;
+    connection.fd = -1;
+    connection.state = Free;
+    detached = true;
+    responded = true;
+    return fd;
+}
+
+// Send as much of the response as the socket takes right now: buffered bytes, then the flash body
+// or the next chunks of a streamed body
+void HttpServer::writeResponse(Connection &connection, uint32_t nowMillis) {
+    for (;;) {
+        const char *data;
+        size_t length;
+        if (connection.outputHead < connection.outputLength) {
+            data = connection.output + connection.outputHead;
+            length = connection.outputLength - connection.outputHead;
+        } else if (connection.flashRemaining > 0) {
+            data = connection.flashBody;
+            length = connection.flashRemaining;
+        } else if (connection.reader != nullptr) {
+            refillChunk(connection);
+            continue;
+        } else {
+            finishResponse(connection, nowMillis);
+            return;
+        }
+
+        long sent = hal::sendSome(connection.fd, data, length);
+        if (sent < 0) {
+            closeConnection(connection); // Peer went away
+            return;
+        }
+        if (sent == 0) {
+            break;
+        }
+        connection.since = nowMillis;
+        if (connection.outputHead < connection.outputLength) {
+            connection.outputHead += sent;
+        } else {
+            connection.flashBody += sent;
+            connection.flashRemaining -= sent;
+        }
+    }
+
+    if (nowMillis - connection.since >= HTTP_REQUEST_TIMEOUT_MS) {
+        timedOut++; // Client stopped reading
+        closeConnection(connection);
+    }
+}
+
+// Pull the next chunk of a streamed body into the output buffer, framed for chunked encoding
+bool HttpServer::refillChunk(Connection &connection) {
+    char *payload = connection.output + chunkPrefixBytes;
+    size_t length = connection.reader(connection.readerContext, payload, sizeof(connection.output) - chunkPrefixBytes - 2);
+    if (length == 0) {
+        memcpy(connection.output, "0\r\n\r\n", 5); // Last chunk, no trailers
+        connection.outputHead = 0;
+        connection.outputLength = 5;
+        connection.reader = nullptr;
+        return false;
+    }
+    char size[chunkPrefixBytes + 1];
+    int digits = snprintf(size, sizeof(size), "%x\r\n", (unsigned)length);
+    connection.outputHead = chunkPrefixBytes - digits;
+    memcpy(connection.output + connection.outputHead, size, digits);
+    memcpy(payload + length, "\r\n", 2);
+    connection.outputLength = chunkPrefixBytes + length + 2;
+    return true;
+}
+
+// Response fully sent: close, or keep the connection and move any pipelined bytes to the front
+void HttpServer::finishResponse(Connection &connection, uint32_t nowMillis) {
+    if (!connection.keepAlive) {
+        closeConnection(connection);
+        return;
+    }
+    size_t remaining = connection.inputLength - connection.requestLength;
+    memmove(connection.input, connection.input + connection.requestLength, remaining);
+    connection.inputLength = remaining;
+    connection.requestLength = 0;
+    connection.outputHead = 0;
+    connection.outputLength = 0;
+    connection.since = nowMillis;
+    connection.state = Reading;
+}
+
+// Answer without running a handler and close once it is sent
+void HttpServer::sendError(Connection &connection, int code, const char *reason) {
+    current = &connection - connections;
+    responded = false;
+    pendingHeadersLength = 0;
+    connection.keepAlive = false;
+    connection.inputLength = 0;
+    connection.requestLength = 0;
+    send(code, "text/plain", reason);
+    connection.state = Writing;
+}
+
+void HttpServer::closeConnection(Connection &connection) {
+    hal::closeSocket(connection.fd);
+    connection.state = Free;
+    connection.fd = -1;
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Config.h"
+#include "Metrics.h"
+#include "RouteTable.h"
+#include "hal/net.h"
+
+// Non-blocking, event-driven HTTP/1.1 server.
+// A fixed set of connection slots is serviced from poll(): each one runs its own state machine
+// (read request -> run handler -> write response -> keep-alive or close), so a slow or stalled
+// client only ever holds its own slot. Requests are parsed in place in the slot's input buffer;
+// responses are written from the slot's output buffer, straight from flash (sendFlash) or pulled
+// chunk by chunk from a BodyReader (sendStream). Nothing is allocated after begin().
+//
+// Handlers run inside poll() and use the request accessors and one send* call, like WebServer.
+// Routes come from a RouteTable built at compile time; query arguments are decoded by parseArgs().
+
+// How one query argument is checked: the untyped part of a QueryArg
+struct QueryArgSpec {
+    enum Kind : uint8_t { Number, Choice, Text };
+    const char *name;
+    Kind kind;
+    bool required;              // Missing is an error rather than leaving the member as it was
+    uint64_t min;               // Number: inclusive bounds. Text: max is the longest accepted length
+    uint64_t max;
+    const char *const *choices; // Choice: the accepted words; the member gets the index of the one given
+    size_t choiceCount;
+};
+
+// A query argument bound to a member of the handler's argument struct; made by the helpers below
+template <typename Args>
+struct QueryArg {
+    QueryArgSpec spec;
+    uint32_t Args::*number;     // Exactly one of these is set
+    uint64_t Args::*wideNumber;
+    uint8_t Args::*choice;
+    const char *Args::*text;    // Points into the request: valid until the handler returns
+};
+
+// Decimal digits only, min to max
+template <typename Args>
+constexpr QueryArg<Args> numberArg(const char *name, uint32_t Args::*member, uint32_t min, uint32_t max, bool required = false) {
+    return {{name, QueryArgSpec::Number, required, min, max, nullptr, 0}, member, nullptr, nullptr, nullptr};
+}
+template <typename Args>
+constexpr QueryArg<Args> numberArg(const char *name, uint64_t Args::*member, uint64_t min, uint64_t max, bool required = false) {
+    return {{name, QueryArgSpec::Number, required, min, max, nullptr, 0}, nullptr, member, nullptr, nullptr};
+}
+
+// One of count words; the member gets its index
+template <typename Args>
+constexpr QueryArg<Args> choiceArg(const char *name, uint8_t Args::*member, const char *const *words, size_t count, bool required = false) {
+    return {{name, QueryArgSpec::Choice, required, 0, 0, words, count}, nullptr, nullptr, member, nullptr};
+}
+
+// Any text up to maxLength bytes (after URL decoding)
+template <typename Args>
+constexpr QueryArg<Args> textArg(const char *name, const char *Args::*member, size_t maxLength, bool required = false) {
+    return {{name, QueryArgSpec::Text, required, 0, maxLength, nullptr, 0}, nullptr, nullptr, nullptr, member};
+}
+
+class HttpServer {
+public:
+    typedef RouteHandler Handler;
+
+    // Copy the next bytes of a streamed body into buffer; return 0 at the end
+    typedef size_t (*BodyReader)(void *context, char *buffer, size_t capacity);
+
+    explicit HttpServer(uint16_t port) : listenPort(port) {}
+
+    // Serve routes (usually a constexpr table, which must outlive the server)
+    bool begin(const RouteTable &routeTable);
+    void poll(uint32_t nowMillis);
+
+    // What poll() is waiting for, so loop() can sleep until then: appends the sockets to watch to
+    // sockets[count] (the listener and reading connections for input, writing ones for room to send)
+    // and returns the milliseconds until a connection times out; 0 if poll() has work right now
+    uint32_t waitSet(hal::WaitSocket *sockets, size_t &count, size_t capacity, uint32_t nowMillis) const;
+
+    // Headers the handlers need; all others are skipped while parsing (like WebServer::collectHeaders)
+    void collectHeaders(const char *headerKeys[], size_t headerKeysCount);
+
+    // Request accessors (inside a handler). Missing arguments and headers read as "".
+    const char *method() const { return request.method; }
+    const char *uri() const { return request.path; }
+    bool hasArg(const char *name) const;
+    const char *arg(const char *name) const;
+    const char *header(const char *name) const;
+    const char *body() const { return request.body; }
+    size_t bodyLength() const { return request.bodyLength; }
+    size_t connectionIndex() const { return current; } // Slot of the request being handled, < HTTP_MAX_CONNECTIONS
+
+    // Decode the query arguments a handler takes into its struct, checked against their specs. Arguments
+    // not given leave their members as initialised. On a bad or missing required argument the request is
+    // answered 400, naming it, and parseArgs() returns false; the handler just returns.
+    template <typename Args, size_t N>
+    bool parseArgs(const QueryArg<Args> (&specs)[N], Args &args) {
+        for (const QueryArg<Args> &field : specs) {
+            const char *text;
+            uint64_t number;
+            if (!decodeArg(field.spec, text, number)) {
+                return false;
+            }
+            if (text == nullptr) {
+                continue; // Not given
+            }
+            if (field.number != nullptr) {
+                args.*field.number = (uint32_t)number;
+            } else if (field.wideNumber != nullptr) {
+                args.*field.wideNumber = number;
+            } else if (field.choice != nullptr) {
+                args.*field.choice = (uint8_t)number;
+            } else {
+                args.*field.text = text;
+            }
+        }
+        return true;
+    }
+
+    // Response (inside a handler)
+    void sendHeader(const char *name, const char *value);
+    void send(int code, const char *contentType = nullptr, const char *content = "");
+    void send(int code, const char *contentType, const char *content, size_t length);
+    void sendFlash(int code, const char *contentType, const char *content, size_t length); // Body must outlive the response
+    void sendStream(int code, const char *contentType, BodyReader reader, void *context); // Chunked transfer encoding
+
+    // Hand the connection's socket to the caller (e.g. an event stream); the server forgets it
+    int detachClient();
+
+    size_t connectionCount() const;
+    uint32_t rejectedConnections() const { return rejected; } // Turned away because every slot was busy
+    uint32_t timedOutConnections() const { return timedOut; }
+
+#if METRICS_ENABLED
+    // Per-route counters for /metrics, in route table order
+    struct RouteStats {
+        uint32_t requests;
+        LatencyHistogram handlerTime; // Handler run time; the response is written out afterwards
+    };
+    size_t registeredRoutes() const { return routes != nullptr ? routes->size() : 0; }
+    const Route &route(size_t index) const { return (*routes)[index]; }
+    const RouteStats &routeStats(size_t index) const { return stats[index]; }
+    uint32_t unmatchedRequests() const { return unmatched; } // Answered 404
+    uint32_t wrongMethodRequests() const { return wrongMethod; } // Answered 405
+#endif
+
+private:
+    enum State : uint8_t { Free, Reading, Writing };
+
+    struct Connection {
+        State state;
+        bool keepAlive;             // Reuse the connection once the response is written
+        int fd;
+        uint32_t since;             // Last progress (bytes read or written), in ms
+        size_t inputLength;         // Bytes received into input
+        size_t requestLength;       // Length of the request being handled (headers + body)
+        size_t outputHead;          // Next byte of output to send
+        size_t outputLength;        // End of valid bytes in output
+        const char *flashBody;      // Body sent straight from flash after output (sendFlash)
+        size_t flashRemaining;
+        BodyReader reader;          // Streamed body source (sendStream), nullptr when done
+        void *readerContext;
+        char input[HTTP_REQUEST_BUFFER_BYTES];
+        char output[HTTP_RESPONSE_BUFFER_BYTES];
+    };
+
+    struct Param {
+        const char *name;
+        const char *value;
+    };
+
+    // The request being handled; pointers into the connection's input buffer
+    struct Request {
+        const char *method;
+        HttpMethod methodId;        // HttpMethodCount for methods no route can have
+        const char *path;
+        const char *body;
+        size_t bodyLength;
+        bool keepAlive;
+        size_t argCount;
+        Param args[HTTP_MAX_ARGS];
+        const char *headers[HTTP_MAX_HEADERS]; // Values, parallel to headerKeys
+    };
+
+    bool decodeArg(const QueryArgSpec &spec, const char *&text, uint64_t &number);
+    void acceptClients(uint32_t nowMillis);
+    void readRequest(Connection &connection, uint32_t nowMillis);
+    bool parseRequest(Connection &connection, char *end, size_t headerLength);
+    void dispatch(Connection &connection);
+    void writeResponse(Connection &connection, uint32_t nowMillis);
+    bool refillChunk(Connection &connection);
+    void finishResponse(Connection &connection, uint32_t nowMillis);
+    void sendError(Connection &connection, int code, const char *reason);
+    bool beginResponse(int code, const char *contentType, long contentLength);
+    void closeConnection(Connection &connection);
+
+    uint16_t listenPort;
+    int listenFd = -1;
+    uint32_t rejected = 0;
+    uint32_t timedOut = 0;
+#if METRICS_ENABLED
+    uint32_t unmatched = 0;
+    uint32_t wrongMethod = 0;
+    RouteStats stats[HTTP_MAX_ROUTES] = {};
+#endif
+
+    const RouteTable *routes = nullptr;
+    const char *headerKeys[HTTP_MAX_HEADERS] = {};
+    size_t headerKeyCount = 0;
+
+    // Handler context: only one request is handled at a time
+    Request request = {};
+    size_t current = 0;
+    bool responded = false;
+    bool detached = false;
+    char pendingHeaders[HTTP_EXTRA_HEADER_BYTES]; // Filled by sendHeader(), emitted by the next send*
+    size_t pendingHeadersLength = 0;
+
+    Connection connections[HTTP_MAX_CONNECTIONS] = {};
+};
@@ -0,0 +1,180 @@
+#include "Log.h"
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "DateTime.h"
+#include "Format.h"
+
+static_assert(LOG_RING_RECORDS >= 4 && (LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0,
+              "LOG_RING_RECORDS must be a power of two");
+
+// Bounded multi-producer ring. Position p lives in cell p % LOG_RING_RECORDS; the cell's state counts
+// its laps: 2 * lap while free for position p, 2 * lap + 1 once p's record is in it. Producers claim a
+// position with a compare-and-swap on tail, fill the cell and publish it through its state; the single
+// consumer frees it for the next lap. States wrap with the positions, so all of it starts at zero.
+struct LogCell {
+    std::atomic<uint32_t> state;
+    LogRecord record;
+};
+
+static const uint32_t stateMask = 2 * (UINT32_MAX / LOG_RING_RECORDS + 1) - 1;
+
+static LogCell cells[LOG_RING_RECORDS];
+static std::atomic<uint32_t> tail{0}; // Next position to claim (producers)
+static uint32_t head = 0;             // Next position to drain (loop())
+static std::atomic<uint32_t> dropped{0};
+
+// Line being written out; Serial may take it over several drains
+static char line[160];
+static size_t lineLength = 0;
+static size_t lineSent = 0;
+static uint32_t droppedReported = 0;
+
+static uint32_t freeState(uint32_t position) {
+    return (2 * (position / LOG_RING_RECORDS)) & stateMask;
+}
+
+bool logWrite(uint8_t level, const char *format, const uintptr_t *args, size_t argCount) {
+    uint32_t position = tail.load(std::memory_order_relaxed);
+    LogCell *cell;
+    for (;;) {
+        cell = &cells[position % LOG_RING_RECORDS];
+        const uint32_t state = cell->state.load(std::memory_order_acquire);
+        const uint32_t expected = freeState(position);
+        if (state == expected) {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (state == ((expected - 1) & stateMask)) {
+            dropped.fetch_add(1, std::memory_order_relaxed); // Previous lap not drained yet: ring full
+            return false;
+        } else {
+            position = tail.load(std::memory_order_relaxed); // Another producer took this position
+        }
+    }
+    LogRecord &record = cell->record;
+    record.millis = millis();
+    record.format = format;
+    record.level = level;
+    record.argCount = static_cast<uint8_t>(argCount);
+    for (size_t i = 0; i < argCount; i++) {
+        record.args[i] = args[i];
+    }
+    cell->state.store(freeState(position) + 1, std::memory_order_release);
+    return true;
+}
+
+static bool takeRecord(LogRecord &record) {
+    LogCell &cell = cells[head % LOG_RING_RECORDS];
+    if (cell.state.load(std::memory_order_acquire) != freeState(head) + 1) {
+        return false;
+    }
+    record = cell.record;
+    cell.state.store(freeState(head + LOG_RING_RECORDS), std::memory_order_release);
+    head++;
+    return true;
+}
+
+// Render one record into line; conversions that would not fit are cut off
+static size_t formatRecord(const LogRecord &record, char *out, size_t capacity) {
+    static const char levelNames[] = "DIWE";
+    const size_t limit = capacity - 24; // Room for the longest conversion and the line end
+    size_t length = formatUnsigned(out, record.millis);
+    out[length++] = ' ';
+    out[length++] = levelNames[record.level < 4 ? record.level : 3];
+    out[length++] = ' ';
+    size_t nextArg = 0;
+    for (const char *p = record.format; *p != '\0' && length < limit; p++) {
+        if (*p != '%' || p[1] == '\0') {
+            out[length++] = *p;
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            out[length++] = '%';
+            continue;
+        }
+        uint8_t decimals = 0;
+        if (*p == '.' && p[1] >= '0' && p[1] <= '9' && p[2] == 'f') {
+            decimals = static_cast<uint8_t>(p[1] - '0');
+            p += 2;
+        }
+        const uintptr_t value = nextArg < record.argCount ? record.args[nextArg++] : 0;
+        switch (*p) {
+        case 'u':
+            length += formatUnsigned(out + length, static_cast<uint32_t>(value));
+            break;
+        case 'd':
+            if (static_cast<intptr_t>(value) < 0) {
+                out[length++] = '-';
+                length += formatUnsigned(out + length, static_cast<uint32_t>(-static_cast<intptr_t>(value)));
+            } else {
+                length += formatUnsigned(out + length, static_cast<uint32_t>(value));
+            }
+            break;
+        case 'f':
+            length += formatFixed(out + length, static_cast<uint32_t>(value), decimals);
+            break;
+        case 't':
+            formatDate(static_cast<uint32_t>(value), out + length);
+            out[length + 10] = ' ';
+            formatTime(static_cast<uint32_t>(value), out + length + 11);
+            length += 19;
+            break;
+        case 's':
+            for (const char *text = reinterpret_cast<const char *>(value); text != nullptr && *text != '\0' && length < limit; text++) {
+                out[length++] = *text;
+            }
+            break;
+        default:
+            out[length++] = '?'; // Unknown conversion
+            break;
+        }
+    }
+    out[length++] = '\r';
+    out[length++] = '\n';
+    return length;
+}
+
+void logDrain() {
+    for (;;) {
+        if (lineSent < lineLength) {
+            int room = Serial.availableForWrite();
+            if (room <= 0) {
+                return; // UART busy; continue from here on the next loop()
+            }
+            size_t count = lineLength - lineSent;
+            if (count > static_cast<size_t>(room)) {
+                count = room;
+            }
+            const size_t written = Serial.write(reinterpret_cast<const uint8_t *>(line) + lineSent, count);
+            if (written == 0) {
+                return;
+            }
+            lineSent += written;
+            continue;
+        }
+
+        LogRecord record;
+        const uint32_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != droppedReported) {
+            record = {static_cast<uint32_t>(millis()), "%u log records dropped", {lost - droppedReported}, LOG_LEVEL_WARN, 1};
+            droppedReported = lost;
+        } else if (!takeRecord(record)) {
+            return;
+        }
+        lineLength = formatRecord(record, line, sizeof(line));
+        lineSent = 0;
+    }
+}
+
+uint32_t logDroppedRecords() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+bool logPending() {
+    return lineSent < lineLength || tail.load(std::memory_order_relaxed) != head ||
+           dropped.load(std::memory_order_relaxed) != droppedReported;
+}
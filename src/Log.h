@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "Config.h"
+
+// Deferred, allocation-free serial log.
+// LOG_INFO("Scheduled time set to: %u seconds.", seconds) copies the format pointer and up to four
+// integer arguments into a fixed record in a RAM ring and returns; nothing is formatted or written to
+// the UART there. loop() calls logDrain(), which formats the oldest records and gives Serial only as
+// many bytes as its transmit buffer takes, so no caller ever waits on the 115200-baud line.
+//
+// Any task may log (the ring is multi-producer, lock-free); only loop() drains. The format is kept by
+// pointer, so it must be a string literal, and so must %s arguments. Conversions:
+//   %u unsigned, %d signed, %.Nf an integer in units of 10^-N printed with N decimals (formatFixed),
+//   %t epoch seconds as "YYYY-MM-DD HH:MM:SS", %s a string literal, %% a percent sign.
+// Each line goes out as "<millis> <D|I|W|E> <message>".
+
+const size_t logMaxArgs = 4;
+
+struct LogRecord {
+    uint32_t millis;           // When it was logged
+    const char *format;        // String literal
+    uintptr_t args[logMaxArgs];
+    uint8_t level;             // LOG_LEVEL_*
+    uint8_t argCount;
+};
+
+// Queue one record; false (and counted in logDroppedRecords()) if the ring is full
+bool logWrite(uint8_t level, const char *format, const uintptr_t *args, size_t argCount);
+
+// Format and write queued records while Serial can take them without blocking (loop() only)
+void logDrain();
+
+// Records (or the rest of a line) still waiting for the UART after logDrain() (loop() only)
+bool logPending();
+
+uint32_t logDroppedRecords(); // Records lost to a full ring since boot
+
+inline uintptr_t logArgument(const char *text) {
+    return reinterpret_cast<uintptr_t>(text);
+}
+
+template <typename T>
+inline uintptr_t logArgument(T value) {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Log arguments are integers (scale fractions for %.Nf)");
+    return static_cast<uintptr_t>(value); // Signed values sign-extend and read back through %d
+}
+
+template <typename... Args>
+inline void logRecord(uint8_t level, const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= logMaxArgs, "At most four log arguments");
+    const uintptr_t values[sizeof...(Args) + 1] = {logArgument(args)...};
+    logWrite(level, format, values, sizeof...(Args));
+}
+
+// The level test is a constant, so filtered records (and their arguments) compile to nothing
+#define LOG_AT(level, ...) do { if ((level) >= LOG_LEVEL) { logRecord((level), __VA_ARGS__); } } while (0)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
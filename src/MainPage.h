@@ -0,0 +1,160 @@
+#pragma once
+
+// Generated by tools/build_page.py from web/index.html. Do not edit.
+// 14227 bytes of HTML, 7137 minified, 2342 gzipped.
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t MAIN_PAGE_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x59, 0xdd, 0x72, 0xdb, 0xb8,
+    0x15, 0xbe, 0xf7, 0x53, 0x20, 0x4c, 0x52, 0x51, 0x5d, 0x91, 0xa2, 0x64, 0xcb, 0xf5, 0x4a, 0x96,
+    0xdc, 0x6c, 0xe2, 0x9d, 0xf5, 0x4e, 0xfe, 0x66, 0xed, 0xb6, 0xd3, 0xc9, 0x64, 0xc6, 0x10, 0x09,
+    0x49, 0x48, 0x48, 0x82, 0x05, 0x41, 0xff, 0x44, 0xd5, 0xdd, 0xb6, 0xb7, 0xbd, 0xd9, 0xcb, 0xce,
+    0xf4, 0x35, 0xfa, 0x3c, 0x7d, 0x81, 0xf6, 0x11, 0x7a, 0x0e, 0x40, 0x4a, 0xa0, 0x24, 0xcb, 0xce,
+    0x26, 0xe3, 0x49, 0x48, 0x1e, 0x1c, 0x9c, 0xf3, 0x9d, 0x7f, 0xc0, 0x3e, 0x7e, 0xf4, 0xe2, 0xcd,
+    0xf3, 0x8b, 0x3f, 0xbf, 0x3d, 0x25, 0x33, 0x95, 0xc4, 0xa3, 0xbd, 0x63, 0x7c, 0x90, 0x98, 0xa6,
+    0xd3, 0xa1, 0xc3, 0x52, 0x07, 0x09, 0x8c, 0x46, 0xf0, 0x48, 0x98, 0xa2, 0x24, 0x9c, 0x51, 0x99,
+    0x33, 0x35, 0x74, 0xfe, 0x70, 0xf1, 0xbd, 0x77, 0xe4, 0x54, 0xe4, 0x94, 0x26, 0x6c, 0xe8, 0x5c,
+    0x71, 0x76, 0x9d, 0x09, 0xa9, 0x1c, 0x12, 0x8a, 0x54, 0xb1, 0x14, 0xd8, 0xae, 0x79, 0xa4, 0x66,
+    0xc3, 0x88, 0x5d, 0xf1, 0x90, 0x79, 0xfa, 0xa3, 0x45, 0x78, 0xca, 0x15, 0xa7, 0xb1, 0x97, 0x87,
+    0x34, 0x66, 0xc3, 0x8e, 0x1f, 0xa0, 0x18, 0xc5, 0x55, 0xcc, 0x46, 0x67, 0xe2, 0x82, 0xbc, 0xe4,
+    0xd3, 0x99, 0x22, 0xdf, 0x15, 0xf1, 0x98, 0x3c, 0x07, 0x31, 0x52, 0xc4, 0xc7, 0x6d, 0xb3, 0xba,
+    0x77, 0x9c, 0xab, 0x5b, 0x78, 0x8e, 0x45, 0x74, 0x3b, 0x9f, 0xc0, 0x9a, 0x37, 0xa1, 0x09, 0x8f,
+    0x6f, 0xfb, 0xcf, 0x24, 0xc8, 0x6b, 0xe5, 0x34, 0xcd, 0xbd, 0x9c, 0x49, 0x3e, 0x19, 0x8c, 0x69,
+    0xf8, 0x71, 0x2a, 0x45, 0x91, 0x46, 0xfd, 0xc7, 0x9d, 0x2e, 0xfe, 0x0c, 0x42, 0x11, 0x0b, 0xd9,
+    0x7f, 0x3c, 0x99, 0x4c, 0x06, 0x09, 0x95, 0x53, 0x9e, 0xf6, 0x83, 0x41, 0x46, 0xa3, 0x88, 0xa7,
+    0xd3, 0x7e, 0x37, 0xc8, 0x6e, 0x16, 0x3e, 0x82, 0xa6, 0x3c, 0x65, 0x72, 0x9e, 0xd0, 0x1b, 0x03,
+    0xb6, 0x7f, 0x14, 0xc0, 0x52, 0xb5, 0x81, 0x16, 0x4a, 0xd4, 0xf6, 0xd4, 0xf5, 0x30, 0xfc, 0x19,
+    0x8c, 0x85, 0x8c, 0x98, 0xf4, 0x24, 0x8d, 0x78, 0x91, 0xf7, 0x8f, 0x90, 0x49, 0xdc, 0x78, 0xf9,
+    0x8c, 0x46, 0xe2, 0xba, 0x1f, 0x90, 0x83, 0xec, 0x86, 0xe0, 0x56, 0x22, 0xa7, 0x63, 0xea, 0x06,
+    0x2d, 0xfd, 0xe3, 0xef, 0x37, 0x17, 0xb3, 0xce, 0x5c, 0xb1, 0x1b, 0xe5, 0xd1, 0x98, 0x4f, 0xd3,
+    0x7e, 0x08, 0xde, 0x63, 0x72, 0xa0, 0x8d, 0xcc, 0xf9, 0x27, 0xd6, 0xef, 0xfa, 0x3d, 0x96, 0x94,
+    0x40, 0xbc, 0xb1, 0x50, 0x4a, 0x24, 0x25, 0xec, 0x84, 0x6a, 0x0a, 0xb8, 0x24, 0xe2, 0x79, 0x16,
+    0xd3, 0xdb, 0xfe, 0x24, 0x66, 0x37, 0x03, 0xfc, 0xcf, 0x8b, 0xb8, 0x64, 0xa1, 0xe2, 0x22, 0xed,
+    0x4b, 0x71, 0xbd, 0xf0, 0x63, 0x36, 0x51, 0x1e, 0x38, 0xa2, 0x48, 0xd2, 0xb9, 0xb1, 0xaf, 0xdb,
+    0x7b, 0xba, 0xb4, 0xa8, 0xa3, 0xc5, 0x49, 0x74, 0x7f, 0x9d, 0xe9, 0x77, 0x1b, 0x4c, 0x63, 0x88,
+    0x8e, 0x17, 0x9a, 0xe8, 0xb4, 0xfc, 0x3c, 0x9c, 0xb1, 0xa8, 0x88, 0x61, 0x79, 0x5e, 0x7a, 0x4a,
+    0x5b, 0x18, 0x0c, 0x76, 0x01, 0x32, 0x1a, 0x06, 0xda, 0x5c, 0x8f, 0x2b, 0x96, 0xe4, 0xa5, 0xd1,
+    0x10, 0x08, 0x2e, 0xc3, 0x22, 0xa6, 0xd2, 0x1b, 0x17, 0x60, 0x67, 0x5a, 0x0a, 0xf5, 0x94, 0xc8,
+    0xb4, 0xfa, 0x15, 0x96, 0x1e, 0x7c, 0x58, 0x2e, 0xc2, 0xb5, 0xb0, 0x90, 0x39, 0xc4, 0x39, 0x13,
+    0x5c, 0x3b, 0xd0, 0x0e, 0xd0, 0x41, 0x48, 0x27, 0xbd, 0xa0, 0x0c, 0x50, 0x3f, 0x15, 0xe9, 0x7a,
+    0xb0, 0x7a, 0xc1, 0xd3, 0x81, 0xb1, 0xf8, 0x10, 0x45, 0xcd, 0x18, 0xba, 0xc2, 0xbc, 0xd7, 0x2c,
+    0xd9, 0xc4, 0x3c, 0xf8, 0x50, 0xe4, 0x8a, 0x4f, 0x6e, 0xbd, 0x32, 0xf1, 0x2b, 0xb2, 0x92, 0x90,
+    0x93, 0x5c, 0xdb, 0xbb, 0x42, 0xe2, 0xe9, 0x54, 0x24, 0xfe, 0x7e, 0x4e, 0x18, 0xcd, 0x59, 0x4b,
+    0x33, 0x4d, 0x84, 0x4c, 0x88, 0xdf, 0x35, 0xa4, 0x0d, 0x17, 0xf4, 0x67, 0xe2, 0x0a, 0xf2, 0xb2,
+    0x66, 0x4d, 0x8f, 0x06, 0x07, 0xdf, 0x2e, 0x78, 0x9a, 0x15, 0xea, 0x9d, 0xba, 0xcd, 0xa0, 0xfe,
+    0x40, 0xce, 0x94, 0x39, 0xef, 0xd7, 0xfd, 0xb5, 0xf0, 0xf3, 0x62, 0x9c, 0x70, 0x75, 0x97, 0x3b,
+    0x3f, 0xcb, 0x47, 0x7a, 0x87, 0x71, 0x52, 0x27, 0xb0, 0xbc, 0x74, 0xb0, 0xc5, 0xf9, 0x0f, 0xb1,
+    0xde, 0x8e, 0x5f, 0x77, 0x03, 0xeb, 0xdd, 0x76, 0xfb, 0x79, 0xcc, 0x11, 0x56, 0x4c, 0xc7, 0x2c,
+    0xde, 0xac, 0x9c, 0xe5, 0x7a, 0x02, 0x96, 0x42, 0x39, 0xd7, 0x6b, 0x63, 0x3d, 0x5a, 0x79, 0x46,
+    0xa1, 0x3d, 0x8d, 0x99, 0xba, 0x66, 0x2c, 0x5d, 0x59, 0xf7, 0x74, 0xa1, 0xe8, 0x38, 0x66, 0xf3,
+    0x15, 0x61, 0xb0, 0xea, 0x0c, 0xfa, 0xb3, 0xf4, 0x0d, 0x98, 0x14, 0xd3, 0x2c, 0x67, 0xfd, 0xea,
+    0x65, 0xb0, 0x1e, 0x02, 0xe8, 0x7b, 0x2a, 0x9a, 0xdb, 0x45, 0x54, 0xf9, 0xb8, 0x03, 0x95, 0x92,
+    0x0b, 0x00, 0x4b, 0x1e, 0xef, 0xef, 0xef, 0x0f, 0x76, 0xf5, 0x80, 0xce, 0x81, 0x96, 0x54, 0x73,
+    0x07, 0xec, 0x59, 0x28, 0xac, 0x7e, 0xa2, 0x20, 0x5e, 0x6a, 0xe6, 0x85, 0x33, 0x1e, 0x47, 0x2e,
+    0xbb, 0x62, 0x69, 0x73, 0xbe, 0xd9, 0x9e, 0x16, 0xbf, 0x4f, 0x58, 0xc4, 0x29, 0x71, 0xd7, 0x5a,
+    0x5c, 0x73, 0x6e, 0xb5, 0x3f, 0xbb, 0xbe, 0xb0, 0x2f, 0x59, 0x21, 0x62, 0x49, 0x69, 0x8a, 0x85,
+    0x0a, 0xc3, 0x66, 0x1c, 0x55, 0x35, 0xd6, 0xc5, 0x16, 0x35, 0x87, 0x77, 0xaa, 0x39, 0xd8, 0xd0,
+    0xe2, 0x07, 0xa0, 0xc7, 0x6a, 0x6c, 0x5b, 0x5b, 0x47, 0xad, 0x9d, 0xb5, 0xb6, 0xf5, 0x2d, 0x1d,
+    0xa2, 0x4a, 0x4b, 0x4f, 0xb7, 0xf8, 0xb5, 0xce, 0x62, 0xf8, 0x7a, 0x56, 0x1e, 0xeb, 0x77, 0xcb,
+    0xb8, 0xc3, 0x8d, 0xe0, 0xd5, 0x9b, 0x8e, 0x89, 0xee, 0xbd, 0xd6, 0x1f, 0xdc, 0x69, 0x7d, 0xb0,
+    0x6e, 0x7d, 0xc7, 0x3f, 0x42, 0xeb, 0xb7, 0x43, 0x3d, 0xe8, 0x59, 0x25, 0xb7, 0x86, 0xa4, 0xbb,
+    0x01, 0xb5, 0x5b, 0x63, 0x38, 0xda, 0x82, 0xf4, 0xb8, 0x6d, 0x46, 0xea, 0xde, 0x71, 0xbb, 0x1c,
+    0xf3, 0xe8, 0x70, 0x78, 0x44, 0xfc, 0x8a, 0x84, 0x31, 0xcd, 0xf3, 0xa1, 0xb3, 0xc4, 0xac, 0x0f,
+    0x03, 0x9d, 0xf5, 0x21, 0xfd, 0x56, 0x8a, 0x0f, 0x10, 0x18, 0x10, 0xd0, 0xa9, 0xef, 0x5b, 0xc6,
+    0xcf, 0xa9, 0xd3, 0xad, 0xb0, 0x69, 0x89, 0x5d, 0xa2, 0x31, 0x0c, 0x9d, 0xcd, 0xdc, 0x77, 0x46,
+    0xe5, 0x11, 0x20, 0x07, 0xf1, 0xdd, 0xba, 0x18, 0x7b, 0x06, 0xa1, 0x1c, 0xdd, 0x09, 0x46, 0x17,
+    0x85, 0x4c, 0xc9, 0x9b, 0x94, 0x3c, 0x8b, 0x63, 0x0d, 0x0f, 0x36, 0x9a, 0x05, 0xb0, 0x4c, 0x3b,
+    0x92, 0xf0, 0x08, 0x34, 0x01, 0xd7, 0x9b, 0x14, 0x78, 0x9c, 0xa5, 0x91, 0x75, 0x77, 0x3b, 0xa3,
+    0xff, 0xfd, 0xeb, 0x97, 0xbf, 0x1f, 0xb7, 0xcd, 0x17, 0xba, 0x07, 0x34, 0x3f, 0x48, 0xbf, 0x98,
+    0x4e, 0x63, 0x66, 0x3c, 0xd3, 0xd9, 0xae, 0x5b, 0x73, 0x20, 0x43, 0x67, 0xa7, 0xf6, 0x9f, 0xbf,
+    0x50, 0x7b, 0xf7, 0x1e, 0xed, 0xdd, 0xaf, 0xaf, 0x5d, 0xfb, 0x7e, 0x32, 0x79, 0x88, 0xf3, 0x27,
+    0x93, 0xfb, 0xbc, 0xff, 0xb7, 0x9d, 0x08, 0x56, 0x67, 0x8e, 0xa5, 0xfe, 0xe5, 0x92, 0x35, 0x19,
+    0x9c, 0xd1, 0xb9, 0x61, 0x2c, 0x9d, 0x72, 0xc1, 0x13, 0x46, 0xdc, 0x9c, 0x01, 0xf6, 0x28, 0x6f,
+    0xf6, 0x57, 0xf8, 0xf4, 0x1c, 0x25, 0xf6, 0x1c, 0xd5, 0x58, 0x4b, 0x35, 0xec, 0x5c, 0xcb, 0x74,
+    0x08, 0x8c, 0x93, 0xa1, 0x03, 0x71, 0x83, 0xca, 0x1e, 0x3a, 0x87, 0x81, 0x43, 0xae, 0x68, 0x5c,
+    0xc0, 0x96, 0x9e, 0x43, 0x44, 0xaa, 0x65, 0x0c, 0x9d, 0x22, 0x8b, 0xa8, 0x62, 0x95, 0xde, 0x3f,
+    0x22, 0x83, 0xdb, 0x5c, 0xab, 0x81, 0xfa, 0x74, 0xc2, 0x45, 0x98, 0x41, 0xe9, 0x08, 0x32, 0x46,
+    0x3f, 0xcb, 0xcf, 0xc3, 0x60, 0xf9, 0x6d, 0x79, 0xc0, 0xc6, 0xf5, 0xc2, 0x8c, 0xb5, 0x95, 0x23,
+    0x0b, 0x29, 0xa1, 0x74, 0x3c, 0x0d, 0xcb, 0x19, 0xf5, 0x48, 0x69, 0x6a, 0xb5, 0xdf, 0x0a, 0x83,
+    0x19, 0xb4, 0x15, 0xcc, 0xa5, 0x84, 0xda, 0xfc, 0x75, 0x46, 0xff, 0xf9, 0xe7, 0x2f, 0xff, 0xfd,
+    0xf7, 0x3f, 0x36, 0x43, 0xb1, 0x19, 0x11, 0xbb, 0x01, 0xdf, 0x5f, 0xd7, 0x3f, 0xf0, 0x5c, 0x09,
+    0xc9, 0xe1, 0x0a, 0x40, 0x5e, 0x50, 0x45, 0xad, 0xf2, 0x46, 0x6c, 0x92, 0x81, 0x51, 0xe7, 0x8a,
+    0xaa, 0x22, 0x77, 0x76, 0x49, 0xa9, 0x60, 0xe8, 0xb6, 0x86, 0xcf, 0xb2, 0x89, 0x29, 0xa9, 0x3f,
+    0x46, 0x20, 0x9a, 0xc1, 0xed, 0x61, 0x66, 0xbe, 0x30, 0xf8, 0xab, 0x2f, 0x53, 0xa2, 0x04, 0xb5,
+    0xac, 0x53, 0xbb, 0xeb, 0xd4, 0xe7, 0xc6, 0xad, 0xc7, 0x63, 0x39, 0x72, 0x9f, 0x35, 0x57, 0xf4,
+    0xb7, 0xe2, 0x9a, 0x49, 0x4d, 0xfd, 0x53, 0x45, 0x6d, 0x6b, 0xdd, 0xed, 0x25, 0x12, 0x3d, 0x9b,
+    0xd1, 0x26, 0x48, 0x0a, 0xfa, 0x93, 0xb8, 0xce, 0x11, 0xb5, 0x2a, 0xbb, 0x6c, 0xbb, 0x02, 0x5e,
+    0xf7, 0x6a, 0xf9, 0xc8, 0x43, 0xc9, 0x33, 0x35, 0xda, 0x83, 0x08, 0xe6, 0x8a, 0xb0, 0x3c, 0xdb,
+    0xef, 0x9e, 0x65, 0x64, 0x48, 0x1a, 0x9d, 0x6f, 0xbb, 0x7e, 0xe7, 0xf0, 0xc8, 0x3f, 0xf0, 0x3b,
+    0x8d, 0xc1, 0x5e, 0xcc, 0x14, 0x31, 0x39, 0x77, 0x86, 0x6e, 0x81, 0xd0, 0x0f, 0xca, 0x2d, 0x90,
+    0x5a, 0xc6, 0xcf, 0xb7, 0xa8, 0x18, 0x76, 0x76, 0x02, 0xc3, 0x3e, 0xab, 0x51, 0xdf, 0xbd, 0x37,
+    0x54, 0x88, 0xa3, 0x3a, 0x67, 0x7f, 0x01, 0x4a, 0x9d, 0xed, 0xf4, 0x82, 0x4e, 0x81, 0x98, 0x16,
+    0x31, 0x48, 0x9e, 0x14, 0xa9, 0x9e, 0xc2, 0x64, 0x6b, 0x9a, 0x93, 0x79, 0xa9, 0x3a, 0xb7, 0xe9,
+    0xb0, 0x39, 0x12, 0x61, 0x91, 0x80, 0x0b, 0xfd, 0x29, 0x53, 0xa7, 0x31, 0xc3, 0xd7, 0xef, 0x6e,
+    0xcf, 0x22, 0x77, 0xbd, 0xc2, 0x9a, 0xbe, 0x4e, 0xdd, 0xc1, 0xde, 0xbd, 0x1b, 0xaa, 0xd4, 0x6f,
+    0xfa, 0x3c, 0x85, 0xe1, 0x74, 0x01, 0xe9, 0x01, 0x7a, 0xea, 0x7a, 0xbf, 0x21, 0x4e, 0x55, 0x01,
+    0xce, 0x60, 0x6f, 0x71, 0xb7, 0xd0, 0xd5, 0x40, 0x68, 0xfa, 0x22, 0x0d, 0x63, 0x1e, 0x7e, 0x04,
+    0x61, 0x60, 0xcf, 0x70, 0x04, 0x02, 0xd2, 0xe8, 0xb9, 0x48, 0x12, 0x9a, 0x46, 0x6e, 0x63, 0xc9,
+    0xd8, 0x68, 0xee, 0xc0, 0x68, 0xf7, 0xf8, 0xfb, 0x04, 0xae, 0x58, 0x1f, 0x28, 0xb2, 0xfb, 0x70,
+    0x91, 0xdd, 0xdd, 0x22, 0x57, 0x8d, 0xf8, 0x21, 0x56, 0x6b, 0xce, 0x9d, 0x02, 0xd7, 0x5a, 0xca,
+    0xa6, 0xd0, 0xaf, 0x96, 0x1d, 0x35, 0x74, 0x15, 0x53, 0xa3, 0x55, 0x17, 0x0c, 0x50, 0x17, 0x56,
+    0xc2, 0xda, 0x7b, 0x42, 0xf3, 0x6c, 0x99, 0xfe, 0x5d, 0x26, 0xf7, 0x2a, 0x7b, 0x0b, 0x19, 0x03,
+    0xcd, 0xac, 0x3d, 0x1a, 0x9a, 0x55, 0x72, 0x42, 0x2e, 0x67, 0x4a, 0x65, 0xfd, 0x76, 0xfb, 0xc9,
+    0xbc, 0x2c, 0xc6, 0x05, 0xbc, 0x96, 0xa2, 0x16, 0x27, 0x66, 0x14, 0x3c, 0x99, 0xeb, 0xe7, 0xe2,
+    0x92, 0xf4, 0x77, 0xf3, 0x5f, 0x02, 0x34, 0xa6, 0xc2, 0x99, 0x0b, 0xca, 0x9a, 0x7b, 0x3e, 0x34,
+    0x8c, 0xd4, 0x95, 0xc0, 0x07, 0x00, 0x98, 0xf1, 0x15, 0x9f, 0x10, 0xf7, 0x51, 0x45, 0xf2, 0xc5,
+    0x47, 0xc4, 0xa7, 0x66, 0x70, 0x93, 0x27, 0x29, 0xbb, 0x26, 0xa7, 0x52, 0x0a, 0xe9, 0x5e, 0xbe,
+    0x86, 0x5b, 0x8b, 0x90, 0x1f, 0xc9, 0x72, 0xeb, 0x35, 0xcd, 0x49, 0x2a, 0x14, 0x11, 0x1f, 0xfb,
+    0xe4, 0xc9, 0x7c, 0xb9, 0x3d, 0xd7, 0xdd, 0x14, 0xab, 0x64, 0x71, 0x89, 0x8e, 0xd9, 0x93, 0x0c,
+    0xa3, 0xba, 0xdc, 0xe7, 0x7f, 0xc8, 0x45, 0xea, 0xe2, 0x4a, 0x05, 0x06, 0x1b, 0xd6, 0x2a, 0x68,
+    0x22, 0x66, 0x7e, 0x2c, 0xa6, 0xae, 0xf3, 0x53, 0xa5, 0x68, 0x22, 0x45, 0x42, 0x4e, 0xcf, 0xdf,
+    0xee, 0x77, 0xfb, 0x4e, 0x8b, 0x20, 0x77, 0xb9, 0x3b, 0xa4, 0x68, 0x16, 0x43, 0x7c, 0xb8, 0xbf,
+    0xda, 0xad, 0x09, 0xae, 0xf3, 0x3d, 0x1a, 0x4d, 0xf4, 0x07, 0xee, 0xd3, 0x2f, 0x4d, 0x8d, 0x68,
+    0x19, 0x29, 0xed, 0x97, 0xd5, 0x84, 0xc0, 0x01, 0xe1, 0xae, 0x07, 0xe7, 0xb2, 0x3d, 0xab, 0x31,
+    0x9c, 0xe4, 0x3c, 0x0d, 0xd1, 0xfd, 0x65, 0x17, 0x5b, 0xfc, 0x26, 0xe6, 0x90, 0x8c, 0x40, 0xa8,
+    0x77, 0x41, 0xf4, 0xbb, 0x91, 0x83, 0x1d, 0x9a, 0x49, 0x6c, 0x80, 0x76, 0x9f, 0x3b, 0x21, 0x73,
+    0xd2, 0x38, 0x9b, 0x78, 0xaf, 0xe1, 0xee, 0xeb, 0xbd, 0x42, 0x4b, 0x1a, 0xfd, 0x1a, 0xc3, 0x02,
+    0x02, 0x3b, 0x5f, 0x58, 0xc1, 0x6b, 0xc1, 0x8e, 0x4a, 0xd6, 0xe2, 0xee, 0x48, 0xae, 0x45, 0x82,
+    0x0c, 0x21, 0xaf, 0xf6, 0x83, 0x03, 0xb4, 0xab, 0x0c, 0x85, 0x69, 0xb0, 0x8b, 0x07, 0xc5, 0xbd,
+    0xb1, 0x23, 0xee, 0x0d, 0xed, 0xcd, 0x7a, 0xf3, 0x5e, 0x8a, 0x2b, 0x91, 0x62, 0xa5, 0xb9, 0x0d,
+    0x5c, 0x44, 0xee, 0xcf, 0xc8, 0x05, 0x04, 0x67, 0xbe, 0x86, 0xab, 0xaa, 0x31, 0xfb, 0x2b, 0xec,
+    0xb8, 0xec, 0x57, 0xc3, 0xe4, 0xb8, 0x1a, 0x2b, 0xc8, 0xb7, 0x65, 0xee, 0xd8, 0x33, 0x67, 0xeb,
+    0xbc, 0xd9, 0x96, 0x0b, 0x03, 0x4b, 0x63, 0x5d, 0xa6, 0xd6, 0xad, 0xff, 0x83, 0x20, 0x43, 0x22,
+    0xba, 0xd6, 0x72, 0x13, 0x7f, 0x29, 0x10, 0x32, 0x37, 0x68, 0xad, 0x4d, 0xc6, 0xa6, 0x8d, 0xc3,
+    0x46, 0x8f, 0x7a, 0x52, 0x70, 0x57, 0xc9, 0xeb, 0x7e, 0xad, 0x04, 0x5f, 0x93, 0xba, 0x4c, 0xed,
+    0xea, 0x8c, 0xb0, 0xab, 0x25, 0x2e, 0xcf, 0x11, 0xd8, 0x89, 0xcb, 0x77, 0x33, 0x02, 0x7f, 0xb8,
+    0x78, 0xf5, 0x12, 0x76, 0x3a, 0x30, 0xea, 0x30, 0x0c, 0x96, 0xe5, 0x70, 0x55, 0x4e, 0xa7, 0x6a,
+    0x46, 0x46, 0x24, 0x58, 0x0b, 0x83, 0x3f, 0x11, 0xf2, 0x94, 0xa2, 0x35, 0x70, 0x98, 0xbf, 0xb5,
+    0x7b, 0x34, 0xe6, 0x9b, 0x05, 0x23, 0x94, 0x0c, 0xc6, 0x7d, 0x89, 0x04, 0x66, 0x87, 0x44, 0xfd,
+    0xc0, 0x53, 0x53, 0x7d, 0x09, 0x07, 0x9e, 0x68, 0x04, 0xed, 0x0e, 0x85, 0x61, 0x18, 0x18, 0xdc,
+    0x30, 0x95, 0x3e, 0x07, 0xad, 0xc8, 0x0a, 0x8e, 0x61, 0x5b, 0xc8, 0x78, 0xa7, 0xe8, 0xe8, 0x73,
+    0xd7, 0x1d, 0x8b, 0xdd, 0xbb, 0x16, 0xcb, 0x43, 0xef, 0x96, 0x95, 0x0c, 0xcf, 0x67, 0x25, 0xfd,
+    0xd2, 0x72, 0x17, 0xcd, 0x32, 0x1c, 0x06, 0xfa, 0x57, 0x25, 0x60, 0x83, 0x0e, 0x2b, 0xfc, 0x23,
+    0x2c, 0x86, 0x42, 0xfa, 0x22, 0x07, 0x80, 0x76, 0xc8, 0x87, 0x18, 0x4f, 0xed, 0x70, 0x41, 0x70,
+    0x46, 0xaf, 0x05, 0x59, 0xf5, 0x29, 0x1d, 0x5f, 0x42, 0xaf, 0x28, 0x8f, 0xf1, 0xdc, 0xa7, 0x71,
+    0xdd, 0x03, 0xcb, 0xce, 0x1a, 0x18, 0xaf, 0x78, 0x24, 0x1c, 0xb3, 0xd3, 0x2b, 0x80, 0x90, 0x5b,
+    0x79, 0xc3, 0x34, 0x01, 0x6b, 0x06, 0x1b, 0x04, 0x7e, 0x9c, 0x8b, 0x42, 0x42, 0xaa, 0x37, 0xda,
+    0x66, 0x09, 0x8b, 0xdc, 0xbc, 0xc1, 0x4c, 0x16, 0xa0, 0x05, 0x78, 0xb7, 0x54, 0xd6, 0x92, 0x89,
+    0x46, 0x91, 0x16, 0xf3, 0x12, 0x96, 0x19, 0x98, 0x07, 0x43, 0x96, 0x26, 0x99, 0x1e, 0xb1, 0x9a,
+    0xc3, 0x4e, 0x94, 0x32, 0x73, 0xc8, 0x8f, 0xe7, 0x6f, 0x5e, 0xfb, 0x19, 0xfe, 0x7d, 0x40, 0xff,
+    0xfa, 0x49, 0xf9, 0xe5, 0x48, 0xc0, 0x5c, 0x34, 0xe1, 0xc8, 0xa1, 0xc0, 0x70, 0x9c, 0x56, 0xc5,
+    0xf6, 0x0d, 0xe9, 0xa0, 0x0d, 0x9f, 0x59, 0xe2, 0xef, 0xb4, 0xb0, 0xf7, 0xbf, 0xba, 0xc0, 0x97,
+    0x58, 0xb6, 0x56, 0xf7, 0x0e, 0x17, 0xe8, 0x5b, 0xc9, 0x36, 0x0f, 0x60, 0x47, 0x67, 0x3b, 0x3c,
+    0x70, 0x67, 0x2d, 0xdb, 0xf7, 0x9c, 0xda, 0x39, 0x76, 0xef, 0xd2, 0x5c, 0x4f, 0x70, 0x84, 0x6b,
+    0xe9, 0x76, 0x79, 0x90, 0xbf, 0x96, 0x37, 0xfc, 0xfa, 0x6a, 0x59, 0x1f, 0x97, 0x65, 0x32, 0x6b,
+    0xbf, 0x5f, 0xf3, 0x34, 0x82, 0x14, 0xb5, 0x52, 0x02, 0x1d, 0xbe, 0x91, 0x48, 0x56, 0xee, 0xe7,
+    0x4c, 0x55, 0xd7, 0x08, 0x77, 0x4b, 0x60, 0x5a, 0xa4, 0x17, 0x04, 0x41, 0xbd, 0x9b, 0x95, 0x7f,
+    0xd0, 0xe1, 0x9f, 0x18, 0xde, 0xb0, 0xac, 0xb4, 0x4c, 0x75, 0x05, 0x61, 0x4e, 0xe2, 0x45, 0x0c,
+    0xd5, 0x18, 0x7a, 0x2c, 0x40, 0xda, 0x2b, 0x9d, 0xaf, 0x00, 0x0e, 0x9c, 0x52, 0xee, 0xf3, 0xec,
+    0xef, 0x4f, 0x30, 0x80, 0xe1, 0xcc, 0x09, 0x78, 0x60, 0xe5, 0xb7, 0xe4, 0x10, 0xd4, 0x06, 0xd5,
+    0xd4, 0xdd, 0x72, 0xb0, 0xc2, 0xae, 0x72, 0x06, 0x40, 0x4e, 0x58, 0x26, 0xc2, 0xd9, 0xab, 0x1c,
+    0x4f, 0x02, 0x46, 0x0d, 0x9c, 0x77, 0x7e, 0xf5, 0xf1, 0xea, 0xfe, 0x31, 0xbb, 0x3e, 0x3a, 0xf1,
+    0x9a, 0xba, 0x75, 0x74, 0xda, 0x87, 0x28, 0x9d, 0x17, 0x5f, 0x30, 0x48, 0xd6, 0x3d, 0x3e, 0x80,
+    0x3b, 0x63, 0x75, 0x5b, 0x84, 0xbb, 0x7a, 0x79, 0xb9, 0x34, 0x7f, 0xd0, 0xfb, 0x3f, 0x21, 0x79,
+    0x61, 0x09, 0xe1, 0x1b, 0x00, 0x00,
+};
+
+const size_t MAIN_PAGE_GZ_LENGTH = sizeof(MAIN_PAGE_GZ);
+const char MAIN_PAGE_ETAG[] = "\"3b25ec97c5a3722c\""; // Strong validator: hash of the gzipped bytes
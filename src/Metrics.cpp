@@ -0,0 +1,87 @@
+#include "Metrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+void MetricsWriter::begin(char *buffer, size_t capacity, size_t skipLines) {
+    out = buffer;
+    room = capacity;
+    used = 0;
+    skip = skipLines;
+    lineIndex = 0;
+    full = false;
+}
+
+void MetricsWriter::line(const char *format, ...) {
+    if (full) {
+        return;
+    }
+    if (lineIndex < skip) {
+        lineIndex++; // Sent in an earlier chunk
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(out + used, room - used, format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length >= room - used) {
+        full = true; // Retried at the start of the next chunk
+        return;
+    }
+    used += length;
+    lineIndex++;
+}
+
+void MetricsWriter::describe(const char *name, const char *type, const char *help) {
+    line("# HELP %s %s\n", name, help);
+    line("# TYPE %s %s\n", name, type);
+}
+
+void MetricsWriter::value(const char *name, const char *labels, uint64_t value) {
+    if (labels != nullptr) {
+        line("%s{%s} %llu\n", name, labels, (unsigned long long)value);
+    } else {
+        line("%s %llu\n", name, (unsigned long long)value);
+    }
+}
+
+void MetricsWriter::signedValue(const char *name, const char *labels, int64_t value) {
+    if (labels != nullptr) {
+        line("%s{%s} %lld\n", name, labels, (long long)value);
+    } else {
+        line("%s %lld\n", name, (long long)value);
+    }
+}
+
+void MetricsWriter::fixedValue(const char *name, const char *labels, uint64_t value, uint8_t decimals) {
+    uint64_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+    if (labels != nullptr) {
+        line("%s{%s} %llu.%0*llu\n", name, labels, (unsigned long long)(value / scale), (int)decimals,
+             (unsigned long long)(value % scale));
+    } else {
+        line("%s %llu.%0*llu\n", name, (unsigned long long)(value / scale), (int)decimals, (unsigned long long)(value % scale));
+    }
+}
+
+void MetricsWriter::histogram(const char *name, const char *labels, const LatencyHistogram &histogram) {
+    const double cyclesPerSecond = hal::cyclesPerMicrosecond() * 1e6;
+    const char *separator = labels != nullptr ? "," : "";
+    labels = labels != nullptr ? labels : "";
+    uint32_t cumulative = 0;
+    for (size_t bucket = 0; bucket + 1 < LatencyHistogram::buckets; bucket++) {
+        cumulative += histogram.bucketCount(bucket);
+        const double upper = (double)(1ULL << (LatencyHistogram::firstShift + bucket)) / cyclesPerSecond;
+        line("%s_bucket{%s%sle=\"%.3g\"} %lu\n", name, labels, separator, upper, (unsigned long)cumulative);
+    }
+    line("%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, separator, (unsigned long)histogram.count());
+    if (labels[0] != '\0') {
+        line("%s_sum{%s} %.9f\n", name, labels, histogram.sumCycles() / cyclesPerSecond);
+        line("%s_count{%s} %lu\n", name, labels, (unsigned long)histogram.count());
+    } else {
+        line("%s_sum %.9f\n", name, histogram.sumCycles() / cyclesPerSecond);
+        line("%s_count %lu\n", name, (unsigned long)histogram.count());
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Config.h"
+#include "hal/hal.h"
+
+// Latency histogram over cycle counts with fixed log2 buckets: bucket 0 holds intervals under
+// 2^firstShift cycles, bucket b those under 2^(firstShift + b), and the last bucket everything longer.
+// record() is a count-leading-zeros and a few adds, well under a microsecond.
+// One core records; another may read the counters for /metrics (each is a single aligned word, so a
+// reader sees a slightly stale histogram at worst).
+class LatencyHistogram {
+public:
+    static const size_t buckets = 24;
+    static const uint32_t firstShift = 8; // 256 cycles, about 1 us at 240 MHz
+
+    void record(uint32_t cycles) {
+        const uint32_t bits = cycles ? 32 - __builtin_clz(cycles) : 0; // Bit length, floor(log2) + 1
+        size_t index = bits <= firstShift ? 0 : bits - firstShift;
+        if (index >= buckets) {
+            index = buckets - 1;
+        }
+        counts[index]++;
+        total++;
+        sum += cycles;
+        if (cycles > longest) {
+            longest = cycles;
+        }
+    }
+
+    uint32_t bucketCount(size_t index) const { return counts[index]; }
+    uint32_t count() const { return total; }
+    uint64_t sumCycles() const { return sum; }
+    uint32_t maxCycles() const { return longest; }
+
+private:
+    uint32_t counts[buckets] = {};
+    uint32_t total = 0;
+    uint64_t sum = 0;
+    uint32_t longest = 0;
+};
+
+// Records the cycles between its construction and the end of the enclosing scope
+class CycleTimer {
+public:
+    explicit CycleTimer(LatencyHistogram &histogram) : target(histogram), start(hal::cycleCount()) {}
+    ~CycleTimer() { target.record(hal::cycleCount() - start); }
+
+private:
+    LatencyHistogram &target;
+    uint32_t start;
+};
+
+// Probes for hot paths; with METRICS_ENABLED 0 they compile to nothing.
+// METRICS_TIME times the rest of the enclosing scope (one per scope).
+#if METRICS_ENABLED
+#define METRICS_TIME(histogram) CycleTimer metricsScopeTimer(histogram)
+#define METRICS_COUNT(counter) ((counter)++)
+#else
+#define METRICS_TIME(histogram)
+#define METRICS_COUNT(counter)
+#endif
+
+// Writes the Prometheus text format a line at a time into one chunk buffer. Output longer than a
+// chunk is produced by making the same sequence of calls for every chunk: lines sent in earlier
+// chunks are skipped, and the first line that does not fit ends this one.
+class MetricsWriter {
+public:
+    void begin(char *buffer, size_t capacity, size_t skipLines);
+
+    // "# HELP" and "# TYPE" lines; type is counter, gauge or histogram
+    void describe(const char *name, const char *type, const char *help);
+
+    // name{labels} value; labels may be nullptr
+    void value(const char *name, const char *labels, uint64_t value);
+    void signedValue(const char *name, const char *labels, int64_t value);
+    void fixedValue(const char *name, const char *labels, uint64_t value, uint8_t decimals); // value in units of 10^-decimals
+
+    // _bucket lines with le in seconds, then _sum (seconds) and _count
+    void histogram(const char *name, const char *labels, const LatencyHistogram &histogram);
+
+    size_t length() const { return used; }
+    size_t lines() const { return lineIndex; } // Lines sent so far, the next chunk's skipLines
+
+private:
+    void line(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    char *out = nullptr;
+    size_t room = 0;
+    size_t used = 0;
+    size_t skip = 0;
+    size_t lineIndex = 0;
+    bool full = false;
+};
@@ -0,0 +1,84 @@
+#include "OvercurrentTrip.h"
+
+#include "WaveformCapture.h"
+#include "hal/hal.h"
+
+void OvercurrentTrip::begin(uint16_t zeroCounts, const Limits &tripLimits, uint64_t relayPins, WaveformCapture *waveformCapture) {
+    zero.store(zeroCounts, std::memory_order_relaxed);
+    limits = tripLimits;
+    outputs = relayPins;
+    capture = waveformCapture;
+}
+
+void OvercurrentTrip::relaysChanged(uint16_t mask) {
+    if (mask & ~relayMask.load(std::memory_order_relaxed)) {
+        inrushStarted.store(true, std::memory_order_release);
+    }
+    relayMask.store(mask, std::memory_order_relaxed);
+}
+
+void OvercurrentTrip::add(uint16_t raw) {
+    readings++;
+    if (resetRequested.load(std::memory_order_relaxed) && resetRequested.exchange(false, std::memory_order_acquire)) {
+        overReadings = 0;
+        heat = 0;
+        latched.store(false, std::memory_order_release);
+    }
+    if (inrushStarted.load(std::memory_order_relaxed) && inrushStarted.exchange(false, std::memory_order_acquire)) {
+        inrushLeft = limits.inrushReadings;
+    }
+    if (latched.load(std::memory_order_relaxed)) {
+        return; // Relays are open until reset
+    }
+
+    const int32_t centered = (int32_t)raw - zero.load(std::memory_order_relaxed);
+    const uint32_t distance = centered < 0 ? -centered : centered;
+    if (distance > peak) {
+        peak = distance;
+    }
+
+    // Instantaneous: a few consecutive readings over the peak limit
+    if (distance > limits.instantCounts && inrushLeft == 0) {
+        if (overReadings++ == 0) {
+            instantOnset = readings;
+        }
+        if (overReadings >= limits.instantReadings) {
+            trip(TripInstant, instantOnset);
+            return;
+        }
+    } else {
+        overReadings = 0;
+    }
+    if (inrushLeft > 0) {
+        inrushLeft--;
+    }
+
+    // I2t: heat above the continuous rating, cooling below it
+    heat += (int64_t)(distance * distance) - limits.pickupSquared;
+    if (heat <= 0) {
+        heat = 0;
+        heatOnset = readings + 1;
+        peak = 0;
+    } else if (heat > limits.heatLimit) {
+        trip(TripI2t, heatOnset);
+    }
+}
+
+// Open every relay output straight away, then latch and report
+void OvercurrentTrip::trip(Kind kind, uint32_t onsetReading) {
+    const uint64_t decided = hal::monotonicMicros();
+    hal::writeOutputs(0, outputs);
+    const uint64_t opened = hal::monotonicMicros();
+    latched.store(true, std::memory_order_release);
+
+    Fault fault;
+    fault.kind = kind;
+    fault.relays = relayMask.load(std::memory_order_relaxed);
+    fault.peakCounts = peak;
+    fault.detectReadings = readings - onsetReading + 1;
+    fault.openMicros = (uint32_t)(opened - decided);
+    fault.tripMicros = decided;
+    fault.captureId = capture != nullptr ? capture->captureNow(WaveformCapture::TriggerTrip) : 0;
+    faults.push(fault); // Dropped if loop() has four unread faults; the counters still show it
+    counts[kind].fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "SpscQueue.h"
+
+class WaveformCapture;
+
+// Overcurrent protection in the sampling path. The current sampler hands every base-rate reading to
+// add() from its timer, where two limits are checked against the distance from the zero reading:
+// - instantaneous: a number of consecutive readings beyond a peak limit (ignored for a while after a
+//   relay closes, while a cold filament draws its inrush);
+// - I2t: the running sum of (reading^2 - pickup^2), floored at 0, beyond a heat limit, so a moderate
+//   overload trips slowly and a heavy one quickly.
+// A trip opens every relay output from the timer itself (the sensor sees only the total current), then
+// latches: the control task keeps the relays open and refuses to close them until reset(). The fault
+// goes to loop() through a queue, with a waveform capture of the readings around it.
+// Not IRAM-safe: the timer runs from flash (esp_timer task) and reads through the ADC driver, so it
+// stops while a flash erase or write has the cache off (a sector erase: ~45 ms, up to 400 ms). A fault
+// starting then trips after the stall plus the detection time; detectReadings does not include the stall.
+class OvercurrentTrip {
+public:
+    enum Kind : uint8_t {
+        TripInstant, // Peak limit
+        TripI2t      // Heat limit
+    };
+
+    // Limits in ADC counts and readings
+    struct Limits {
+        uint16_t instantCounts;   // Distance from zero beyond which a reading is an instantaneous overcurrent
+        uint16_t instantReadings; // Consecutive such readings that trip
+        uint32_t inrushReadings;  // Readings after a relay closes during which the peak limit is ignored
+        uint32_t pickupSquared;   // Continuous rating, counts^2; heat builds above it
+        int64_t heatLimit;        // counts^2 x readings
+    };
+
+    struct Fault {
+        Kind kind;
+        uint16_t relays;         // Relays closed at the trip; all were opened
+        uint16_t peakCounts;     // Largest distance from zero between the onset and the trip
+        uint32_t detectReadings; // Readings from the first one over the limit to the trip, inclusive
+        uint32_t openMicros;     // Trip decision to relay outputs written, measured
+        uint64_t tripMicros;     // hal::monotonicMicros() at the decision
+        uint32_t captureId;      // Waveform capture around the trip, 0 if none was free
+    };
+
+    // relayPins: GPIO mask of every relay output. capture may be nullptr. Call before the sampler starts.
+    void begin(uint16_t zeroCounts, const Limits &limits, uint64_t relayPins, WaveformCapture *capture);
+
+    // Move the zero-current reading while running (any task)
+    void setZero(uint16_t zeroCounts) { zero.store(zeroCounts, std::memory_order_relaxed); }
+
+    // Control task: the relay mask after every change (starts the inrush allowance when one closes)
+    void relaysChanged(uint16_t mask);
+
+    // Timer context: one base-rate reading
+    void add(uint16_t raw);
+
+    // Latched since the last trip; the control task clears it with reset(), applied with the next reading
+    bool tripped() const { return latched.load(std::memory_order_acquire); }
+    void reset() { resetRequested.store(true, std::memory_order_release); }
+
+    // loop(): the next fault, if any
+    bool takeFault(Fault &fault) { return faults.pop(fault); }
+    bool faultWaiting() const { return faults.size() > 0; } // Any task
+
+    uint32_t trips(Kind kind) const { return counts[kind].load(std::memory_order_relaxed); }
+
+private:
+    void trip(Kind kind, uint32_t onsetReading);
+
+    Limits limits = {};
+    std::atomic<uint16_t> zero{2048};
+    uint64_t outputs = 0;
+    WaveformCapture *capture = nullptr;
+
+    // From the control task
+    std::atomic<uint16_t> relayMask{0};
+    std::atomic<bool> inrushStarted{false};
+    std::atomic<bool> resetRequested{false};
+    std::atomic<bool> latched{false};
+
+    // Timer context only
+    uint32_t readings = 0;      // Readings so far, for onset bookkeeping
+    uint32_t inrushLeft = 0;    // Readings before the peak limit applies again
+    uint16_t overReadings = 0;  // Consecutive readings beyond the peak limit
+    uint32_t instantOnset = 0;  // First of them
+    int64_t heat = 0;           // I2t accumulator
+    uint32_t heatOnset = 0;     // Reading at which heat last rose from 0
+    uint16_t peak = 0;          // Largest distance since heat last rose from 0
+
+    SpscQueue<Fault, 4> faults; // Timer -> loop()
+    std::atomic<uint32_t> counts[2] = {};
+};
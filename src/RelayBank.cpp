@@ -0,0 +1,43 @@
+#include "RelayBank.h"
+
+#include <Arduino.h>
+
+#include "hal/hal.h"
+
+void RelayBank::begin(const uint8_t *pins, size_t count) {
+    channelCount = count < maxChannels ? count : maxChannels;
+    channelMask = channelCount == 16 ? 0xffff : (uint16_t)((1u << channelCount) - 1);
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        pinMode(pins[channel], OUTPUT);
+    }
+    // Precompute the GPIO bits of every combination within each group of four channels
+    for (size_t group = 0; group < 4; group++) {
+        for (size_t value = 0; value < 16; value++) {
+            uint64_t bits = 0;
+            for (size_t bit = 0; bit < 4; bit++) {
+                size_t channel = group * 4 + bit;
+                if ((value & (1u << bit)) && channel < channelCount) {
+                    bits |= 1ULL << pins[channel];
+                }
+            }
+            nibbleBits[group][value] = bits;
+        }
+    }
+    state = 0;
+    hal::writeOutputs(0, gpioBits(channelMask)); // Known state: everything off
+}
+
+uint64_t RelayBank::gpioBits(uint16_t mask) const {
+    return nibbleBits[0][mask & 0xf] | nibbleBits[1][(mask >> 4) & 0xf] | nibbleBits[2][(mask >> 8) & 0xf] |
+           nibbleBits[3][mask >> 12];
+}
+
+void RelayBank::apply(uint16_t mask) {
+    mask &= channelMask;
+    const uint16_t rising = mask & ~state;
+    const uint16_t falling = state & ~mask;
+    if (rising | falling) {
+        hal::writeOutputs(gpioBits(rising), gpioBits(falling));
+    }
+    state = mask;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Table-driven relay channels. Channel n (0-based) drives pins[n] and is bit n of every mask;
+// the state of all channels is one bitmask. A change to any set of channels is translated to
+// GPIO set/clear masks with four nibble lookups and applied in one hal::writeOutputs() call,
+// so switching every relay costs the same as switching one, for 2 to 16 channels. The ESP32 has
+// separate set/clear registers for GPIO 0-31 and 32-39, so relays on pins in both banks change
+// bank by bank, a few cycles apart; keep them in one bank where they must switch together.
+class RelayBank {
+public:
+    static const size_t maxChannels = 16;
+
+    // Configure the pins as outputs and switch every relay off
+    void begin(const uint8_t *pins, size_t channelCount);
+
+    // Switch to exactly the channels in mask (bits beyond the channel count are ignored)
+    void apply(uint16_t mask);
+
+    void turnOn(uint16_t mask) { apply(state | mask); }
+    void turnOff(uint16_t mask) { apply(state & ~mask); }
+    void toggle(uint16_t mask) { apply(state ^ mask); }
+    void transform(uint16_t clear, uint16_t flip) { apply((state & ~clear) ^ flip); } // Off, then toggle: any mix at once
+
+    uint16_t mask() const { return state; }
+    uint16_t allChannels() const { return channelMask; }
+    size_t channels() const { return channelCount; }
+    uint64_t outputPins() const { return gpioBits(channelMask); } // GPIO mask of every relay output
+
+private:
+    uint64_t gpioBits(uint16_t mask) const; // GPIO mask for a channel mask
+
+    size_t channelCount = 0;
+    uint16_t channelMask = 0;
+    uint16_t state = 0;
+    uint64_t nibbleBits[4][16] = {}; // GPIO bits for each value of each 4-channel group
+};
@@ -0,0 +1,57 @@
+#include "RouteTable.h"
+
+#include <string.h>
+
+static const char *const methodNames[] = {"GET", "POST", "PUT", "DELETE"}; // By HttpMethod
+
+int RouteTable::find(HttpMethod method, const char *path) const {
+    const size_t length = strlen(path);
+    int index = lookup(method, path, length, false);
+    for (size_t i = 0; index < 0 && i < prefixLengthCount; i++) {
+        if (prefixLengths[i] <= length) {
+            index = lookup(method, path, prefixLengths[i], true);
+        }
+    }
+    return index;
+}
+
+uint8_t RouteTable::allowedMethods(const char *path) const {
+    uint8_t methods = 0;
+    for (uint8_t method = 0; method < HttpMethodCount; method++) {
+        if (find((HttpMethod)method, path) >= 0) {
+            methods |= 1u << method;
+        }
+    }
+    return methods;
+}
+
+// The one route that can have this key, if it really does
+int RouteTable::lookup(HttpMethod method, const char *path, size_t length, bool prefixOnly) const {
+    const uint8_t index = slots[hash(seed, method, path, length) & (slotCount - 1)];
+    if (index == emptySlot) {
+        return -1;
+    }
+    const Route &route = routes[index];
+    if (route.method != method || lengths[index] != length || (prefixOnly && !route.prefix) ||
+        memcmp(route.path, path, length) != 0) {
+        return -1;
+    }
+    return index;
+}
+
+const char *RouteTable::methodName(HttpMethod method) {
+    return method < HttpMethodCount ? methodNames[method] : "";
+}
+
+HttpMethod RouteTable::parseMethod(const char *name) {
+    for (uint8_t method = 0; method < HttpMethodCount; method++) {
+        if (strcmp(name, methodNames[method]) == 0) {
+            return (HttpMethod)method;
+        }
+    }
+    return HttpMethodCount;
+}
+
+void RouteTable::duplicateRoute() {}
+void RouteTable::noPerfectHash() {}
+void RouteTable::tooManyPrefixLengths() {}
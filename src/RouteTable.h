@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Config.h"
+
+// Request methods routes are registered for
+enum HttpMethod : uint8_t { HttpGet, HttpPost, HttpPut, HttpDelete, HttpMethodCount };
+
+typedef void (*RouteHandler)();
+
+// One route: an exact path, or (prefix) every path starting with it, for one method. A prefix route's
+// handler parses the rest of the path from HttpServer::uri().
+struct Route {
+    HttpMethod method;
+    const char *path;
+    bool prefix;
+    RouteHandler handler;
+};
+
+// Route table built by the compiler: a perfect hash over method + path, so looking up a request costs
+// one hash and one compare however many routes there are (plus one more per distinct prefix length
+// when no exact route matches). The constructor searches for a hash seed under which every route has
+// a slot of its own. Declared constexpr, that search runs at compile time and the table lands in
+// flash; two routes with the same method and path, or a seed search that gives up, stop the build.
+// An exact route wins over a prefix one, a longer prefix over a shorter one.
+class RouteTable {
+public:
+    static_assert(HTTP_MAX_ROUTES < 64, "HTTP_MAX_ROUTES must be below 64");
+
+    static const size_t capacity = HTTP_MAX_ROUTES;
+    static const size_t maxPrefixLengths = 4;  // Distinct prefix lengths, each one a lookup on a miss
+
+    template <size_t N>
+    constexpr explicit RouteTable(const Route (&list)[N]) {
+        static_assert(N <= capacity, "More routes than HTTP_MAX_ROUTES");
+        for (size_t i = 0; i < N; i++) {
+            routes[i] = list[i];
+            lengths[i] = (uint8_t)textLength(list[i].path);
+            for (size_t j = 0; j < i; j++) {
+                if (routes[j].method == routes[i].method && sameText(routes[j].path, routes[i].path)) {
+                    duplicateRoute();
+                }
+            }
+            if (routes[i].prefix) {
+                addPrefixLength(lengths[i]);
+            }
+        }
+        count = N;
+        while (!placeRoutes()) {
+            if (++seed == maxSeed) {
+                noPerfectHash();
+                count = 0; // Built at run time after all: no routes rather than wrong ones
+                placeRoutes();
+                return;
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+    const Route &operator[](size_t index) const { return routes[index]; }
+
+    // The route for a request (index into the table), -1 if none
+    int find(HttpMethod method, const char *path) const;
+
+    // Methods with a route for this path, bit n = HttpMethod n (for 405 and the Allow header)
+    uint8_t allowedMethods(const char *path) const;
+
+    static const char *methodName(HttpMethod method);
+    static HttpMethod parseMethod(const char *name); // HttpMethodCount if it is none of them
+
+private:
+    static const size_t slotCount = capacity <= 16 ? 64 : capacity <= 32 ? 128 : 256; // At least 4x the routes
+    static const uint8_t emptySlot = 0xff;
+    static const uint32_t maxSeed = 100000;
+
+    // FNV-1a over the method and the first length bytes of path, mixed with the seed
+    static constexpr uint32_t hash(uint32_t seed, HttpMethod method, const char *path, size_t length) {
+        uint32_t value = (2166136261u ^ seed) * 16777619u;
+        value = (value ^ method) * 16777619u;
+        for (size_t i = 0; i < length; i++) {
+            value = (value ^ (uint8_t)path[i]) * 16777619u;
+        }
+        return value ^ value >> 15;
+    }
+
+    static constexpr size_t textLength(const char *text) {
+        size_t length = 0;
+        while (text[length] != '\0') {
+            length++;
+        }
+        return length;
+    }
+
+    static constexpr bool sameText(const char *a, const char *b) {
+        while (*a != '\0' && *a == *b) {
+            a++;
+            b++;
+        }
+        return *a == *b;
+    }
+
+    // Longest first, so the longest matching prefix wins
+    constexpr void addPrefixLength(uint8_t length) {
+        size_t at = 0;
+        while (at < prefixLengthCount && prefixLengths[at] > length) {
+            at++;
+        }
+        if (at < prefixLengthCount && prefixLengths[at] == length) {
+            return;
+        }
+        if (prefixLengthCount == maxPrefixLengths) {
+            tooManyPrefixLengths();
+        }
+        for (size_t i = prefixLengthCount; i > at; i--) {
+            prefixLengths[i] = prefixLengths[i - 1];
+        }
+        prefixLengths[at] = length;
+        prefixLengthCount++;
+    }
+
+    // Every route into its own slot under the current seed; false on the first collision
+    constexpr bool placeRoutes() {
+        for (size_t slot = 0; slot < slotCount; slot++) {
+            slots[slot] = emptySlot;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const size_t slot = hash(seed, routes[i].method, routes[i].path, lengths[i]) & (slotCount - 1);
+            if (slots[slot] != emptySlot) {
+                return false;
+            }
+            slots[slot] = (uint8_t)i;
+        }
+        return true;
+    }
+
+    int lookup(HttpMethod method, const char *path, size_t length, bool prefixOnly) const;
+
+    // Not constexpr: reaching one of these while building a constexpr table is a compile error naming it
+    static void duplicateRoute();
+    static void noPerfectHash();
+    static void tooManyPrefixLengths();
+
+    Route routes[capacity] = {};
+    uint8_t lengths[capacity] = {};
+    size_t count = 0;
+    uint32_t seed = 0;
+    uint8_t slots[slotCount] = {};
+    uint8_t prefixLengths[maxPrefixLengths] = {};
+    size_t prefixLengthCount = 0;
+};
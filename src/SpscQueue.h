@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// Exactly one thread (task, core) may call push() and exactly one other may call pop().
+// Only std::atomic is used, so the same code runs between the ESP32 cores and between
+// threads on the host. Indices increase monotonically and wrap through the power-of-two mask.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    // Producer side: copy item in; returns false (and leaves the queue unchanged) when full
+    bool push(const T &item) {
+        const size_t head = writeIndex.load(std::memory_order_relaxed);
+        if (head - readIndex.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[head & (Capacity - 1)] = item;
+        writeIndex.store(head + 1, std::memory_order_release); // Publish the slot contents
+        return true;
+    }
+
+    // Consumer side: copy the oldest item out; returns false when empty
+    bool pop(T &item) {
+        const size_t tail = readIndex.load(std::memory_order_relaxed);
+        if (writeIndex.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        item = slots[tail & (Capacity - 1)];
+        readIndex.store(tail + 1, std::memory_order_release); // Hand the slot back to the producer
+        return true;
+    }
+
+    // Approximate when called concurrently; exact from either side for its own view
+    size_t size() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    T slots[Capacity] = {};
+    std::atomic<size_t> writeIndex{0}; // Next slot the producer fills
+    std::atomic<size_t> readIndex{0};  // Next slot the consumer empties
+};
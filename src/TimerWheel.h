@@ -0,0 +1,194 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hashed timing wheel: a fixed pool of timers hashed by deadline into Slots buckets of one tick each.
+// Buckets are intrusive doubly linked lists through the pool, so schedule() and cancel() are O(1)
+// and advancing one tick only looks at the timers in that tick's bucket. Timers further out than
+// one revolution simply stay in their bucket until a later pass reaches their deadline.
+// Ticks are a free-running uint32_t; deadlines are compared with wraparound-safe arithmetic.
+template <typename T, size_t Capacity, size_t Slots>
+class TimerWheel {
+public:
+    static_assert(Capacity > 0 && Capacity < 0xffff, "Timer pool indices are 16-bit");
+    static_assert(Slots > 0, "Timer wheel needs at least one slot");
+
+    TimerWheel() {
+        for (size_t i = 0; i < Slots; i++) {
+            slots[i] = none;
+        }
+        for (size_t i = 0; i < Capacity; i++) {
+            nodes[i].next = i + 1 < Capacity ? i + 1 : none; // Everything starts on the free list
+        }
+        freeList = 0;
+    }
+
+    // Arm a timer delayTicks from now (at least the next tick). Returns its id, or 0 if the pool is full.
+    uint32_t schedule(uint32_t delayTicks, const T &payload) {
+        if (freeList == none) {
+            return 0;
+        }
+        const uint16_t index = freeList;
+        Node &node = nodes[index];
+        freeList = node.next;
+        node.used = true;
+        node.generation++;
+        node.payload = payload;
+        link(index, currentTick + (delayTicks > 0 ? delayTicks : 1));
+        count++;
+        return makeId(index);
+    }
+
+    // Disarm a timer; false if the id is unknown or the timer already fired
+    bool cancel(uint32_t id) {
+        Node *node = find(id);
+        if (node == nullptr) {
+            return false;
+        }
+        const uint16_t index = static_cast<uint16_t>(node - nodes);
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    // Move an armed timer to delayTicks from now (at least the next tick); false if the id is unknown
+    // or the timer already fired
+    bool reschedule(uint32_t id, uint32_t delayTicks) {
+        Node *node = find(id);
+        if (node == nullptr) {
+            return false;
+        }
+        const uint16_t index = static_cast<uint16_t>(node - nodes);
+        unlink(index);
+        link(index, currentTick + (delayTicks > 0 ? delayTicks : 1));
+        return true;
+    }
+
+    // Process every tick up to nowTick. For each expired timer, onExpire(id, payload, deadline) runs;
+    // returning true re-arms the timer at the (possibly updated) deadline, false frees it.
+    // After a stall longer than one revolution every bucket is visited once, so nothing is missed.
+    // onExpire must not schedule or cancel other timers.
+    template <typename F>
+    void advance(uint32_t nowTick, F onExpire) {
+        const uint32_t startTick = currentTick;
+        uint32_t ticks = nowTick - startTick;
+        if (ticks > Slots) {
+            ticks = Slots;
+        }
+        for (uint32_t step = 1; step <= ticks; step++) {
+            const size_t slot = (startTick + step) % Slots;
+            uint16_t index = slots[slot];
+            while (index != none) {
+                Node &node = nodes[index];
+                const uint16_t next = node.next;
+                if (static_cast<int32_t>(node.deadline - nowTick) <= 0) {
+                    unlink(index);
+                    uint32_t deadline = node.deadline;
+                    if (onExpire(makeId(index), node.payload, deadline)) {
+                        link(index, static_cast<int32_t>(deadline - nowTick) > 0 ? deadline : nowTick + 1);
+                    } else {
+                        release(index);
+                    }
+                }
+                index = next;
+            }
+        }
+        currentTick = nowTick;
+    }
+
+    // Timer in pool position index (0 .. capacity() - 1), for walking all armed timers a few at a time;
+    // false if that position is free
+    bool at(size_t index, uint32_t &id, T &payload, uint32_t &deadline) const {
+        if (index >= Capacity || !nodes[index].used) {
+            return false;
+        }
+        id = makeId(index);
+        payload = nodes[index].payload;
+        deadline = nodes[index].deadline;
+        return true;
+    }
+
+    // Ticks from now until the earliest timer falls due, looking at most limitTicks (and one revolution)
+    // ahead: one bucket per tick, so keep the limit short. limitTicks if none is due within it.
+    uint32_t ticksToNext(uint32_t limitTicks) const {
+        if (count == 0) {
+            return limitTicks;
+        }
+        for (uint32_t step = 1; step <= limitTicks && step <= Slots; step++) {
+            const uint32_t tick = currentTick + step;
+            for (uint16_t index = slots[tick % Slots]; index != none; index = nodes[index].next) {
+                if (static_cast<int32_t>(nodes[index].deadline - tick) <= 0) {
+                    return step;
+                }
+            }
+        }
+        return limitTicks;
+    }
+
+    uint32_t now() const { return currentTick; }
+    size_t size() const { return count; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static const uint16_t none = 0xffff;
+
+    struct Node {
+        T payload;
+        uint32_t deadline;    // Absolute tick
+        uint16_t prev;
+        uint16_t next;        // Bucket list, or free list while unused
+        uint16_t generation;  // Bumped on every reuse so stale ids never match
+        bool used;
+    };
+
+    // Ids pack the generation above the pool index (+1, so 0 is never a valid id)
+    uint32_t makeId(size_t index) const {
+        return (static_cast<uint32_t>(nodes[index].generation) << 16) | (index + 1);
+    }
+
+    Node *find(uint32_t id) {
+        const size_t index = (id & 0xffff) - 1;
+        if (index >= Capacity || !nodes[index].used || nodes[index].generation != (id >> 16)) {
+            return nullptr;
+        }
+        return &nodes[index];
+    }
+
+    void link(uint16_t index, uint32_t deadline) {
+        Node &node = nodes[index];
+        uint16_t &head = slots[deadline % Slots];
+        node.deadline = deadline;
+        node.prev = none;
+        node.next = head;
+        if (head != none) {
+            nodes[head].prev = index;
+        }
+        head = index;
+    }
+
+    void unlink(uint16_t index) {
+        Node &node = nodes[index];
+        if (node.prev != none) {
+            nodes[node.prev].next = node.next;
+        } else {
+            slots[node.deadline % Slots] = node.next;
+        }
+        if (node.next != none) {
+            nodes[node.next].prev = node.prev;
+        }
+    }
+
+    void release(uint16_t index) {
+        nodes[index].used = false;
+        nodes[index].next = freeList;
+        freeList = index;
+        count--;
+    }
+
+    Node nodes[Capacity] = {};
+    uint16_t slots[Slots];
+    uint16_t freeList;
+    size_t count = 0;
+    uint32_t currentTick = 0;
+};
@@ -0,0 +1,74 @@
+#include "WallClock.h"
+
+#include "hal/hal.h"
+
+WallClock::Anchor WallClock::load() const {
+    Anchor anchor;
+    for (;;) {
+        const uint32_t before = version.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue; // sync() is part way through on the other core
+        }
+        anchor = {anchorMonotonic, anchorEpoch, anchorSlew, drift};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version.load(std::memory_order_relaxed) == before) {
+            return anchor;
+        }
+    }
+}
+
+// Anchor reading plus elapsed time, corrected for drift, plus as much of the slew as has run in
+int64_t WallClock::reading(const Anchor &anchor, uint64_t monotonic) {
+    const int64_t elapsed = static_cast<int64_t>(monotonic - anchor.monotonic);
+    const int64_t corrected = elapsed + (elapsed / 1000) * anchor.drift / 1000000; // ms * ppb, no overflow for years
+    int64_t slewed = elapsed / 1000 * slewPpm / 1000;
+    if (slewed > (anchor.slew < 0 ? -anchor.slew : anchor.slew)) {
+        slewed = anchor.slew < 0 ? -anchor.slew : anchor.slew;
+    }
+    return anchor.epoch + corrected + (anchor.slew < 0 ? -slewed : slewed);
+}
+
+int64_t WallClock::nowMicros() const {
+    return reading(load(), hal::monotonicMicros());
+}
+
+int64_t WallClock::sync(int64_t epochMicros) {
+    const uint64_t monotonic = hal::monotonicMicros();
+    const Anchor current = load();
+    const int64_t offset = epochMicros - reading(current, monotonic);
+    const bool step = syncs == 0 || offset > stepMicros || offset < -stepMicros;
+
+    // Rate error over the baseline: how far the reported time moved against the timer
+    int32_t newDrift = drift;
+    const uint64_t window = monotonic - baselineMonotonic;
+    if (step && syncs > 0) {
+        baselineMonotonic = monotonic; // The reported time jumped; measure afresh from here
+        baselineEpoch = epochMicros;
+    } else if (syncs == 0 || window >= driftWindowMicros) {
+        if (syncs > 0) {
+            const int64_t error = (epochMicros - baselineEpoch) - static_cast<int64_t>(window);
+            const int64_t measured = error * 1000 / static_cast<int64_t>(window / 1000000); // ppb
+            if (measured >= -maxDriftPpb && measured <= maxDriftPpb) {
+                newDrift = static_cast<int32_t>((drift + measured) / 2);
+            }
+        }
+        baselineMonotonic = monotonic;
+        baselineEpoch = epochMicros;
+    }
+
+    version.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_release);
+    anchorMonotonic = monotonic;
+    if (step) {
+        anchorEpoch = epochMicros;
+        anchorSlew = 0;
+        steps++;
+    } else {
+        anchorEpoch = reading(current, monotonic); // Carry on from the current reading, no jump
+        anchorSlew = offset;
+    }
+    drift = newDrift;
+    version.fetch_add(1, std::memory_order_release);
+    syncs++;
+    return offset;
+}
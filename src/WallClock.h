@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Wall clock anchored to the 64-bit monotonic timer (hal::monotonicMicros()), so it never wraps
+// the way millis() does after 49.7 days. Time is whatever local time the clients report.
+//
+// sync() takes a client's reading at any time, from any client:
+// - The first sync, or one that disagrees by more than stepMicros, steps the clock.
+// - Smaller offsets are slewed out at slewPpm, so the clock never jumps or runs backwards and
+//   consecutive history rows stay in order.
+// - Two syncs at least driftWindowMicros apart measure the oscillator's rate error. Half of each new
+//   measurement is folded into the running correction, which later readings apply.
+//
+// Readers on either core see a consistent anchor: sync() publishes it under a sequence counter.
+// Samples are stamped with seconds() (4 bytes); dates are only formatted when a response is encoded.
+class WallClock {
+public:
+    static const int64_t stepMicros = 2000000;             // Larger offsets step instead of slewing
+    static const int32_t slewPpm = 500;                    // 0.5 ms per second
+    static const uint64_t driftWindowMicros = 3600000000;  // Shortest baseline for a drift estimate
+    static const int32_t maxDriftPpb = 500000;             // Estimates beyond +-500 ppm are discarded
+
+    explicit WallClock(uint32_t defaultEpoch) : anchorEpoch(static_cast<int64_t>(defaultEpoch) * 1000000) {}
+
+    // Epoch time now, in microseconds and in whole seconds
+    int64_t nowMicros() const;
+    uint32_t seconds() const { return static_cast<uint32_t>(nowMicros() / 1000000); }
+
+    // Adopt a client's reading (epoch microseconds); returns the offset it corrected (reported minus
+    // the clock's reading before the sync). One writer (loop()).
+    int64_t sync(int64_t epochMicros);
+
+    bool synced() const { return syncs > 0; }
+    uint32_t syncCount() const { return syncs; }
+    uint32_t stepCount() const { return steps; }
+    int32_t driftPpb() const { return drift; } // Rate correction applied, parts per billion
+
+private:
+    struct Anchor {
+        uint64_t monotonic; // hal::monotonicMicros() at the anchor
+        int64_t epoch;      // Clock reading there
+        int64_t slew;       // Offset still to be slewed in from there
+        int32_t drift;      // Rate correction from there on
+    };
+
+    Anchor load() const;
+    static int64_t reading(const Anchor &anchor, uint64_t monotonic);
+
+    std::atomic<uint32_t> version{0}; // Odd while sync() rewrites the anchor
+    uint64_t anchorMonotonic = 0;
+    int64_t anchorEpoch;
+    int64_t anchorSlew = 0;
+    int32_t drift = 0;
+
+    // Drift baseline: the last sync the rate is measured from (loop() only)
+    uint64_t baselineMonotonic = 0;
+    int64_t baselineEpoch = 0;
+
+    uint32_t syncs = 0;
+    uint32_t steps = 0;
+};
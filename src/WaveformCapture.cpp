@@ -0,0 +1,156 @@
+#include "WaveformCapture.h"
+
+#include <string.h>
+
+#include "hal/hal.h"
+
+void WaveformCapture::begin(uint16_t zeroCounts, uint16_t thresholdCounts) {
+    zeroReading.store(zeroCounts, std::memory_order_relaxed);
+    threshold = thresholdCounts;
+    for (uint8_t slot = 0; slot < slotCount; slot++) {
+        freeSlots.push(slot);
+    }
+}
+
+void WaveformCapture::trigger(uint16_t relaysBefore, uint16_t relaysAfter) {
+    relayMasks.store((uint32_t)relaysBefore << 16 | relaysAfter, std::memory_order_relaxed);
+    relayTriggered.store(true, std::memory_order_release);
+}
+
+void WaveformCapture::add(uint16_t raw) {
+    if (active != nullptr) {
+        if (relayTriggered.load(std::memory_order_relaxed) && relayTriggered.exchange(false, std::memory_order_acquire)) {
+            relays = (uint16_t)relayMasks.load(std::memory_order_relaxed);
+            active->relaysAfter = relays; // Inside the window being recorded: no capture of its own
+        }
+        active->samples[active->before + active->after++] = raw;
+        if (active->after == postSamples) {
+            finishedSlots.push(activeSlot); // Never full: there are only slotCount slots
+            active = nullptr;
+            ringFilled = 0; // The ring is stale; the next capture only gets readings from here on
+            quiet = 0;
+        }
+        return;
+    }
+
+    ring[ringHead++ & (preSamples - 1)] = raw;
+    if (ringFilled < preSamples) {
+        ringFilled++;
+    }
+    const int32_t centered = (int32_t)raw - zeroReading.load(std::memory_order_relaxed);
+    const bool armed = quiet >= preSamples; // A whole quiet ring since the last spike
+    quiet = (centered > threshold || centered < -(int32_t)threshold) ? 0 : quiet + 1;
+
+    if (relayTriggered.load(std::memory_order_relaxed) && relayTriggered.exchange(false, std::memory_order_acquire)) {
+        const uint32_t masks = relayMasks.load(std::memory_order_relaxed);
+        relays = (uint16_t)masks;
+        start(TriggerRelay, (uint16_t)(masks >> 16), relays);
+    } else if (armed && quiet == 0) {
+        start(TriggerThreshold, relays, relays);
+    }
+}
+
+uint32_t WaveformCapture::captureNow(Trigger trigger) {
+    if (active == nullptr) {
+        start(trigger, relays, relays);
+    }
+    return active != nullptr ? active->id.load(std::memory_order_relaxed) : 0;
+}
+
+// Freeze the ring into a free slot and record the rest of the window after it
+void WaveformCapture::start(Trigger trigger, uint16_t relaysBefore, uint16_t relaysAfter) {
+    uint8_t slot;
+    if (!freeSlots.pop(slot)) {
+        missedCaptures.fetch_add(1, std::memory_order_relaxed); // loop() still holds every slot
+        return;
+    }
+    Capture &capture = slots[slot];
+    capture.id.store(nextId++, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // Readers of the old capture see the new id first
+    capture.trigger = trigger;
+    capture.relaysBefore = relaysBefore;
+    capture.relaysAfter = relaysAfter;
+    capture.triggerMicros = hal::monotonicMicros();
+    capture.before = ringFilled;
+    capture.after = 0;
+    for (uint32_t i = 0; i < ringFilled; i++) {
+        capture.samples[i] = ring[(ringHead - ringFilled + i) & (preSamples - 1)];
+    }
+    counts[trigger].fetch_add(1, std::memory_order_relaxed);
+    active = &capture;
+    activeSlot = slot;
+}
+
+const WaveformCapture::Capture *WaveformCapture::take() {
+    uint8_t slot;
+    if (!finishedSlots.pop(slot)) {
+        return nullptr;
+    }
+    return &slots[slot];
+}
+
+void WaveformCapture::release(const Capture *capture) {
+    freeSlots.push((uint8_t)(capture - slots));
+}
+
+void CaptureBinaryEncoder::begin(const WaveformCapture::Capture &capture, uint16_t zeroCounts, const CaptureBinInfo &info) {
+    source = &capture;
+    id = capture.id.load(std::memory_order_relaxed);
+    nextReading = 0;
+    readingCount = capture.before + capture.after;
+    headerOffset = 0;
+
+    uint8_t *out = header;
+    memcpy(out, "BCAP", 4);
+    out[4] = captureBinVersion;
+    out[5] = captureBinHeaderBytes;
+    out[6] = capture.trigger;
+    out[7] = 12;
+    const uint16_t words[] = {capture.before, capture.after, info.baseRateHz, info.burstRateHz,
+                              zeroCounts, capture.relaysBefore, capture.relaysAfter, 0};
+    memcpy(out + 8, &id, 4); // The ESP32 and the host are little-endian
+    memcpy(out + 12, &info.epochSeconds, 4);
+    memcpy(out + 16, &info.epochMicros, 4);
+    memcpy(out + 20, words, sizeof(words));
+    memcpy(out + 36, &info.countsPerAmp, 4);
+}
+
+size_t CaptureBinaryEncoder::read(char *buffer, size_t capacity) {
+    uint8_t *out = reinterpret_cast<uint8_t *>(buffer);
+    uint8_t *end = out + capacity;
+    if (headerOffset < captureBinHeaderBytes) {
+        size_t length = captureBinHeaderBytes - headerOffset;
+        if (length > capacity) {
+            length = capacity;
+        }
+        memcpy(out, header + headerOffset, length);
+        headerOffset += length;
+        return length;
+    }
+
+    // Whole pairs (three bytes), then a lone last reading (two bytes)
+    const uint16_t *samples = source->samples;
+    while (readingCount - nextReading >= 2 && end - out >= 3) {
+        const uint16_t first = samples[nextReading];
+        const uint16_t second = samples[nextReading + 1];
+        out[0] = (uint8_t)first;
+        out[1] = (uint8_t)((first >> 8 & 0xf) | (second & 0xf) << 4);
+        out[2] = (uint8_t)(second >> 4);
+        out += 3;
+        nextReading += 2;
+    }
+    if (readingCount - nextReading == 1 && end - out >= 2) {
+        out[0] = (uint8_t)samples[nextReading];
+        out[1] = (uint8_t)(samples[nextReading] >> 8 & 0xf);
+        out += 2;
+        nextReading++;
+    }
+
+    // The sampler stamps a new id before it rewrites a released slot; drop what was read if it did
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (source->id.load(std::memory_order_relaxed) != id) {
+        nextReading = readingCount;
+        return 0;
+    }
+    return out - reinterpret_cast<uint8_t *>(buffer);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "Config.h"
+#include "SpscQueue.h"
+
+// Event-triggered capture of raw current readings, for inrush and fault analysis.
+// The current sampler hands every ADC reading to add() from its timer. While idle a reading costs one
+// store into the pre-trigger ring and one compare against the trigger threshold. A trigger (a relay
+// change reported through trigger(), or a reading beyond the threshold after a whole quiet ring)
+// copies the ring into a free slot and records the post-trigger readings after it; recording() tells
+// the sampler to run at the burst rate meanwhile.
+//
+// Slots move between the timer and loop() through two queues (finished ones out, released ones back),
+// so nothing is copied twice or allocated, and a slot is only rewritten after loop() released it.
+class WaveformCapture {
+public:
+    static_assert((CAPTURE_PRE_SAMPLES & (CAPTURE_PRE_SAMPLES - 1)) == 0, "CAPTURE_PRE_SAMPLES must be a power of two");
+    static_assert(CAPTURE_SLOTS >= 2 && CAPTURE_SLOTS <= 4, "CAPTURE_SLOTS must be 2 to 4");
+
+    static const size_t preSamples = CAPTURE_PRE_SAMPLES;
+    static const size_t postSamples = CAPTURE_POST_SAMPLES;
+    static const size_t slotCount = CAPTURE_SLOTS;
+
+    enum Trigger : uint8_t {
+        TriggerRelay,     // Relay change
+        TriggerThreshold, // Reading beyond the threshold
+        TriggerTrip       // Overcurrent trip (OvercurrentTrip)
+    };
+
+    struct Capture {
+        std::atomic<uint32_t> id{0}; // Set before the readings are rewritten, so readers can spot reuse
+        Trigger trigger;
+        uint16_t relaysBefore;       // Relay mask at the trigger
+        uint16_t relaysAfter;        // After the last relay change inside the window
+        uint16_t before;             // Readings before the trigger, at the base rate (fewer after a recent capture)
+        uint16_t after;              // Readings from the trigger on, at the burst rate
+        uint64_t triggerMicros;      // hal::monotonicMicros() at the trigger
+        uint16_t samples[CAPTURE_PRE_SAMPLES + CAPTURE_POST_SAMPLES]; // Raw 12-bit readings, oldest first
+    };
+
+    // Zero-current reading and the distance from it that triggers; call before the sampler starts
+    void begin(uint16_t zeroCounts, uint16_t thresholdCounts);
+
+    // Capture around a relay change (control task). Picked up with the next reading.
+    void trigger(uint16_t relaysBefore, uint16_t relaysAfter);
+
+    // Timer context: one reading, and whether the sampler should run at the burst rate
+    void add(uint16_t raw);
+    bool recording() const { return active != nullptr; }
+
+    // Timer context: make sure a capture covers this moment, the one being recorded or a new one;
+    // returns its id, 0 if no slot was free
+    uint32_t captureNow(Trigger trigger);
+
+    // loop(): next finished capture (nullptr if none), and handing one back for reuse
+    const Capture *take();
+    void release(const Capture *capture);
+    bool finished() const { return finishedSlots.size() > 0; } // Any task: take() has a capture
+
+    uint32_t captured(Trigger trigger) const { return counts[trigger].load(std::memory_order_relaxed); }
+    uint32_t missed() const { return missedCaptures.load(std::memory_order_relaxed); } // No free slot
+
+    uint16_t zero() const { return zeroReading.load(std::memory_order_relaxed); }
+    void setZero(uint16_t zeroCounts) { zeroReading.store(zeroCounts, std::memory_order_relaxed); } // Any task
+
+private:
+    void start(Trigger trigger, uint16_t relaysBefore, uint16_t relaysAfter);
+
+    Capture slots[CAPTURE_SLOTS];
+    SpscQueue<uint8_t, 4> freeSlots;     // loop() -> timer
+    SpscQueue<uint8_t, 4> finishedSlots; // Timer -> loop()
+
+    // Relay trigger from the control task: masks first, then the flag
+    std::atomic<bool> relayTriggered{false};
+    std::atomic<uint32_t> relayMasks{0}; // Before << 16 | after
+
+    // Timer context only
+    uint16_t ring[CAPTURE_PRE_SAMPLES] = {};
+    uint32_t ringHead = 0;  // Readings written to the ring (index of the next one)
+    uint32_t ringFilled = 0; // Readings in the ring since the last capture, up to preSamples
+    uint32_t quiet = 0;     // Consecutive readings within the threshold
+    std::atomic<uint16_t> zeroReading{2048};
+    uint16_t threshold = 0xffff;
+    uint16_t relays = 0;    // Latest relay mask reported by trigger()
+    uint32_t nextId = 1;
+    Capture *active = nullptr; // Slot being recorded
+    uint8_t activeSlot = 0;
+
+    std::atomic<uint32_t> counts[3] = {};
+    std::atomic<uint32_t> missedCaptures{0};
+};
+
+// Binary capture download (/captures/<id>.bin), version 1. All integers are little-endian.
+//
+// Header, captureBinHeaderBytes long (decoders skip any bytes past the fields they know):
+//    0  char[4] magic "BCAP"
+//    4  u8      version (1)
+//    5  u8      header length in bytes
+//    6  u8      trigger: 0 relay change, 1 current threshold, 2 overcurrent trip
+//    7  u8      bits per reading (12)
+//    8  u32     capture id
+//   12  u32     trigger time, epoch seconds (device clock, local time)
+//   16  u32     trigger time, microseconds within that second
+//   20  u16     readings before the trigger, at the base rate
+//   22  u16     readings from the trigger on, at the burst rate
+//   24  u16     base rate in Hz
+//   26  u16     burst rate in Hz
+//   28  u16     zero-current reading
+//   30  u16     relay mask before the trigger (bit n = relay n)
+//   32  u16     relay mask after the trigger
+//   34  u16     reserved, 0
+//   36  f32     readings per ampere
+//
+// Readings follow, oldest first, packed two into three bytes: b0 = r0 & 0xff,
+// b1 = r0 >> 8 | (r1 & 0xf) << 4, b2 = r1 >> 4. An odd last reading takes two bytes (b0, b1).
+// A body that ends early was cut off because the slot was reused while it was being sent.
+
+const uint8_t captureBinVersion = 1;
+const size_t captureBinHeaderBytes = 40;
+
+// Fields of the header that come from outside the capture
+struct CaptureBinInfo {
+    uint32_t epochSeconds;
+    uint32_t epochMicros;
+    uint16_t baseRateHz;
+    uint16_t burstRateHz;
+    float countsPerAmp;
+};
+
+// Resumable encoder for one capture, like HistoryBinaryEncoder: the header, then the readings packed
+// into whatever buffer the caller hands it.
+class CaptureBinaryEncoder {
+public:
+    void begin(const WaveformCapture::Capture &capture, uint16_t zeroCounts, const CaptureBinInfo &info);
+
+    // Copy the next bytes of the body into buffer; returns 0 once it is complete (or the slot was reused)
+    size_t read(char *buffer, size_t capacity);
+
+private:
+    const WaveformCapture::Capture *source = nullptr;
+    uint32_t id = 0;
+    uint8_t header[captureBinHeaderBytes];
+    size_t headerOffset = captureBinHeaderBytes;
+    size_t nextReading = 0;
+    size_t readingCount = 0;
+};
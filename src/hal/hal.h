@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Board services the sketch needs beyond the Arduino API.
+// hal_esp32.cpp implements them with ESP-IDF; host/src/hal_host.cpp implements them on the
+// simulated board, where timers fire as the fake clock advances.
+namespace hal {
+
+typedef void (*TimerCallback)(void *arg);
+
+// Start a periodic timer. The callback runs outside loop() (esp_timer task on the ESP32,
+// inside clock advances on the host) and must be short and non-blocking.
+bool startPeriodicTimer(uint32_t periodMicros, TimerCallback callback, void *arg);
+
+// Change the period of a timer started with the same callback and arg; the next call comes one new
+// period from now. Safe to call from that timer's own callback.
+bool setTimerPeriod(TimerCallback callback, void *arg, uint32_t periodMicros);
+
+// One raw 12-bit ADC conversion; safe to call from a timer callback
+uint16_t readAdc(uint8_t pin);
+
+// Drive several output pins at once: bit n of each mask is GPIO n. Pins in setPins go high and pins
+// in clearPins go low through the set/clear registers (one store per 32-pin bank on the ESP32),
+// so there is no read-modify-write and the cost does not depend on how many pins change.
+void writeOutputs(uint64_t setPins, uint64_t clearPins);
+
+// Raw flash region for the persistent history log: the HISTORY_LOG_PARTITION data partition on the
+// ESP32, a file on the host. NOR semantics: erasing sets a whole sector to 0xff and writes can only
+// clear bits, so every byte is written at most once between erases.
+const size_t flashSectorBytes = 4096;
+size_t flashSize(); // Bytes in the region, 0 if there is none
+bool flashRead(uint32_t offset, void *data, size_t length);
+bool flashWrite(uint32_t offset, const void *data, size_t length);
+bool flashEraseSector(uint32_t offset); // offset must be a multiple of flashSectorBytes
+
+// Small settings that survive a restart, by key (up to 15 characters): NVS on the ESP32, a file on the
+// host (memory only unless the harness opened one). A read fails if the key is missing or was stored
+// with another length. Writes take milliseconds when NVS has to reclaim a page; keep them out of the
+// control task and the timers.
+bool settingsRead(const char *key, void *data, size_t length);
+bool settingsWrite(const char *key, const void *data, size_t length);
+
+// Microseconds since boot from a 64-bit timer (esp_timer on the ESP32, the fake clock on the host).
+// Unlike millis() and micros() it never wraps.
+uint64_t monotonicMicros();
+
+// Free-running cycle counter of the calling core, for timing short intervals (wraps; subtract two
+// readings taken on the same core). cyclesPerMicrosecond() converts to time.
+uint32_t cycleCount();
+uint32_t cyclesPerMicrosecond();
+
+// Heap state: free bytes now, lowest free since boot, largest block that could be allocated
+size_t freeHeap();
+size_t minFreeHeap();
+size_t largestFreeBlock();
+
+// Scale the CPU clock down while every task is blocked, and enter light sleep between wakeups where
+// the build has power management and tickless idle enabled; false if it has not (and on the host)
+bool enablePowerSaving();
+
+typedef void (*TaskStep)(void *arg);
+
+// Run step(arg) every periodMillis in its own task pinned to the given core (FreeRTOS on
+// the ESP32). On the host the task is driven by the fake clock like a periodic timer.
+bool startPeriodicTask(const char *name, TaskStep step, void *arg, uint32_t periodMillis, int core, int priority);
+
+} // namespace hal
@@ -0,0 +1,185 @@
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include "hal.h"
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_pm.h>
+#include <nvs.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <soc/gpio_struct.h>
+
+#include "../Config.h"
+
+namespace hal {
+
+// Timers started so far, so setTimerPeriod() can find them by callback and arg
+struct PeriodicTimer {
+    TimerCallback callback;
+    void *arg;
+    esp_timer_handle_t handle;
+};
+static PeriodicTimer periodicTimers[4];
+static size_t periodicTimerCount = 0;
+
+bool startPeriodicTimer(uint32_t periodMicros, TimerCallback callback, void *arg) {
+    if (periodicTimerCount == sizeof(periodicTimers) / sizeof(periodicTimers[0])) {
+        return false;
+    }
+    esp_timer_create_args_t args = {};
+    args.callback = callback;
+    args.arg = arg;
+    args.dispatch_method = ESP_TIMER_TASK; // Runs in the high-priority esp_timer task, not an ISR
+    args.name = "hal_periodic";
+
+    esp_timer_handle_t timer;
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        return false;
+    }
+    if (esp_timer_start_periodic(timer, periodMicros) != ESP_OK) {
+        esp_timer_delete(timer);
+        return false;
+    }
+    periodicTimers[periodicTimerCount++] = {callback, arg, timer};
+    return true;
+}
+
+bool setTimerPeriod(TimerCallback callback, void *arg, uint32_t periodMicros) {
+    for (size_t i = 0; i < periodicTimerCount; i++) {
+        if (periodicTimers[i].callback == callback && periodicTimers[i].arg == arg) {
+            esp_timer_stop(periodicTimers[i].handle); // Allowed from the timer's own callback
+            return esp_timer_start_periodic(periodicTimers[i].handle, periodMicros) == ESP_OK;
+        }
+    }
+    return false;
+}
+
+uint16_t readAdc(uint8_t pin) {
+    return analogRead(pin);
+}
+
+void writeOutputs(uint64_t setPins, uint64_t clearPins) {
+    // GPIO 0-31 and 32-39 live in separate banks; skip a bank nothing changes in
+    if ((uint32_t)setPins != 0) {
+        GPIO.out_w1ts = (uint32_t)setPins;
+    }
+    if ((uint32_t)clearPins != 0) {
+        GPIO.out_w1tc = (uint32_t)clearPins;
+    }
+    if ((setPins >> 32) != 0) {
+        GPIO.out1_w1ts.val = (uint32_t)(setPins >> 32);
+    }
+    if ((clearPins >> 32) != 0) {
+        GPIO.out1_w1tc.val = (uint32_t)(clearPins >> 32);
+    }
+}
+
+// The sketch's NVS namespace, opened once (the Arduino core has initialised the NVS partition)
+static nvs_handle_t settingsHandle() {
+    static nvs_handle_t handle = 0;
+    static const bool opened = nvs_open("bulb", NVS_READWRITE, &handle) == ESP_OK;
+    return opened ? handle : 0;
+}
+
+bool settingsRead(const char *key, void *data, size_t length) {
+    size_t stored = length;
+    return settingsHandle() != 0 && nvs_get_blob(settingsHandle(), key, data, &stored) == ESP_OK && stored == length;
+}
+
+bool settingsWrite(const char *key, const void *data, size_t length) {
+    return settingsHandle() != 0 && nvs_set_blob(settingsHandle(), key, data, length) == ESP_OK &&
+           nvs_commit(settingsHandle()) == ESP_OK;
+}
+
+uint64_t monotonicMicros() {
+    return esp_timer_get_time();
+}
+
+uint32_t cycleCount() {
+    return ESP.getCycleCount(); // CCOUNT special register, one instruction
+}
+
+uint32_t cyclesPerMicrosecond() {
+    return ESP.getCpuFreqMHz();
+}
+
+size_t freeHeap() {
+    return ESP.getFreeHeap();
+}
+
+size_t minFreeHeap() {
+    return ESP.getMinFreeHeap();
+}
+
+size_t largestFreeBlock() {
+    return ESP.getMaxAllocHeap();
+}
+
+// The history partition, looked up once (see partitions.csv)
+static const esp_partition_t *historyPartition() {
+    static const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTORY_LOG_PARTITION);
+    return partition;
+}
+
+size_t flashSize() {
+    return historyPartition() != nullptr ? historyPartition()->size : 0;
+}
+
+bool flashRead(uint32_t offset, void *data, size_t length) {
+    return historyPartition() != nullptr && esp_partition_read(historyPartition(), offset, data, length) == ESP_OK;
+}
+
+bool flashWrite(uint32_t offset, const void *data, size_t length) {
+    return historyPartition() != nullptr && esp_partition_write(historyPartition(), offset, data, length) == ESP_OK;
+}
+
+bool flashEraseSector(uint32_t offset) {
+    return historyPartition() != nullptr &&
+           esp_partition_erase_range(historyPartition(), offset, flashSectorBytes) == ESP_OK;
+}
+
+bool enablePowerSaving() {
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t config = {};
+    config.max_freq_mhz = ESP.getCpuFreqMHz();
+    config.min_freq_mhz = 80; // APB frequency: the ADC, UART and timers keep their rates
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    config.light_sleep_enable = true; // Only taken while nothing (Wi-Fi included) holds a lock against it
+#endif
+    return esp_pm_configure(&config) == ESP_OK;
+#else
+    return false; // Arduino-ESP32's prebuilt SDK: the idle task still parks the core in WAITI
+#endif
+}
+
+struct PeriodicTask {
+    TaskStep step;
+    void *arg;
+    TickType_t period;
+};
+
+static void periodicTaskLoop(void *param) {
+    PeriodicTask task = *static_cast<PeriodicTask *>(param);
+    delete static_cast<PeriodicTask *>(param);
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        task.step(task.arg);
+        vTaskDelayUntil(&lastWake, task.period); // Fixed cadence regardless of step duration
+    }
+}
+
+bool startPeriodicTask(const char *name, TaskStep step, void *arg, uint32_t periodMillis, int core, int priority) {
+    PeriodicTask *task = new PeriodicTask{step, arg, pdMS_TO_TICKS(periodMillis) ? pdMS_TO_TICKS(periodMillis) : 1};
+    if (xTaskCreatePinnedToCore(periodicTaskLoop, name, 4096, task, priority, nullptr, core) != pdPASS) {
+        delete task;
+        return false;
+    }
+    return true;
+}
+
+} // namespace hal
+
+#endif // ARDUINO_ARCH_ESP32
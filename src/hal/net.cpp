@@ -0,0 +1,150 @@
+#include "net.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_timer.h>
+#include <esp_vfs_eventfd.h>
+#include <lwip/sockets.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <atomic>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // lwIP never raises SIGPIPE
+#endif
+
+namespace hal {
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+int listenTcp(uint16_t port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, backlog) != 0 || !setNonBlocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int acceptClient(int listenFd) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+        return -1;
+    }
+    if (!setNonBlocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // Messages are small, send them now
+    return fd;
+}
+
+long sendSome(int fd, const void *data, size_t length) {
+    long sent = send(fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+        return wouldBlock() ? 0 : -1;
+    }
+    return sent;
+}
+
+long receiveSome(int fd, void *buffer, size_t capacity) {
+    if (capacity == 0) {
+        return 0;
+    }
+    long received = recv(fd, buffer, capacity, MSG_DONTWAIT);
+    if (received == 0) {
+        return -1; // Orderly shutdown by the peer
+    }
+    if (received < 0) {
+        return wouldBlock() ? 0 : -1;
+    }
+    return received;
+}
+
+void closeSocket(int fd) {
+    close(fd);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// wakeLoop() writes an eventfd that select() watches with the sockets (VFS select covers both).
+// Only the first wake between two waits writes it; later ones find wakePending already set.
+static int wakeFd = -1;
+static std::atomic<bool> wakePending{false};
+static std::atomic<uint32_t> wakeMicros{0};
+
+static int wakeDescriptor() {
+    if (wakeFd < 0) {
+        esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+        esp_vfs_eventfd_register(&config); // Fails harmlessly if it is registered already
+        wakeFd = eventfd(0, 0);
+    }
+    return wakeFd;
+}
+
+void wakeLoop() {
+    if (wakeFd < 0 || wakePending.exchange(true, std::memory_order_acq_rel)) {
+        return; // Not waiting yet (loop() is running anyway), or already woken
+    }
+    wakeMicros.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    const uint64_t one = 1;
+    write(wakeFd, &one, sizeof(one));
+}
+
+WakeReason waitForEvent(const WaitSocket *sockets, size_t count, uint32_t timeoutMicros, uint32_t &signalMicros) {
+    const int signalFd = wakeDescriptor();
+    fd_set readable;
+    fd_set writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    int highest = -1;
+    if (signalFd >= 0) {
+        FD_SET(signalFd, &readable);
+        highest = signalFd;
+    }
+    for (size_t i = 0; i < count; i++) {
+        FD_SET(sockets[i].fd, sockets[i].writable ? &writable : &readable);
+        highest = sockets[i].fd > highest ? sockets[i].fd : highest;
+    }
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMicros / 1000000;
+    timeout.tv_usec = timeoutMicros % 1000000;
+    const int ready = select(highest + 1, &readable, &writable, nullptr, &timeout);
+    if (ready > 0 && signalFd >= 0 && FD_ISSET(signalFd, &readable)) {
+        uint64_t wakes;
+        read(signalFd, &wakes, sizeof(wakes)); // Resets the counter
+        signalMicros = wakeMicros.load(std::memory_order_relaxed);
+        wakePending.store(false, std::memory_order_release);
+        return WakeSignal;
+    }
+    return ready > 0 ? WakeSocket : WakeTimeout;
+}
+#endif
+
+} // namespace hal
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Non-blocking TCP sockets for the HTTP server and event stream: lwIP on the ESP32, POSIX on the host.
+// The socket headers stay in net.cpp because lwIP may define send()/recv()/close() as macros.
+namespace hal {
+
+// Non-blocking TCP listener on all interfaces; returns -1 on failure
+int listenTcp(uint16_t port, int backlog);
+
+// Next pending connection, already non-blocking with Nagle off; -1 if none is waiting
+int acceptClient(int listenFd);
+
+// Send what the socket takes now: bytes sent, 0 if it would block, -1 if the peer is gone
+long sendSome(int fd, const void *data, size_t length);
+
+// Receive what has arrived: bytes read, 0 if nothing yet, -1 if the peer closed or reset
+long receiveSome(int fd, void *buffer, size_t capacity);
+
+void closeSocket(int fd);
+
+// What loop() waits on between its deadlines
+struct WaitSocket {
+    int fd;
+    bool writable; // Room to send; otherwise input (or a pending connection, or the peer closing)
+};
+
+enum WakeReason : uint8_t {
+    WakeTimeout, // The deadline passed
+    WakeSocket,  // One of the sockets is ready
+    WakeSignal   // wakeLoop() was called
+};
+
+// Block loop() until one of the sockets is ready, wakeLoop() is called or timeoutMicros pass, so the
+// core idles instead of spinning. On WakeSignal, signalMicros is the low 32 bits of monotonicMicros()
+// at the first wakeLoop() since the last wait. The ESP32 waits in select() (net.cpp); the host polls
+// the sockets and, once hostSetTickless() is on, moves the fake clock to the deadline (hal_host.cpp).
+WakeReason waitForEvent(const WaitSocket *sockets, size_t count, uint32_t timeoutMicros, uint32_t &signalMicros);
+
+// Cut the current (or next) waitForEvent() short; any task or timer callback may call it
+void wakeLoop();
+
+} // namespace hal
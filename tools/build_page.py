@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Minify and gzip web/index.html into src/MainPage.h.
+
+The generated header holds the compressed page as a PROGMEM byte array plus a strong
+ETag derived from its contents. Run this after editing web/index.html and commit both
+files; the Arduino IDE has no pre-build step, so the header is checked in.
+
+    python3 tools/build_page.py            # regenerate src/MainPage.h
+    python3 tools/build_page.py --check    # fail if src/MainPage.h is out of date
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "web", "index.html")
+OUTPUT = os.path.join(ROOT, "src", "MainPage.h")
+
+
+def minify_css(css):
+    css = re.sub(r"/\*.*?\*/", "", css, flags=re.S)
+    css = re.sub(r"\s+", " ", css)
+    css = re.sub(r"\s*([{};,])\s*", r"\1", css)
+    css = re.sub(r":\s+", ":", css)
+    return css.replace(";}", "}").strip()
+
+
+def strip_js_comment(line):
+    """Drop a // comment unless the // sits inside a string or template literal."""
+    quote = None
+    i = 0
+    while i < len(line):
+        c = line[i]
+        if quote:
+            if c == "\\":
+                i += 1
+            elif c == quote:
+                quote = None
+        elif c in "'\"`":
+            quote = c
+        elif line.startswith("//", i):
+            return line[:i].rstrip()
+        i += 1
+    return line
+
+
+def minify_js(js):
+    # Keep line breaks so automatic semicolon insertion behaves exactly as before
+    lines = (strip_js_comment(line).strip() for line in js.splitlines())
+    return "\n".join(line for line in lines if line)
+
+
+def minify_html(html):
+    html = re.sub(r"<!--.*?-->", "", html, flags=re.S)
+    html = re.sub(r"(<style[^>]*>)(.*?)(</style>)",
+                  lambda m: m.group(1) + minify_css(m.group(2)) + m.group(3), html, flags=re.S)
+    html = re.sub(r"(<script[^>]*>)(.*?)(</script>)",
+                  lambda m: m.group(1) + "\n" + minify_js(m.group(2)) + "\n" + m.group(3), html, flags=re.S)
+    lines = (line.strip() for line in html.splitlines())
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def render_header(source, minified, compressed):
+    etag = hashlib.sha256(compressed).hexdigest()[:16]
+    rows = []
+    for offset in range(0, len(compressed), 16):
+        rows.append("    " + ", ".join("0x%02x" % b for b in compressed[offset:offset + 16]) + ",")
+    return "\n".join([
+        "#pragma once",
+        "",
+        "// Generated by tools/build_page.py from web/index.html. Do not edit.",
+        "// %d bytes of HTML, %d minified, %d gzipped." % (len(source), len(minified), len(compressed)),
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "const uint8_t MAIN_PAGE_GZ[] PROGMEM = {",
+        *rows,
+        "};",
+        "",
+        "const size_t MAIN_PAGE_GZ_LENGTH = sizeof(MAIN_PAGE_GZ);",
+        "const char MAIN_PAGE_ETAG[] = \"\\\"%s\\\"\"; // Strong validator: hash of the gzipped bytes" % etag,
+        "",
+    ])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--check", action="store_true", help="verify that the generated header is up to date")
+    args = parser.parse_args()
+
+    with open(SOURCE, "rb") as f:
+        source = f.read()
+    minified = minify_html(source.decode("utf-8")).encode("utf-8")
+    compressed = gzip.compress(minified, compresslevel=9, mtime=0) # mtime 0 keeps the output reproducible
+    header = render_header(source, minified, compressed)
+
+    if args.check:
+        with open(OUTPUT) as f:
+            if f.read() != header:
+                sys.exit("%s is out of date; run tools/build_page.py" % os.path.relpath(OUTPUT, ROOT))
+        return
+
+    with open(OUTPUT, "w") as f:
+        f.write(header)
+    print("%s: %d -> %d -> %d bytes" % (os.path.relpath(OUTPUT, ROOT), len(source), len(minified), len(compressed)))
+
+
+if __name__ == "__main__":
+    main()